@@ -0,0 +1,90 @@
+#ifndef __APPLICATIONOPTIONS_H__
+#define __APPLICATIONOPTIONS_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tut {
+
+/*
+	What the swapchain is tuned for. LowLatency prefers IMMEDIATE and keeps
+	one frame in flight, Throughput prefers MAILBOX with deep queues, and
+	PowerSave sticks to vsynced FIFO with the fewest images.
+*/
+enum class PresentPolicy {
+	LowLatency,
+	Throughput,
+	PowerSave
+};
+
+struct ApplicationOptions {
+	PresentPolicy	Presentation		= PresentPolicy::Throughput;
+	//Frames the CPU may record ahead of the GPU in a window, clamped to 1-3. Zero lets the present policy decide.
+	uint32_t		FramesInFlight		= 0;
+	//Per frame acquire, submit and present timings are written here on exit when set
+	std::string		PresentLogPath;
+	//Resize the window every frame for this many seconds, then exit
+	uint32_t		ResizeStressSeconds	= 0;
+
+	//Validation message severities written to stderr, see DebugMessenger::ParseSeverities
+	VkDebugUtilsMessageSeverityFlagsEXT	DebugSeverities	= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+
+	//Device to render on, by index or part of its name, instead of the best scoring one
+	std::string		PreferredDevice;
+
+	//Run the init stages one after another on the main thread, to compare against the task graph
+	bool			SerialInit			= false;
+
+	//Mesh file to draw instead of the triangle, see MeshFile
+	std::string		MeshPath;
+
+	//Texture files streamed onto the bindless draws, one per draw in turn, see TextureFile
+	std::vector<std::string>	TexturePaths;
+	//Device memory the streamed textures may keep resident
+	uint32_t		TextureBudgetMB		= 64;
+
+	//Stream this many megabytes through the upload queue, a chunk per frame, and report bandwidth and frame times
+	uint32_t		StreamUploadMB		= 0;
+
+	//GPU timestamps and CPU scopes are written here as a Chrome trace on exit when set
+	std::string		ProfilePath;
+
+	//Threads recording the draw list into secondary command buffers, zero records inline on the main thread
+	uint32_t		RecordThreads		= 0;
+	//Triangle instances drawn per frame, laid out on a grid, one draw each unless CullOnGpu
+	uint32_t		DrawsPerFrame		= 1;
+	//Cull the instances in a compute pass and draw the visible ones with one indirect draw per batch
+	bool			CullOnGpu			= false;
+	//Time per object against GPU culled drawing at several instance counts instead of rendering frames
+	bool			CullingBenchmark	= false;
+	//Per object draws find their instances through the bindless table, pushing its index per draw, where descriptor indexing is supported
+	bool			Bindless			= false;
+	//Time binding per draw with a set from the frame's pools against the bindless table instead of rendering frames
+	bool			DescriptorBenchmark	= false;
+	//Time recording this many draws on 1 to RecordThreads threads instead of rendering frames
+	uint32_t		RecordingBenchmarkDraws	= 0;
+	//Compile and execute a deferred style render graph and print its schedule instead of rendering frames
+	bool			RenderGraphBenchmark	= false;
+	//Run the device memory allocator traces on the device instead of rendering frames
+	bool			DeviceMemoryBenchmark	= false;
+	//Print the compiled frame graph schedule with the exit report
+	bool			PrintRenderGraph	= false;
+
+	//Render into offscreen images without GLFW, a surface or a swapchain
+	bool			Headless			= false;
+	uint32_t		HeadlessFrames		= 1000;
+
+	//Staging buffers in the readback ring, also the number of headless frames in flight
+	uint32_t		ReadbackDepth		= 3;
+	//Finished frames are written here when set, as PPM unless RawOutput
+	std::string		OutputDirectory;
+	bool			RawOutput			= false;
+	//Threads encoding and writing frames, zero means one per hardware thread
+	uint32_t		WriterThreads		= 0;
+};
+
+}
+
+#endif // !__APPLICATIONOPTIONS_H__
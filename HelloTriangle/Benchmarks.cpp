@@ -0,0 +1,907 @@
+#include "Benchmarks.h"
+#include "BuddyAllocator.h"
+#include "DeviceMemoryAllocator.h"
+#include "HostAllocator.h"
+#include "VKHandle.h"
+#include "VKWrapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tut {
+
+namespace {
+
+const uint32_t		HANDLE_ITERATIONS{ 1000000 };
+const uint32_t		MEMORY_TRACE_OPERATIONS{ 200000 };
+const uint32_t		TRANSIENT_TRACE_FRAMES{ 10000 };
+const uint32_t		TRANSIENT_ALLOCATIONS_PER_FRAME{ 500 };
+const uint32_t		ALLOCATOR_TRACE_OPERATIONS{ 20000 };
+const uint64_t		ALLOCATOR_TRACE_LIVE_BYTES{ 128ull * 1024 * 1024 };
+const uint32_t		ALLOCATOR_TRACE_DEDICATED{ 2 };		//Live dedicated allocations at most
+const uint32_t		ALLOCATOR_TRACE_FRAME_SLOTS{ 3 };
+const uint32_t		ALLOCATOR_TRACE_FRAMES{ 1000 };
+const uint32_t		ALLOCATOR_TRACE_TRANSIENTS{ 200 };	//Per frame
+const uint32_t		DEFRAGMENT_TRACE_BLOCKS{ 3 };		//Filled with buffers, then three in four buffers are freed
+const uint32_t		DEFRAGMENT_TRACE_MOVES{ 64 };		//Per pass
+const VkDeviceSize	FAKE_HEAP_SIZE{ 8ull * 1024 * 1024 * 1024 };
+const VkDeviceSize	FAKE_BUFFER_IMAGE_GRANULARITY{ 64 * 1024 };
+const VkDeviceSize	FAKE_BUFFER_ALIGNMENT{ 256 };
+const uint32_t		FAKE_DEVICE_LOCAL_TYPE{ 0 };
+const uint32_t		FAKE_HOST_VISIBLE_TYPE{ 1 };
+volatile uint64_t	s_destroyCount{ 0 };
+
+struct TraceAllocation {
+	DeviceAllocation*	Allocation;
+	DeviceResourceKind	Kind;
+	bool				Dedicated;
+};
+
+//Live allocations by memory and offset
+typedef std::map<std::pair<VkDeviceMemory, VkDeviceSize>, TraceAllocation> PlacementMap;
+
+/*
+	What the allocator traces run on, a real device or the fake one below.
+	Only the fake device knows the size of each VkDeviceMemory.
+*/
+struct TraceDevice {
+	typedef VkDeviceSize ( *MemorySizeFunction )( VkDeviceMemory memory );
+
+	VkDevice			Device			= VK_NULL_HANDLE;
+	DeviceMemoryBackend	Backend;
+	PFN_vkCreateBuffer	CreateBuffer	= nullptr;
+	PFN_vkDestroyBuffer	DestroyBuffer	= nullptr;
+	MemorySizeFunction	MemorySize		= nullptr;
+};
+
+struct TraceBuffer {
+	const TraceDevice*	Device;
+	VkBuffer			Buffer	= VK_NULL_HANDLE;
+	DeviceAllocation*	Memory	= nullptr;
+	VkDeviceSize		Size	= 0;
+	uint32_t			Seed	= 0;
+
+	explicit			TraceBuffer( const TraceDevice& device ) : Device( &device ) {}
+						~TraceBuffer( void ) { Destroy(); }
+
+	TraceBuffer( const TraceBuffer& ) = delete;
+	TraceBuffer& operator=( const TraceBuffer& ) = delete;
+
+	void				Destroy( void ) {
+		if ( Buffer != VK_NULL_HANDLE ) {
+			Device->DestroyBuffer( Device->Device, Buffer, HostAllocator::Installed() );
+			Buffer = VK_NULL_HANDLE;
+		}
+	}
+};
+
+//The fake device's memory objects and buffers, a handle is the address of its storage
+struct FakeMemory {
+	std::unique_ptr<uint8_t[]>	Data;		//Only host visible memory gets the whole size
+	VkDeviceSize				Size;
+	uint32_t					MemoryTypeIndex;
+};
+
+struct FakeBuffer {
+	VkDeviceSize		Size;
+	VkDeviceMemory		Memory;
+};
+
+std::unordered_map<VkDeviceMemory, FakeMemory>					s_fakeMemory;
+std::unordered_map<VkBuffer, std::unique_ptr<FakeBuffer>>		s_fakeBuffers;
+uint64_t														s_fakeErrors{ 0 };
+
+/*
+===============
+FakeDestroyDevice
+
+	Stand-in for vkDestroyDevice so the benchmark measures only the wrapper
+===============
+*/
+VKAPI_ATTR void VKAPI_CALL FakeDestroyDevice( VkDevice /*device*/, const VkAllocationCallbacks* /*pAllocator*/ ) {
+	s_destroyCount = s_destroyCount + 1;
+}
+/*
+===============
+FakeDestroyImageView
+
+	Stand-in for vkDestroyImageView so the benchmark measures only the wrapper
+===============
+*/
+VKAPI_ATTR void VKAPI_CALL FakeDestroyImageView( VkDevice /*device*/, VkImageView /*imageView*/, const VkAllocationCallbacks* /*pAllocator*/ ) {
+	s_destroyCount = s_destroyCount + 1;
+}
+/*
+===============
+FakeAllocateMemory
+
+	Stand-in for vkAllocateMemory, backing host visible memory with host
+	memory so it can be mapped
+===============
+*/
+VKAPI_ATTR VkResult VKAPI_CALL FakeAllocateMemory( VkDevice, const VkMemoryAllocateInfo* allocateInfo, const VkAllocationCallbacks*, VkDeviceMemory* memory ) {
+	FakeMemory	fake;
+	size_t		storage = allocateInfo->memoryTypeIndex == FAKE_HOST_VISIBLE_TYPE ? ( size_t )allocateInfo->allocationSize : 1;
+
+	if ( allocateInfo->allocationSize == 0 || allocateInfo->memoryTypeIndex > FAKE_HOST_VISIBLE_TYPE ) {
+		++s_fakeErrors;
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	fake.Data				= std::unique_ptr<uint8_t[]>( new uint8_t[ storage ] );
+	fake.Size				= allocateInfo->allocationSize;
+	fake.MemoryTypeIndex	= allocateInfo->memoryTypeIndex;
+	*memory					= ( VkDeviceMemory )( uintptr_t )fake.Data.get();
+
+	s_fakeMemory[ *memory ] = std::move( fake );
+
+	return VK_SUCCESS;
+}
+/*
+===============
+FakeFreeMemory
+
+	Stand-in for vkFreeMemory
+===============
+*/
+VKAPI_ATTR void VKAPI_CALL FakeFreeMemory( VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks* ) {
+	if ( s_fakeMemory.erase( memory ) == 0 ) {
+		++s_fakeErrors;
+	}
+}
+/*
+===============
+FakeMapMemory
+
+	Stand-in for vkMapMemory, only host visible memory can be mapped
+===============
+*/
+VKAPI_ATTR VkResult VKAPI_CALL FakeMapMemory( VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void** data ) {
+	std::unordered_map<VkDeviceMemory, FakeMemory>::iterator fake = s_fakeMemory.find( memory );
+
+	if ( fake == s_fakeMemory.end() || fake->second.MemoryTypeIndex != FAKE_HOST_VISIBLE_TYPE || offset >= fake->second.Size ) {
+		++s_fakeErrors;
+		return VK_ERROR_MEMORY_MAP_FAILED;
+	}
+
+	*data = fake->second.Data.get() + offset;
+
+	return VK_SUCCESS;
+}
+/*
+===============
+FakeCreateBuffer
+
+	Stand-in for vkCreateBuffer
+===============
+*/
+VKAPI_ATTR VkResult VKAPI_CALL FakeCreateBuffer( VkDevice, const VkBufferCreateInfo* createInfo, const VkAllocationCallbacks*, VkBuffer* buffer ) {
+	std::unique_ptr<FakeBuffer> fake = std::make_unique<FakeBuffer>();
+
+	fake->Size		= createInfo->size;
+	fake->Memory	= VK_NULL_HANDLE;
+	*buffer			= ( VkBuffer )( uintptr_t )fake.get();
+
+	s_fakeBuffers[ *buffer ] = std::move( fake );
+
+	return VK_SUCCESS;
+}
+/*
+===============
+FakeDestroyBuffer
+
+	Stand-in for vkDestroyBuffer
+===============
+*/
+VKAPI_ATTR void VKAPI_CALL FakeDestroyBuffer( VkDevice, VkBuffer buffer, const VkAllocationCallbacks* ) {
+	if ( s_fakeBuffers.erase( buffer ) == 0 ) {
+		++s_fakeErrors;
+	}
+}
+/*
+===============
+FakeGetBufferMemoryRequirements
+
+	Stand-in for vkGetBufferMemoryRequirements, any memory type will do
+===============
+*/
+VKAPI_ATTR void VKAPI_CALL FakeGetBufferMemoryRequirements( VkDevice, VkBuffer buffer, VkMemoryRequirements* requirements ) {
+	requirements->size				= s_fakeBuffers.at( buffer )->Size;
+	requirements->alignment			= FAKE_BUFFER_ALIGNMENT;
+	requirements->memoryTypeBits	= ( 1u << FAKE_DEVICE_LOCAL_TYPE ) | ( 1u << FAKE_HOST_VISIBLE_TYPE );
+}
+/*
+===============
+FakeBindBufferMemory
+
+	Stand-in for vkBindBufferMemory, failing where the validation layers
+	would complain
+===============
+*/
+VKAPI_ATTR VkResult VKAPI_CALL FakeBindBufferMemory( VkDevice, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset ) {
+	std::unordered_map<VkBuffer, std::unique_ptr<FakeBuffer>>::iterator	fakeBuffer	= s_fakeBuffers.find( buffer );
+	std::unordered_map<VkDeviceMemory, FakeMemory>::iterator			fakeMemory	= s_fakeMemory.find( memory );
+
+	if ( fakeBuffer == s_fakeBuffers.end() || fakeMemory == s_fakeMemory.end() || fakeBuffer->second->Memory != VK_NULL_HANDLE ||
+		offset % FAKE_BUFFER_ALIGNMENT != 0 || offset > fakeMemory->second.Size || fakeBuffer->second->Size > fakeMemory->second.Size - offset ) {
+		++s_fakeErrors;
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+	fakeBuffer->second->Memory = memory;
+
+	return VK_SUCCESS;
+}
+/*
+===============
+FakeMemorySize
+
+	Returns the size a fake VkDeviceMemory was allocated with
+===============
+*/
+VkDeviceSize FakeMemorySize( VkDeviceMemory memory ) {
+	return s_fakeMemory.at( memory ).Size;
+}
+/*
+===============
+FakeCapabilities
+
+	A device with one device local and one host visible memory type, each
+	on a heap of its own, and a coarse bufferImageGranularity so
+	conflicts between resource kinds show up
+===============
+*/
+DeviceCapabilities FakeCapabilities( void ) {
+	DeviceCapabilities capabilities;
+
+	capabilities.Properties	= {};
+	capabilities.Features	= {};
+	capabilities.Memory		= {};
+
+	capabilities.Properties.limits.maxMemoryAllocationCount	= 4096;
+	capabilities.Properties.limits.bufferImageGranularity	= FAKE_BUFFER_IMAGE_GRANULARITY;
+
+	capabilities.Memory.memoryHeapCount				= 2;
+	capabilities.Memory.memoryHeaps[ 0 ].size		= FAKE_HEAP_SIZE;
+	capabilities.Memory.memoryHeaps[ 0 ].flags		= VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+	capabilities.Memory.memoryHeaps[ 1 ].size		= FAKE_HEAP_SIZE;
+
+	capabilities.Memory.memoryTypeCount										= 2;
+	capabilities.Memory.memoryTypes[ FAKE_DEVICE_LOCAL_TYPE ].propertyFlags	= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	capabilities.Memory.memoryTypes[ FAKE_DEVICE_LOCAL_TYPE ].heapIndex		= 0;
+	capabilities.Memory.memoryTypes[ FAKE_HOST_VISIBLE_TYPE ].propertyFlags	= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	capabilities.Memory.memoryTypes[ FAKE_HOST_VISIBLE_TYPE ].heapIndex		= 1;
+
+	return capabilities;
+}
+/*
+===============
+FakeImageView
+
+	Returns a unique non-null handle value for iteration i
+===============
+*/
+VkImageView FakeImageView( uint32_t i ) {
+	return ( VkImageView )( uintptr_t )( i + 1 );
+}
+/*
+===============
+ReportTiming
+
+	Prints the per-iteration cost of a benchmark run
+===============
+*/
+void ReportTiming( const char* name, std::chrono::high_resolution_clock::duration elapsed ) {
+	double totalNs = ( double )std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count();
+
+	std::cout << "  " << name << ": " << totalNs / HANDLE_ITERATIONS << " ns per create/destroy" << std::endl;
+}
+/*
+===============
+CheckPlacement
+
+	Returns false when an allocation overlaps a live one in the same memory,
+	or shares a bufferImageGranularity page with one of the other kind
+===============
+*/
+bool CheckPlacement( const PlacementMap& placements, const DeviceAllocation& allocation, DeviceResourceKind kind, VkDeviceSize granularity ) {
+	PlacementMap::const_iterator	next		= placements.lower_bound( std::make_pair( allocation.Memory, allocation.Offset ) );
+	VkDeviceSize					firstPage	= allocation.Offset / granularity;
+	VkDeviceSize					lastPage	= ( allocation.Offset + allocation.Size - 1 ) / granularity;
+
+	for ( PlacementMap::const_iterator after = next; after != placements.end() && after->first.first == allocation.Memory; ++after ) {
+		if ( after->first.second < allocation.Offset + allocation.Size ) {
+			return false;
+		}
+
+		if ( after->first.second / granularity > lastPage ) {
+			break;
+		}
+
+		if ( after->second.Kind != kind ) {
+			return false;
+		}
+	}
+
+	//Live allocations don't overlap, so their ends are in offset order too
+	for ( PlacementMap::const_iterator before = next; before != placements.begin(); ) {
+		--before;
+
+		if ( before->first.first != allocation.Memory ) {
+			break;
+		}
+
+		VkDeviceSize end = before->first.second + before->second.Allocation->Size;
+
+		if ( end > allocation.Offset ) {
+			return false;
+		}
+
+		if ( ( end - 1 ) / granularity < firstPage ) {
+			break;
+		}
+
+		if ( before->second.Kind != kind ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+/*
+===============
+CheckDedicated
+
+	Returns false when a dedicated allocation shares its memory with another
+	live allocation
+===============
+*/
+bool CheckDedicated( const PlacementMap& placements, const DeviceAllocation& allocation, bool dedicated ) {
+	PlacementMap::const_iterator first = placements.lower_bound( std::make_pair( allocation.Memory, ( VkDeviceSize )0 ) );
+
+	if ( first == placements.end() || first->first.first != allocation.Memory ) {
+		return true;
+	}
+
+	return !dedicated && !first->second.Dedicated;
+}
+/*
+===============
+FillPattern
+
+	Writes a pattern derived from seed over a mapped range
+===============
+*/
+void FillPattern( void* mapped, VkDeviceSize size, uint32_t seed ) {
+	uint32_t* words = ( uint32_t* )mapped;
+
+	for ( VkDeviceSize i = 0; i < size / sizeof( uint32_t ); ++i ) {
+		words[ i ] = seed * 2654435761u + ( uint32_t )i;
+	}
+}
+/*
+===============
+CheckPattern
+
+	Returns if a mapped range still holds the pattern FillPattern wrote
+===============
+*/
+bool CheckPattern( const void* mapped, VkDeviceSize size, uint32_t seed ) {
+	const uint32_t* words = ( const uint32_t* )mapped;
+
+	for ( VkDeviceSize i = 0; i < size / sizeof( uint32_t ); ++i ) {
+		if ( words[ i ] != seed * 2654435761u + ( uint32_t )i ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+/*
+===============
+CreateTraceBuffer
+
+	Creates the buffer and, unless it is bound already, allocates memory for
+	it; once memory is given it is bound at the allocation's current place
+===============
+*/
+void CreateTraceBuffer( const TraceDevice& trace, DeviceMemoryAllocator& allocator, TraceBuffer& buffer ) {
+	VkBufferCreateInfo bufferInfo = {};
+
+	bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size			= buffer.Size;
+	bufferInfo.usage		= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+	buffer.Destroy();
+
+	if ( trace.CreateBuffer( trace.Device, &bufferInfo, HostAllocator::Installed(), &buffer.Buffer ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create benchmark buffer" );
+	}
+
+	if ( buffer.Memory == nullptr ) {
+		buffer.Memory = allocator.AllocateForBuffer( buffer.Buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0 );
+	} else if ( trace.Backend.BindBufferMemory( trace.Device, buffer.Buffer, buffer.Memory->Memory, buffer.Memory->Offset ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not bind benchmark buffer" );
+	}
+}
+
+/*
+===============
+RunAllocatorTraces
+
+	Drives a DeviceMemoryAllocator of its own on trace's device with
+	synthetic traces: requests either side of the dedicated threshold;
+	pooled allocations of both resource kinds with the occasional dedicated
+	one, freed at random; a frame loop of transient allocations; and
+	buffers filled with a pattern, three in four freed, then defragmented
+	until nothing moves, moving their contents and rebinding them the way
+	an owner has to. Every placement is checked for overlaps,
+	bufferImageGranularity conflicts and dedicated memory shared with
+	others, every buffer for its pattern, and the defragmented blocks for
+	how close they come to the fewest that could hold the buffers.
+===============
+*/
+int RunAllocatorTraces( const DeviceCapabilities& capabilities, const TraceDevice& trace ) {
+	DeviceMemoryAllocator	allocator( capabilities, trace.Device, ALLOCATOR_TRACE_FRAME_SLOTS, trace.Backend );
+	std::mt19937			random( 1234 );
+	VkDeviceSize			blockSize	= allocator.BlockSize();
+	VkDeviceSize			granularity	= std::max<VkDeviceSize>( capabilities.Properties.limits.bufferImageGranularity, 1 );
+
+	std::cout << "  " << blockSize / ( 1024 * 1024 ) << " MB blocks, " << granularity << " byte bufferImageGranularity" << std::endl;
+
+	//Half a block is the largest request sub-allocated, one byte more gets memory of its own
+	const VkDeviceSize thresholdSizes[] = { blockSize / 2, blockSize / 2 + 1 };
+
+	for ( VkDeviceSize size : thresholdSizes ) {
+		VkMemoryRequirements requirements = {};
+
+		requirements.size			= size;
+		requirements.alignment		= 256;
+		requirements.memoryTypeBits	= ~0u;
+
+		DeviceAllocation*	allocation	= allocator.Allocate( requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, DeviceResourceKind::Linear );
+		bool				dedicated	= size > blockSize / 2;
+		VkDeviceSize		memorySize	= trace.MemorySize != nullptr ? trace.MemorySize( allocation->Memory ) : 0;
+
+		if ( allocator.GetStats().DedicatedCount != ( dedicated ? 1u : 0u ) || ( memorySize != 0 && memorySize != ( dedicated ? size : blockSize ) ) ) {
+			std::cerr << "A request of " << size << " bytes was placed in " << ( memorySize != 0 ? memorySize : allocation->Size ) << " bytes of "
+				<< ( allocator.GetStats().DedicatedCount != 0 ? "dedicated" : "pooled" ) << " memory" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		allocator.Free( allocation );
+	}
+
+	PlacementMap					placements;
+	std::vector<TraceAllocation>	live;
+	uint64_t						liveBytes		= 0;
+	uint32_t						liveDedicated	= 0;
+	double							utilization		= 0.0;
+	uint32_t						samples			= 0;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for ( uint32_t i = 0; i < ALLOCATOR_TRACE_OPERATIONS; ++i ) {
+		bool allocate = live.empty() || ( liveBytes < ALLOCATOR_TRACE_LIVE_BYTES && random() % 2 == 0 );
+
+		if ( allocate ) {
+			VkMemoryRequirements	requirements	= {};
+			uint32_t				shape			= random() % 100;
+
+			//Mostly small buffers, some large images and now and then one too big for a block
+			if ( shape == 0 && liveDedicated < ALLOCATOR_TRACE_DEDICATED ) {
+				requirements.size = blockSize / 2 + 1 + random() % ( blockSize / 2 );
+			} else if ( shape < 10 ) {
+				requirements.size = 256 * 1024 + random() % ( blockSize / 2 - 256 * 1024 );
+			} else {
+				requirements.size = 256 + random() % ( 64 * 1024 );
+			}
+
+			requirements.alignment		= 1ull << ( 4 + random() % 9 );
+			requirements.memoryTypeBits	= ~0u;
+
+			DeviceResourceKind	kind		= random() % 2 == 0 ? DeviceResourceKind::Linear : DeviceResourceKind::Optimal;
+			DeviceAllocation*	allocation	= allocator.Allocate( requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, kind );
+			bool				dedicated	= requirements.size > blockSize / 2;
+			bool				wrongMemory	= trace.MemorySize != nullptr && trace.MemorySize( allocation->Memory ) != ( dedicated ? requirements.size : blockSize );
+
+			if ( allocation->Offset % requirements.alignment != 0 || allocation->Size < requirements.size || ( dedicated && allocation->Offset != 0 ) || wrongMemory ||
+				!CheckPlacement( placements, *allocation, kind, granularity ) || !CheckDedicated( placements, *allocation, dedicated ) ) {
+				std::cerr << "Invalid placement of " << requirements.size << " bytes at offset " << allocation->Offset << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			TraceAllocation traced = { allocation, kind, dedicated };
+
+			placements[ std::make_pair( allocation->Memory, allocation->Offset ) ] = traced;
+			live.push_back( traced );
+			liveBytes		+= allocation->Size;
+			liveDedicated	+= dedicated ? 1 : 0;
+		} else {
+			size_t				victim		= random() % live.size();
+			DeviceAllocation*	allocation	= live[ victim ].Allocation;
+
+			liveBytes		-= allocation->Size;
+			liveDedicated	-= allocation->Size > blockSize / 2 ? 1 : 0;
+			placements.erase( std::make_pair( allocation->Memory, allocation->Offset ) );
+			allocator.Free( allocation );
+
+			live[ victim ] = live.back();
+			live.pop_back();
+		}
+
+		if ( i % 1000 == 0 ) {
+			DeviceMemoryStats stats = allocator.GetStats();
+
+			utilization += stats.ReservedBytes > 0 ? ( double )stats.UsedBytes / stats.ReservedBytes : 0.0;
+			++samples;
+		}
+	}
+	std::chrono::high_resolution_clock::duration elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	DeviceMemoryStats stats = allocator.GetStats();
+
+	if ( stats.AllocationCount != live.size() || stats.DedicatedCount != liveDedicated ) {
+		std::cerr << "Allocator counts " << stats.AllocationCount << " allocations and " << stats.DedicatedCount << " dedicated, the trace "
+			<< live.size() << " and " << liveDedicated << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "  pooled: " << std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() / ( double )ALLOCATOR_TRACE_OPERATIONS
+		<< " ns per operation (including validation), " << 100.0 * utilization / samples << "% average block utilization, "
+		<< stats.BlockCount << " blocks and " << stats.DedicatedCount << " dedicated at the end" << std::endl;
+
+	for ( const TraceAllocation& traced : live ) {
+		allocator.Free( traced.Allocation );
+	}
+	live.clear();
+	placements.clear();
+
+	//Transient allocations, each frame checked against the others of its frame
+	std::vector<DeviceAllocation>	transients;
+	uint64_t						warmPages = 0;
+
+	transients.reserve( ALLOCATOR_TRACE_TRANSIENTS );
+
+	start = std::chrono::high_resolution_clock::now();
+	for ( uint32_t frame = 0; frame < ALLOCATOR_TRACE_FRAMES; ++frame ) {
+		allocator.BeginFrame( frame );
+		transients.clear();
+		placements.clear();
+
+		for ( uint32_t i = 0; i < ALLOCATOR_TRACE_TRANSIENTS; ++i ) {
+			VkMemoryRequirements requirements = {};
+
+			requirements.size			= 64 + random() % 16384;
+			requirements.alignment		= 256;
+			requirements.memoryTypeBits	= ~0u;
+
+			DeviceResourceKind kind = random() % 2 == 0 ? DeviceResourceKind::Linear : DeviceResourceKind::Optimal;
+
+			transients.push_back( allocator.AllocateTransient( requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, kind ) );
+
+			const DeviceAllocation& allocation = transients.back();
+
+			if ( allocation.Offset % requirements.alignment != 0 || !CheckPlacement( placements, allocation, kind, granularity ) ) {
+				std::cerr << "Invalid transient placement at offset " << allocation.Offset << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			TraceAllocation traced = { &transients.back(), kind, false };
+
+			placements[ std::make_pair( allocation.Memory, allocation.Offset ) ] = traced;
+		}
+
+		if ( frame == ALLOCATOR_TRACE_FRAME_SLOTS ) {
+			warmPages = allocator.GetStats().TransientPageCount;
+		}
+	}
+	elapsed = std::chrono::high_resolution_clock::now() - start;
+	placements.clear();
+
+	stats = allocator.GetStats();
+
+	if ( stats.TransientPageCount != warmPages ) {
+		std::cerr << "Transient pages grew from " << warmPages << " to " << stats.TransientPageCount << " after every frame slot was used" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "  transient: " << std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() / ( double )( ALLOCATOR_TRACE_FRAMES * ALLOCATOR_TRACE_TRANSIENTS )
+		<< " ns per allocation (including validation), " << stats.TransientPageCount << " pages" << std::endl;
+
+	//Fragment host visible blocks holding buffers, then defragment them
+	const void*											owner	= &allocator;
+	std::vector<std::unique_ptr<TraceBuffer>>			buffers;
+	std::unordered_map<DeviceAllocation*, TraceBuffer*>	byMemory;
+	uint32_t											seed	= 0;
+	uint64_t											blocks	= allocator.GetStats().BlockCount + DEFRAGMENT_TRACE_BLOCKS;
+
+	while ( allocator.GetStats().BlockCount < blocks ) {
+		std::unique_ptr<TraceBuffer> buffer = std::make_unique<TraceBuffer>( trace );
+
+		buffer->Size	= 4 * 1024 + 4 * ( random() % ( 64 * 1024 ) );
+		buffer->Seed	= ++seed;
+		CreateTraceBuffer( trace, allocator, *buffer );
+
+		buffer->Memory->Owner = owner;
+		FillPattern( buffer->Memory->Mapped, buffer->Size, buffer->Seed );
+
+		buffers.push_back( std::move( buffer ) );
+	}
+
+	std::shuffle( buffers.begin(), buffers.end(), random );
+
+	for ( size_t i = buffers.size() / 4; i < buffers.size(); ++i ) {
+		buffers[ i ]->Destroy();
+		allocator.Free( buffers[ i ]->Memory );
+	}
+	buffers.resize( buffers.size() / 4 );
+
+	for ( std::unique_ptr<TraceBuffer>& buffer : buffers ) {
+		byMemory[ buffer->Memory ] = buffer.get();
+	}
+
+	DeviceMemoryStats	before	= allocator.GetStats();
+	uint64_t			moved	= 0;
+	uint32_t			passes	= 0;
+
+	start = std::chrono::high_resolution_clock::now();
+	for ( ;; ) {
+		std::vector<DefragmentationMove> moves = allocator.BeginDefragmentation( owner, DEFRAGMENT_TRACE_MOVES );
+
+		if ( moves.empty() ) {
+			break;
+		}
+
+		//Buffers can't be rebound, each moved one is created again at its new place
+		for ( const DefragmentationMove& move : moves ) {
+			TraceBuffer& buffer = *byMemory.at( move.Allocation );
+
+			memcpy( move.Allocation->Mapped, move.SourceMapped, ( size_t )buffer.Size );
+			CreateTraceBuffer( trace, allocator, buffer );
+		}
+
+		allocator.EndDefragmentation( moves );
+
+		moved += moves.size();
+		++passes;
+	}
+	elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	stats = allocator.GetStats();
+
+	for ( std::unique_ptr<TraceBuffer>& buffer : buffers ) {
+		if ( !CheckPattern( buffer->Memory->Mapped, buffer->Size, buffer->Seed ) ) {
+			std::cerr << "Buffer " << buffer->Seed << " lost its contents in defragmentation" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ( stats.BlockCount > before.BlockCount || stats.AllocationCount != buffers.size() ) {
+		std::cerr << "Defragmentation went from " << before.BlockCount << " to " << stats.BlockCount << " blocks with "
+			<< stats.AllocationCount << " of " << buffers.size() << " allocations left" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	//Buddy rounding can strand a little space per block, but never a whole block's worth
+	uint64_t occupiedBefore	= before.BlockCount - before.EmptyBlockCount;
+	uint64_t occupied		= stats.BlockCount - stats.EmptyBlockCount;
+	uint64_t fewest			= ( stats.UsedBytes + blockSize - 1 ) / blockSize;
+
+	if ( occupied > fewest + 1 || ( occupied > fewest && occupied >= occupiedBefore ) ) {
+		std::cerr << "Defragmentation left the buffers in " << occupied << " blocks, " << fewest << " could hold them" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "  defragmentation: " << moved << " buffers moved in " << passes << " passes, "
+		<< std::chrono::duration_cast<std::chrono::microseconds>( elapsed ).count() / 1000.0 << " ms, buffers in "
+		<< occupiedBefore << " blocks down to " << occupied << ", " << fewest << " at best; "
+		<< before.ReservedBytes / ( 1024 * 1024 ) << " MB reserved down to " << stats.ReservedBytes / ( 1024 * 1024 ) << " MB" << std::endl;
+
+	for ( std::unique_ptr<TraceBuffer>& buffer : buffers ) {
+		buffer->Destroy();
+		allocator.Free( buffer->Memory );
+	}
+
+	return EXIT_SUCCESS;
+}
+
+}
+
+/*
+===============
+Benchmarks::RunHandleBenchmark
+
+	Compares the cost and size of VKWrapper against VKChildHandle
+===============
+*/
+int Benchmarks::RunHandleBenchmark( void ) {
+	typedef VKChildHandle<VkDevice, VkImageView, FakeDestroyImageView> FakeImageViewHandle;
+
+	std::cout << "Handle benchmark (" << HANDLE_ITERATIONS << " iterations)" << std::endl;
+	std::cout << "  sizeof( VKWrapper<VkImageView> ): " << sizeof( VKWrapper<VkImageView> ) << std::endl;
+	std::cout << "  sizeof( VKImageViewHandle ): " << sizeof( VKImageViewHandle ) << std::endl;
+	std::cout << "  sizeof( VKDeviceHandle ): " << sizeof( VKDeviceHandle ) << std::endl;
+
+	VKWrapper<VkDevice> wrappedDevice{ FakeDestroyDevice };
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for ( uint32_t i = 0; i < HANDLE_ITERATIONS; ++i ) {
+		VKWrapper<VkImageView> imageView{ wrappedDevice, FakeDestroyImageView };
+		imageView = FakeImageView( i );
+	}
+	ReportTiming( "VKWrapper", std::chrono::high_resolution_clock::now() - start );
+
+	start = std::chrono::high_resolution_clock::now();
+	for ( uint32_t i = 0; i < HANDLE_ITERATIONS; ++i ) {
+		FakeImageViewHandle imageView{ VK_NULL_HANDLE };
+		*imageView.replace() = FakeImageView( i );
+	}
+	ReportTiming( "VKChildHandle", std::chrono::high_resolution_clock::now() - start );
+
+	if ( s_destroyCount != 2 * HANDLE_ITERATIONS ) {
+		std::cerr << "Unexpected destroy count " << s_destroyCount << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+===============
+Benchmarks::RunDeviceMemoryBenchmark
+
+	Drives the buddy and linear allocators behind DeviceMemoryAllocator with
+	synthetic traces, checking every placement, then runs the allocator
+	traces of RunDeviceAllocatorBenchmark on a fake device. Needs no GPU.
+===============
+*/
+int Benchmarks::RunDeviceMemoryBenchmark( void ) {
+	const uint64_t					blockSize	= 256ull * 1024 * 1024;
+	BuddyAllocator					buddy( blockSize, 256 );
+	std::map<uint64_t, uint64_t>	live;
+	std::vector<uint64_t>			liveOffsets;
+	std::mt19937					random( 1234 );
+	uint64_t						failures	= 0;
+	double							utilization	= 0.0;
+	double							fragmentation = 0.0;
+
+	std::cout << "Device memory benchmark (" << MEMORY_TRACE_OPERATIONS << " operations)" << std::endl;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for ( uint32_t i = 0; i < MEMORY_TRACE_OPERATIONS; ++i ) {
+		//Mostly small buffers with the occasional large image, freed at random
+		bool allocate = live.empty() || random() % 2 == 0;
+
+		if ( allocate ) {
+			uint64_t size		= random() % 10 == 0 ? 256 * 1024 + random() % ( 4 * 1024 * 1024 ) : 256 + random() % ( 64 * 1024 );
+			uint64_t alignment	= 1ull << ( 4 + random() % 9 );
+			uint64_t offset		= buddy.Allocate( size, alignment );
+
+			if ( offset == BuddyAllocator::INVALID_OFFSET ) {
+				++failures;
+				continue;
+			}
+
+			std::map<uint64_t, uint64_t>::iterator next = live.lower_bound( offset );
+			bool overlaps = ( next != live.end() && next->first < offset + size ) ||
+							( next != live.begin() && std::prev( next )->first + std::prev( next )->second > offset );
+
+			if ( offset % alignment != 0 || offset + size > blockSize || overlaps ) {
+				std::cerr << "Invalid placement at offset " << offset << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			live[ offset ] = size;
+			liveOffsets.push_back( offset );
+		} else {
+			size_t victim = random() % liveOffsets.size();
+
+			buddy.Free( liveOffsets[ victim ] );
+			live.erase( liveOffsets[ victim ] );
+
+			liveOffsets[ victim ] = liveOffsets.back();
+			liveOffsets.pop_back();
+		}
+
+		if ( i % 1000 == 0 && buddy.UsedBytes() < blockSize ) {
+			utilization		+= ( double )buddy.UsedBytes() / blockSize;
+			fragmentation	+= 1.0 - ( double )buddy.LargestFreeBlock() / ( blockSize - buddy.UsedBytes() );
+		}
+	}
+	std::chrono::high_resolution_clock::duration elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	double samples = MEMORY_TRACE_OPERATIONS / 1000.0;
+
+	std::cout << "  buddy: " << std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() / ( double )MEMORY_TRACE_OPERATIONS
+		<< " ns per operation (including validation), " << failures << " failed allocations, "
+		<< 100.0 * utilization / samples << "% average utilization, "
+		<< 100.0 * fragmentation / samples << "% average fragmentation" << std::endl;
+
+	for ( const std::pair<const uint64_t, uint64_t>& allocation : live ) {
+		buddy.Free( allocation.first );
+	}
+
+	if ( !buddy.IsEmpty() || buddy.LargestFreeBlock() != blockSize ) {
+		std::cerr << "Buddy allocator did not coalesce back to a single block" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	LinearAllocator	linear( 16 * 1024 * 1024 );
+	uint64_t		linearFailures = 0;
+
+	start = std::chrono::high_resolution_clock::now();
+	for ( uint32_t frame = 0; frame < TRANSIENT_TRACE_FRAMES; ++frame ) {
+		linear.Reset();
+
+		for ( uint32_t i = 0; i < TRANSIENT_ALLOCATIONS_PER_FRAME; ++i ) {
+			if ( linear.Allocate( 64 + random() % 16384, 256 ) == BuddyAllocator::INVALID_OFFSET ) {
+				++linearFailures;
+			}
+		}
+	}
+	elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	std::cout << "  linear: " << std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() / ( double )( TRANSIENT_TRACE_FRAMES * TRANSIENT_ALLOCATIONS_PER_FRAME )
+		<< " ns per allocation, " << linearFailures << " failed allocations" << std::endl;
+
+	TraceDevice trace;
+
+	trace.Backend.AllocateMemory				= FakeAllocateMemory;
+	trace.Backend.FreeMemory					= FakeFreeMemory;
+	trace.Backend.MapMemory						= FakeMapMemory;
+	trace.Backend.GetBufferMemoryRequirements	= FakeGetBufferMemoryRequirements;
+	trace.Backend.BindBufferMemory				= FakeBindBufferMemory;
+	trace.CreateBuffer							= FakeCreateBuffer;
+	trace.DestroyBuffer							= FakeDestroyBuffer;
+	trace.MemorySize							= FakeMemorySize;
+
+	std::cout << "Device memory allocator on a fake device" << std::endl;
+
+	//The traces create no images, so the image entry points stay null
+	if ( RunAllocatorTraces( FakeCapabilities(), trace ) != EXIT_SUCCESS ) {
+		return EXIT_FAILURE;
+	}
+
+	if ( s_fakeErrors != 0 || !s_fakeMemory.empty() || !s_fakeBuffers.empty() ) {
+		std::cerr << "The allocator made " << s_fakeErrors << " invalid calls and left " << s_fakeMemory.size() << " memory objects and "
+			<< s_fakeBuffers.size() << " buffers behind" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+===============
+Benchmarks::RunDeviceAllocatorBenchmark
+
+	Runs the allocator traces on a real device
+===============
+*/
+int Benchmarks::RunDeviceAllocatorBenchmark( const DeviceCapabilities& capabilities, VkDevice device ) {
+	TraceDevice trace;
+
+	trace.Device		= device;
+	trace.Backend		= DeviceMemoryBackend::Vulkan();
+	trace.CreateBuffer	= vkCreateBuffer;
+	trace.DestroyBuffer	= vkDestroyBuffer;
+
+	std::cout << "Device memory allocator benchmark" << std::endl;
+
+	return RunAllocatorTraces( capabilities, trace );
+}
+
+}
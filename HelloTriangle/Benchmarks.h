@@ -0,0 +1,19 @@
+#ifndef __BENCHMARKS_H__
+#define __BENCHMARKS_H__
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceCapabilities.h"
+
+namespace tut {
+
+class Benchmarks {
+public:
+	static int		RunHandleBenchmark( void );
+	static int		RunDeviceMemoryBenchmark( void );
+	static int		RunDeviceAllocatorBenchmark( const DeviceCapabilities& capabilities, VkDevice device );
+};
+
+}
+
+#endif // !__BENCHMARKS_H__
@@ -0,0 +1,335 @@
+#include "BindlessTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "DebugMessenger.h"
+#include "HostAllocator.h"
+
+namespace tut {
+
+const uint32_t BindlessTable::IMAGE_BINDING;
+const uint32_t BindlessTable::BUFFER_BINDING;
+const uint32_t BindlessTable::SAMPLER_BINDING;
+const uint32_t BindlessTable::MAX_IMAGES;
+const uint32_t BindlessTable::MAX_BUFFERS;
+const uint32_t BindlessTable::INVALID_INDEX;
+
+namespace {
+
+const VkShaderStageFlags			BINDLESS_STAGES{ VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT };
+const VkDescriptorBindingFlagsEXT	BINDLESS_BINDING_FLAGS{ VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT };
+
+}
+
+/*
+===============
+BindlessTable::BindlessTable
+
+	Creates the set with arrays as large as MAX_IMAGES and MAX_BUFFERS, or
+	the device's update after bind limits if those are lower, and writes
+	the sampler
+===============
+*/
+BindlessTable::BindlessTable( const DeviceCapabilities& capabilities, VkDevice device, DescriptorLayoutCache& layouts, uint32_t framesInFlight ) :
+	m_device( device ),
+	m_pending( std::max( framesInFlight, 1u ) )
+{
+	const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& limits = capabilities.DescriptorIndexingLimits;
+
+	m_images.Capacity	= std::min( { MAX_IMAGES, limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages } );
+	m_buffers.Capacity	= std::min( { MAX_BUFFERS, limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers } );
+
+	VkSamplerCreateInfo samplerInfo = {};
+
+	samplerInfo.sType			= VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter		= VK_FILTER_LINEAR;
+	samplerInfo.minFilter		= VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode		= VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU	= VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV	= VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW	= VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.minLod			= 0.0f;
+	samplerInfo.maxLod			= VK_LOD_CLAMP_NONE;
+
+	m_sampler = VKSamplerHandle( m_device );
+
+	if ( vkCreateSampler( m_device, &samplerInfo, HostAllocator::Installed(), m_sampler.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create bindless sampler" );
+	}
+
+	DescriptorLayoutDesc layoutDesc;
+
+	layoutDesc.Flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutDesc.Bindings.resize( 3 );
+	layoutDesc.BindingFlags.assign( 3, BINDLESS_BINDING_FLAGS );
+
+	layoutDesc.Bindings[ 0 ].binding			= IMAGE_BINDING;
+	layoutDesc.Bindings[ 0 ].descriptorType		= VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	layoutDesc.Bindings[ 0 ].descriptorCount	= m_images.Capacity;
+	layoutDesc.Bindings[ 0 ].stageFlags			= BINDLESS_STAGES;
+	layoutDesc.Bindings[ 1 ].binding			= BUFFER_BINDING;
+	layoutDesc.Bindings[ 1 ].descriptorType		= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	layoutDesc.Bindings[ 1 ].descriptorCount	= m_buffers.Capacity;
+	layoutDesc.Bindings[ 1 ].stageFlags			= BINDLESS_STAGES;
+	layoutDesc.Bindings[ 2 ].binding			= SAMPLER_BINDING;
+	layoutDesc.Bindings[ 2 ].descriptorType		= VK_DESCRIPTOR_TYPE_SAMPLER;
+	layoutDesc.Bindings[ 2 ].descriptorCount	= 1;
+	layoutDesc.Bindings[ 2 ].stageFlags			= BINDLESS_STAGES;
+
+	//Written once before the set is ever bound
+	layoutDesc.BindingFlags[ 2 ] = 0;
+
+	m_layout = layouts.Get( layoutDesc );
+
+	VkDescriptorPoolSize		poolSizes[ 3 ]	= {};
+	VkDescriptorPoolCreateInfo	poolInfo		= {};
+
+	poolSizes[ 0 ].type				= VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSizes[ 0 ].descriptorCount	= m_images.Capacity;
+	poolSizes[ 1 ].type				= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[ 1 ].descriptorCount	= m_buffers.Capacity;
+	poolSizes[ 2 ].type				= VK_DESCRIPTOR_TYPE_SAMPLER;
+	poolSizes[ 2 ].descriptorCount	= 1;
+
+	poolInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags			= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.maxSets		= 1;
+	poolInfo.poolSizeCount	= 3;
+	poolInfo.pPoolSizes		= poolSizes;
+
+	m_pool = VKDescriptorPoolHandle( m_device );
+
+	if ( vkCreateDescriptorPool( m_device, &poolInfo, HostAllocator::Installed(), m_pool.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create bindless descriptor pool" );
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+
+	allocInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool		= m_pool;
+	allocInfo.descriptorSetCount	= 1;
+	allocInfo.pSetLayouts			= &m_layout;
+
+	if ( vkAllocateDescriptorSets( m_device, &allocInfo, &m_set ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not allocate bindless descriptor set" );
+	}
+
+	DebugMessenger::Name( m_device, VK_OBJECT_TYPE_DESCRIPTOR_SET, m_set, "Bindless table" );
+
+	VkDescriptorImageInfo	samplerDescriptor	= {};
+	VkWriteDescriptorSet	write				= {};
+
+	samplerDescriptor.sampler = m_sampler;
+
+	write.sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet			= m_set;
+	write.dstBinding		= SAMPLER_BINDING;
+	write.descriptorCount	= 1;
+	write.descriptorType	= VK_DESCRIPTOR_TYPE_SAMPLER;
+	write.pImageInfo		= &samplerDescriptor;
+
+	vkUpdateDescriptorSets( m_device, 1, &write, 0, nullptr );
+}
+/*
+===============
+BindlessTable::IsSupported
+
+	Returns if the device can index update after bind arrays of sampled
+	images and storage buffers that are only partially written
+===============
+*/
+bool BindlessTable::IsSupported( const DeviceCapabilities& capabilities ) {
+	const VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features = capabilities.DescriptorIndexing;
+
+	return capabilities.HasExtension( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME ) && capabilities.HasExtension( VK_KHR_MAINTENANCE3_EXTENSION_NAME ) &&
+		features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound && features.descriptorBindingUpdateUnusedWhilePending &&
+		features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind;
+}
+/*
+===============
+BindlessTable::Layout
+
+	Returns the set layout, for pipeline layouts that use the table
+===============
+*/
+VkDescriptorSetLayout BindlessTable::Layout( void ) const {
+	return m_layout;
+}
+/*
+===============
+BindlessTable::Set
+
+	Returns the one set there is
+===============
+*/
+VkDescriptorSet BindlessTable::Set( void ) const {
+	return m_set;
+}
+/*
+===============
+BindlessTable::BeginFrame
+
+	Frees the slots released the last time this frame slot was recorded.
+	The caller must have waited on the fence of that frame.
+===============
+*/
+void BindlessTable::BeginFrame( uint64_t frameIndex ) {
+	m_frameSlot = ( uint32_t )( frameIndex % m_pending.size() );
+
+	PendingReleases& pending = m_pending[ m_frameSlot ];
+
+	m_images.Free.insert( m_images.Free.end(), pending.Images.begin(), pending.Images.end() );
+	m_buffers.Free.insert( m_buffers.Free.end(), pending.Buffers.begin(), pending.Buffers.end() );
+
+	m_images.Used	-= ( uint32_t )pending.Images.size();
+	m_buffers.Used	-= ( uint32_t )pending.Buffers.size();
+
+	pending.Images.clear();
+	pending.Buffers.clear();
+}
+/*
+===============
+BindlessTable::AddImage
+
+	Writes the view into a free slot of the image array and returns its
+	index. The image must be in the given layout whenever a shader reads it.
+===============
+*/
+uint32_t BindlessTable::AddImage( VkImageView view, VkImageLayout layout ) {
+	uint32_t				index		= Acquire( m_images, "image" );
+	VkDescriptorImageInfo	imageInfo	= {};
+	VkWriteDescriptorSet	write		= {};
+
+	imageInfo.imageView		= view;
+	imageInfo.imageLayout	= layout;
+
+	write.sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet			= m_set;
+	write.dstBinding		= IMAGE_BINDING;
+	write.dstArrayElement	= index;
+	write.descriptorCount	= 1;
+	write.descriptorType	= VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	write.pImageInfo		= &imageInfo;
+
+	vkUpdateDescriptorSets( m_device, 1, &write, 0, nullptr );
+	++m_writes;
+
+	return index;
+}
+/*
+===============
+BindlessTable::AddBuffer
+
+	Writes the buffer range into a free slot of the buffer array and
+	returns its index
+===============
+*/
+uint32_t BindlessTable::AddBuffer( VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range ) {
+	uint32_t				index		= Acquire( m_buffers, "buffer" );
+	VkDescriptorBufferInfo	bufferInfo	= {};
+	VkWriteDescriptorSet	write		= {};
+
+	bufferInfo.buffer	= buffer;
+	bufferInfo.offset	= offset;
+	bufferInfo.range	= range;
+
+	write.sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet			= m_set;
+	write.dstBinding		= BUFFER_BINDING;
+	write.dstArrayElement	= index;
+	write.descriptorCount	= 1;
+	write.descriptorType	= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo		= &bufferInfo;
+
+	vkUpdateDescriptorSets( m_device, 1, &write, 0, nullptr );
+	++m_writes;
+
+	return index;
+}
+/*
+===============
+BindlessTable::ReleaseImage
+
+	Gives the slot back once the frames in flight are done with it. The
+	descriptor is left as it is; nothing may index it after this call.
+===============
+*/
+void BindlessTable::ReleaseImage( uint32_t index ) {
+	m_pending[ m_frameSlot ].Images.push_back( index );
+	++m_releases;
+}
+/*
+===============
+BindlessTable::ReleaseBuffer
+
+	Gives the slot back once the frames in flight are done with it
+===============
+*/
+void BindlessTable::ReleaseBuffer( uint32_t index ) {
+	m_pending[ m_frameSlot ].Buffers.push_back( index );
+	++m_releases;
+}
+/*
+===============
+BindlessTable::GetStats
+
+	Returns a snapshot of the counters
+===============
+*/
+BindlessTableStats BindlessTable::GetStats( void ) const {
+	BindlessTableStats stats;
+
+	stats.ImageCapacity		= m_images.Capacity;
+	stats.BufferCapacity	= m_buffers.Capacity;
+	stats.Images			= m_images.Used;
+	stats.Buffers			= m_buffers.Used;
+	stats.Writes			= m_writes;
+	stats.Releases			= m_releases;
+
+	for ( const PendingReleases& pending : m_pending ) {
+		stats.PendingReleases += ( uint32_t )( pending.Images.size() + pending.Buffers.size() );
+	}
+
+	return stats;
+}
+/*
+===============
+BindlessTable::Report
+
+	Writes how full the arrays are
+===============
+*/
+void BindlessTable::Report( std::ostream& out ) const {
+	BindlessTableStats stats = GetStats();
+
+	out << "Bindless table: " << stats.Images << "/" << stats.ImageCapacity << " images, " << stats.Buffers << "/" << stats.BufferCapacity
+		<< " buffers, " << stats.Writes << " descriptor writes, " << stats.Releases << " releases (" << stats.PendingReleases << " waiting on the GPU)" << std::endl;
+}
+/*
+===============
+BindlessTable::Acquire
+
+	Takes a free slot, reusing released ones before growing into the
+	never used part of the array
+===============
+*/
+uint32_t BindlessTable::Acquire( Slots& slots, const char* kind ) {
+	uint32_t index;
+
+	if ( !slots.Free.empty() ) {
+		index = slots.Free.back();
+		slots.Free.pop_back();
+	} else if ( slots.HighWater < slots.Capacity ) {
+		index = slots.HighWater++;
+	} else {
+		throw std::runtime_error( std::string( "The bindless table is out of " ) + kind + " slots" );
+	}
+
+	++slots.Used;
+
+	return index;
+}
+
+}
@@ -0,0 +1,106 @@
+#ifndef __BINDLESSTABLE_H__
+#define __BINDLESSTABLE_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "DescriptorLayoutCache.h"
+#include "DeviceCapabilities.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+struct BindlessTableStats {
+	uint32_t			ImageCapacity	= 0;
+	uint32_t			BufferCapacity	= 0;
+	uint32_t			Images			= 0;
+	uint32_t			Buffers			= 0;
+	uint64_t			Writes			= 0;
+	uint64_t			Releases		= 0;
+	uint32_t			PendingReleases	= 0;
+};
+
+/*
+===============
+BindlessTable
+
+	One descriptor set holding every sampled image and storage buffer the
+	renderer uses, in two large arrays, plus the trilinear sampler images
+	are read with. It is bound once per command buffer
+	and shaders pick their resources by index, passed in push constants, so
+	draws change no descriptor state. Both arrays are update after bind and
+	partially bound: slots can be written while the set is bound and while
+	frames that do not use them are in flight, and unwritten slots are
+	never read. A released slot is only handed out again once the frames
+	that could still index it have finished, which BeginFrame tracks the
+	same way the deletion queue does.
+
+	Needs VK_EXT_descriptor_indexing, see IsSupported. Not thread safe.
+===============
+*/
+class BindlessTable {
+public:
+	static const uint32_t								IMAGE_BINDING{ 0 };
+	static const uint32_t								BUFFER_BINDING{ 1 };
+	static const uint32_t								SAMPLER_BINDING{ 2 };
+	static const uint32_t								MAX_IMAGES{ 16384 };
+	static const uint32_t								MAX_BUFFERS{ 16384 };
+	static const uint32_t								INVALID_INDEX{ 0xffffffff };
+
+														BindlessTable( const DeviceCapabilities& capabilities, VkDevice device, DescriptorLayoutCache& layouts, uint32_t framesInFlight );
+
+	BindlessTable( const BindlessTable& ) = delete;
+	BindlessTable& operator=( const BindlessTable& ) = delete;
+
+	static bool											IsSupported( const DeviceCapabilities& capabilities );
+
+	VkDescriptorSetLayout								Layout( void ) const;
+	VkDescriptorSet										Set( void ) const;
+
+	void												BeginFrame( uint64_t frameIndex );
+
+	uint32_t											AddImage( VkImageView view, VkImageLayout layout );
+	uint32_t											AddBuffer( VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range );
+	void												ReleaseImage( uint32_t index );
+	void												ReleaseBuffer( uint32_t index );
+
+	BindlessTableStats									GetStats( void ) const;
+	void												Report( std::ostream& out ) const;
+
+private:
+	//Tracks which slots of one array are in use
+	struct Slots {
+		uint32_t										Capacity		= 0;
+		uint32_t										Used			= 0;
+		uint32_t										HighWater		= 0;	//Slots past it were never handed out
+		std::vector<uint32_t>							Free;
+	};
+
+	//Released this frame, free once the frame slot comes around again
+	struct PendingReleases {
+		std::vector<uint32_t>							Images;
+		std::vector<uint32_t>							Buffers;
+	};
+
+	static uint32_t										Acquire( Slots& slots, const char* kind );
+
+	VkDevice											m_device;
+
+	VkDescriptorSetLayout								m_layout;
+	VKSamplerHandle										m_sampler;
+	VKDescriptorPoolHandle								m_pool;
+	VkDescriptorSet										m_set{ VK_NULL_HANDLE };
+
+	Slots												m_images;
+	Slots												m_buffers;
+	std::vector<PendingReleases>						m_pending;
+	uint32_t											m_frameSlot{ 0 };
+	uint64_t											m_writes{ 0 };
+	uint64_t											m_releases{ 0 };
+};
+
+}
+
+#endif // !__BINDLESSTABLE_H__
@@ -0,0 +1,274 @@
+#include "BuddyAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tut {
+
+const uint64_t BuddyAllocator::INVALID_OFFSET;
+
+/*
+===============
+BuddyAllocator::BuddyAllocator
+
+	Creates an allocator with one free block covering the whole range. Both
+	sizes must be powers of two.
+===============
+*/
+BuddyAllocator::BuddyAllocator( uint64_t size, uint64_t minBlockSize ) :
+	m_minBlockSize( minBlockSize )
+{
+	if ( minBlockSize == 0 || ( minBlockSize & ( minBlockSize - 1 ) ) != 0 || ( size & ( size - 1 ) ) != 0 || size < minBlockSize ) {
+		throw std::runtime_error( "Buddy allocator sizes must be powers of two" );
+	}
+
+	while ( BlockSize( m_maxOrder ) < size ) {
+		++m_maxOrder;
+	}
+
+	m_freeLists.resize( m_maxOrder + 1 );
+	m_freeLists[ m_maxOrder ].insert( 0 );
+}
+/*
+===============
+BuddyAllocator::Allocate
+
+	Returns the offset of a block that fits size and alignment, or
+	INVALID_OFFSET if there is no room
+===============
+*/
+uint64_t BuddyAllocator::Allocate( uint64_t size, uint64_t alignment ) {
+	uint32_t order = OrderFor( std::max( size, alignment ) );
+	if ( order > m_maxOrder ) {
+		return INVALID_OFFSET;
+	}
+
+	uint32_t freeOrder = order;
+	while ( freeOrder <= m_maxOrder && m_freeLists[ freeOrder ].empty() ) {
+		++freeOrder;
+	}
+
+	if ( freeOrder > m_maxOrder ) {
+		return INVALID_OFFSET;
+	}
+
+	//Lowest offset first keeps the range compact
+	uint64_t offset = *m_freeLists[ freeOrder ].begin();
+	m_freeLists[ freeOrder ].erase( m_freeLists[ freeOrder ].begin() );
+
+	//Split down to the requested order, freeing the upper halves
+	while ( freeOrder > order ) {
+		--freeOrder;
+		m_freeLists[ freeOrder ].insert( offset + BlockSize( freeOrder ) );
+	}
+
+	m_allocations[ offset ]	= order;
+	m_usedBytes				+= BlockSize( order );
+
+	return offset;
+}
+/*
+===============
+BuddyAllocator::Free
+
+	Frees a block and merges it with its buddy as far as possible
+===============
+*/
+void BuddyAllocator::Free( uint64_t offset ) {
+	std::unordered_map<uint64_t, uint32_t>::iterator allocation = m_allocations.find( offset );
+	if ( allocation == m_allocations.end() ) {
+		throw std::runtime_error( "Freeing an offset that was not allocated" );
+	}
+
+	uint32_t order = allocation->second;
+
+	m_usedBytes -= BlockSize( order );
+	m_allocations.erase( allocation );
+
+	while ( order < m_maxOrder ) {
+		uint64_t						buddy		= offset ^ BlockSize( order );
+		std::set<uint64_t>::iterator	freeBuddy	= m_freeLists[ order ].find( buddy );
+
+		if ( freeBuddy == m_freeLists[ order ].end() ) {
+			break;
+		}
+
+		m_freeLists[ order ].erase( freeBuddy );
+		offset = std::min( offset, buddy );
+		++order;
+	}
+
+	m_freeLists[ order ].insert( offset );
+}
+/*
+===============
+BuddyAllocator::AllocationSize
+
+	Returns the size of the block reserved at offset
+===============
+*/
+uint64_t BuddyAllocator::AllocationSize( uint64_t offset ) const {
+	std::unordered_map<uint64_t, uint32_t>::const_iterator allocation = m_allocations.find( offset );
+
+	return allocation != m_allocations.end() ? BlockSize( allocation->second ) : 0;
+}
+/*
+===============
+BuddyAllocator::Size
+
+	Returns the size of the managed range
+===============
+*/
+uint64_t BuddyAllocator::Size( void ) const {
+	return BlockSize( m_maxOrder );
+}
+/*
+===============
+BuddyAllocator::UsedBytes
+
+	Returns the bytes reserved, including rounding to block sizes
+===============
+*/
+uint64_t BuddyAllocator::UsedBytes( void ) const {
+	return m_usedBytes;
+}
+/*
+===============
+BuddyAllocator::LargestFreeBlock
+
+	Returns the size of the biggest allocation that would currently succeed
+===============
+*/
+uint64_t BuddyAllocator::LargestFreeBlock( void ) const {
+	for ( uint32_t order = m_maxOrder + 1; order > 0; --order ) {
+		if ( !m_freeLists[ order - 1 ].empty() ) {
+			return BlockSize( order - 1 );
+		}
+	}
+
+	return 0;
+}
+/*
+===============
+BuddyAllocator::AllocationCount
+
+	Returns the number of live allocations
+===============
+*/
+size_t BuddyAllocator::AllocationCount( void ) const {
+	return m_allocations.size();
+}
+/*
+===============
+BuddyAllocator::IsEmpty
+
+	Returns if nothing is allocated
+===============
+*/
+bool BuddyAllocator::IsEmpty( void ) const {
+	return m_allocations.empty();
+}
+/*
+===============
+BuddyAllocator::GetAllocations
+
+	Returns the offsets of all live allocations in ascending order
+===============
+*/
+std::vector<uint64_t> BuddyAllocator::GetAllocations( void ) const {
+	std::vector<uint64_t> offsets;
+
+	offsets.reserve( m_allocations.size() );
+	for ( const std::pair<const uint64_t, uint32_t>& allocation : m_allocations ) {
+		offsets.push_back( allocation.first );
+	}
+
+	std::sort( offsets.begin(), offsets.end() );
+
+	return offsets;
+}
+/*
+===============
+BuddyAllocator::OrderFor
+
+	Returns the smallest order whose block holds size bytes
+===============
+*/
+uint32_t BuddyAllocator::OrderFor( uint64_t size ) const {
+	uint32_t order = 0;
+
+	while ( BlockSize( order ) < size && order <= m_maxOrder ) {
+		++order;
+	}
+
+	return order;
+}
+/*
+===============
+BuddyAllocator::BlockSize
+
+	Returns the size of a block of the given order
+===============
+*/
+uint64_t BuddyAllocator::BlockSize( uint32_t order ) const {
+	return m_minBlockSize << order;
+}
+/*
+===============
+LinearAllocator::LinearAllocator
+
+	Creates an empty bump allocator over size bytes
+===============
+*/
+LinearAllocator::LinearAllocator( uint64_t size ) :
+	m_size( size )
+{}
+/*
+===============
+LinearAllocator::Allocate
+
+	Bumps the offset, returns BuddyAllocator::INVALID_OFFSET when full
+===============
+*/
+uint64_t LinearAllocator::Allocate( uint64_t size, uint64_t alignment ) {
+	uint64_t offset = alignment > 1 ? ( m_offset + alignment - 1 ) / alignment * alignment : m_offset;
+
+	if ( offset + size > m_size ) {
+		return BuddyAllocator::INVALID_OFFSET;
+	}
+
+	m_offset = offset + size;
+
+	return offset;
+}
+/*
+===============
+LinearAllocator::Reset
+
+	Frees everything at once
+===============
+*/
+void LinearAllocator::Reset( void ) {
+	m_offset = 0;
+}
+/*
+===============
+LinearAllocator::Size
+
+	Returns the size of the managed range
+===============
+*/
+uint64_t LinearAllocator::Size( void ) const {
+	return m_size;
+}
+/*
+===============
+LinearAllocator::UsedBytes
+
+	Returns the bytes handed out since the last reset
+===============
+*/
+uint64_t LinearAllocator::UsedBytes( void ) const {
+	return m_offset;
+}
+}
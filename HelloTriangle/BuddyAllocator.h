@@ -0,0 +1,75 @@
+#ifndef __BUDDYALLOCATOR_H__
+#define __BUDDYALLOCATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace tut {
+
+/*
+===============
+BuddyAllocator
+
+	Offset allocator over a power of two range. Knows nothing about Vulkan so
+	it can be driven on the CPU alone. Blocks are naturally aligned to their
+	size, so any alignment up to the block size is free.
+===============
+*/
+class BuddyAllocator {
+public:
+	static const uint64_t						INVALID_OFFSET{ ~0ull };
+
+												BuddyAllocator( uint64_t size, uint64_t minBlockSize );
+
+	uint64_t									Allocate( uint64_t size, uint64_t alignment );
+	void										Free( uint64_t offset );
+	uint64_t									AllocationSize( uint64_t offset ) const;
+
+	uint64_t									Size( void ) const;
+	uint64_t									UsedBytes( void ) const;
+	uint64_t									LargestFreeBlock( void ) const;
+	size_t										AllocationCount( void ) const;
+	bool										IsEmpty( void ) const;
+
+	std::vector<uint64_t>						GetAllocations( void ) const;
+
+private:
+	uint32_t									OrderFor( uint64_t size ) const;
+	uint64_t									BlockSize( uint32_t order ) const;
+
+	uint64_t									m_minBlockSize;
+	uint32_t									m_maxOrder{ 0 };
+	uint64_t									m_usedBytes{ 0 };
+
+	std::vector<std::set<uint64_t>>				m_freeLists;
+	std::unordered_map<uint64_t, uint32_t>		m_allocations;
+};
+
+/*
+===============
+LinearAllocator
+
+	Bump allocator for transient data, freed all at once with Reset
+===============
+*/
+class LinearAllocator {
+public:
+												LinearAllocator( uint64_t size );
+
+	uint64_t									Allocate( uint64_t size, uint64_t alignment );
+	void										Reset( void );
+
+	uint64_t									Size( void ) const;
+	uint64_t									UsedBytes( void ) const;
+
+private:
+	uint64_t									m_size;
+	uint64_t									m_offset{ 0 };
+};
+
+}
+
+#endif // !__BUDDYALLOCATOR_H__
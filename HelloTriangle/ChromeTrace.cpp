@@ -0,0 +1,180 @@
+#include "ChromeTrace.h"
+
+#include <atomic>
+#include <stdexcept>
+
+namespace tut {
+
+const uint32_t ChromeTrace::GPU_TRACK;
+
+namespace {
+
+/*
+===============
+WriteJsonString
+
+	Writes a quoted JSON string, escaping what needs escaping
+===============
+*/
+void WriteJsonString( std::ostream& out, const char* text ) {
+	out << '"';
+
+	for ( const char* c = text; *c != '\0'; ++c ) {
+		if ( *c == '"' || *c == '\\' ) {
+			out << '\\' << *c;
+		} else if ( ( unsigned char )*c < 0x20 ) {
+			out << ' ';
+		} else {
+			out << *c;
+		}
+	}
+
+	out << '"';
+}
+
+}
+
+/*
+===============
+ChromeTrace::ChromeTrace
+
+	Opens the trace file and starts the trace clock
+===============
+*/
+ChromeTrace::ChromeTrace( const std::string& filePath ) :
+	m_origin( Clock::now() ),
+	m_file( filePath, std::ios::trunc )
+{
+	if ( !m_file.is_open() ) {
+		throw std::runtime_error( "Could not open trace file " + filePath );
+	}
+
+	m_file.precision( 3 );
+	m_file << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	m_trackNames[ GPU_TRACK ] = "GPU graphics queue";
+}
+/*
+===============
+ChromeTrace::~ChromeTrace
+
+	Finishes the file if Close was not called
+===============
+*/
+ChromeTrace::~ChromeTrace( void ) {
+	Close();
+}
+/*
+===============
+ChromeTrace::ToMicroseconds
+
+	Converts a clock reading to trace time
+===============
+*/
+double ChromeTrace::ToMicroseconds( Clock::time_point time ) const {
+	return std::chrono::duration<double, std::micro>( time - m_origin ).count();
+}
+/*
+===============
+ChromeTrace::NowMicroseconds
+
+	Returns the current trace time
+===============
+*/
+double ChromeTrace::NowMicroseconds( void ) const {
+	return ToMicroseconds( Clock::now() );
+}
+/*
+===============
+ChromeTrace::AddEvent
+
+	Writes a complete event, callable from any thread. Ignored once the
+	trace is closed.
+===============
+*/
+void ChromeTrace::AddEvent( const char* name, uint32_t track, double startUs, double durationUs ) {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	if ( !m_file.is_open() ) {
+		return;
+	}
+
+	m_file << ( m_eventCount == 0 ? "\n" : ",\n" ) << "{\"name\":";
+	WriteJsonString( m_file, name );
+	m_file << ",\"cat\":\"" << ( track == GPU_TRACK ? "gpu" : "cpu" ) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track
+		<< ",\"ts\":" << startUs << ",\"dur\":" << durationUs << "}";
+
+	++m_eventCount;
+
+	if ( m_trackNames.find( track ) == m_trackNames.end() ) {
+		m_trackNames[ track ] = "CPU thread " + std::to_string( track );
+	}
+}
+/*
+===============
+ChromeTrace::NameTrack
+
+	Sets the name a track is shown under
+===============
+*/
+void ChromeTrace::NameTrack( uint32_t track, const std::string& name ) {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	m_trackNames[ track ] = name;
+}
+/*
+===============
+ChromeTrace::EventCount
+
+	Returns the number of events written so far
+===============
+*/
+size_t ChromeTrace::EventCount( void ) const {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	return m_eventCount;
+}
+/*
+===============
+ChromeTrace::Close
+
+	Writes the track names and finishes the JSON, returns if the file was
+	written completely
+===============
+*/
+bool ChromeTrace::Close( void ) {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	if ( !m_file.is_open() ) {
+		return false;
+	}
+
+	bool first = m_eventCount == 0;
+
+	for ( const std::pair<const uint32_t, std::string>& track : m_trackNames ) {
+		m_file << ( first ? "\n" : ",\n" ) << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track.first << ",\"args\":{\"name\":";
+		WriteJsonString( m_file, track.second.c_str() );
+		m_file << "}}";
+		first = false;
+	}
+
+	m_file << "\n]}\n";
+	m_file.close();
+
+	return !m_file.fail();
+}
+/*
+===============
+ChromeTrace::CurrentThreadTrack
+
+	Returns a small stable number for the calling thread, the first thread
+	to ask gets track 1
+===============
+*/
+uint32_t ChromeTrace::CurrentThreadTrack( void ) {
+	static std::atomic<uint32_t>	nextTrack{ GPU_TRACK + 1 };
+	thread_local uint32_t			track = nextTrack++;
+
+	return track;
+}
+}
@@ -0,0 +1,57 @@
+#ifndef __CHROMETRACE_H__
+#define __CHROMETRACE_H__
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace tut {
+
+/*
+===============
+ChromeTrace
+
+	Streams timed events on named tracks to a file in the Chrome trace
+	event format, which chrome://tracing and Perfetto both load. Times are
+	microseconds since the trace was opened. Track names are written when
+	the trace is closed.
+===============
+*/
+class ChromeTrace {
+public:
+	typedef std::chrono::high_resolution_clock	Clock;
+
+	static const uint32_t						GPU_TRACK{ 0 };
+
+												ChromeTrace( const std::string& filePath );
+												~ChromeTrace( void );
+
+	ChromeTrace( const ChromeTrace& ) = delete;
+	ChromeTrace& operator=( const ChromeTrace& ) = delete;
+
+	double										ToMicroseconds( Clock::time_point time ) const;
+	double										NowMicroseconds( void ) const;
+
+	void										AddEvent( const char* name, uint32_t track, double startUs, double durationUs );
+	void										NameTrack( uint32_t track, const std::string& name );
+	size_t										EventCount( void ) const;
+
+	bool										Close( void );
+
+	static uint32_t								CurrentThreadTrack( void );
+
+private:
+	Clock::time_point							m_origin;
+
+	mutable std::mutex							m_lock;
+	std::ofstream								m_file;
+	size_t										m_eventCount{ 0 };
+	std::map<uint32_t, std::string>				m_trackNames;
+};
+
+}
+
+#endif // !__CHROMETRACE_H__
@@ -0,0 +1,549 @@
+#include "DebugMessenger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include "HostAllocator.h"
+
+namespace tut {
+
+const uint32_t DebugMessage::MAX_OBJECTS;
+const uint32_t DebugMessenger::RING_CAPACITY;
+const uint32_t DebugMessenger::REPEATS_WRITTEN;
+const uint32_t DebugMessenger::LINES_PER_SECOND;
+std::atomic<DebugMessenger*> DebugMessenger::s_installedMessenger{ nullptr };
+
+namespace {
+
+const std::chrono::milliseconds DRAIN_INTERVAL{ 10 };
+
+/*
+===============
+CopyText
+
+	Copies as much of a string as fits, always terminating it. Null copies
+	as empty.
+===============
+*/
+void CopyText( char* destination, size_t capacity, const char* source ) {
+	size_t length = 0;
+
+	if ( source != nullptr ) {
+		length = strnlen( source, capacity - 1 );
+		memcpy( destination, source, length );
+	}
+
+	destination[ length ] = '\0';
+}
+/*
+===============
+SeverityName
+
+	Returns how a severity is written in messages and on the command line
+===============
+*/
+const char* SeverityName( VkDebugUtilsMessageSeverityFlagBitsEXT severity ) {
+	switch ( severity ) {
+		case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:		return "error";
+		case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:	return "warning";
+		case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:		return "info";
+		default:												return "verbose";
+	}
+}
+/*
+===============
+WriteTypes
+
+	Writes the message types a message has, separated by bars
+===============
+*/
+void WriteTypes( std::ostream& out, VkDebugUtilsMessageTypeFlagsEXT types ) {
+	const char* separator = "";
+
+	if ( ( types & VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT ) != 0 ) {
+		out << separator << "general";
+		separator = "|";
+	}
+
+	if ( ( types & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT ) != 0 ) {
+		out << separator << "validation";
+		separator = "|";
+	}
+
+	if ( ( types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT ) != 0 ) {
+		out << separator << "performance";
+	}
+}
+
+}
+
+/*
+===============
+DebugMessageRing::DebugMessageRing
+
+	Creates a ring holding capacity messages, capacity must be a power of two
+===============
+*/
+DebugMessageRing::DebugMessageRing( uint32_t capacity ) :
+	m_cells( new Cell[ capacity ] ),
+	m_mask( capacity - 1 )
+{
+	if ( capacity == 0 || ( capacity & ( capacity - 1 ) ) != 0 ) {
+		throw std::runtime_error( "Debug message ring capacity must be a power of two" );
+	}
+
+	for ( uint32_t i = 0; i < capacity; ++i ) {
+		m_cells[ i ].Sequence.store( i, std::memory_order_relaxed );
+	}
+}
+/*
+===============
+DebugMessageRing::Claim
+
+	Reserves the next free cell for the calling thread to fill in, or
+	returns nullptr when the ring is full. Every claimed cell must be
+	published, the consumer stops at the first unpublished one.
+===============
+*/
+DebugMessage* DebugMessageRing::Claim( uint64_t& position ) {
+	uint64_t head = m_head.load( std::memory_order_relaxed );
+
+	for ( ;; ) {
+		Cell&		cell		= m_cells[ head & m_mask ];
+		uint64_t	sequence	= cell.Sequence.load( std::memory_order_acquire );
+		int64_t		lag			= ( int64_t )( sequence - head );
+
+		if ( lag == 0 ) {
+			//Free at this position, take it unless another producer got there first
+			if ( m_head.compare_exchange_weak( head, head + 1, std::memory_order_relaxed ) ) {
+				position = head;
+				return &cell.Message;
+			}
+		} else if ( lag < 0 ) {
+			//Still holding the message from a lap ago
+			m_dropped.fetch_add( 1, std::memory_order_relaxed );
+			return nullptr;
+		} else {
+			head = m_head.load( std::memory_order_relaxed );
+		}
+	}
+}
+/*
+===============
+DebugMessageRing::Publish
+
+	Hands a filled in cell to the consumer
+===============
+*/
+void DebugMessageRing::Publish( uint64_t position ) {
+	m_cells[ position & m_mask ].Sequence.store( position + 1, std::memory_order_release );
+}
+/*
+===============
+DebugMessageRing::Front
+
+	Returns the oldest published message, or nullptr. Consumer only.
+===============
+*/
+const DebugMessage* DebugMessageRing::Front( void ) const {
+	const Cell& cell = m_cells[ m_tail & m_mask ];
+
+	if ( cell.Sequence.load( std::memory_order_acquire ) != m_tail + 1 ) {
+		return nullptr;
+	}
+
+	return &cell.Message;
+}
+/*
+===============
+DebugMessageRing::Pop
+
+	Frees the cell Front returned for the producers' next lap
+===============
+*/
+void DebugMessageRing::Pop( void ) {
+	m_cells[ m_tail & m_mask ].Sequence.store( m_tail + m_mask + 1, std::memory_order_release );
+	++m_tail;
+}
+/*
+===============
+DebugMessageRing::Dropped
+
+	Returns how many messages were lost to a full ring
+===============
+*/
+uint64_t DebugMessageRing::Dropped( void ) const {
+	return m_dropped.load( std::memory_order_relaxed );
+}
+/*
+===============
+DebugMessenger::DebugMessenger
+
+	Registers the messenger with the instance, which must have
+	VK_EXT_debug_utils enabled, and starts the drain thread
+===============
+*/
+DebugMessenger::DebugMessenger( VkInstance instance, VkDebugUtilsMessageSeverityFlagsEXT severities, std::ostream& out ) :
+	m_out( out ),
+	m_severities( severities ),
+	m_lastRefill( Clock::now() )
+{
+	VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
+
+	createInfo.sType			= VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	createInfo.messageSeverity	= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	createInfo.messageType		= VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	createInfo.pfnUserCallback	= Callback;
+	createInfo.pUserData		= this;
+
+	m_messenger = VKDebugUtilsMessengerHandle( instance );
+	if ( VulkanProxies::CreateDebugUtilsMessengerEXT( instance, &createInfo, HostAllocator::Installed(), m_messenger.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Failed to setup debug messenger" );
+	}
+
+	m_setObjectName = ( PFN_vkSetDebugUtilsObjectNameEXT )vkGetInstanceProcAddr( instance, "vkSetDebugUtilsObjectNameEXT" );
+	m_drainThread	= std::thread( &DebugMessenger::DrainMain, this );
+}
+/*
+===============
+DebugMessenger::~DebugMessenger
+
+	Unregisters the messenger and writes what is left
+===============
+*/
+DebugMessenger::~DebugMessenger( void ) {
+	Stop();
+}
+/*
+===============
+DebugMessenger::Install
+
+	Makes the messenger the one Name goes through, nullptr turns naming off
+===============
+*/
+void DebugMessenger::Install( DebugMessenger* messenger ) {
+	s_installedMessenger.store( messenger, std::memory_order_release );
+}
+/*
+===============
+DebugMessenger::Installed
+
+	Returns the messenger Name goes through, or nullptr
+===============
+*/
+DebugMessenger* DebugMessenger::Installed( void ) {
+	return s_installedMessenger.load( std::memory_order_acquire );
+}
+/*
+===============
+DebugMessenger::Name
+
+	Gives an object the name messages about it are written with. Does
+	nothing unless a messenger is installed.
+===============
+*/
+void DebugMessenger::Name( VkDevice device, VkObjectType type, uint64_t handle, const char* name ) {
+	DebugMessenger* messenger = Installed();
+
+	if ( messenger == nullptr || messenger->m_setObjectName == nullptr ) {
+		return;
+	}
+
+	VkDebugUtilsObjectNameInfoEXT nameInfo = {};
+
+	nameInfo.sType			= VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+	nameInfo.objectType		= type;
+	nameInfo.objectHandle	= handle;
+	nameInfo.pObjectName	= name;
+
+	messenger->m_setObjectName( device, &nameInfo );
+}
+/*
+===============
+DebugMessenger::ParseSeverities
+
+	Reads a comma separated list of error, warning, info and verbose, or
+	all. Returns false on anything else.
+===============
+*/
+bool DebugMessenger::ParseSeverities( const char* list, VkDebugUtilsMessageSeverityFlagsEXT& severities ) {
+	const VkDebugUtilsMessageSeverityFlagBitsEXT ALL_SEVERITIES[] = {
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT,
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
+	};
+
+	VkDebugUtilsMessageSeverityFlagsEXT	parsed	= 0;
+	std::string							names	= list;
+	size_t								start	= 0;
+
+	while ( start <= names.size() ) {
+		size_t		end		= std::min( names.find( ',', start ), names.size() );
+		std::string	name	= names.substr( start, end - start );
+		bool		known	= false;
+
+		for ( VkDebugUtilsMessageSeverityFlagBitsEXT severity : ALL_SEVERITIES ) {
+			if ( name == "all" || name == SeverityName( severity ) ) {
+				parsed	|= severity;
+				known	= true;
+			}
+		}
+
+		if ( !known ) {
+			return false;
+		}
+
+		start = end + 1;
+	}
+
+	severities = parsed;
+
+	return true;
+}
+/*
+===============
+DebugMessenger::SetSeverities
+
+	Changes which severities are kept, from any thread. Takes effect on
+	the next message.
+===============
+*/
+void DebugMessenger::SetSeverities( VkDebugUtilsMessageSeverityFlagsEXT severities ) {
+	m_severities.store( severities, std::memory_order_relaxed );
+}
+/*
+===============
+DebugMessenger::Severities
+
+	Returns which severities are kept
+===============
+*/
+VkDebugUtilsMessageSeverityFlagsEXT DebugMessenger::Severities( void ) const {
+	return m_severities.load( std::memory_order_relaxed );
+}
+/*
+===============
+DebugMessenger::Stop
+
+	Uninstalls and unregisters the messenger, joins the drain thread and
+	writes what is left, along with how often each repeated message ID was
+	left out
+===============
+*/
+void DebugMessenger::Stop( void ) {
+	if ( Installed() == this ) {
+		Install( nullptr );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_drainLock );
+
+		if ( m_stopping ) {
+			return;
+		}
+
+		m_stopping = true;
+	}
+
+	m_messenger.reset();
+
+	m_drainWake.notify_all();
+	m_drainThread.join();
+
+	DrainRing();
+	WriteSuppressed();
+	m_out.flush();
+}
+/*
+===============
+DebugMessenger::Report
+
+	Writes how many messages came in and what became of them
+===============
+*/
+void DebugMessenger::Report( std::ostream& out ) const {
+	out << "Debug messages: " << m_received.load( std::memory_order_relaxed ) << " received, " << m_filtered.load( std::memory_order_relaxed ) << " below the severity filter, "
+		<< m_written.load( std::memory_order_relaxed ) << " written, " << m_duplicates.load( std::memory_order_relaxed ) << " repeats counted, "
+		<< m_rateLimitedTotal.load( std::memory_order_relaxed ) << " over the line budget, " << m_ring.Dropped() << " dropped on a full ring" << std::endl;
+}
+/*
+===============
+DebugMessenger::Callback
+
+	Called by the layers on whichever thread made the Vulkan call. Copies
+	the message into the ring and returns without locking, formatting or
+	writing anything.
+===============
+*/
+VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessenger::Callback(
+	VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+	VkDebugUtilsMessageTypeFlagsEXT types,
+	const VkDebugUtilsMessengerCallbackDataEXT* callbackData,
+	void* userData
+) {
+	DebugMessenger* messenger = ( DebugMessenger* )userData;
+
+	messenger->m_received.fetch_add( 1, std::memory_order_relaxed );
+
+	if ( ( severity & messenger->m_severities.load( std::memory_order_relaxed ) ) == 0 ) {
+		messenger->m_filtered.fetch_add( 1, std::memory_order_relaxed );
+		return VK_FALSE;
+	}
+
+	uint64_t		position;
+	DebugMessage*	message = messenger->m_ring.Claim( position );
+
+	if ( message == nullptr ) {
+		return VK_FALSE;
+	}
+
+	message->Severity		= severity;
+	message->Types			= types;
+	message->MessageId		= callbackData->messageIdNumber;
+	message->ObjectCount	= callbackData->objectCount;
+
+	CopyText( message->IdName, sizeof( message->IdName ), callbackData->pMessageIdName );
+	CopyText( message->Text, sizeof( message->Text ), callbackData->pMessage );
+
+	for ( uint32_t i = 0; i < std::min( callbackData->objectCount, DebugMessage::MAX_OBJECTS ); ++i ) {
+		message->Objects[ i ].Type		= callbackData->pObjects[ i ].objectType;
+		message->Objects[ i ].Handle	= callbackData->pObjects[ i ].objectHandle;
+		CopyText( message->Objects[ i ].Name, sizeof( message->Objects[ i ].Name ), callbackData->pObjects[ i ].pObjectName );
+	}
+
+	messenger->m_ring.Publish( position );
+
+	//Never abort the call that raised the message
+	return VK_FALSE;
+}
+/*
+===============
+DebugMessenger::DrainMain
+
+	Drains the ring every few milliseconds until stopped
+===============
+*/
+void DebugMessenger::DrainMain( void ) {
+	std::unique_lock<std::mutex> lock( m_drainLock );
+
+	while ( !m_stopping ) {
+		m_drainWake.wait_for( lock, DRAIN_INTERVAL );
+
+		lock.unlock();
+		DrainRing();
+		lock.lock();
+	}
+}
+/*
+===============
+DebugMessenger::DrainRing
+
+	Writes every published message, flushing once at the end. Only one
+	thread drains at a time: the drain thread, or Stop once it has been
+	joined.
+===============
+*/
+void DebugMessenger::DrainRing( void ) {
+	bool drained = false;
+
+	for ( const DebugMessage* message = m_ring.Front(); message != nullptr; message = m_ring.Front() ) {
+		Write( *message );
+		m_ring.Pop();
+
+		drained = true;
+	}
+
+	if ( drained ) {
+		m_out.flush();
+	}
+}
+/*
+===============
+DebugMessenger::Write
+
+	Writes a message with the objects it names, unless its ID has already
+	been written REPEATS_WRITTEN times or the second's line budget is spent.
+	Messages without an ID are told apart by their text.
+===============
+*/
+void DebugMessenger::Write( const DebugMessage& message ) {
+	uint64_t key = message.MessageId != 0 ? ( uint64_t )( uint32_t )message.MessageId : std::hash<std::string>()( std::string( message.IdName ) + message.Text ) | ( 1ull << 63 );
+	Repeats& repeats = m_repeats[ key ];
+
+	if ( ++repeats.Count > REPEATS_WRITTEN ) {
+		if ( repeats.IdName.empty() ) {
+			repeats.IdName = message.IdName[ 0 ] != '\0' ? message.IdName : message.Text;
+		}
+
+		++repeats.Suppressed;
+		m_duplicates.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	//Refill the line budget for the time since the last message, up to one second's worth
+	Clock::time_point now = Clock::now();
+
+	m_lineBudget	= std::min( ( double )LINES_PER_SECOND, m_lineBudget + std::chrono::duration<double>( now - m_lastRefill ).count() * LINES_PER_SECOND );
+	m_lastRefill	= now;
+
+	if ( m_lineBudget < 1.0 ) {
+		++m_rateLimited;
+		m_rateLimitedTotal.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	m_lineBudget -= 1.0;
+
+	if ( m_rateLimited > 0 ) {
+		m_out << "[debug] " << m_rateLimited << " messages left out over the line budget\n";
+		m_rateLimited = 0;
+	}
+
+	m_out << "[" << SeverityName( message.Severity ) << " ";
+	WriteTypes( m_out, message.Types );
+	m_out << "] " << message.IdName << " (0x" << std::hex << ( uint32_t )message.MessageId << std::dec << "): " << message.Text << '\n';
+
+	uint32_t objectCount = std::min( message.ObjectCount, DebugMessage::MAX_OBJECTS );
+
+	for ( uint32_t i = 0; i < objectCount; ++i ) {
+		const DebugMessageObject& object = message.Objects[ i ];
+
+		m_out << "    object " << i << ": " << ( object.Name[ 0 ] != '\0' ? object.Name : "unnamed" ) << ", type " << object.Type
+			<< ", handle 0x" << std::hex << object.Handle << std::dec << '\n';
+	}
+
+	if ( message.ObjectCount > objectCount ) {
+		m_out << "    and " << message.ObjectCount - objectCount << " more objects\n";
+	}
+
+	if ( repeats.Count == REPEATS_WRITTEN ) {
+		m_out << "    written " << REPEATS_WRITTEN << " times, further repeats are only counted\n";
+	}
+
+	m_written.fetch_add( 1, std::memory_order_relaxed );
+}
+/*
+===============
+DebugMessenger::WriteSuppressed
+
+	Writes how many repeats of each message ID were left out
+===============
+*/
+void DebugMessenger::WriteSuppressed( void ) {
+	if ( m_rateLimited > 0 ) {
+		m_out << "[debug] " << m_rateLimited << " messages left out over the line budget\n";
+		m_rateLimited = 0;
+	}
+
+	for ( const std::pair<const uint64_t, Repeats>& entry : m_repeats ) {
+		if ( entry.second.Suppressed > 0 ) {
+			m_out << "[debug] " << entry.second.IdName << " repeated " << entry.second.Suppressed << " more times\n";
+		}
+	}
+}
+
+}
@@ -0,0 +1,195 @@
+#ifndef __DEBUGMESSENGER_H__
+#define __DEBUGMESSENGER_H__
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "VKHandle.h"
+
+namespace tut {
+
+struct DebugMessageObject {
+	VkObjectType						Type;
+	uint64_t							Handle;
+	char								Name[ 64 ];		//Empty when the object was never named
+};
+
+/*
+	A message as the callback copies it out of the layer, fixed size so
+	pushing one never allocates. Longer text is cut short.
+*/
+struct DebugMessage {
+	static const uint32_t				MAX_OBJECTS{ 4 };
+
+	VkDebugUtilsMessageSeverityFlagBitsEXT	Severity;
+	VkDebugUtilsMessageTypeFlagsEXT		Types;
+	int32_t								MessageId;
+	uint32_t							ObjectCount;	//Of the message, only the first MAX_OBJECTS are kept
+	DebugMessageObject					Objects[ MAX_OBJECTS ];
+	char								IdName[ 96 ];
+	char								Text[ 1024 ];
+};
+
+/*
+===============
+DebugMessageRing
+
+	Fixed size multiple producer, single consumer ring of debug messages.
+	Any thread inside a Vulkan call claims a cell with one compare and swap,
+	fills it in place and publishes it; the messenger's drain thread reads
+	cells in order. Neither side takes a lock; a full ring drops the
+	message and counts it.
+===============
+*/
+class DebugMessageRing {
+public:
+	explicit							DebugMessageRing( uint32_t capacity );
+
+	DebugMessageRing( const DebugMessageRing& ) = delete;
+	DebugMessageRing& operator=( const DebugMessageRing& ) = delete;
+
+	DebugMessage*						Claim( uint64_t& position );
+	void								Publish( uint64_t position );
+
+	const DebugMessage*					Front( void ) const;
+	void								Pop( void );
+
+	uint64_t							Dropped( void ) const;
+
+private:
+	//Sequence is the position the cell can next be claimed at, or one past it once the message is published
+	struct Cell {
+		std::atomic<uint64_t>			Sequence;
+		DebugMessage					Message;
+	};
+
+	std::unique_ptr<Cell[]>				m_cells;
+	uint64_t							m_mask;
+
+	//Producer and consumer indices live on separate cache lines
+	alignas( 64 ) std::atomic<uint64_t>	m_head{ 0 };
+	alignas( 64 ) uint64_t				m_tail{ 0 };
+	std::atomic<uint64_t>				m_dropped{ 0 };
+};
+
+/*
+===============
+DebugMessenger
+
+	VK_EXT_debug_utils messenger that never blocks the thread the layer
+	calls it on. The callback checks the severity filter, copies the message
+	and the names of the objects it refers to into a DebugMessageRing and
+	returns. A background thread drains the ring every few milliseconds,
+	formats each message, writes the first few of every message ID and
+	counts the rest, and holds the output to a line budget per second, so a
+	layer complaining every draw neither slows the draws nor buries the
+	first occurrence.
+
+	The messenger is registered for every severity and type, so the filter
+	can change while running without recreating it. The installed messenger
+	also names objects for the layers through Name, a no op when none is
+	installed.
+===============
+*/
+class DebugMessenger {
+public:
+	typedef std::chrono::steady_clock	Clock;
+
+	static const uint32_t				RING_CAPACITY{ 256 };
+	static const uint32_t				REPEATS_WRITTEN{ 3 };		//Per message ID, later copies are only counted
+	static const uint32_t				LINES_PER_SECOND{ 50 };		//Also the burst a quiet second saves up to
+
+										DebugMessenger( VkInstance instance, VkDebugUtilsMessageSeverityFlagsEXT severities, std::ostream& out );
+										~DebugMessenger( void );
+
+	DebugMessenger( const DebugMessenger& ) = delete;
+	DebugMessenger& operator=( const DebugMessenger& ) = delete;
+
+	static void							Install( DebugMessenger* messenger );
+	static DebugMessenger*				Installed( void );
+
+	static void							Name( VkDevice device, VkObjectType type, uint64_t handle, const char* name );
+	template<typename HandleType>
+	static void							Name( VkDevice device, VkObjectType type, HandleType* handle, const char* name );
+
+	static bool							ParseSeverities( const char* list, VkDebugUtilsMessageSeverityFlagsEXT& severities );
+
+	void								SetSeverities( VkDebugUtilsMessageSeverityFlagsEXT severities );
+	VkDebugUtilsMessageSeverityFlagsEXT	Severities( void ) const;
+
+	void								Stop( void );
+	void								Report( std::ostream& out ) const;
+
+private:
+	//Occurrences of one message ID
+	struct Repeats {
+		uint64_t						Count		= 0;
+		uint64_t						Suppressed	= 0;
+		std::string						IdName;
+	};
+
+	static VKAPI_ATTR VkBool32 VKAPI_CALL	Callback(
+											VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+											VkDebugUtilsMessageTypeFlagsEXT types,
+											const VkDebugUtilsMessengerCallbackDataEXT* callbackData,
+											void* userData
+										);
+
+	void								DrainMain( void );
+	void								DrainRing( void );
+	void								Write( const DebugMessage& message );
+	void								WriteSuppressed( void );
+
+	std::ostream&						m_out;
+	DebugMessageRing					m_ring{ RING_CAPACITY };
+	std::atomic<uint32_t>				m_severities;
+	std::atomic<uint64_t>				m_received{ 0 };
+	std::atomic<uint64_t>				m_filtered{ 0 };
+	PFN_vkSetDebugUtilsObjectNameEXT	m_setObjectName{ nullptr };
+
+	//Drain thread only, then Stop once it has joined
+	std::unordered_map<uint64_t, Repeats>	m_repeats;
+	double								m_lineBudget{ LINES_PER_SECOND };
+	Clock::time_point					m_lastRefill;
+	uint64_t							m_rateLimited{ 0 };		//Since the last notice
+
+	//Written by the drain thread, read by Report
+	std::atomic<uint64_t>				m_written{ 0 };
+	std::atomic<uint64_t>				m_duplicates{ 0 };
+	std::atomic<uint64_t>				m_rateLimitedTotal{ 0 };
+
+	std::mutex							m_drainLock;
+	std::condition_variable				m_drainWake;
+	bool								m_stopping{ false };
+	std::thread							m_drainThread;
+
+	VKDebugUtilsMessengerHandle			m_messenger;
+
+	static std::atomic<DebugMessenger*>	s_installedMessenger;
+};
+
+/*
+===============
+DebugMessenger::Name
+
+	Names a dispatchable handle, or a non dispatchable one where those are
+	pointers
+===============
+*/
+template<typename HandleType>
+void DebugMessenger::Name( VkDevice device, VkObjectType type, HandleType* handle, const char* name ) {
+	Name( device, type, ( uint64_t )( uintptr_t )handle, name );
+}
+
+}
+
+#endif // !__DEBUGMESSENGER_H__
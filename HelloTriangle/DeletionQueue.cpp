@@ -0,0 +1,134 @@
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tut {
+/*
+===============
+DeletionQueue::DeletionQueue
+
+	Creates a ring with one bucket per frame in flight
+===============
+*/
+DeletionQueue::DeletionQueue( uint32_t framesInFlight ) :
+	m_buckets( std::max( framesInFlight, 1u ) )
+{}
+/*
+===============
+DeletionQueue::~DeletionQueue
+
+	Destroys everything still pending. The owner must make sure the device is
+	idle before this runs.
+===============
+*/
+DeletionQueue::~DeletionQueue( void ) {
+	Flush();
+}
+/*
+===============
+DeletionQueue::Push
+
+	Queues an object for destruction once the current frame has completed
+===============
+*/
+void DeletionQueue::Push( DestroyFunc destroy, uint64_t parent, uint64_t object ) {
+	Bucket& bucket = m_buckets[ m_currentFrame % m_buckets.size() ];
+
+	bucket.FrameIndex = m_currentFrame;
+	bucket.Entries.push_back( { destroy, parent, object, Clock::now() } );
+
+	++m_pendingObjects;
+}
+/*
+===============
+DeletionQueue::BeginFrame
+
+	Starts a new frame. The caller must already have waited on the fence of the
+	frame that last used this slot, so everything in it can be destroyed.
+===============
+*/
+void DeletionQueue::BeginFrame( uint64_t frameIndex ) {
+	if ( frameIndex < m_currentFrame ) {
+		throw std::runtime_error( "Deletion queue frame index went backwards" );
+	}
+
+	m_currentFrame = frameIndex;
+	DestroyBucket( m_buckets[ m_currentFrame % m_buckets.size() ], m_currentFrame );
+}
+/*
+===============
+DeletionQueue::Flush
+
+	Destroys every pending object regardless of frame
+===============
+*/
+void DeletionQueue::Flush( void ) {
+	for ( Bucket& bucket : m_buckets ) {
+		DestroyBucket( bucket, m_currentFrame );
+	}
+}
+/*
+===============
+DeletionQueue::DestroyBucket
+
+	Destroys all the entries in a bucket and records their latency
+===============
+*/
+void DeletionQueue::DestroyBucket( Bucket& bucket, uint64_t currentFrame ) {
+	if ( bucket.Entries.empty() ) {
+		return;
+	}
+
+	Clock::time_point	now				= Clock::now();
+	uint64_t			latencyFrames	= currentFrame - bucket.FrameIndex;
+
+	for ( const Entry& entry : bucket.Entries ) {
+		entry.Destroy( entry.Parent, entry.Object );
+
+		double latencyMs = std::chrono::duration<double, std::milli>( now - entry.RetiredAt ).count();
+
+		m_totalLatencyMs	+= latencyMs;
+		m_maxLatencyMs		= std::max( m_maxLatencyMs, latencyMs );
+	}
+
+	m_maxLatencyFrames	= std::max( m_maxLatencyFrames, latencyFrames );
+	m_destroyedObjects	+= bucket.Entries.size();
+	m_pendingObjects	-= bucket.Entries.size();
+
+	bucket.Entries.clear();
+}
+/*
+===============
+DeletionQueue::GetStats
+
+	Returns how many objects are waiting and how long they waited
+===============
+*/
+DeletionQueueStats DeletionQueue::GetStats( void ) const {
+	DeletionQueueStats stats;
+
+	stats.PendingObjects	= m_pendingObjects;
+	stats.DestroyedObjects	= m_destroyedObjects;
+	stats.MaxLatencyFrames	= m_maxLatencyFrames;
+	stats.AverageLatencyMs	= m_destroyedObjects > 0 ? m_totalLatencyMs / m_destroyedObjects : 0.0;
+	stats.MaxLatencyMs		= m_maxLatencyMs;
+
+	return stats;
+}
+/*
+===============
+DeletionQueue::Report
+
+	Writes the queue statistics in a human readable form
+===============
+*/
+void DeletionQueue::Report( std::ostream& out ) const {
+	DeletionQueueStats stats = GetStats();
+
+	out << "Deletion queue: " << stats.PendingObjects << " pending, "
+		<< stats.DestroyedObjects << " destroyed, latency avg "
+		<< stats.AverageLatencyMs << " ms / max " << stats.MaxLatencyMs << " ms ("
+		<< stats.MaxLatencyFrames << " frames)" << std::endl;
+}
+}
@@ -0,0 +1,104 @@
+#ifndef __DELETIONQUEUE_H__
+#define __DELETIONQUEUE_H__
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+namespace tut {
+
+struct DeletionQueueStats {
+	uint64_t	PendingObjects		= 0;
+	uint64_t	DestroyedObjects	= 0;
+	uint64_t	MaxLatencyFrames	= 0;
+	double		AverageLatencyMs	= 0.0;
+	double		MaxLatencyMs		= 0.0;
+};
+
+/*
+===============
+DeletionQueue
+
+	Ring of per-frame buckets holding retired handles. A handle retired while
+	recording frame K is destroyed when frame K's slot comes around again,
+	which is only after the fence guarding that slot has been waited on.
+===============
+*/
+class DeletionQueue {
+public:
+	typedef void ( *DestroyFunc )( uint64_t parent, uint64_t object );
+
+										DeletionQueue( uint32_t framesInFlight );
+										~DeletionQueue( void );
+
+	DeletionQueue( const DeletionQueue& ) = delete;
+	DeletionQueue& operator=( const DeletionQueue& ) = delete;
+
+	void								Push( DestroyFunc destroy, uint64_t parent, uint64_t object );
+	void								BeginFrame( uint64_t frameIndex );
+	void								Flush( void );
+
+	DeletionQueueStats					GetStats( void ) const;
+	void								Report( std::ostream& out ) const;
+
+	/*
+	===============
+	DeletionQueue::ToRaw
+
+		Packs a Vulkan handle (pointer or uint64_t depending on platform) into 64 bits
+	===============
+	*/
+	template<typename T>
+	static uint64_t ToRaw( T handle ) {
+		static_assert( sizeof( T ) <= sizeof( uint64_t ), "Handle does not fit in 64 bits" );
+
+		uint64_t raw = 0;
+		memcpy( &raw, &handle, sizeof( T ) );
+		return raw;
+	}
+	/*
+	===============
+	DeletionQueue::FromRaw
+
+		Unpacks a handle previously packed with ToRaw
+	===============
+	*/
+	template<typename T>
+	static T FromRaw( uint64_t raw ) {
+		T handle;
+		memcpy( &handle, &raw, sizeof( T ) );
+		return handle;
+	}
+
+private:
+	typedef std::chrono::steady_clock	Clock;
+
+	struct Entry {
+		DestroyFunc			Destroy;
+		uint64_t			Parent;
+		uint64_t			Object;
+		Clock::time_point	RetiredAt;
+	};
+
+	struct Bucket {
+		uint64_t			FrameIndex = 0;
+		std::vector<Entry>	Entries;
+	};
+
+	void								DestroyBucket( Bucket& bucket, uint64_t currentFrame );
+
+	std::vector<Bucket>					m_buckets;
+	uint64_t							m_currentFrame{ 0 };
+
+	uint64_t							m_pendingObjects{ 0 };
+	uint64_t							m_destroyedObjects{ 0 };
+	uint64_t							m_maxLatencyFrames{ 0 };
+	double								m_totalLatencyMs{ 0.0 };
+	double								m_maxLatencyMs{ 0.0 };
+};
+
+}
+
+#endif // !__DELETIONQUEUE_H__
@@ -0,0 +1,173 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "HostAllocator.h"
+
+namespace tut {
+
+const uint32_t DescriptorAllocator::FIRST_POOL_SETS;
+const uint32_t DescriptorAllocator::MAX_POOL_SETS;
+
+namespace {
+
+/*
+	Descriptors of each type a pool holds per set. Sets draw from a shared
+	budget, so a pool of mostly buffer sets can still hold a few image heavy
+	ones.
+*/
+const VkDescriptorPoolSize POOL_RATIOS[] = {
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,			2 },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	1 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,			4 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,	1 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	4 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,				4 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER,					1 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,				1 }
+};
+
+}
+
+/*
+===============
+DescriptorAllocator::DescriptorAllocator
+
+	Creates the frame slots, pools are created on first use
+===============
+*/
+DescriptorAllocator::DescriptorAllocator( VkDevice device, uint32_t framesInFlight ) :
+	m_device( device ),
+	m_slots( std::max( framesInFlight, 1u ) )
+{}
+/*
+===============
+DescriptorAllocator::BeginFrame
+
+	Resets every pool the frame slot about to be recorded used. The caller
+	must have waited on the fence of the frame that last used it.
+===============
+*/
+void DescriptorAllocator::BeginFrame( uint64_t frameIndex ) {
+	m_slot = ( uint32_t )( frameIndex % m_slots.size() );
+
+	FrameSlot& slot = m_slots[ m_slot ];
+
+	//Pools past Current were not touched last time around and are already empty
+	for ( uint32_t i = 0; i <= slot.Current && i < slot.Pools.size(); ++i ) {
+		vkResetDescriptorPool( m_device, slot.Pools[ i ], 0 );
+		++m_stats.PoolResets;
+	}
+
+	slot.Current		= 0;
+	slot.SetsAllocated	= 0;
+}
+/*
+===============
+DescriptorAllocator::Allocate
+
+	Allocates a set from the current frame slot. It is valid until the slot's
+	next BeginFrame.
+===============
+*/
+VkDescriptorSet DescriptorAllocator::Allocate( VkDescriptorSetLayout layout ) {
+	FrameSlot&					slot		= m_slots[ m_slot ];
+	VkDescriptorSetAllocateInfo	allocInfo	= {};
+	VkDescriptorSet				set			= VK_NULL_HANDLE;
+
+	allocInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount	= 1;
+	allocInfo.pSetLayouts			= &layout;
+
+	while ( true ) {
+		bool created = slot.Current == slot.Pools.size();
+
+		if ( created ) {
+			CreatePool( slot );
+		}
+
+		allocInfo.descriptorPool = slot.Pools[ slot.Current ];
+
+		VkResult result = vkAllocateDescriptorSets( m_device, &allocInfo, &set );
+
+		if ( result == VK_SUCCESS ) {
+			break;
+		}
+
+		//A set that does not fit in an empty pool is larger than the pool ratios allow for
+		if ( created || ( result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL ) ) {
+			throw std::runtime_error( "Could not allocate descriptor set" );
+		}
+
+		++slot.Current;
+		++m_stats.PoolOverflows;
+	}
+
+	++slot.SetsAllocated;
+	++m_stats.SetsAllocated;
+
+	m_stats.PeakFrameSets	= std::max( m_stats.PeakFrameSets, slot.SetsAllocated );
+	m_stats.PeakFramePools	= std::max( m_stats.PeakFramePools, slot.Current + 1 );
+
+	return set;
+}
+/*
+===============
+DescriptorAllocator::GetStats
+
+	Returns a snapshot of the counters
+===============
+*/
+DescriptorAllocatorStats DescriptorAllocator::GetStats( void ) const {
+	return m_stats;
+}
+/*
+===============
+DescriptorAllocator::Report
+
+	Writes how many sets were handed out and how much pool churn that took
+===============
+*/
+void DescriptorAllocator::Report( std::ostream& out ) const {
+	out << "Descriptor allocator: " << m_stats.SetsAllocated << " sets from " << m_stats.PoolsCreated << " pools, "
+		<< m_stats.PoolResets << " pool resets, " << m_stats.PoolOverflows << " overflows; peak "
+		<< m_stats.PeakFrameSets << " sets in " << m_stats.PeakFramePools << " pools per frame" << std::endl;
+}
+/*
+===============
+DescriptorAllocator::CreatePool
+
+	Appends a pool to the slot, doubling the size of the next one up to
+	MAX_POOL_SETS
+===============
+*/
+void DescriptorAllocator::CreatePool( FrameSlot& slot ) {
+	const uint32_t TYPE_COUNT = sizeof( POOL_RATIOS ) / sizeof( POOL_RATIOS[ 0 ] );
+
+	VkDescriptorPoolSize		poolSizes[ TYPE_COUNT ];
+	VkDescriptorPoolCreateInfo	poolInfo = {};
+
+	for ( uint32_t i = 0; i < TYPE_COUNT; ++i ) {
+		poolSizes[ i ].type				= POOL_RATIOS[ i ].type;
+		poolSizes[ i ].descriptorCount	= POOL_RATIOS[ i ].descriptorCount * m_nextPoolSets;
+	}
+
+	poolInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets		= m_nextPoolSets;
+	poolInfo.poolSizeCount	= TYPE_COUNT;
+	poolInfo.pPoolSizes		= poolSizes;
+
+	VKDescriptorPoolHandle pool = VKDescriptorPoolHandle( m_device );
+
+	if ( vkCreateDescriptorPool( m_device, &poolInfo, HostAllocator::Installed(), pool.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create descriptor pool" );
+	}
+
+	slot.Pools.push_back( std::move( pool ) );
+	++m_stats.PoolsCreated;
+
+	m_nextPoolSets = std::min( m_nextPoolSets * 2, MAX_POOL_SETS );
+}
+
+}
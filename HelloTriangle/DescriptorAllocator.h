@@ -0,0 +1,70 @@
+#ifndef __DESCRIPTORALLOCATOR_H__
+#define __DESCRIPTORALLOCATOR_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "VKHandle.h"
+
+namespace tut {
+
+struct DescriptorAllocatorStats {
+	uint64_t			SetsAllocated	= 0;
+	uint64_t			PoolsCreated	= 0;
+	uint64_t			PoolResets		= 0;
+	uint64_t			PoolOverflows	= 0;	//Allocations that moved on to the next pool
+	uint32_t			PeakFrameSets	= 0;
+	uint32_t			PeakFramePools	= 0;
+};
+
+/*
+===============
+DescriptorAllocator
+
+	Transient descriptor sets, valid for the frame they were allocated in.
+	Each frame slot owns a list of pools that is reset in bulk when the
+	slot comes around again, so sets are never freed one at a time. When a
+	pool runs out the next one in the slot's list is used, and only when
+	the list is exhausted is a new pool created, each one larger than the
+	last. Once a slot has grown to what a frame needs it stops creating
+	pools. Not thread safe.
+===============
+*/
+class DescriptorAllocator {
+public:
+	static const uint32_t								FIRST_POOL_SETS{ 64 };
+	static const uint32_t								MAX_POOL_SETS{ 4096 };
+
+														DescriptorAllocator( VkDevice device, uint32_t framesInFlight );
+
+	DescriptorAllocator( const DescriptorAllocator& ) = delete;
+	DescriptorAllocator& operator=( const DescriptorAllocator& ) = delete;
+
+	void												BeginFrame( uint64_t frameIndex );
+	VkDescriptorSet										Allocate( VkDescriptorSetLayout layout );
+
+	DescriptorAllocatorStats							GetStats( void ) const;
+	void												Report( std::ostream& out ) const;
+
+private:
+	struct FrameSlot {
+		std::vector<VKDescriptorPoolHandle>				Pools;
+		uint32_t										Current			= 0;	//Pools before it are full
+		uint32_t										SetsAllocated	= 0;
+	};
+
+	void												CreatePool( FrameSlot& slot );
+
+	VkDevice											m_device;
+	std::vector<FrameSlot>								m_slots;
+	uint32_t											m_slot{ 0 };
+	uint32_t											m_nextPoolSets{ FIRST_POOL_SETS };
+
+	DescriptorAllocatorStats							m_stats;
+};
+
+}
+
+#endif // !__DESCRIPTORALLOCATOR_H__
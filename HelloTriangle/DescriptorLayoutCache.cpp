@@ -0,0 +1,194 @@
+#include "DescriptorLayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "HostAllocator.h"
+#include "ShaderStore.h"
+
+namespace tut {
+
+/*
+===============
+DescriptorLayoutCache::DescriptorLayoutCache
+
+	Creates an empty cache for the device
+===============
+*/
+DescriptorLayoutCache::DescriptorLayoutCache( VkDevice device ) :
+	m_device( device )
+{}
+/*
+===============
+DescriptorLayoutCache::Get
+
+	Returns the layout for the description, creating it on first request
+===============
+*/
+VkDescriptorSetLayout DescriptorLayoutCache::Get( const DescriptorLayoutDesc& desc ) {
+	DescriptorLayoutDesc	normalized	= Normalize( desc );
+	uint64_t				hash		= Hash( normalized );
+
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	++m_stats.Requests;
+
+	std::pair<std::unordered_multimap<uint64_t, size_t>::const_iterator, std::unordered_multimap<uint64_t, size_t>::const_iterator> range = m_index.equal_range( hash );
+
+	for ( std::unordered_multimap<uint64_t, size_t>::const_iterator it = range.first; it != range.second; ++it ) {
+		if ( Equal( m_entries[ it->second ].Desc, normalized ) ) {
+			++m_stats.Hits;
+			return m_entries[ it->second ].Layout;
+		}
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT	flagsInfo	= {};
+	VkDescriptorSetLayoutCreateInfo					layoutInfo	= {};
+
+	layoutInfo.sType		= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.flags		= normalized.Flags;
+	layoutInfo.bindingCount	= ( uint32_t )normalized.Bindings.size();
+	layoutInfo.pBindings	= normalized.Bindings.data();
+
+	//Without descriptor indexing the struct must not be chained at all
+	bool hasBindingFlags = std::any_of( normalized.BindingFlags.begin(), normalized.BindingFlags.end(), []( VkDescriptorBindingFlagsEXT flags ) { return flags != 0; } );
+
+	if ( hasBindingFlags ) {
+		flagsInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		flagsInfo.bindingCount	= ( uint32_t )normalized.BindingFlags.size();
+		flagsInfo.pBindingFlags	= normalized.BindingFlags.data();
+
+		layoutInfo.pNext = &flagsInfo;
+	}
+
+	Entry entry;
+
+	entry.Layout = VKDescriptorSetLayoutHandle( m_device );
+
+	if ( vkCreateDescriptorSetLayout( m_device, &layoutInfo, HostAllocator::Installed(), entry.Layout.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create descriptor set layout" );
+	}
+
+	VkDescriptorSetLayout layout = entry.Layout;
+
+	entry.Desc = std::move( normalized );
+
+	m_index.insert( std::make_pair( hash, m_entries.size() ) );
+	m_entries.push_back( std::move( entry ) );
+	++m_stats.Layouts;
+
+	return layout;
+}
+/*
+===============
+DescriptorLayoutCache::GetStats
+
+	Returns a snapshot of the counters
+===============
+*/
+DescriptorLayoutCacheStats DescriptorLayoutCache::GetStats( void ) const {
+	std::lock_guard<std::mutex> lock( m_lock );
+	return m_stats;
+}
+/*
+===============
+DescriptorLayoutCache::Report
+
+	Writes how many requests were served by an existing layout
+===============
+*/
+void DescriptorLayoutCache::Report( std::ostream& out ) const {
+	DescriptorLayoutCacheStats stats = GetStats();
+
+	out << "Descriptor layouts: " << stats.Layouts << " created for " << stats.Requests << " requests, "
+		<< stats.Hits << " deduplicated" << std::endl;
+}
+/*
+===============
+DescriptorLayoutCache::Normalize
+
+	Sorts the bindings by binding number, keeping their flags with them, and
+	gives every binding a flags entry so an empty list and all zero flags
+	compare equal
+===============
+*/
+DescriptorLayoutDesc DescriptorLayoutCache::Normalize( const DescriptorLayoutDesc& desc ) {
+	if ( !desc.BindingFlags.empty() && desc.BindingFlags.size() != desc.Bindings.size() ) {
+		throw std::runtime_error( "Descriptor layout binding flags must match the bindings" );
+	}
+
+	std::vector<uint32_t> order( desc.Bindings.size() );
+
+	for ( uint32_t i = 0; i < order.size(); ++i ) {
+		if ( desc.Bindings[ i ].pImmutableSamplers != nullptr ) {
+			throw std::runtime_error( "Descriptor layouts with immutable samplers are not cached" );
+		}
+
+		order[ i ] = i;
+	}
+
+	std::sort( order.begin(), order.end(), [&desc]( uint32_t a, uint32_t b ) { return desc.Bindings[ a ].binding < desc.Bindings[ b ].binding; } );
+
+	DescriptorLayoutDesc normalized;
+
+	normalized.Flags = desc.Flags;
+
+	for ( uint32_t index : order ) {
+		normalized.Bindings.push_back( desc.Bindings[ index ] );
+		normalized.BindingFlags.push_back( desc.BindingFlags.empty() ? 0 : desc.BindingFlags[ index ] );
+	}
+
+	return normalized;
+}
+/*
+===============
+DescriptorLayoutCache::Hash
+
+	Hashes the fields one word at a time, since the binding struct has
+	padding and a pointer that must not take part
+===============
+*/
+uint64_t DescriptorLayoutCache::Hash( const DescriptorLayoutDesc& desc ) {
+	std::vector<uint32_t> words;
+
+	words.reserve( 2 + desc.Bindings.size() * 5 );
+	words.push_back( desc.Flags );
+	words.push_back( ( uint32_t )desc.Bindings.size() );
+
+	for ( size_t i = 0; i < desc.Bindings.size(); ++i ) {
+		const VkDescriptorSetLayoutBinding& binding = desc.Bindings[ i ];
+
+		words.push_back( binding.binding );
+		words.push_back( ( uint32_t )binding.descriptorType );
+		words.push_back( binding.descriptorCount );
+		words.push_back( binding.stageFlags );
+		words.push_back( desc.BindingFlags[ i ] );
+	}
+
+	return ShaderStore::Hash( words.data(), words.size() * sizeof( uint32_t ) );
+}
+/*
+===============
+DescriptorLayoutCache::Equal
+
+	Compares two normalized descriptions field by field
+===============
+*/
+bool DescriptorLayoutCache::Equal( const DescriptorLayoutDesc& a, const DescriptorLayoutDesc& b ) {
+	if ( a.Flags != b.Flags || a.Bindings.size() != b.Bindings.size() || a.BindingFlags != b.BindingFlags ) {
+		return false;
+	}
+
+	for ( size_t i = 0; i < a.Bindings.size(); ++i ) {
+		const VkDescriptorSetLayoutBinding& lhs = a.Bindings[ i ];
+		const VkDescriptorSetLayoutBinding& rhs = b.Bindings[ i ];
+
+		if ( lhs.binding != rhs.binding || lhs.descriptorType != rhs.descriptorType || lhs.descriptorCount != rhs.descriptorCount || lhs.stageFlags != rhs.stageFlags ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef __DESCRIPTORLAYOUTCACHE_H__
+#define __DESCRIPTORLAYOUTCACHE_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+	Everything a descriptor set layout is created from. BindingFlags is
+	either empty or holds one VkDescriptorBindingFlagsEXT per binding, in
+	the same order. Immutable samplers are not supported.
+*/
+struct DescriptorLayoutDesc {
+	std::vector<VkDescriptorSetLayoutBinding>	Bindings;
+	std::vector<VkDescriptorBindingFlagsEXT>	BindingFlags;
+	VkDescriptorSetLayoutCreateFlags			Flags	= 0;
+};
+
+struct DescriptorLayoutCacheStats {
+	uint64_t			Requests		= 0;
+	uint64_t			Hits			= 0;
+	uint64_t			Layouts			= 0;
+};
+
+/*
+===============
+DescriptorLayoutCache
+
+	Creates each distinct descriptor set layout once. Descriptions are
+	hashed after sorting their bindings, so two systems that declare the
+	same bindings in a different order share a layout, and with it set
+	compatibility across pipeline layouts. Layouts live as long as the
+	cache. Thread safe.
+===============
+*/
+class DescriptorLayoutCache {
+public:
+												DescriptorLayoutCache( VkDevice device );
+
+	DescriptorLayoutCache( const DescriptorLayoutCache& ) = delete;
+	DescriptorLayoutCache& operator=( const DescriptorLayoutCache& ) = delete;
+
+	VkDescriptorSetLayout						Get( const DescriptorLayoutDesc& desc );
+
+	DescriptorLayoutCacheStats					GetStats( void ) const;
+	void										Report( std::ostream& out ) const;
+
+private:
+	struct Entry {
+		DescriptorLayoutDesc					Desc;
+		VKDescriptorSetLayoutHandle				Layout;
+	};
+
+	static DescriptorLayoutDesc					Normalize( const DescriptorLayoutDesc& desc );
+	static uint64_t								Hash( const DescriptorLayoutDesc& desc );
+	static bool									Equal( const DescriptorLayoutDesc& a, const DescriptorLayoutDesc& b );
+
+	VkDevice									m_device;
+
+	mutable std::mutex							m_lock;
+	std::unordered_multimap<uint64_t, size_t>	m_index;	//Hash to index into m_entries
+	std::vector<Entry>							m_entries;
+	DescriptorLayoutCacheStats					m_stats;
+};
+
+}
+
+#endif // !__DESCRIPTORLAYOUTCACHE_H__
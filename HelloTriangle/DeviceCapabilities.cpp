@@ -0,0 +1,247 @@
+#include "DeviceCapabilities.h"
+
+#include <algorithm>
+
+namespace tut {
+
+namespace {
+
+const int64_t		DISCRETE_SCORE{ 10000 };
+const int64_t		INTEGRATED_SCORE{ 5000 };
+const int64_t		VIRTUAL_SCORE{ 2000 };
+const int64_t		CPU_SCORE{ 1000 };
+const int64_t		DEDICATED_QUEUE_SCORE{ 500 };
+const VkDeviceSize	VRAM_SCORE_UNIT{ 64ull << 20 };	//One point per 64 MiB of device local memory
+const int64_t		MAX_VRAM_SCORE{ 4096 };
+
+}
+
+/*
+===============
+DeviceCapabilities::Query
+
+	Reads everything about a device in one go. Surface support, formats and
+	present modes are only read when a surface is given. Extension features
+	are only read when the instance enabled
+	VK_KHR_get_physical_device_properties2.
+===============
+*/
+DeviceCapabilities DeviceCapabilities::Query( VkInstance instance, VkPhysicalDevice device, VkSurfaceKHR surface ) {
+	DeviceCapabilities capabilities;
+
+	capabilities.Device = device;
+
+	vkGetPhysicalDeviceProperties( device, &capabilities.Properties );
+	vkGetPhysicalDeviceFeatures( device, &capabilities.Features );
+	vkGetPhysicalDeviceMemoryProperties( device, &capabilities.Memory );
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties( device, &familyCount, nullptr );
+
+	capabilities.QueueFamilies.resize( familyCount );
+	vkGetPhysicalDeviceQueueFamilyProperties( device, &familyCount, capabilities.QueueFamilies.data() );
+
+	capabilities.PresentSupport.assign( familyCount, VK_FALSE );
+
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, nullptr );
+
+	std::vector<VkExtensionProperties> extensions( extensionCount );
+	vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, extensions.data() );
+
+	for ( const VkExtensionProperties& extension : extensions ) {
+		capabilities.Extensions.push_back( extension.extensionName );
+	}
+
+	PFN_vkGetPhysicalDeviceFeatures2KHR		getFeatures2	= ( PFN_vkGetPhysicalDeviceFeatures2KHR )vkGetInstanceProcAddr( instance, "vkGetPhysicalDeviceFeatures2KHR" );
+	PFN_vkGetPhysicalDeviceProperties2KHR	getProperties2	= ( PFN_vkGetPhysicalDeviceProperties2KHR )vkGetInstanceProcAddr( instance, "vkGetPhysicalDeviceProperties2KHR" );
+
+	if ( getFeatures2 != nullptr && getProperties2 != nullptr && capabilities.HasExtension( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME ) ) {
+		VkPhysicalDeviceFeatures2KHR	features	= {};
+		VkPhysicalDeviceProperties2KHR	properties	= {};
+
+		capabilities.DescriptorIndexing.sType		= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		capabilities.DescriptorIndexingLimits.sType	= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+		features.sType		= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		features.pNext		= &capabilities.DescriptorIndexing;
+		properties.sType	= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+		properties.pNext	= &capabilities.DescriptorIndexingLimits;
+
+		getFeatures2( device, &features );
+		getProperties2( device, &properties );
+
+		//The chain pointed into this struct, which is about to be copied
+		capabilities.DescriptorIndexing.pNext		= nullptr;
+		capabilities.DescriptorIndexingLimits.pNext	= nullptr;
+	}
+
+	if ( surface == VK_NULL_HANDLE ) {
+		return capabilities;
+	}
+
+	for ( uint32_t i = 0; i < familyCount; ++i ) {
+		vkGetPhysicalDeviceSurfaceSupportKHR( device, i, surface, &capabilities.PresentSupport[ i ] );
+	}
+
+	capabilities.RefreshSurfaceCapabilities( surface );
+
+	uint32_t formatCount = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR( device, surface, &formatCount, nullptr );
+
+	capabilities.Surface.formats.resize( formatCount );
+	vkGetPhysicalDeviceSurfaceFormatsKHR( device, surface, &formatCount, capabilities.Surface.formats.data() );
+
+	uint32_t presentModeCount = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR( device, surface, &presentModeCount, nullptr );
+
+	capabilities.Surface.presentModes.resize( presentModeCount );
+	vkGetPhysicalDeviceSurfacePresentModesKHR( device, surface, &presentModeCount, capabilities.Surface.presentModes.data() );
+
+	return capabilities;
+}
+/*
+===============
+DeviceCapabilities::RefreshSurfaceCapabilities
+
+	Rereads the surface extent limits and transform, which follow the window
+===============
+*/
+void DeviceCapabilities::RefreshSurfaceCapabilities( VkSurfaceKHR surface ) {
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR( Device, surface, &Surface.capabilities );
+}
+/*
+===============
+DeviceCapabilities::HasExtension
+
+	Returns if the device exposes an extension
+===============
+*/
+bool DeviceCapabilities::HasExtension( const char* name ) const {
+	for ( const std::string& extension : Extensions ) {
+		if ( extension == name ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+/*
+===============
+DeviceCapabilities::FindQueueFamily
+
+	Returns the first queue family with all required and none of the excluded
+	flags, or -1
+===============
+*/
+int DeviceCapabilities::FindQueueFamily( VkQueueFlags required, VkQueueFlags excluded ) const {
+	for ( uint32_t i = 0; i < QueueFamilies.size(); ++i ) {
+		const VkQueueFamilyProperties& family = QueueFamilies[ i ];
+
+		if ( family.queueCount > 0 && ( family.queueFlags & required ) == required && ( family.queueFlags & excluded ) == 0 ) {
+			return ( int )i;
+		}
+	}
+
+	return -1;
+}
+/*
+===============
+DeviceCapabilities::FindQueueFamilies
+
+	Picks the graphics and present families, preferring one family for both,
+	and the dedicated compute and transfer families if the device has them
+===============
+*/
+QueueFamilyIndicies DeviceCapabilities::FindQueueFamilies( bool needsPresent ) const {
+	QueueFamilyIndicies indicies;
+
+	indicies.GraphicsFamily	= FindQueueFamily( VK_QUEUE_GRAPHICS_BIT, 0 );
+	indicies.ComputeFamily	= FindQueueFamily( VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT );
+	indicies.TransferFamily	= FindQueueFamily( VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT );
+
+	if ( !needsPresent ) {
+		return indicies;
+	}
+
+	if ( indicies.GraphicsFamily >= 0 && PresentSupport[ indicies.GraphicsFamily ] ) {
+		indicies.PresentFamily = indicies.GraphicsFamily;
+		return indicies;
+	}
+
+	for ( uint32_t i = 0; i < QueueFamilies.size(); ++i ) {
+		if ( QueueFamilies[ i ].queueCount > 0 && PresentSupport[ i ] ) {
+			indicies.PresentFamily = ( int )i;
+			break;
+		}
+	}
+
+	return indicies;
+}
+/*
+===============
+DeviceCapabilities::DeviceLocalBytes
+
+	Returns the size of the largest device local heap
+===============
+*/
+VkDeviceSize DeviceCapabilities::DeviceLocalBytes( void ) const {
+	VkDeviceSize largest = 0;
+
+	for ( uint32_t i = 0; i < Memory.memoryHeapCount; ++i ) {
+		if ( Memory.memoryHeaps[ i ].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ) {
+			largest = std::max( largest, Memory.memoryHeaps[ i ].size );
+		}
+	}
+
+	return largest;
+}
+/*
+===============
+DeviceCapabilities::Score
+
+	Ranks the device for rendering. The device type dominates, then memory,
+	with a bonus for each dedicated compute or transfer family since those
+	let uploads and async work run beside graphics.
+===============
+*/
+int64_t DeviceCapabilities::Score( void ) const {
+	int64_t score = 0;
+
+	switch ( Properties.deviceType ) {
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:		score += DISCRETE_SCORE;	break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:	score += INTEGRATED_SCORE;	break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:		score += VIRTUAL_SCORE;		break;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:				score += CPU_SCORE;			break;
+		default:										break;
+	}
+
+	score += std::min( MAX_VRAM_SCORE, ( int64_t )( DeviceLocalBytes() / VRAM_SCORE_UNIT ) );
+
+	if ( FindQueueFamily( VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT ) >= 0 ) {
+		score += DEDICATED_QUEUE_SCORE;
+	}
+
+	if ( FindQueueFamily( VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) >= 0 ) {
+		score += DEDICATED_QUEUE_SCORE;
+	}
+
+	return score;
+}
+/*
+===============
+DeviceCapabilities::TypeName
+
+	Returns the device type for reports
+===============
+*/
+const char* DeviceCapabilities::TypeName( void ) const {
+	switch ( Properties.deviceType ) {
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:		return "discrete";
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:	return "integrated";
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:		return "virtual";
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:				return "cpu";
+		default:										return "other";
+	}
+}
+}
@@ -0,0 +1,50 @@
+#ifndef __DEVICECAPABILITIES_H__
+#define __DEVICECAPABILITIES_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "QueueFamilyIndicies.h"
+#include "SwapChainSupportDetails.h"
+
+namespace tut {
+
+/*
+===============
+DeviceCapabilities
+
+	Everything the application asks a physical device, queried once. Only the
+	surface capabilities change at run time, as the window is resized, so
+	they alone can be refreshed.
+===============
+*/
+struct DeviceCapabilities {
+	VkPhysicalDevice						Device				= VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties				Properties;
+	VkPhysicalDeviceFeatures				Features;
+	VkPhysicalDeviceMemoryProperties		Memory;
+	//Zeroed unless the device has VK_EXT_descriptor_indexing and the instance VK_KHR_get_physical_device_properties2
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT	DescriptorIndexing			= {};
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT	DescriptorIndexingLimits	= {};
+	std::vector<VkQueueFamilyProperties>	QueueFamilies;
+	std::vector<VkBool32>					PresentSupport;		//Per queue family, all false without a surface
+	std::vector<std::string>				Extensions;
+	SwapChainSupportDetails					Surface;			//Empty without a surface
+
+	static DeviceCapabilities				Query( VkInstance instance, VkPhysicalDevice device, VkSurfaceKHR surface );
+	void									RefreshSurfaceCapabilities( VkSurfaceKHR surface );
+
+	bool									HasExtension( const char* name ) const;
+	int										FindQueueFamily( VkQueueFlags required, VkQueueFlags excluded ) const;
+	QueueFamilyIndicies						FindQueueFamilies( bool needsPresent ) const;
+	VkDeviceSize							DeviceLocalBytes( void ) const;
+
+	int64_t									Score( void ) const;
+	const char*								TypeName( void ) const;
+};
+
+}
+
+#endif // !__DEVICECAPABILITIES_H__
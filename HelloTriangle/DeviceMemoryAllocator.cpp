@@ -0,0 +1,676 @@
+#include "DeviceMemoryAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tut {
+
+namespace {
+
+const VkDeviceSize	DEFAULT_BLOCK_SIZE{ 64 * 1024 * 1024 };
+const VkDeviceSize	MIN_BLOCK_SIZE{ 4 * 1024 * 1024 };
+const VkDeviceSize	MIN_ALLOCATION_SIZE{ 256 };
+const VkDeviceSize	TRANSIENT_PAGE_SIZE{ 16 * 1024 * 1024 };
+
+/*
+===============
+PreviousPowerOfTwo
+
+	Rounds value down to a power of two
+===============
+*/
+VkDeviceSize PreviousPowerOfTwo( VkDeviceSize value ) {
+	VkDeviceSize power = 1;
+
+	while ( power * 2 <= value ) {
+		power *= 2;
+	}
+
+	return power;
+}
+/*
+===============
+FreeDeferred
+
+	DeletionQueue callback returning a retired allocation
+===============
+*/
+void FreeDeferred( uint64_t allocator, uint64_t allocation ) {
+	DeletionQueue::FromRaw<DeviceMemoryAllocator*>( allocator )->Free( DeletionQueue::FromRaw<DeviceAllocation*>( allocation ) );
+}
+
+}
+
+/*
+	A VkDeviceMemory allocation. Pooled blocks carry a buddy allocator and
+	remember which allocation owns each offset so they can be defragmented,
+	null for the source ranges of moves not yet ended.
+	Dedicated blocks hold exactly one allocation and have no allocator.
+	Memory is freed through Backend.
+*/
+struct DeviceMemoryBlock {
+	const DeviceMemoryBackend*							Backend;
+	VkDevice											Device;
+	VkDeviceMemory										Memory	= VK_NULL_HANDLE;
+	std::unique_ptr<BuddyAllocator>						Allocator;
+	void*												Mapped	= nullptr;
+	VkDeviceSize										Size	= 0;
+	std::unordered_map<VkDeviceSize, DeviceAllocation*>	Owners;
+
+	DeviceMemoryBlock( const DeviceMemoryBackend& backend, VkDevice device ) : Backend( &backend ), Device( device ) {}
+	~DeviceMemoryBlock( void ) {
+		if ( Memory != VK_NULL_HANDLE ) {
+			Backend->FreeMemory( Device, Memory, HostAllocator::Installed() );
+		}
+	}
+
+	DeviceMemoryBlock( const DeviceMemoryBlock& ) = delete;
+	DeviceMemoryBlock& operator=( const DeviceMemoryBlock& ) = delete;
+};
+
+/*
+===============
+DeviceMemoryBackend::Vulkan
+
+	Returns the loader's entry points
+===============
+*/
+DeviceMemoryBackend DeviceMemoryBackend::Vulkan( void ) {
+	DeviceMemoryBackend backend;
+
+	backend.AllocateMemory				= vkAllocateMemory;
+	backend.FreeMemory					= vkFreeMemory;
+	backend.MapMemory					= vkMapMemory;
+	backend.GetBufferMemoryRequirements	= vkGetBufferMemoryRequirements;
+	backend.GetImageMemoryRequirements	= vkGetImageMemoryRequirements;
+	backend.BindBufferMemory			= vkBindBufferMemory;
+	backend.BindImageMemory				= vkBindImageMemory;
+
+	return backend;
+}
+
+/*
+===============
+DeviceMemoryAllocator::DeviceMemoryAllocator
+
+	Reads the memory types and heaps of the physical device and sets up one
+	pool per memory type and resource kind
+===============
+*/
+DeviceMemoryAllocator::DeviceMemoryAllocator( const DeviceCapabilities& capabilities, VkDevice device, uint32_t frameSlots ) :
+	DeviceMemoryAllocator( capabilities, device, frameSlots, DeviceMemoryBackend::Vulkan() )
+{
+}
+/*
+===============
+DeviceMemoryAllocator::DeviceMemoryAllocator
+
+	Same, calling backend instead of Vulkan
+===============
+*/
+DeviceMemoryAllocator::DeviceMemoryAllocator( const DeviceCapabilities& capabilities, VkDevice device, uint32_t frameSlots, const DeviceMemoryBackend& backend ) :
+	m_device( device ),
+	m_backend( backend ),
+	m_memoryProperties( capabilities.Memory ),
+	m_blockSize( DEFAULT_BLOCK_SIZE ),
+	m_transientPages( std::max( frameSlots, 1u ) )
+{
+	m_maxAllocationCount = capabilities.Properties.limits.maxMemoryAllocationCount;
+
+	//Keep blocks small enough that a heap holds several of them
+	for ( uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i ) {
+		VkDeviceSize heapShare = PreviousPowerOfTwo( m_memoryProperties.memoryHeaps[ i ].size / 8 );
+
+		m_blockSize = std::max( MIN_BLOCK_SIZE, std::min( m_blockSize, heapShare ) );
+	}
+
+	m_pools.resize( m_memoryProperties.memoryTypeCount * 2 );
+	for ( uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i ) {
+		m_pools[ PoolIndex( i, DeviceResourceKind::Linear ) ].MemoryTypeIndex	= i;
+		m_pools[ PoolIndex( i, DeviceResourceKind::Linear ) ].Kind				= DeviceResourceKind::Linear;
+		m_pools[ PoolIndex( i, DeviceResourceKind::Optimal ) ].MemoryTypeIndex	= i;
+		m_pools[ PoolIndex( i, DeviceResourceKind::Optimal ) ].Kind				= DeviceResourceKind::Optimal;
+	}
+}
+/*
+===============
+DeviceMemoryAllocator::~DeviceMemoryAllocator
+
+	Frees every block. Resources bound to them must be destroyed already.
+===============
+*/
+DeviceMemoryAllocator::~DeviceMemoryAllocator( void ) {
+	m_allocations.clear();
+	m_transientPages.clear();
+	m_pools.clear();
+}
+/*
+===============
+DeviceMemoryAllocator::Allocate
+
+	Sub-allocates memory for a long lived resource. Requests bigger than half
+	a block get their own VkDeviceMemory.
+===============
+*/
+DeviceAllocation* DeviceMemoryAllocator::Allocate( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, DeviceResourceKind kind ) {
+	uint32_t							memoryTypeIndex = FindMemoryType( requirements.memoryTypeBits, required, preferred );
+	uint32_t							poolIndex		= PoolIndex( memoryTypeIndex, kind );
+	Pool&								pool			= m_pools[ poolIndex ];
+	std::unique_ptr<DeviceAllocation>	allocation		= std::make_unique<DeviceAllocation>();
+
+	allocation->MemoryTypeIndex	= memoryTypeIndex;
+	allocation->PoolIndex		= poolIndex;
+
+	if ( requirements.size > m_blockSize / 2 ) {
+		std::unique_ptr<DeviceMemoryBlock> block = std::make_unique<DeviceMemoryBlock>( m_backend, m_device );
+
+		block->Size = requirements.size;
+		AllocateDeviceMemory( block->Memory, requirements.size, memoryTypeIndex, &block->Mapped );
+
+		allocation->Memory	= block->Memory;
+		allocation->Size	= requirements.size;
+		allocation->Mapped	= block->Mapped;
+		allocation->Block	= block.get();
+
+		block->Owners[ 0 ] = allocation.get();
+
+		pool.Blocks.push_back( std::move( block ) );
+		++m_dedicatedCount;
+	} else {
+		bool allocated = false;
+
+		for ( std::unique_ptr<DeviceMemoryBlock>& block : pool.Blocks ) {
+			if ( block->Allocator && AllocateFromBlock( *block, requirements.size, requirements.alignment, *allocation ) ) {
+				allocated = true;
+				break;
+			}
+		}
+
+		if ( !allocated && !AllocateFromBlock( *CreateBlock( pool ), requirements.size, requirements.alignment, *allocation ) ) {
+			throw std::runtime_error( "Failed to sub-allocate device memory" );
+		}
+	}
+
+	DeviceAllocation* result = allocation.get();
+	m_allocations[ result ] = std::move( allocation );
+
+	return result;
+}
+/*
+===============
+DeviceMemoryAllocator::AllocateForBuffer
+
+	Allocates memory for a buffer and binds it
+===============
+*/
+DeviceAllocation* DeviceMemoryAllocator::AllocateForBuffer( VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred ) {
+	VkMemoryRequirements requirements;
+	m_backend.GetBufferMemoryRequirements( m_device, buffer, &requirements );
+
+	DeviceAllocation* allocation = Allocate( requirements, required, preferred, DeviceResourceKind::Linear );
+
+	if ( m_backend.BindBufferMemory( m_device, buffer, allocation->Memory, allocation->Offset ) != VK_SUCCESS ) {
+		Free( allocation );
+		throw std::runtime_error( "Failed to bind buffer memory" );
+	}
+
+	return allocation;
+}
+/*
+===============
+DeviceMemoryAllocator::AllocateForImage
+
+	Allocates memory for an optimally tiled image and binds it
+===============
+*/
+DeviceAllocation* DeviceMemoryAllocator::AllocateForImage( VkImage image, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred ) {
+	VkMemoryRequirements requirements;
+	m_backend.GetImageMemoryRequirements( m_device, image, &requirements );
+
+	DeviceAllocation* allocation = Allocate( requirements, required, preferred, DeviceResourceKind::Optimal );
+
+	if ( m_backend.BindImageMemory( m_device, image, allocation->Memory, allocation->Offset ) != VK_SUCCESS ) {
+		Free( allocation );
+		throw std::runtime_error( "Failed to bind image memory" );
+	}
+
+	return allocation;
+}
+/*
+===============
+DeviceMemoryAllocator::Free
+
+	Returns an allocation to its block, releasing blocks that became empty
+===============
+*/
+void DeviceMemoryAllocator::Free( DeviceAllocation* allocation ) {
+	if ( allocation == nullptr ) {
+		return;
+	}
+
+	std::unordered_map<DeviceAllocation*, std::unique_ptr<DeviceAllocation>>::iterator entry = m_allocations.find( allocation );
+	if ( entry == m_allocations.end() ) {
+		throw std::runtime_error( "Freeing device memory that was not allocated here" );
+	}
+
+	Pool&				pool	= m_pools[ allocation->PoolIndex ];
+	DeviceMemoryBlock*	block	= allocation->Block;
+
+	if ( block->Allocator ) {
+		block->Allocator->Free( allocation->Offset );
+	} else {
+		--m_dedicatedCount;
+	}
+
+	block->Owners.erase( allocation->Offset );
+
+	m_allocations.erase( entry );
+
+	ReleaseEmptyBlocks( pool );
+}
+/*
+===============
+DeviceMemoryAllocator::Retire
+
+	Frees an allocation once the deletion queue reaches it, when the frames
+	that may still use it have finished. Does nothing for null.
+===============
+*/
+void DeviceMemoryAllocator::Retire( DeletionQueue& deletionQueue, DeviceAllocation* allocation ) {
+	if ( allocation != nullptr ) {
+		deletionQueue.Push( FreeDeferred, DeletionQueue::ToRaw( this ), DeletionQueue::ToRaw( allocation ) );
+	}
+}
+/*
+===============
+DeviceMemoryAllocator::AllocateTransient
+
+	Allocates from the linear pages of the current frame slot. The memory is
+	only valid until the slot is reused, there is no individual free.
+===============
+*/
+DeviceAllocation DeviceMemoryAllocator::AllocateTransient( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, DeviceResourceKind kind ) {
+	uint32_t									memoryTypeIndex	= FindMemoryType( requirements.memoryTypeBits, required, preferred );
+	std::vector<std::unique_ptr<TransientPage>>&	pages			= m_transientPages[ m_currentFrameSlot ];
+	DeviceAllocation							allocation;
+
+	allocation.MemoryTypeIndex	= memoryTypeIndex;
+	allocation.Size				= requirements.size;
+
+	for ( std::unique_ptr<TransientPage>& page : pages ) {
+		if ( page->MemoryTypeIndex != memoryTypeIndex || page->Kind != kind ) {
+			continue;
+		}
+
+		uint64_t offset = page->Allocator.Allocate( requirements.size, requirements.alignment );
+		if ( offset != BuddyAllocator::INVALID_OFFSET ) {
+			allocation.Memory	= page->Memory;
+			allocation.Offset	= offset;
+			allocation.Mapped	= page->Mapped != nullptr ? ( uint8_t* )page->Mapped + offset : nullptr;
+			return allocation;
+		}
+	}
+
+	std::unique_ptr<TransientPage> page = std::make_unique<TransientPage>( m_backend, m_device, std::max( TRANSIENT_PAGE_SIZE, requirements.size ) );
+
+	page->MemoryTypeIndex	= memoryTypeIndex;
+	page->Kind				= kind;
+	AllocateDeviceMemory( page->Memory, page->Allocator.Size(), memoryTypeIndex, &page->Mapped );
+
+	allocation.Memory	= page->Memory;
+	allocation.Offset	= page->Allocator.Allocate( requirements.size, requirements.alignment );
+	allocation.Mapped	= page->Mapped;
+
+	pages.push_back( std::move( page ) );
+
+	return allocation;
+}
+/*
+===============
+DeviceMemoryAllocator::BeginFrame
+
+	Resets the transient pages of the frame slot about to be recorded. The
+	caller must have waited on the fence of the frame that last used it.
+===============
+*/
+void DeviceMemoryAllocator::BeginFrame( uint64_t frameIndex ) {
+	m_currentFrameSlot = ( uint32_t )( frameIndex % m_transientPages.size() );
+
+	for ( std::unique_ptr<TransientPage>& page : m_transientPages[ m_currentFrameSlot ] ) {
+		page->Allocator.Reset();
+	}
+}
+/*
+===============
+DeviceMemoryAllocator::BeginDefragmentation
+
+	Moves allocations of one owner out of the least used block of each pool
+	into the other blocks. Only blocks holding nothing but that owner's
+	allocations are drained, as nobody else would rebuild their resources.
+	The returned allocations already describe their new location; the owner
+	copies the contents from SourceMemory/SourceOffset, rebinds its resources
+	and then calls EndDefragmentation to release the old ranges, once nothing
+	in flight reads them any more.
+===============
+*/
+std::vector<DefragmentationMove> DeviceMemoryAllocator::BeginDefragmentation( const void* owner, uint32_t maxMoves ) {
+	std::vector<DefragmentationMove> moves;
+
+	for ( Pool& pool : m_pools ) {
+		std::vector<DeviceMemoryBlock*>	blocks;
+		DeviceMemoryBlock*				source	= nullptr;
+
+		for ( std::unique_ptr<DeviceMemoryBlock>& block : pool.Blocks ) {
+			if ( !block->Allocator || block->Allocator->IsEmpty() ) {
+				continue;
+			}
+
+			blocks.push_back( block.get() );
+
+			//Source ranges of unfinished moves have no owner
+			bool drainable = true;
+			for ( const std::pair<const VkDeviceSize, DeviceAllocation*>& owned : block->Owners ) {
+				if ( owned.second == nullptr || owned.second->Owner != owner ) {
+					drainable = false;
+					break;
+				}
+			}
+
+			if ( drainable && ( source == nullptr || block->Allocator->UsedBytes() < source->Allocator->UsedBytes() ) ) {
+				source = block.get();
+			}
+		}
+
+		if ( owner == nullptr || source == nullptr || blocks.size() < 2 ) {
+			continue;
+		}
+
+		//Fill the fullest blocks first so the emptiest ones drain
+		std::sort( blocks.begin(), blocks.end(), []( const DeviceMemoryBlock* a, const DeviceMemoryBlock* b ) {
+			return a->Allocator->UsedBytes() > b->Allocator->UsedBytes();
+		} );
+
+		for ( uint64_t offset : source->Allocator->GetAllocations() ) {
+			if ( moves.size() >= maxMoves ) {
+				return moves;
+			}
+
+			DeviceAllocation*	allocation	= source->Owners[ offset ];
+			DeviceAllocation	moved		= *allocation;
+			VkDeviceSize		alignment	= source->Allocator->AllocationSize( offset );
+			bool				relocated	= false;
+
+			//Buddy blocks are aligned to their size, so reusing it as the
+			//alignment keeps the original alignment guarantee
+			for ( size_t i = 0; i < blocks.size() && !relocated; ++i ) {
+				if ( blocks[ i ] != source ) {
+					relocated = AllocateFromBlock( *blocks[ i ], allocation->Size, alignment, moved );
+				}
+			}
+
+			if ( !relocated ) {
+				continue;
+			}
+
+			DefragmentationMove move;
+
+			move.Allocation		= allocation;
+			move.SourceMemory	= allocation->Memory;
+			move.SourceOffset	= allocation->Offset;
+			move.SourceMapped	= allocation->Mapped;
+			move.SourceBlock	= source;
+
+			*allocation							= moved;
+			moved.Block->Owners[ moved.Offset ]	= allocation;
+			source->Owners[ offset ]			= nullptr;
+
+			moves.push_back( move );
+		}
+	}
+
+	return moves;
+}
+/*
+===============
+DeviceMemoryAllocator::EndDefragmentation
+
+	Releases the source ranges of finished moves and any block left empty.
+	The source range keeps its block alive until then, so this is safe even
+	when the moved allocation was freed in the meantime.
+===============
+*/
+void DeviceMemoryAllocator::EndDefragmentation( const std::vector<DefragmentationMove>& moves ) {
+	for ( const DefragmentationMove& move : moves ) {
+		move.SourceBlock->Allocator->Free( move.SourceOffset );
+		move.SourceBlock->Owners.erase( move.SourceOffset );
+	}
+
+	for ( Pool& pool : m_pools ) {
+		ReleaseEmptyBlocks( pool );
+	}
+}
+/*
+===============
+DeviceMemoryAllocator::FindMemoryType
+
+	Picks a memory type with all the required and, if possible, all the
+	preferred property flags
+===============
+*/
+uint32_t DeviceMemoryAllocator::FindMemoryType( uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred ) const {
+	for ( uint32_t pass = 0; pass < 2; ++pass ) {
+		VkMemoryPropertyFlags wanted = pass == 0 ? required | preferred : required;
+
+		for ( uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i ) {
+			if ( ( typeBits & ( 1u << i ) ) && ( m_memoryProperties.memoryTypes[ i ].propertyFlags & wanted ) == wanted ) {
+				return i;
+			}
+		}
+	}
+
+	throw std::runtime_error( "No suitable memory type found" );
+}
+/*
+===============
+DeviceMemoryAllocator::GetMemoryProperties
+
+	Returns the memory types and heaps of the physical device
+===============
+*/
+const VkPhysicalDeviceMemoryProperties& DeviceMemoryAllocator::GetMemoryProperties( void ) const {
+	return m_memoryProperties;
+}
+/*
+===============
+DeviceMemoryAllocator::BlockSize
+
+	Returns the size of pooled blocks, requests over half of it get their
+	own VkDeviceMemory
+===============
+*/
+VkDeviceSize DeviceMemoryAllocator::BlockSize( void ) const {
+	return m_blockSize;
+}
+/*
+===============
+DeviceMemoryAllocator::GetStats
+
+	Returns block and allocation counts across all pools
+===============
+*/
+DeviceMemoryStats DeviceMemoryAllocator::GetStats( void ) const {
+	DeviceMemoryStats stats;
+
+	for ( const Pool& pool : m_pools ) {
+		for ( const std::unique_ptr<DeviceMemoryBlock>& block : pool.Blocks ) {
+			if ( block->Allocator ) {
+				++stats.BlockCount;
+				stats.EmptyBlockCount	+= block->Allocator->IsEmpty() ? 1 : 0;
+				stats.ReservedBytes	+= block->Size;
+				stats.UsedBytes		+= block->Allocator->UsedBytes();
+			} else {
+				stats.ReservedBytes	+= block->Size;
+				stats.UsedBytes		+= block->Size;
+			}
+		}
+	}
+
+	for ( const std::vector<std::unique_ptr<TransientPage>>& pages : m_transientPages ) {
+		for ( const std::unique_ptr<TransientPage>& page : pages ) {
+			++stats.TransientPageCount;
+			stats.ReservedBytes		+= page->Allocator.Size();
+			stats.TransientBytes	+= page->Allocator.UsedBytes();
+		}
+	}
+
+	stats.DedicatedCount		= m_dedicatedCount;
+	stats.AllocationCount		= m_allocations.size();
+	stats.MaxAllocationCount	= m_maxAllocationCount;
+
+	return stats;
+}
+/*
+===============
+DeviceMemoryAllocator::Report
+
+	Writes the allocator statistics in a human readable form
+===============
+*/
+void DeviceMemoryAllocator::Report( std::ostream& out ) const {
+	DeviceMemoryStats stats = GetStats();
+
+	out << "Device memory: " << stats.AllocationCount << " allocations in "
+		<< stats.BlockCount << " blocks, " << stats.DedicatedCount << " dedicated, "
+		<< stats.TransientPageCount << " transient pages; "
+		<< stats.UsedBytes << " / " << stats.ReservedBytes << " bytes used; "
+		<< m_deviceMemoryCount << " of " << stats.MaxAllocationCount << " vkAllocateMemory slots" << std::endl;
+}
+/*
+===============
+DeviceMemoryAllocator::AllocateDeviceMemory
+
+	Calls vkAllocateMemory and maps host visible memory persistently. The
+	caller frees memory, which stays null when this throws.
+===============
+*/
+VkDeviceMemory DeviceMemoryAllocator::AllocateDeviceMemory( VkDeviceMemory& memory, VkDeviceSize size, uint32_t memoryTypeIndex, void** mapped ) {
+	if ( m_deviceMemoryCount >= m_maxAllocationCount ) {
+		throw std::runtime_error( "Out of device memory allocation slots" );
+	}
+
+	VkMemoryAllocateInfo allocateInfo = {};
+
+	allocateInfo.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize		= size;
+	allocateInfo.memoryTypeIndex	= memoryTypeIndex;
+
+	VkDeviceMemory allocated = VK_NULL_HANDLE;
+	if ( m_backend.AllocateMemory( m_device, &allocateInfo, HostAllocator::Installed(), &allocated ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Failed to allocate device memory" );
+	}
+
+	*mapped = nullptr;
+	if ( m_memoryProperties.memoryTypes[ memoryTypeIndex ].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ) {
+		if ( m_backend.MapMemory( m_device, allocated, 0, VK_WHOLE_SIZE, 0, mapped ) != VK_SUCCESS ) {
+			m_backend.FreeMemory( m_device, allocated, HostAllocator::Installed() );
+			throw std::runtime_error( "Failed to map device memory" );
+		}
+	}
+
+	++m_deviceMemoryCount;
+
+	memory = allocated;
+	return memory;
+}
+/*
+===============
+DeviceMemoryAllocator::CreateBlock
+
+	Adds a new buddy managed block to a pool
+===============
+*/
+DeviceMemoryBlock* DeviceMemoryAllocator::CreateBlock( Pool& pool ) {
+	std::unique_ptr<DeviceMemoryBlock> block = std::make_unique<DeviceMemoryBlock>( m_backend, m_device );
+
+	block->Size			= m_blockSize;
+	block->Allocator	= std::make_unique<BuddyAllocator>( m_blockSize, MIN_ALLOCATION_SIZE );
+	AllocateDeviceMemory( block->Memory, m_blockSize, pool.MemoryTypeIndex, &block->Mapped );
+
+	pool.Blocks.push_back( std::move( block ) );
+
+	return pool.Blocks.back().get();
+}
+/*
+===============
+DeviceMemoryAllocator::AllocateFromBlock
+
+	Tries to place an allocation in a block
+===============
+*/
+bool DeviceMemoryAllocator::AllocateFromBlock( DeviceMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, DeviceAllocation& allocation ) {
+	uint64_t offset = block.Allocator->Allocate( size, alignment );
+	if ( offset == BuddyAllocator::INVALID_OFFSET ) {
+		return false;
+	}
+
+	allocation.Memory	= block.Memory;
+	allocation.Offset	= offset;
+	allocation.Size		= size;
+	allocation.Mapped	= block.Mapped != nullptr ? ( uint8_t* )block.Mapped + offset : nullptr;
+	allocation.Block	= &block;
+
+	block.Owners[ offset ] = &allocation;
+
+	return true;
+}
+/*
+===============
+DeviceMemoryAllocator::ReleaseEmptyBlocks
+
+	Frees empty blocks, keeping one around so alternating allocations don't
+	thrash vkAllocateMemory
+===============
+*/
+void DeviceMemoryAllocator::ReleaseEmptyBlocks( Pool& pool ) {
+	bool keptEmptyBlock = false;
+
+	std::vector<std::unique_ptr<DeviceMemoryBlock>>::iterator block = pool.Blocks.begin();
+	while ( block != pool.Blocks.end() ) {
+		bool isPooled	= ( *block )->Allocator != nullptr;
+		bool release	= ( *block )->Owners.empty() && ( !isPooled || keptEmptyBlock );
+
+		if ( ( *block )->Owners.empty() && isPooled ) {
+			keptEmptyBlock = true;
+		}
+
+		if ( release ) {
+			--m_deviceMemoryCount;
+			block = pool.Blocks.erase( block );
+		} else {
+			++block;
+		}
+	}
+}
+/*
+===============
+DeviceMemoryAllocator::TransientPage::~TransientPage
+
+	Frees the page's memory
+===============
+*/
+DeviceMemoryAllocator::TransientPage::~TransientPage( void ) {
+	if ( Memory != VK_NULL_HANDLE ) {
+		Backend->FreeMemory( Device, Memory, HostAllocator::Installed() );
+	}
+}
+/*
+===============
+DeviceMemoryAllocator::PoolIndex
+
+	Returns the pool for a memory type and resource kind
+===============
+*/
+uint32_t DeviceMemoryAllocator::PoolIndex( uint32_t memoryTypeIndex, DeviceResourceKind kind ) const {
+	return memoryTypeIndex * 2 + ( kind == DeviceResourceKind::Optimal ? 1 : 0 );
+}
+}
@@ -0,0 +1,166 @@
+#ifndef __DEVICEMEMORYALLOCATOR_H__
+#define __DEVICEMEMORYALLOCATOR_H__
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "BuddyAllocator.h"
+#include "DeletionQueue.h"
+#include "DeviceCapabilities.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+	Buffers and linearly tiled images are "Linear", optimally tiled images are
+	"Optimal". The two never share a memory block, which keeps every block
+	clear of bufferImageGranularity conflicts.
+*/
+enum class DeviceResourceKind {
+	Linear,
+	Optimal
+};
+
+struct DeviceMemoryBlock;
+
+/*
+	The Vulkan entry points DeviceMemoryAllocator calls, so its traces can be
+	replayed against a fake device on a machine without a GPU. Vulkan
+	returns the loader's.
+*/
+struct DeviceMemoryBackend {
+	PFN_vkAllocateMemory				AllocateMemory				= nullptr;
+	PFN_vkFreeMemory					FreeMemory					= nullptr;
+	PFN_vkMapMemory						MapMemory					= nullptr;
+	PFN_vkGetBufferMemoryRequirements	GetBufferMemoryRequirements	= nullptr;
+	PFN_vkGetImageMemoryRequirements	GetImageMemoryRequirements	= nullptr;
+	PFN_vkBindBufferMemory				BindBufferMemory			= nullptr;
+	PFN_vkBindImageMemory				BindImageMemory				= nullptr;
+
+	static DeviceMemoryBackend			Vulkan( void );
+};
+
+struct DeviceAllocation {
+	VkDeviceMemory		Memory			= VK_NULL_HANDLE;
+	VkDeviceSize		Offset			= 0;
+	VkDeviceSize		Size			= 0;
+	void*				Mapped			= nullptr;
+	uint32_t			MemoryTypeIndex	= 0;
+	const void*			Owner			= nullptr;	//Set by owners that rebuild their resource when defragmentation moves it
+
+	//Bookkeeping for the allocator
+	uint32_t			PoolIndex		= 0;
+	DeviceMemoryBlock*	Block			= nullptr;
+};
+
+struct DefragmentationMove {
+	DeviceAllocation*	Allocation		= nullptr;
+	VkDeviceMemory		SourceMemory	= VK_NULL_HANDLE;
+	VkDeviceSize		SourceOffset	= 0;
+	void*				SourceMapped	= nullptr;
+
+	//Bookkeeping for the allocator, the allocation may be freed before EndDefragmentation
+	DeviceMemoryBlock*	SourceBlock		= nullptr;
+};
+
+struct DeviceMemoryStats {
+	uint64_t			BlockCount			= 0;
+	uint64_t			EmptyBlockCount		= 0;	//Of BlockCount, kept around for the next allocation
+	uint64_t			DedicatedCount		= 0;
+	uint64_t			TransientPageCount	= 0;
+	uint64_t			ReservedBytes		= 0;
+	uint64_t			UsedBytes			= 0;
+	uint64_t			AllocationCount		= 0;
+	uint64_t			TransientBytes		= 0;
+	uint32_t			MaxAllocationCount	= 0;
+};
+
+/*
+===============
+DeviceMemoryAllocator
+
+	Sub-allocates device memory out of large blocks. Long lived resources use
+	a buddy allocator per block, transient resources use linear pages that are
+	reset when their frame slot comes round again.
+===============
+*/
+class DeviceMemoryAllocator {
+public:
+													DeviceMemoryAllocator( const DeviceCapabilities& capabilities, VkDevice device, uint32_t frameSlots );
+													DeviceMemoryAllocator( const DeviceCapabilities& capabilities, VkDevice device, uint32_t frameSlots, const DeviceMemoryBackend& backend );
+													~DeviceMemoryAllocator( void );
+
+	DeviceMemoryAllocator( const DeviceMemoryAllocator& ) = delete;
+	DeviceMemoryAllocator& operator=( const DeviceMemoryAllocator& ) = delete;
+
+	DeviceAllocation*								Allocate( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, DeviceResourceKind kind );
+	DeviceAllocation*								AllocateForBuffer( VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred );
+	DeviceAllocation*								AllocateForImage( VkImage image, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred );
+	void											Free( DeviceAllocation* allocation );
+	void											Retire( DeletionQueue& deletionQueue, DeviceAllocation* allocation );
+
+	DeviceAllocation								AllocateTransient( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, DeviceResourceKind kind );
+	void											BeginFrame( uint64_t frameIndex );
+
+	std::vector<DefragmentationMove>				BeginDefragmentation( const void* owner, uint32_t maxMoves );
+	void											EndDefragmentation( const std::vector<DefragmentationMove>& moves );
+
+	uint32_t										FindMemoryType( uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred ) const;
+	const VkPhysicalDeviceMemoryProperties&			GetMemoryProperties( void ) const;
+	VkDeviceSize									BlockSize( void ) const;
+
+	DeviceMemoryStats								GetStats( void ) const;
+	void											Report( std::ostream& out ) const;
+
+private:
+	struct Pool {
+		uint32_t										MemoryTypeIndex = 0;
+		DeviceResourceKind								Kind			= DeviceResourceKind::Linear;
+		std::vector<std::unique_ptr<DeviceMemoryBlock>>	Blocks;
+	};
+
+	//Memory is freed through Backend
+	struct TransientPage {
+		const DeviceMemoryBackend*						Backend;
+		VkDevice										Device;
+		VkDeviceMemory									Memory			= VK_NULL_HANDLE;
+		LinearAllocator									Allocator;
+		void*											Mapped			= nullptr;
+		uint32_t										MemoryTypeIndex	= 0;
+		DeviceResourceKind								Kind			= DeviceResourceKind::Linear;
+
+														TransientPage( const DeviceMemoryBackend& backend, VkDevice device, VkDeviceSize size ) : Backend( &backend ), Device( device ), Allocator( size ) {}
+														~TransientPage( void );
+
+		TransientPage( const TransientPage& ) = delete;
+		TransientPage& operator=( const TransientPage& ) = delete;
+	};
+
+	VkDeviceMemory									AllocateDeviceMemory( VkDeviceMemory& memory, VkDeviceSize size, uint32_t memoryTypeIndex, void** mapped );
+	DeviceMemoryBlock*								CreateBlock( Pool& pool );
+	bool											AllocateFromBlock( DeviceMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, DeviceAllocation& allocation );
+	void											ReleaseEmptyBlocks( Pool& pool );
+	uint32_t										PoolIndex( uint32_t memoryTypeIndex, DeviceResourceKind kind ) const;
+
+	VkDevice										m_device;
+	DeviceMemoryBackend								m_backend;
+	VkPhysicalDeviceMemoryProperties				m_memoryProperties;
+	uint32_t										m_maxAllocationCount;
+	VkDeviceSize									m_blockSize;
+
+	uint32_t										m_deviceMemoryCount{ 0 };
+	uint64_t										m_dedicatedCount{ 0 };
+
+	std::vector<Pool>								m_pools;
+	std::vector<std::vector<std::unique_ptr<TransientPage>>>	m_transientPages;
+	uint32_t										m_currentFrameSlot{ 0 };
+
+	std::unordered_map<DeviceAllocation*, std::unique_ptr<DeviceAllocation>>	m_allocations;
+};
+
+}
+
+#endif // !__DEVICEMEMORYALLOCATOR_H__
@@ -0,0 +1,43 @@
+#ifndef __EMBEDDEDSHADERS_H__
+#define __EMBEDDEDSHADERS_H__
+
+#include <cstdint>
+
+#include "ShaderStore.h"
+
+namespace tut {
+
+/*
+	SPIR-V generated by compile.bat / compile.sh before the build. glslang
+	emits each shader as a uint32_t array, so the code is word aligned and
+	baked into the executable with no file I/O at runtime.
+*/
+namespace embedded {
+#include "generated/vert.spv.h"
+#include "generated/frag.spv.h"
+#include "generated/mesh_vert.spv.h"
+#include "generated/cull.spv.h"
+#include "generated/bindless_vert.spv.h"
+#include "generated/textured_frag.spv.h"
+}
+
+/*
+===============
+EmbeddedShaders
+
+	The shaders compiled into the executable
+===============
+*/
+class EmbeddedShaders {
+public:
+	static ShaderBytecode			Vertex( void ) { return ShaderBytecode{ embedded::VertShaderCode, sizeof( embedded::VertShaderCode ) }; }
+	static ShaderBytecode			Fragment( void ) { return ShaderBytecode{ embedded::FragShaderCode, sizeof( embedded::FragShaderCode ) }; }
+	static ShaderBytecode			MeshVertex( void ) { return ShaderBytecode{ embedded::MeshVertShaderCode, sizeof( embedded::MeshVertShaderCode ) }; }
+	static ShaderBytecode			Cull( void ) { return ShaderBytecode{ embedded::CullShaderCode, sizeof( embedded::CullShaderCode ) }; }
+	static ShaderBytecode			BindlessVertex( void ) { return ShaderBytecode{ embedded::BindlessVertShaderCode, sizeof( embedded::BindlessVertShaderCode ) }; }
+	static ShaderBytecode			TexturedFragment( void ) { return ShaderBytecode{ embedded::TexturedFragShaderCode, sizeof( embedded::TexturedFragShaderCode ) }; }
+};
+
+}
+
+#endif // !__EMBEDDEDSHADERS_H__
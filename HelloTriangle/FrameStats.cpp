@@ -0,0 +1,106 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+
+namespace tut {
+/*
+===============
+FrameStats::FrameStats
+
+	FrameStats constructor
+===============
+*/
+FrameStats::FrameStats( void ) :
+	m_lastFrame( Clock::now() )
+{
+}
+/*
+===============
+FrameStats::Record
+
+	Records the end of a frame and the time the CPU waited for the GPU
+	during it. Frame time is measured between consecutive calls.
+===============
+*/
+void FrameStats::Record( double waitMs ) {
+	Clock::time_point now = Clock::now();
+
+	m_lastFrameMs	= std::chrono::duration<double, std::milli>( now - m_lastFrame ).count();
+	m_lastWaitMs	= waitMs;
+	m_lastFrame		= now;
+
+	++m_frames;
+	m_totalFrameMs	+= m_lastFrameMs;
+	m_totalWaitMs	+= m_lastWaitMs;
+	m_maxFrameMs	= std::max( m_maxFrameMs, m_lastFrameMs );
+	m_maxWaitMs		= std::max( m_maxWaitMs, m_lastWaitMs );
+}
+/*
+===============
+FrameStats::RecordSwapchainRecreation
+
+	Records how long rebuilding the swapchain took. The frame it happened
+	in absorbs the cost, so the worst frame time is the worst resize hitch.
+===============
+*/
+void FrameStats::RecordSwapchainRecreation( double milliseconds ) {
+	++m_recreations;
+	m_totalRecreationMs	+= milliseconds;
+	m_maxRecreationMs	= std::max( m_maxRecreationMs, milliseconds );
+}
+/*
+===============
+FrameStats::FrameCount
+
+	Returns the number of frames recorded
+===============
+*/
+uint64_t FrameStats::FrameCount( void ) const {
+	return m_frames;
+}
+/*
+===============
+FrameStats::LastFrameMs
+
+	Returns the duration of the most recent frame
+===============
+*/
+double FrameStats::LastFrameMs( void ) const {
+	return m_lastFrameMs;
+}
+/*
+===============
+FrameStats::LastWaitMs
+
+	Returns how long the CPU waited on the GPU in the most recent frame
+===============
+*/
+double FrameStats::LastWaitMs( void ) const {
+	return m_lastWaitMs;
+}
+/*
+===============
+FrameStats::Report
+
+	Writes average and worst frame and wait times
+===============
+*/
+void FrameStats::Report( std::ostream& out ) const {
+	if ( m_frames == 0 ) {
+		return;
+	}
+
+	double averageFrameMs	= m_totalFrameMs / m_frames;
+	double averageWaitMs	= m_totalWaitMs / m_frames;
+	double waitShare		= m_totalFrameMs > 0.0 ? 100.0 * m_totalWaitMs / m_totalFrameMs : 0.0;
+
+	out << "Frames: " << m_frames << ", " << averageFrameMs << " ms average (max " << m_maxFrameMs << " ms), CPU waited "
+		<< averageWaitMs << " ms per frame (max " << m_maxWaitMs << " ms, " << waitShare << "% of frame time), "
+		<< ( waitShare >= 25.0 ? "GPU bound" : "CPU bound" ) << std::endl;
+
+	if ( m_recreations > 0 ) {
+		out << "Swapchain: " << m_recreations << " recreations, " << m_totalRecreationMs / m_recreations << " ms average (max "
+			<< m_maxRecreationMs << " ms), worst frame hitch " << m_maxFrameMs << " ms" << std::endl;
+	}
+}
+}
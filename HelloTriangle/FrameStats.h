@@ -0,0 +1,50 @@
+#ifndef __FRAMESTATS_H__
+#define __FRAMESTATS_H__
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace tut {
+
+/*
+===============
+FrameStats
+
+	Tracks how long each frame took and how much of it the CPU spent blocked
+	on the GPU. A frame that mostly waits is GPU (or vsync) bound, one that
+	barely waits is CPU bound.
+===============
+*/
+class FrameStats {
+public:
+	typedef std::chrono::high_resolution_clock	Clock;
+
+												FrameStats( void );
+
+	void										Record( double waitMs );
+	void										RecordSwapchainRecreation( double milliseconds );
+
+	uint64_t									FrameCount( void ) const;
+	double										LastFrameMs( void ) const;
+	double										LastWaitMs( void ) const;
+
+	void										Report( std::ostream& out ) const;
+
+private:
+	Clock::time_point							m_lastFrame;
+	uint64_t									m_frames{ 0 };
+	double										m_lastFrameMs{ 0.0 };
+	double										m_lastWaitMs{ 0.0 };
+	double										m_totalFrameMs{ 0.0 };
+	double										m_totalWaitMs{ 0.0 };
+	double										m_maxFrameMs{ 0.0 };
+	double										m_maxWaitMs{ 0.0 };
+	uint64_t									m_recreations{ 0 };
+	double										m_totalRecreationMs{ 0.0 };
+	double										m_maxRecreationMs{ 0.0 };
+};
+
+}
+
+#endif // !__FRAMESTATS_H__
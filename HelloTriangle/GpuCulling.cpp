@@ -0,0 +1,527 @@
+#include "GpuCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "DebugMessenger.h"
+#include "HostAllocator.h"
+
+namespace tut {
+
+namespace {
+
+const uint32_t	CULL_GROUP_SIZE{ 64 };	//local_size_x of cull.comp
+const uint32_t	BINDING_COUNT{ 4 };
+
+//Matches the Cull push constant block of cull.comp
+struct CullConstants {
+	float		Planes[ 6 ][ 4 ];
+	uint32_t	InstanceCount;
+};
+
+/*
+===============
+ExtractFrustumPlanes
+
+	Pulls the six clip planes out of a column major view projection matrix,
+	with Vulkan's 0 to w depth range, normalized so the distance to a plane
+	can be compared against a sphere's radius. A plane the matrix leaves
+	unbounded comes out as zero and culls nothing.
+===============
+*/
+void ExtractFrustumPlanes( const float m[ 16 ], float planes[ 6 ][ 4 ] ) {
+	for ( uint32_t column = 0; column < 4; ++column ) {
+		float x = m[ column * 4 + 0 ];
+		float y = m[ column * 4 + 1 ];
+		float z = m[ column * 4 + 2 ];
+		float w = m[ column * 4 + 3 ];
+
+		planes[ 0 ][ column ] = w + x;
+		planes[ 1 ][ column ] = w - x;
+		planes[ 2 ][ column ] = w + y;
+		planes[ 3 ][ column ] = w - y;
+		planes[ 4 ][ column ] = z;
+		planes[ 5 ][ column ] = w - z;
+	}
+
+	for ( uint32_t i = 0; i < 6; ++i ) {
+		float length = sqrtf( planes[ i ][ 0 ] * planes[ i ][ 0 ] + planes[ i ][ 1 ] * planes[ i ][ 1 ] + planes[ i ][ 2 ] * planes[ i ][ 2 ] );
+
+		if ( length > 0.0f ) {
+			for ( uint32_t component = 0; component < 4; ++component ) {
+				planes[ i ][ component ] /= length;
+			}
+		}
+	}
+}
+
+}
+
+/*
+===============
+GpuCulling::GpuCulling
+
+	Creates the descriptor set and the culling compute pipeline, the set
+	layout coming from the shared cache. Buffers are created by
+	SetInstances, so nothing is allocated from device memory here. Buffers
+	and descriptor pools SetInstances replaces are retired to deletionQueue.
+===============
+*/
+GpuCulling::GpuCulling( const DeviceCapabilities& capabilities, VkDevice device, DeviceMemoryAllocator& deviceMemory, DeletionQueue& deletionQueue,
+	DescriptorLayoutCache& layouts, VkPipelineCache pipelineCache, ShaderStore& shaders ) :
+	m_device( device ),
+	m_deviceMemory( deviceMemory ),
+	m_deletionQueue( deletionQueue ),
+	m_drawCount( HasDrawCount( capabilities ) ),
+	m_maxDrawCount( capabilities.Properties.limits.maxDrawIndirectCount )
+{
+	if ( m_drawCount ) {
+		m_cmdDrawIndexedIndirectCount = ( PFN_vkCmdDrawIndexedIndirectCountKHR )vkGetDeviceProcAddr( device, "vkCmdDrawIndexedIndirectCountKHR" );
+		m_drawCount = m_cmdDrawIndexedIndirectCount != nullptr;
+	}
+
+	//Instances are read by the vertex shader too, everything else only by culling
+	DescriptorLayoutDesc layoutDesc;
+
+	layoutDesc.Bindings.resize( BINDING_COUNT );
+
+	for ( uint32_t i = 0; i < BINDING_COUNT; ++i ) {
+		layoutDesc.Bindings[ i ].binding			= i;
+		layoutDesc.Bindings[ i ].descriptorType		= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		layoutDesc.Bindings[ i ].descriptorCount	= 1;
+		layoutDesc.Bindings[ i ].stageFlags			= VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	layoutDesc.Bindings[ 0 ].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+	m_setLayout = layouts.Get( layoutDesc );
+
+	CreateDescriptorSet();
+
+	VkDescriptorSetLayout		setLayout			= m_setLayout;
+	VkPushConstantRange			pushConstantRange	= {};
+	VkPipelineLayoutCreateInfo	pipelineLayoutInfo	= {};
+
+	pushConstantRange.stageFlags	= VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset		= 0;
+	pushConstantRange.size			= sizeof( CullConstants );
+
+	pipelineLayoutInfo.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount			= 1;
+	pipelineLayoutInfo.pSetLayouts				= &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount	= 1;
+	pipelineLayoutInfo.pPushConstantRanges		= &pushConstantRange;
+
+	m_pipelineLayout = VKPipelineLayoutHandle( m_device );
+
+	if ( vkCreatePipelineLayout( m_device, &pipelineLayoutInfo, HostAllocator::Installed(), m_pipelineLayout.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create culling pipeline layout" );
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+
+	pipelineInfo.sType			= VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType	= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage	= VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module	= shaders.GetModule( "cull.spv" );
+	pipelineInfo.stage.pName	= "main";
+	pipelineInfo.layout			= m_pipelineLayout;
+
+	m_pipeline = VKPipelineHandle( m_device );
+
+	if ( vkCreateComputePipelines( m_device, pipelineCache, 1, &pipelineInfo, HostAllocator::Installed(), m_pipeline.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create culling pipeline" );
+	}
+}
+/*
+===============
+GpuCulling::~GpuCulling
+
+	Returns the buffers' memory, the device must be idle
+===============
+*/
+GpuCulling::~GpuCulling( void ) {
+	FreeBuffers();
+}
+/*
+===============
+GpuCulling::IsSupported
+
+	Returns if the device can draw many indirect commands in one call, each
+	with its own firstInstance
+===============
+*/
+bool GpuCulling::IsSupported( const DeviceCapabilities& capabilities ) {
+	return capabilities.Features.multiDrawIndirect == VK_TRUE && capabilities.Features.drawIndirectFirstInstance == VK_TRUE;
+}
+/*
+===============
+GpuCulling::HasDrawCount
+
+	Returns if the device can take the draw count from a buffer
+===============
+*/
+bool GpuCulling::HasDrawCount( const DeviceCapabilities& capabilities ) {
+	return capabilities.HasExtension( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+}
+/*
+===============
+GpuCulling::InstanceLayout
+
+	Returns the set layout graphics pipelines read the instances through,
+	instances are binding 0
+===============
+*/
+VkDescriptorSetLayout GpuCulling::InstanceLayout( void ) const {
+	return m_setLayout;
+}
+/*
+===============
+GpuCulling::InstanceBuffer
+
+	Returns the instance storage buffer, replaced by every SetInstances
+===============
+*/
+VkBuffer GpuCulling::InstanceBuffer( void ) const {
+	return m_instanceBuffer;
+}
+/*
+===============
+GpuCulling::DescriptorSet
+
+	Returns the set holding the culling buffers
+===============
+*/
+VkDescriptorSet GpuCulling::DescriptorSet( void ) const {
+	return m_descriptorSet;
+}
+/*
+===============
+GpuCulling::InstanceCount
+
+	Returns the number of instances culled each frame
+===============
+*/
+uint32_t GpuCulling::InstanceCount( void ) const {
+	return m_instanceCount;
+}
+/*
+===============
+GpuCulling::DrawCommands
+
+	Returns the buffer culling writes the indirect draws into
+===============
+*/
+VkBuffer GpuCulling::DrawCommands( void ) const {
+	return m_commandBuffer;
+}
+/*
+===============
+GpuCulling::DrawCounts
+
+	Returns the buffer holding the number of visible instances per batch
+===============
+*/
+VkBuffer GpuCulling::DrawCounts( void ) const {
+	return m_countBuffer;
+}
+/*
+===============
+GpuCulling::UsesDrawCount
+
+	Whether batches are drawn with the count from DrawCounts. Without it
+	RecordClear also clears DrawCommands.
+===============
+*/
+bool GpuCulling::UsesDrawCount( void ) const {
+	return m_drawCount;
+}
+/*
+===============
+GpuCulling::SetInstances
+
+	Replaces the instances and batches and uploads them. Every batch gets a
+	range of the command buffer as large as its instance count, the most it
+	could ever draw. Frames in flight may still read the previous buffers
+	through the previous descriptor set, so those are retired together with
+	the pool the set came from, and a new set is written. The next graphics
+	submission must acquire the upload.
+===============
+*/
+void GpuCulling::SetInstances( const std::vector<CullInstance>& instances, const std::vector<CullBatch>& batches, UploadQueue& uploads ) {
+	if ( batches.empty() || batches.size() > MAX_BATCHES ) {
+		throw std::runtime_error( "GPU culling needs between one and MAX_BATCHES batches" );
+	}
+
+	if ( m_instanceMemory != nullptr ) {
+		RetireBuffers();
+
+		m_descriptorPool.retire( m_deletionQueue );
+		CreateDescriptorSet();
+	}
+
+	m_batches			= batches;
+	m_batchCapacities.assign( batches.size(), 0 );
+	m_instanceCount		= ( uint32_t )instances.size();
+
+	for ( const CullInstance& instance : instances ) {
+		if ( instance.Batch >= batches.size() ) {
+			throw std::runtime_error( "Culling instance refers to a batch that does not exist" );
+		}
+
+		++m_batchCapacities[ instance.Batch ];
+	}
+
+	uint32_t firstCommand = 0;
+
+	for ( size_t i = 0; i < m_batches.size(); ++i ) {
+		if ( m_drawCount && m_batchCapacities[ i ] > m_maxDrawCount ) {
+			throw std::runtime_error( "Culling batch holds more instances than one indirect draw can take, split it" );
+		}
+
+		m_batches[ i ].FirstCommand	= firstCommand;
+		firstCommand				+= m_batchCapacities[ i ];
+	}
+
+	//Storage buffers may not be empty, so every buffer holds at least one element
+	VkDeviceSize instanceBytes	= std::max<VkDeviceSize>( instances.size(), 1 ) * sizeof( CullInstance );
+	VkDeviceSize batchBytes		= m_batches.size() * sizeof( CullBatch );
+	VkDeviceSize commandBytes	= std::max<VkDeviceSize>( instances.size(), 1 ) * sizeof( VkDrawIndexedIndirectCommand );
+	VkDeviceSize countBytes		= m_batches.size() * sizeof( uint32_t );
+
+	CreateBuffer( instanceBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, "Culling instances", m_instanceBuffer, m_instanceMemory );
+	CreateBuffer( batchBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, "Culling batches", m_batchBuffer, m_batchMemory );
+	CreateBuffer( commandBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, "Culled draw commands", m_commandBuffer, m_commandMemory );
+	CreateBuffer( countBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, "Culled draw counts", m_countBuffer, m_countMemory );
+
+	if ( !instances.empty() ) {
+		uploads.UploadBuffer( m_instanceBuffer, 0, instances.data(), instances.size() * sizeof( CullInstance ) );
+	}
+
+	uploads.UploadBuffer( m_batchBuffer, 0, m_batches.data(), batchBytes );
+
+	VkDescriptorBufferInfo	bufferInfos[ BINDING_COUNT ]	= {};
+	VkWriteDescriptorSet	writes[ BINDING_COUNT ]			= {};
+
+	bufferInfos[ 0 ].buffer = m_instanceBuffer;
+	bufferInfos[ 1 ].buffer = m_batchBuffer;
+	bufferInfos[ 2 ].buffer = m_commandBuffer;
+	bufferInfos[ 3 ].buffer = m_countBuffer;
+
+	for ( uint32_t i = 0; i < BINDING_COUNT; ++i ) {
+		bufferInfos[ i ].offset	= 0;
+		bufferInfos[ i ].range	= VK_WHOLE_SIZE;
+
+		writes[ i ].sType			= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[ i ].dstSet			= m_descriptorSet;
+		writes[ i ].dstBinding		= i;
+		writes[ i ].descriptorCount	= 1;
+		writes[ i ].descriptorType	= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[ i ].pBufferInfo		= &bufferInfos[ i ];
+	}
+
+	vkUpdateDescriptorSets( m_device, BINDING_COUNT, writes, 0, nullptr );
+}
+/*
+===============
+GpuCulling::RecordClear
+
+	Zeroes the per batch counts, and the draw commands when they are drawn
+	without a count. The caller orders it after earlier indirect reads and
+	before RecordDispatch.
+===============
+*/
+void GpuCulling::RecordClear( VkCommandBuffer commandBuffer ) {
+	if ( m_instanceCount == 0 ) {
+		return;
+	}
+
+	vkCmdFillBuffer( commandBuffer, m_countBuffer, 0, VK_WHOLE_SIZE, 0 );
+
+	//Without a count buffer every slot is drawn, so the slots culling leaves unwritten must draw nothing
+	if ( !m_drawCount ) {
+		vkCmdFillBuffer( commandBuffer, m_commandBuffer, 0, VK_WHOLE_SIZE, 0 );
+	}
+}
+/*
+===============
+GpuCulling::RecordDispatch
+
+	Records the culling dispatch. The caller orders it after RecordClear
+	and before the indirect draws read its output.
+===============
+*/
+void GpuCulling::RecordDispatch( VkCommandBuffer commandBuffer, const float viewProjection[ 16 ] ) {
+	if ( m_instanceCount == 0 ) {
+		return;
+	}
+
+	CullConstants constants = {};
+
+	ExtractFrustumPlanes( viewProjection, constants.Planes );
+	constants.InstanceCount = m_instanceCount;
+
+	VkDescriptorSet descriptorSet = m_descriptorSet;
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline );
+	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+	vkCmdPushConstants( commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( constants ), &constants );
+	vkCmdDispatch( commandBuffer, ( m_instanceCount + CULL_GROUP_SIZE - 1 ) / CULL_GROUP_SIZE, 1, 1 );
+
+	++m_culledFrames;
+}
+/*
+===============
+GpuCulling::RecordDraws
+
+	Records one indirect draw per batch. The caller binds the graphics
+	pipeline, its descriptor set and the index buffer the batches index.
+===============
+*/
+void GpuCulling::RecordDraws( VkCommandBuffer commandBuffer ) {
+	const uint32_t stride = sizeof( VkDrawIndexedIndirectCommand );
+
+	for ( size_t i = 0; i < m_batches.size(); ++i ) {
+		uint32_t		capacity	= m_batchCapacities[ i ];
+		VkDeviceSize	offset		= ( VkDeviceSize )m_batches[ i ].FirstCommand * stride;
+
+		if ( capacity == 0 ) {
+			continue;
+		}
+
+		if ( m_drawCount ) {
+			m_cmdDrawIndexedIndirectCount( commandBuffer, m_commandBuffer, offset, m_countBuffer, i * sizeof( uint32_t ), capacity, stride );
+			++m_indirectDraws;
+			continue;
+		}
+
+		//A batch larger than the device's draw limit takes a few calls
+		for ( uint32_t first = 0; first < capacity; first += m_maxDrawCount ) {
+			vkCmdDrawIndexedIndirect( commandBuffer, m_commandBuffer, offset + ( VkDeviceSize )first * stride, std::min( m_maxDrawCount, capacity - first ), stride );
+			++m_indirectDraws;
+		}
+	}
+}
+/*
+===============
+GpuCulling::Report
+
+	Writes the instance count and how the batches are drawn
+===============
+*/
+void GpuCulling::Report( std::ostream& out ) const {
+	VkDeviceSize bufferBytes = ( VkDeviceSize )m_instanceCount * ( sizeof( CullInstance ) + sizeof( VkDrawIndexedIndirectCommand ) );
+
+	out << "GPU culling: " << m_instanceCount << " instances in " << m_batches.size() << " batches, " << m_culledFrames << " frames culled, "
+		<< m_indirectDraws << " indirect draws, " << ( m_drawCount ? "draw count from buffer" : "cleared command ranges" ) << ", "
+		<< bufferBytes / ( 1024.0 * 1024.0 ) << " MB of instances and commands" << std::endl;
+}
+/*
+===============
+GpuCulling::CreateDescriptorSet
+
+	Creates a pool holding a single set for the four storage buffers and
+	allocates the set from it
+===============
+*/
+void GpuCulling::CreateDescriptorSet( void ) {
+	VkDescriptorPoolSize		poolSize	= {};
+	VkDescriptorPoolCreateInfo	poolInfo	= {};
+
+	poolSize.type				= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount	= BINDING_COUNT;
+
+	poolInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets		= 1;
+	poolInfo.poolSizeCount	= 1;
+	poolInfo.pPoolSizes		= &poolSize;
+
+	m_descriptorPool = VKDescriptorPoolHandle( m_device );
+
+	if ( vkCreateDescriptorPool( m_device, &poolInfo, HostAllocator::Installed(), m_descriptorPool.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create culling descriptor pool" );
+	}
+
+	VkDescriptorSetLayout		setLayout	= m_setLayout;
+	VkDescriptorSetAllocateInfo	allocInfo	= {};
+
+	allocInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool		= m_descriptorPool;
+	allocInfo.descriptorSetCount	= 1;
+	allocInfo.pSetLayouts			= &setLayout;
+
+	if ( vkAllocateDescriptorSets( m_device, &allocInfo, &m_descriptorSet ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not allocate culling descriptor set" );
+	}
+}
+/*
+===============
+GpuCulling::CreateBuffer
+
+	Creates a device local buffer, named for debug messages
+===============
+*/
+void GpuCulling::CreateBuffer( VkDeviceSize size, VkBufferUsageFlags usage, const char* name, VKBufferHandle& buffer, DeviceAllocation*& memory ) {
+	VkBufferCreateInfo bufferInfo = {};
+
+	bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size			= size;
+	bufferInfo.usage		= usage;
+	bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+	buffer = VKBufferHandle( m_device );
+
+	if ( vkCreateBuffer( m_device, &bufferInfo, HostAllocator::Installed(), buffer.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create culling buffer" );
+	}
+
+	DebugMessenger::Name( m_device, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )buffer, name );
+
+	memory = m_deviceMemory.AllocateForBuffer( buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 );
+}
+/*
+===============
+GpuCulling::RetireBuffers
+
+	Hands the buffers and their memory to the deletion queue, which destroys
+	them once the frames that may still read them have finished
+===============
+*/
+void GpuCulling::RetireBuffers( void ) {
+	m_instanceBuffer.retire( m_deletionQueue );
+	m_batchBuffer.retire( m_deletionQueue );
+	m_commandBuffer.retire( m_deletionQueue );
+	m_countBuffer.retire( m_deletionQueue );
+
+	DeviceAllocation** memory[] = { &m_instanceMemory, &m_batchMemory, &m_commandMemory, &m_countMemory };
+
+	for ( DeviceAllocation** allocation : memory ) {
+		m_deviceMemory.Retire( m_deletionQueue, *allocation );
+		*allocation = nullptr;
+	}
+}
+/*
+===============
+GpuCulling::FreeBuffers
+
+	Destroys the buffers and returns their memory at once, for the
+	destructor, when the device is idle
+===============
+*/
+void GpuCulling::FreeBuffers( void ) {
+	m_instanceBuffer	= VKBufferHandle();
+	m_batchBuffer		= VKBufferHandle();
+	m_commandBuffer		= VKBufferHandle();
+	m_countBuffer		= VKBufferHandle();
+
+	DeviceAllocation** memory[] = { &m_instanceMemory, &m_batchMemory, &m_commandMemory, &m_countMemory };
+
+	for ( DeviceAllocation** allocation : memory ) {
+		if ( *allocation != nullptr ) {
+			m_deviceMemory.Free( *allocation );
+			*allocation = nullptr;
+		}
+	}
+}
+}
@@ -0,0 +1,127 @@
+#ifndef __GPUCULLING_H__
+#define __GPUCULLING_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "DescriptorLayoutCache.h"
+#include "DeviceCapabilities.h"
+#include "DeviceMemoryAllocator.h"
+#include "ShaderStore.h"
+#include "UploadQueue.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+	One entry of the instance storage buffer, std430 layout as read by
+	cull.comp and shader.vert
+*/
+struct CullInstance {
+	float				Transform[ 4 ]	= { 0.0f, 0.0f, 0.0f, 1.0f };	//xyz translation, w uniform scale
+	float				Bounds[ 4 ]		= {};							//World space bounding sphere, w is the radius
+	uint32_t			Batch			= 0;
+	uint32_t			Padding[ 3 ]	= {};
+};
+
+static_assert( sizeof( CullInstance ) == 48, "CullInstance must match the std430 layout of the shaders" );
+
+/*
+	Geometry a batch draws for each of its visible instances. FirstCommand is
+	filled in by SetInstances.
+*/
+struct CullBatch {
+	uint32_t			FirstCommand	= 0;
+	uint32_t			IndexCount		= 0;
+	uint32_t			FirstIndex		= 0;
+	int32_t				VertexOffset	= 0;
+};
+
+/*
+===============
+GpuCulling
+
+	GPU driven drawing. A compute pass tests every instance's bounding
+	sphere against the frustum and appends a VkDrawIndexedIndirectCommand
+	for each visible one to its batch's range of the command buffer, with an
+	atomic count per batch. Each batch, standing for one material, is then
+	drawn with a single indirect call: vkCmdDrawIndexedIndirectCountKHR when
+	the device has VK_KHR_draw_indirect_count, otherwise the whole range is
+	cleared before culling and drawn, leaving empty commands that draw
+	nothing. firstInstance of each command is the instance index, so the
+	vertex shader finds its transform with gl_InstanceIndex. The clear, the
+	dispatch and the draws are separate render graph passes, which own the
+	barriers between them.
+===============
+*/
+class GpuCulling {
+public:
+	static const uint32_t								MAX_BATCHES{ 16 };
+
+														GpuCulling( const DeviceCapabilities& capabilities, VkDevice device, DeviceMemoryAllocator& deviceMemory, DeletionQueue& deletionQueue,
+															DescriptorLayoutCache& layouts, VkPipelineCache pipelineCache, ShaderStore& shaders );
+														~GpuCulling( void );
+
+	GpuCulling( const GpuCulling& ) = delete;
+	GpuCulling& operator=( const GpuCulling& ) = delete;
+
+	static bool											IsSupported( const DeviceCapabilities& capabilities );
+	static bool											HasDrawCount( const DeviceCapabilities& capabilities );
+
+	VkDescriptorSetLayout								InstanceLayout( void ) const;
+	VkDescriptorSet										DescriptorSet( void ) const;
+	VkBuffer											InstanceBuffer( void ) const;
+	uint32_t											InstanceCount( void ) const;
+	VkBuffer											DrawCommands( void ) const;
+	VkBuffer											DrawCounts( void ) const;
+	bool												UsesDrawCount( void ) const;
+
+	void												SetInstances( const std::vector<CullInstance>& instances, const std::vector<CullBatch>& batches, UploadQueue& uploads );
+	void												RecordClear( VkCommandBuffer commandBuffer );
+	void												RecordDispatch( VkCommandBuffer commandBuffer, const float viewProjection[ 16 ] );
+	void												RecordDraws( VkCommandBuffer commandBuffer );
+
+	void												Report( std::ostream& out ) const;
+
+private:
+	void												CreateDescriptorSet( void );
+	void												CreateBuffer( VkDeviceSize size, VkBufferUsageFlags usage, const char* name, VKBufferHandle& buffer, DeviceAllocation*& memory );
+	void												RetireBuffers( void );
+	void												FreeBuffers( void );
+
+	VkDevice											m_device;
+	DeviceMemoryAllocator&								m_deviceMemory;
+	DeletionQueue&										m_deletionQueue;
+	bool												m_drawCount;
+	uint32_t											m_maxDrawCount;
+	PFN_vkCmdDrawIndexedIndirectCountKHR				m_cmdDrawIndexedIndirectCount{ nullptr };
+
+	VkDescriptorSetLayout								m_setLayout;	//Owned by the layout cache
+	VKDescriptorPoolHandle								m_descriptorPool;
+	VkDescriptorSet										m_descriptorSet{ VK_NULL_HANDLE };
+	VKPipelineLayoutHandle								m_pipelineLayout;
+	VKPipelineHandle									m_pipeline;
+
+	VKBufferHandle										m_instanceBuffer;
+	DeviceAllocation*									m_instanceMemory{ nullptr };
+	VKBufferHandle										m_batchBuffer;
+	DeviceAllocation*									m_batchMemory{ nullptr };
+	VKBufferHandle										m_commandBuffer;
+	DeviceAllocation*									m_commandMemory{ nullptr };
+	VKBufferHandle										m_countBuffer;
+	DeviceAllocation*									m_countMemory{ nullptr };
+
+	std::vector<CullBatch>								m_batches;
+	std::vector<uint32_t>								m_batchCapacities;
+	uint32_t											m_instanceCount{ 0 };
+
+	uint64_t											m_culledFrames{ 0 };
+	uint64_t											m_indirectDraws{ 0 };
+};
+
+}
+
+#endif // !__GPUCULLING_H__
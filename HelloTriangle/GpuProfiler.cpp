@@ -0,0 +1,294 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tut {
+
+const uint32_t GpuProfiler::INVALID_SCOPE;
+const uint32_t GpuProfiler::MAX_SCOPES_PER_FRAME;
+const size_t GpuProfiler::MAX_RECORDED_SCOPES;
+
+/*
+===============
+GpuProfiler::GpuProfiler
+
+	Creates a timestamp query pool for every frame slot
+===============
+*/
+GpuProfiler::GpuProfiler( const DeviceCapabilities& capabilities, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlots, ChromeTrace& trace ) :
+	m_device( device ),
+	m_trace( trace ),
+	m_slots( frameSlots ),
+	m_submitOffsetUs( 0.0 )
+{
+	uint32_t validBits = capabilities.QueueFamilies[ queueFamilyIndex ].timestampValidBits;
+
+	m_nanosecondsPerTick	= capabilities.Properties.limits.timestampPeriod;
+	m_tickMask				= validBits >= 64 ? ~0ull : ( 1ull << validBits ) - 1;
+
+	for ( FrameSlot& slot : m_slots ) {
+		VkQueryPoolCreateInfo poolInfo = {};
+
+		poolInfo.sType		= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType	= VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount	= MAX_SCOPES_PER_FRAME * 2;
+
+		slot.Pool = VKQueryPoolHandle( m_device );
+
+		if ( vkCreateQueryPool( m_device, &poolInfo, HostAllocator::Installed(), slot.Pool.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create timestamp query pool" );
+		}
+
+		slot.Names.reserve( MAX_SCOPES_PER_FRAME );
+	}
+
+	m_results.reserve( 4096 );
+}
+/*
+===============
+GpuProfiler::IsSupported
+
+	Returns if the queue family can write timestamps
+===============
+*/
+bool GpuProfiler::IsSupported( const DeviceCapabilities& capabilities, uint32_t queueFamilyIndex ) {
+	return queueFamilyIndex < capabilities.QueueFamilies.size() && capabilities.QueueFamilies[ queueFamilyIndex ].timestampValidBits > 0;
+}
+/*
+===============
+GpuProfiler::BeginFrame
+
+	Reads the results the slot's previous frame left behind, then resets
+	its queries in the new command buffer. The slot's fence must have been
+	waited on. Must be recorded outside a render pass.
+===============
+*/
+void GpuProfiler::BeginFrame( VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameIndex ) {
+	FrameSlot& slot = m_slots[ frameSlot ];
+
+	if ( slot.Pending ) {
+		CollectSlot( slot );
+	}
+
+	vkCmdResetQueryPool( commandBuffer, slot.Pool, 0, MAX_SCOPES_PER_FRAME * 2 );
+
+	slot.Names.clear();
+	slot.FrameIndex	= frameIndex;
+	m_recording		= &slot;
+}
+/*
+===============
+GpuProfiler::EndFrame
+
+	Call right after the frame was submitted, its results become readable
+	once the slot comes around again
+===============
+*/
+void GpuProfiler::EndFrame( uint32_t frameSlot ) {
+	FrameSlot& slot = m_slots[ frameSlot ];
+
+	slot.SubmitUs	= m_trace.NowMicroseconds();
+	slot.Pending	= !slot.Names.empty();
+	m_recording		= nullptr;
+}
+/*
+===============
+GpuProfiler::BeginScope
+
+	Writes the opening timestamp of a scope once all prior commands have
+	started
+===============
+*/
+uint32_t GpuProfiler::BeginScope( VkCommandBuffer commandBuffer, const char* name ) {
+	if ( m_recording == nullptr || m_recording->Names.size() >= MAX_SCOPES_PER_FRAME ) {
+		++m_droppedScopes;
+		return INVALID_SCOPE;
+	}
+
+	uint32_t scope = ( uint32_t )m_recording->Names.size();
+
+	m_recording->Names.push_back( name );
+	vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_recording->Pool, scope * 2 );
+
+	return scope;
+}
+/*
+===============
+GpuProfiler::EndScope
+
+	Writes the closing timestamp of a scope once all prior commands have
+	finished
+===============
+*/
+void GpuProfiler::EndScope( VkCommandBuffer commandBuffer, uint32_t scope ) {
+	if ( m_recording == nullptr || scope == INVALID_SCOPE ) {
+		return;
+	}
+
+	vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_recording->Pool, scope * 2 + 1 );
+}
+/*
+===============
+GpuProfiler::Collect
+
+	Reads every slot with results outstanding. Only call once the device
+	is idle.
+===============
+*/
+void GpuProfiler::Collect( void ) {
+	for ( FrameSlot& slot : m_slots ) {
+		if ( slot.Pending ) {
+			CollectSlot( slot );
+		}
+	}
+}
+/*
+===============
+GpuProfiler::Export
+
+	Adds every recorded scope to the trace's GPU track
+===============
+*/
+void GpuProfiler::Export( void ) const {
+	for ( const GpuScopeResult& result : m_results ) {
+		double beginUs		= TicksToMicroseconds( result.BeginTicks ) + m_submitOffsetUs;
+		double durationUs	= TicksToMicroseconds( result.EndTicks - result.BeginTicks );
+
+		m_trace.AddEvent( result.Name, ChromeTrace::GPU_TRACK, beginUs, durationUs );
+	}
+}
+/*
+===============
+GpuProfiler::Report
+
+	Writes average and worst GPU time per scope name
+===============
+*/
+void GpuProfiler::Report( std::ostream& out ) const {
+	out << "GPU profile: " << m_results.size() << " scopes recorded, " << m_droppedScopes << " dropped, "
+		<< m_unavailableFrames << " frames without results" << std::endl;
+
+	for ( const std::pair<const std::string, ScopeTotals>& entry : m_totals ) {
+		out << "  " << entry.first << ": " << entry.second.TotalMs / entry.second.Count << " ms average (max "
+			<< entry.second.MaxMs << " ms) over " << entry.second.Count << " frames" << std::endl;
+	}
+}
+/*
+===============
+GpuProfiler::CollectSlot
+
+	Copies a finished slot's timestamps out without waiting
+===============
+*/
+void GpuProfiler::CollectSlot( FrameSlot& slot ) {
+	slot.Pending = false;
+
+	uint32_t				queryCount = ( uint32_t )slot.Names.size() * 2;
+	std::vector<uint64_t>	ticks( queryCount );
+
+	if ( vkGetQueryPoolResults( m_device, slot.Pool, 0, queryCount, ticks.size() * sizeof( uint64_t ), ticks.data(), sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT ) != VK_SUCCESS ) {
+		++m_unavailableFrames;
+		return;
+	}
+
+	//The first scope opens the frame on the GPU, which cannot happen before the submit
+	double offsetUs = slot.SubmitUs - TicksToMicroseconds( UnwrapTicks( ticks[ 0 ] ) );
+
+	if ( !m_hasOffset || offsetUs > m_submitOffsetUs ) {
+		m_submitOffsetUs	= offsetUs;
+		m_hasOffset			= true;
+	}
+
+	for ( size_t i = 0; i < slot.Names.size(); ++i ) {
+		uint64_t	beginTicks	= UnwrapTicks( ticks[ i * 2 ] );
+		uint64_t	endTicks	= UnwrapTicks( ticks[ i * 2 + 1 ] );
+		double		durationMs	= TicksToMicroseconds( endTicks - beginTicks ) / 1000.0;
+
+		ScopeTotals& totals = m_totals[ slot.Names[ i ] ];
+
+		++totals.Count;
+		totals.TotalMs	+= durationMs;
+		totals.MaxMs	= std::max( totals.MaxMs, durationMs );
+
+		if ( m_results.size() < MAX_RECORDED_SCOPES ) {
+			GpuScopeResult result;
+
+			result.Name			= slot.Names[ i ];
+			result.FrameIndex	= slot.FrameIndex;
+			result.BeginTicks	= beginTicks;
+			result.EndTicks		= endTicks;
+
+			m_results.push_back( result );
+		} else {
+			++m_droppedScopes;
+		}
+	}
+}
+/*
+===============
+GpuProfiler::UnwrapTicks
+
+	Extends a timestamp with fewer than 64 valid bits onto a continuous
+	timeline. Timestamps arrive roughly in order, so one that lands more
+	than half the counter range away from the last one has wrapped.
+===============
+*/
+uint64_t GpuProfiler::UnwrapTicks( uint64_t ticks ) {
+	ticks &= m_tickMask;
+
+	if ( m_tickMask == ~0ull ) {
+		return ticks;
+	}
+
+	uint64_t range		= m_tickMask + 1;
+	uint64_t extended	= ( m_lastTicks & ~m_tickMask ) | ticks;
+
+	if ( extended + range / 2 < m_lastTicks ) {
+		extended += range;
+	} else if ( extended > m_lastTicks + range / 2 && extended >= range ) {
+		extended -= range;
+	}
+
+	m_lastTicks = std::max( m_lastTicks, extended );
+
+	return extended;
+}
+/*
+===============
+GpuProfiler::TicksToMicroseconds
+
+	Converts timestamp ticks to microseconds using the device's timestampPeriod
+===============
+*/
+double GpuProfiler::TicksToMicroseconds( uint64_t ticks ) const {
+	return ( double )ticks * m_nanosecondsPerTick / 1000.0;
+}
+/*
+===============
+GpuScope::GpuScope
+
+	Opens a GPU scope in the command buffer
+===============
+*/
+GpuScope::GpuScope( GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name ) :
+	m_profiler( profiler ),
+	m_commandBuffer( commandBuffer )
+{
+	if ( m_profiler != nullptr ) {
+		m_scope = m_profiler->BeginScope( m_commandBuffer, name );
+	}
+}
+/*
+===============
+GpuScope::~GpuScope
+
+	Closes the GPU scope
+===============
+*/
+GpuScope::~GpuScope( void ) {
+	if ( m_profiler != nullptr ) {
+		m_profiler->EndScope( m_commandBuffer, m_scope );
+	}
+}
+}
@@ -0,0 +1,122 @@
+#ifndef __GPUPROFILER_H__
+#define __GPUPROFILER_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ChromeTrace.h"
+#include "DeviceCapabilities.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+===============
+GpuProfiler
+
+	Timestamp queries around named scopes in command buffers. Every frame
+	slot has its own query pool. A slot's results are read when the slot
+	is begun again, which is after its fence has been waited on, so the
+	read never blocks and results arrive one ring length late.
+
+	GPU ticks are put on the trace clock using the CPU submit time of each
+	frame: the GPU cannot start a frame before it was submitted, so the
+	smallest offset that keeps every frame after its submit is used.
+===============
+*/
+class GpuProfiler {
+public:
+	static const uint32_t						INVALID_SCOPE{ 0xffffffff };
+	static const uint32_t						MAX_SCOPES_PER_FRAME{ 64 };
+	static const size_t							MAX_RECORDED_SCOPES{ 1 << 20 };
+
+												GpuProfiler( const DeviceCapabilities& capabilities, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlots, ChromeTrace& trace );
+
+	GpuProfiler( const GpuProfiler& ) = delete;
+	GpuProfiler& operator=( const GpuProfiler& ) = delete;
+
+	static bool									IsSupported( const DeviceCapabilities& capabilities, uint32_t queueFamilyIndex );
+
+	void										BeginFrame( VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameIndex );
+	void										EndFrame( uint32_t frameSlot );
+
+	uint32_t									BeginScope( VkCommandBuffer commandBuffer, const char* name );
+	void										EndScope( VkCommandBuffer commandBuffer, uint32_t scope );
+
+	void										Collect( void );
+	void										Export( void ) const;
+	void										Report( std::ostream& out ) const;
+
+private:
+	struct FrameSlot {
+		VKQueryPoolHandle						Pool;
+		std::vector<const char*>				Names;
+		uint64_t								FrameIndex	= 0;
+		double									SubmitUs	= 0.0;
+		bool									Pending		= false;
+	};
+
+	//A finished scope in unwrapped ticks, converted to trace time on export
+	struct GpuScopeResult {
+		const char*								Name;
+		uint64_t								FrameIndex;
+		uint64_t								BeginTicks;
+		uint64_t								EndTicks;
+	};
+
+	struct ScopeTotals {
+		uint64_t								Count		= 0;
+		double									TotalMs		= 0.0;
+		double									MaxMs		= 0.0;
+	};
+
+	void										CollectSlot( FrameSlot& slot );
+	uint64_t									UnwrapTicks( uint64_t ticks );
+	double										TicksToMicroseconds( uint64_t ticks ) const;
+
+	VkDevice									m_device;
+	ChromeTrace&								m_trace;
+	double										m_nanosecondsPerTick;
+	uint64_t									m_tickMask;
+	uint64_t									m_lastTicks{ 0 };
+
+	std::vector<FrameSlot>						m_slots;
+	FrameSlot*									m_recording{ nullptr };
+
+	std::vector<GpuScopeResult>					m_results;
+	std::map<std::string, ScopeTotals>			m_totals;
+	double										m_submitOffsetUs;
+	bool										m_hasOffset{ false };
+	uint64_t									m_droppedScopes{ 0 };
+	uint64_t									m_unavailableFrames{ 0 };
+};
+
+/*
+===============
+GpuScope
+
+	Brackets the enclosing block's commands with timestamps. Does nothing
+	when profiler is null.
+===============
+*/
+class GpuScope {
+public:
+												GpuScope( GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name );
+												~GpuScope( void );
+
+	GpuScope( const GpuScope& ) = delete;
+	GpuScope& operator=( const GpuScope& ) = delete;
+
+private:
+	GpuProfiler*								m_profiler;
+	VkCommandBuffer								m_commandBuffer;
+	uint32_t									m_scope{ GpuProfiler::INVALID_SCOPE };
+};
+
+}
+
+#endif // !__GPUPROFILER_H__
@@ -1,4 +1,5 @@
 #include "HelloTriangleApplication.h"
+#include "Benchmarks.h"
 #include "VulkanProxies.h"
 
 #include <iostream>
@@ -7,38 +8,118 @@
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <cstdlib>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cmath>
+#include <thread>
 
 namespace tut {
+
+const VkDeviceSize HelloTriangleApplication::STREAM_CHUNK_SIZE;
+const VkDeviceSize HelloTriangleApplication::MESH_UPLOAD_CHUNK;
+
+namespace {
+
+const uint32_t	CULL_BATCHES{ 4 };
+const float		TRIANGLE_BOUNDS_RADIUS{ 0.71f };	//shader.vert's triangle reaches sqrt( 0.5 ) from its origin
+
+//Matches the MeshTransform push constant block of mesh.vert
+struct MeshTransform {
+	float		Scale[ 4 ];
+	float		Offset[ 4 ];
+};
+
+//Matches the Draw push constant block of bindless.vert and textured.frag
+struct BindlessDrawConstants {
+	float		ViewProjection[ 16 ];
+	uint32_t	FeedbackBuffer;
+	uint32_t	InstanceBuffer;		//From here on pushed per draw
+	uint32_t	Texture;			//Bindless image index, INVALID_INDEX draws the vertex colors
+	uint32_t	TextureId;			//Streamer id, the feedback entry to write
+};
+
+/*
+===============
+PresentPolicyName
+
+	Returns the command line spelling of a present policy
+===============
+*/
+const char* PresentPolicyName( PresentPolicy policy ) {
+	switch ( policy ) {
+		case PresentPolicy::LowLatency:	return "low-latency";
+		case PresentPolicy::Throughput:	return "throughput";
+		case PresentPolicy::PowerSave:	return "power-save";
+	}
+
+	return "unknown";
+}
+/*
+===============
+PresentModeName
+
+	Returns a readable name for a present mode
+===============
+*/
+const char* PresentModeName( VkPresentModeKHR presentMode ) {
+	switch ( presentMode ) {
+		case VK_PRESENT_MODE_IMMEDIATE_KHR:		return "IMMEDIATE";
+		case VK_PRESENT_MODE_MAILBOX_KHR:		return "MAILBOX";
+		case VK_PRESENT_MODE_FIFO_KHR:			return "FIFO";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR:	return "FIFO_RELAXED";
+		default:								return "other";
+	}
+}
+/*
+===============
+PolicyFramesInFlight
+
+	Returns how far the CPU may run ahead under a present policy. Every
+	queued frame is a frame of input latency, so low latency keeps one.
+===============
+*/
+uint32_t PolicyFramesInFlight( PresentPolicy policy ) {
+	switch ( policy ) {
+		case PresentPolicy::LowLatency:	return 1;
+		case PresentPolicy::Throughput:	return 3;
+		case PresentPolicy::PowerSave:	return 2;
+	}
+
+	return 2;
+}
 /*
 ===============
-HelloTriangleApplication::DebugCallback
+WindowedFramesInFlight
 
-	Debug message callback from the Vulkan validation layers
+	An explicit frame count wins over the one implied by the present policy
 ===============
 */
-VKAPI_ATTR VkBool32 VKAPI_CALL HelloTriangleApplication::DebugCallback(
-	VkDebugReportFlagsEXT flags,
-	VkDebugReportObjectTypeEXT objType,
-	uint64_t obj,
-	size_t location,
-	int32_t code,
-	const char* layerPrefix,
-	const char* msg,
-	void* userData
-) {
-	std::cerr << msg << std::endl;
+uint32_t WindowedFramesInFlight( const ApplicationOptions& options, uint32_t maxFramesInFlight ) {
+	uint32_t framesInFlight = options.FramesInFlight != 0 ? options.FramesInFlight : PolicyFramesInFlight( options.Presentation );
+
+	return std::min( std::max( framesInFlight, 1u ), maxFramesInFlight );
+}
 
-	return VK_FALSE;
 }
+
 /*
 ===============
 HelloTriangleApplication::HelloTriangleApplication
 
-	HelloTriangleApplication default constructor
+	HelloTriangleApplication constructor
 ===============
 */
-HelloTriangleApplication::HelloTriangleApplication( void ) 
-{}
+HelloTriangleApplication::HelloTriangleApplication( const ApplicationOptions& options ) :
+	m_options( options ),
+	m_framesInFlight( options.Headless ? std::max( options.ReadbackDepth, 1u ) : WindowedFramesInFlight( options, MAX_FRAMES_IN_FLIGHT ) )
+{
+	//Route every host allocation the driver makes through our allocator
+	HostAllocator::Install( &m_hostAllocator );
+}
 /*
 ===============
 HelloTriangleApplication::Run
@@ -47,10 +128,165 @@ HelloTriangleApplication::Run
 ===============
 */
 int HelloTriangleApplication::Run( void ) {
+	m_runStart = std::chrono::high_resolution_clock::now();
+
 	try {
-		InitWindow();
+		//First so startup itself is traced
+		if ( !m_options.ProfilePath.empty() ) {
+			CreateTrace();
+		}
+
+		//Window creation and the instance's required extensions both need GLFW before the init graph starts
+		if ( !m_options.Headless ) {
+			glfwInit();
+		}
+
 		InitVulkan();
-		MainLoop();
+
+		if ( m_options.CullOnGpu && !GpuCulling::IsSupported( m_deviceCapabilities ) ) {
+			std::cerr << "GPU culling needs multiDrawIndirect and drawIndirectFirstInstance, drawing per object instead" << std::endl;
+			m_options.CullOnGpu = false;
+		}
+
+		if ( m_options.Bindless && !m_bindless ) {
+			std::cerr << "Bindless drawing needs VK_EXT_descriptor_indexing, binding the instance set instead" << std::endl;
+			m_options.Bindless = false;
+		}
+
+		if ( !m_options.TexturePaths.empty() ) {
+			if ( !TextureStreamer::IsSupported( m_deviceCapabilities ) ) {
+				std::cerr << "Texture streaming needs BC textures, fragment shader stores and VK_EXT_descriptor_indexing, drawing without textures" << std::endl;
+			} else {
+				m_textures = std::make_unique<TextureStreamer>( m_vulkanDevice, *m_deviceMemory, *m_uploads, *m_bindless, m_deletionQueue, m_framesInFlight,
+					( VkDeviceSize )m_options.TextureBudgetMB << 20, TEXTURE_IO_THREADS );
+
+				for ( const std::string& texturePath : m_options.TexturePaths ) {
+					m_textures->Add( texturePath );
+				}
+
+				//Only the bindless pipeline samples streamed textures
+				m_options.Bindless = true;
+			}
+		}
+
+		CreateInstances( std::max( 1u, std::max( m_options.DrawsPerFrame, m_options.RecordingBenchmarkDraws ) ) );
+
+		if ( !m_options.MeshPath.empty() ) {
+			LoadMesh();
+		}
+
+		if ( m_options.DeviceMemoryBenchmark ) {
+			if ( Benchmarks::RunDeviceAllocatorBenchmark( m_deviceCapabilities, m_vulkanDevice ) != EXIT_SUCCESS ) {
+				throw std::runtime_error( "Device memory allocator benchmark failed" );
+			}
+		} else if ( m_options.RenderGraphBenchmark ) {
+			RunRenderGraphBenchmark();
+		} else if ( m_options.DescriptorBenchmark ) {
+			RunDescriptorBenchmark();
+		} else if ( m_options.CullingBenchmark ) {
+			RunCullingBenchmark();
+		} else if ( m_options.RecordingBenchmarkDraws > 0 ) {
+			RunRecordingBenchmark();
+		} else if ( m_options.Headless ) {
+			HeadlessLoop();
+		} else {
+			MainLoop();
+		}
+
+		vkDeviceWaitIdle( m_vulkanDevice );
+		m_deletionQueue.Flush();
+		m_pipelineCache->Save();
+
+		if ( m_traceCollector ) {
+			m_traceCollector->Stop();
+			m_traceCollector->Report( std::cout );
+		}
+
+		if ( m_gpuProfiler ) {
+			m_gpuProfiler->Collect();
+			m_gpuProfiler->Export();
+			m_gpuProfiler->Report( std::cout );
+		}
+
+		if ( m_trace ) {
+			size_t eventCount = m_trace->EventCount();
+
+			if ( m_trace->Close() ) {
+				std::cout << "Trace: " << eventCount << " events written to " << m_options.ProfilePath << std::endl;
+			} else {
+				std::cerr << "Could not write trace " << m_options.ProfilePath << std::endl;
+			}
+		}
+
+		ReportDevices( std::cout );
+		m_initGraph.Report( std::cout );
+
+		if ( m_firstFrameMs > 0.0 ) {
+			std::cout << "Startup: " << m_firstFrameMs << " ms to first frame with " << ( m_options.SerialInit ? "serial" : "parallel" ) << " init, "
+				<< m_jobs->StealCount() << " jobs stolen" << std::endl;
+		}
+
+		m_pipelineCache->Report( std::cout );
+		m_pipelineCompiler->Report( std::cout );
+		m_shaderStore->Report( std::cout );
+		m_deletionQueue.Report( std::cout );
+		m_hostAllocator.Report( std::cout );
+
+		if ( m_debugMessenger ) {
+			m_debugMessenger->Report( std::cout );
+		}
+		m_deviceMemory->Report( std::cout );
+		m_uploads->Report( std::cout );
+		m_descriptorLayouts->Report( std::cout );
+		m_descriptors->Report( std::cout );
+
+		if ( m_bindless ) {
+			m_bindless->Report( std::cout );
+		}
+
+		if ( m_textures ) {
+			m_textures->Report( std::cout );
+		}
+
+		if ( m_mesh.IndexCount > 0 ) {
+			std::cout << "Mesh: " << m_mesh.VertexCount << " vertices, " << m_mesh.IndexCount / 3 << " triangles, "
+				<< ( m_mesh.IndexType == VK_INDEX_TYPE_UINT16 ? 16 : 32 ) << " bit indices, " << m_mesh.FileBytes / ( 1024.0 * 1024.0 ) << " MB loaded in "
+				<< m_mesh.LoadMs << " ms (" << m_mesh.StageMs << " ms copying into staging)" << std::endl;
+		}
+
+		if ( m_options.StreamUploadMB > 0 ) {
+			ReportUploadStream( std::cout );
+		}
+
+		if ( m_options.CullOnGpu ) {
+			m_culling->Report( std::cout );
+		}
+
+		m_renderGraph->Report( std::cout );
+
+		if ( m_options.PrintRenderGraph ) {
+			m_renderGraph->WriteSchedule( std::cout );
+		}
+
+		m_frameStats.Report( std::cout );
+
+		if ( m_recorder ) {
+			m_recorder->Report( std::cout );
+		}
+
+		if ( !m_options.Headless ) {
+			std::cout << "Present: " << PresentPolicyName( m_options.Presentation ) << " policy, " << PresentModeName( m_presentMode ) << ", "
+				<< m_swapChainImages.size() << " images, " << m_framesInFlight << " frames in flight" << std::endl;
+			m_presentTimings.Report( std::cout );
+
+			if ( !m_options.PresentLogPath.empty() && !m_presentTimings.WriteCsv( m_options.PresentLogPath ) ) {
+				std::cerr << "Could not write present timings to " << m_options.PresentLogPath << std::endl;
+			}
+		}
+
+		if ( m_readback ) {
+			m_readback->Report( std::cout );
+		}
 	} catch ( const std::runtime_error& err ) {
 		std::cerr << err.what() << std::endl;
 		return EXIT_FAILURE;
@@ -66,44 +302,90 @@ HelloTriangleApplication::InitVulkan
 ===============
 */
 void HelloTriangleApplication::InitVulkan( void ) {
+	TUT_ZONE( "InitVulkan" );
+
 	if ( ENABLE_VALIDATION_LAYERS && !CheckValidationLayerSupport() ) {
 		std::cerr << "Validation layers are not available" << std::endl;
 		throw std::runtime_error( "Validation layers were requested, but not available!" );
 	}
 
-	CreateInstance();
-	SetupDebugCallback();
-	CreateSurface();
-	PickPhysicalDevice();
-	CreateLogicalDevice();
-	CreateSwapChain();
-	CreateImageViews();
-	CreateGraphicsPipeline();
+	if ( m_options.Headless ) {
+		//Offscreen targets stand in for the swapchain images
+		m_swapChainImageFormat	= OFFSCREEN_FORMAT;
+		m_swapChainExtent		= { WIDTH, HEIGHT };
+	}
+
+	m_jobs = std::make_unique<JobSystem>( 0 );
+
+	//Each stage waits only for what it reads, so the window opens while the instance is created and shaders load beside the swapchain
+	TaskGraph&			graph		= m_initGraph;
+	TaskGraph::TaskId	instance	= graph.Add( "CreateInstance", [this]() { CreateInstance(); } );
+	TaskGraph::TaskId	deviceInput	= instance;
+
+	//Before the device, so every object created on it can be named
+	TaskGraph::TaskId debugMessenger = graph.Add( "SetupDebugMessenger", [this]() { SetupDebugMessenger(); }, { instance } );
+
+	if ( !m_options.Headless ) {
+		//Device selection checks presentation support, so windowed runs need the surface first
+		TaskGraph::TaskId window = graph.AddMainThread( "InitWindow", [this]() { InitWindow(); } );
+
+		deviceInput = graph.Add( "CreateSurface", [this]() { CreateSurface(); }, { instance, window } );
+	}
+
+	TaskGraph::TaskId physicalDevice	= graph.Add( "PickPhysicalDevice", [this]() { PickPhysicalDevice(); }, { deviceInput } );
+	TaskGraph::TaskId device			= graph.Add( "CreateLogicalDevice", [this]() { CreateLogicalDevice(); }, { physicalDevice, debugMessenger } );
+	TaskGraph::TaskId shaders			= graph.Add( "CreateShaderStore", [this]() { CreateShaderStore(); }, { device } );
+	TaskGraph::TaskId commandPool		= graph.Add( "CreateCommandPool", [this]() { CreateCommandPool(); }, { device } );
+
+	if ( !m_options.ProfilePath.empty() ) {
+		graph.Add( "CreateProfiler", [this]() { CreateProfiler(); }, { device } );
+	}
+
+	//The benchmark makes its own recorders, one per thread count
+	if ( m_options.RecordThreads > 0 && m_options.RecordingBenchmarkDraws == 0 ) {
+		graph.Add( "CreateRecorder", [this]() { CreateRecorder(); }, { device } );
+	}
+
+	if ( m_options.Headless ) {
+		TaskGraph::TaskId renderPass = graph.Add( "CreateRenderPass", [this]() { CreateRenderPass(); }, { device } );
+
+		graph.Add( "CreateGraphicsPipeline", [this]() { CreateGraphicsPipeline(); }, { renderPass, shaders } );
+		graph.Add( "CreateOffscreenFrames", [this]() { CreateOffscreenFrames(); }, { renderPass, commandPool } );
+	} else {
+		//The render pass needs the surface format the swapchain settled on
+		TaskGraph::TaskId swapChain		= graph.Add( "CreateSwapChain", [this]() { CreateSwapChain(); }, { device } );
+		TaskGraph::TaskId imageViews	= graph.Add( "CreateImageViews", [this]() { CreateImageViews(); }, { swapChain } );
+		TaskGraph::TaskId renderPass	= graph.Add( "CreateRenderPass", [this]() { CreateRenderPass(); }, { swapChain } );
+
+		graph.Add( "CreateGraphicsPipeline", [this]() { CreateGraphicsPipeline(); }, { renderPass, shaders } );
+		graph.Add( "CreateFramebuffers", [this]() { CreateFramebuffers(); }, { imageViews, renderPass } );
+		graph.Add( "CreateFrameResources", [this]() { CreateFrameResources(); }, { device } );
+	}
+
+	if ( m_options.SerialInit ) {
+		graph.RunSerial();
+	} else {
+		graph.Run( *m_jobs );
+	}
 }
 /*
 ===============
-HelloTriangleApplication::SetupDebugCallback
+HelloTriangleApplication::SetupDebugMessenger
 
-	Hooks the debug callback into the vulkan debug layer
+	Routes validation messages through a DebugMessenger to stderr, keeping
+	the severities from the options, and installs it for object naming
 ===============
 */
-void HelloTriangleApplication::SetupDebugCallback( void ) {
+void HelloTriangleApplication::SetupDebugMessenger( void ) {
+	TUT_ZONE( "SetupDebugMessenger" );
+
 	//Don't do this if the validation layers are disabled
 	if ( !ENABLE_VALIDATION_LAYERS ) {
 		return;
 	}
 
-	VkDebugReportCallbackCreateInfoEXT createInfo = {};
-
-	createInfo.sType		= VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT;
-	createInfo.flags		= VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT; //Enable warnings and errors
-	createInfo.pfnCallback	= DebugCallback;
-
-	//Init unique pointer and use feed it to Vulkan
-	m_vulkanDebugCallback = std::make_unique<VKWrapper<VkDebugReportCallbackEXT>>( *m_vulkanInstance, VulkanProxies::DestroyDebugReportCallbackEXT );
-	if ( VulkanProxies::CreateDebugReportCallbackEXT( *m_vulkanInstance, &createInfo, nullptr, m_vulkanDebugCallback->replace() ) != VK_SUCCESS ) {
-		throw std::runtime_error( "Failed to setup debug callback" );
-	}
+	m_debugMessenger = std::make_unique<DebugMessenger>( m_vulkanInstance, m_options.DebugSeverities, std::cerr );
+	DebugMessenger::Install( m_debugMessenger.get() );
 }
 /*
 ===============
@@ -147,6 +429,8 @@ HelloTriangleApplication::CreateInstance
 ===============
 */
 void HelloTriangleApplication::CreateInstance( void ) {
+	TUT_ZONE( "CreateInstance" );
+
 	VkApplicationInfo							applicationInfo		= {};
 	VkInstanceCreateInfo						instanceInfo		= {};
 	std::unique_ptr<std::vector<const char*>>	requiredExtensions	= GetRequiredExtensions();
@@ -175,11 +459,8 @@ void HelloTriangleApplication::CreateInstance( void ) {
 		instanceInfo.enabledLayerCount = 0;
 	}
 
-	//Initialize the wrapper for our instance
-	m_vulkanInstance = std::make_unique<VKWrapper<VkInstance>>( vkDestroyInstance );
-
-	//Create the instance and store it in the wrapper
-	if ( vkCreateInstance( &instanceInfo, nullptr, m_vulkanInstance->replace() ) != VK_SUCCESS ) {
+	//Create the instance and store it in the handle
+	if ( vkCreateInstance( &instanceInfo, m_hostAllocator.Callbacks(), m_vulkanInstance.replace() ) != VK_SUCCESS ) {
 		throw std::runtime_error( "Could not create a Vulkan Instance!" );
 	}
 }
@@ -250,15 +531,24 @@ HelloTriangleApplication::GetRequiredExtensions
 */
 std::unique_ptr<std::vector<const char*>> HelloTriangleApplication::GetRequiredExtensions( void ) {
 	std::unique_ptr<std::vector<const char*>>	extensions		= std::make_unique<std::vector<const char*>>();
-	uint32_t									extensionCount	= 0;
-	const char**								glfwExtensions	= glfwGetRequiredInstanceExtensions( &extensionCount );
 
-	for ( uint32_t i = 0; i < extensionCount; ++i ) {
-		extensions->push_back( glfwExtensions[ i ] );
+	//Headless runs never initialize GLFW and need no surface extensions
+	if ( !m_options.Headless ) {
+		uint32_t		extensionCount	= 0;
+		const char**	glfwExtensions	= glfwGetRequiredInstanceExtensions( &extensionCount );
+
+		for ( uint32_t i = 0; i < extensionCount; ++i ) {
+			extensions->push_back( glfwExtensions[ i ] );
+		}
 	}
 
 	if ( ENABLE_VALIDATION_LAYERS ) {
-		extensions->push_back( VK_EXT_DEBUG_REPORT_EXTENSION_NAME );
+		extensions->push_back( VK_EXT_DEBUG_UTILS_EXTENSION_NAME );
+	}
+
+	//Optional, device features beyond Vulkan 1.0 can only be queried through it
+	if ( IsExtensionAvailable( GetAvailableExtensions(), VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME ) ) {
+		extensions->push_back( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME );
 	}
 
 	if ( !CheckExtensionSupport( extensions ) ) {
@@ -276,12 +566,52 @@ HelloTriangleApplication::InitWindow
 ===============
 */
 void HelloTriangleApplication::InitWindow( void ) {
-	glfwInit();
+	TUT_ZONE( "InitWindow" );
 
 	glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API ); //Don't use OpenGL from now on
-	glfwWindowHint( GLFW_RESIZABLE, GLFW_FALSE );
+	glfwWindowHint( GLFW_RESIZABLE, GLFW_TRUE );
 
 	m_window = glfwCreateWindow( WIDTH, HEIGHT, "Vulkan", nullptr, nullptr );
+
+	glfwSetWindowUserPointer( m_window, this );
+	glfwSetFramebufferSizeCallback( m_window, FramebufferResized );
+	glfwSetKeyCallback( m_window, KeyPressed );
+}
+/*
+===============
+HelloTriangleApplication::FramebufferResized
+
+	GLFW callback, flags the swapchain for recreation before the next frame
+===============
+*/
+void HelloTriangleApplication::FramebufferResized( GLFWwindow* window, int /*width*/, int /*height*/ ) {
+	HelloTriangleApplication* application = ( HelloTriangleApplication* )glfwGetWindowUserPointer( window );
+
+	application->m_swapChainOutOfDate = true;
+}
+/*
+===============
+HelloTriangleApplication::KeyPressed
+
+	GLFW callback, V switches the debug messenger between the severities
+	from the options and every severity
+===============
+*/
+void HelloTriangleApplication::KeyPressed( GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/ ) {
+	HelloTriangleApplication* application = ( HelloTriangleApplication* )glfwGetWindowUserPointer( window );
+
+	if ( key != GLFW_KEY_V || action != GLFW_PRESS || !application->m_debugMessenger ) {
+		return;
+	}
+
+	const VkDebugUtilsMessageSeverityFlagsEXT ALL_SEVERITIES = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+
+	DebugMessenger&						messenger	= *application->m_debugMessenger;
+	VkDebugUtilsMessageSeverityFlagsEXT	severities	= messenger.Severities() == ALL_SEVERITIES ? application->m_options.DebugSeverities : ALL_SEVERITIES;
+
+	messenger.SetSeverities( severities );
+	std::cout << "Debug messages: " << ( severities == ALL_SEVERITIES ? "every severity" : "severities from the options" ) << std::endl;
 }
 /*
 ===============
@@ -291,9 +621,11 @@ HelloTriangleApplication::CreateSurface
 ===============
 */
 void HelloTriangleApplication::CreateSurface( void ) {
-	m_windowSurface = std::make_unique<VKWrapper<VkSurfaceKHR>>( *m_vulkanInstance, vkDestroySurfaceKHR );
+	TUT_ZONE( "CreateSurface" );
 
-	if ( glfwCreateWindowSurface( *m_vulkanInstance, m_window, nullptr, m_windowSurface->replace() ) != VK_SUCCESS ) {
+	m_windowSurface = VKSurfaceHandle( m_vulkanInstance );
+
+	if ( glfwCreateWindowSurface( m_vulkanInstance, m_window, m_hostAllocator.Callbacks(), m_windowSurface.replace() ) != VK_SUCCESS ) {
 		throw std::runtime_error( "Failed to create window surface for rendering" );
 	}
 }
@@ -301,109 +633,133 @@ void HelloTriangleApplication::CreateSurface( void ) {
 ===============
 HelloTriangleApplication::PickPhysicalDevice
 
-	Picks the physical device to use for rendering
+	Snapshots every physical device once, then picks the preferred device
+	if one was named, otherwise the suitable device with the best score
 ===============
 */
 void HelloTriangleApplication::PickPhysicalDevice( void ) {
+	TUT_ZONE( "PickPhysicalDevice" );
+
 	uint32_t deviceCount = 0;
-	vkEnumeratePhysicalDevices( *m_vulkanInstance, &deviceCount, nullptr );
+	vkEnumeratePhysicalDevices( m_vulkanInstance, &deviceCount, nullptr );
 
 	if ( deviceCount == 0 ) {
 		throw std::runtime_error( "No GPU that supports Vulkan was found" );
 	}
 
 	std::vector<VkPhysicalDevice> devices( deviceCount );
-	vkEnumeratePhysicalDevices( *m_vulkanInstance, &deviceCount, devices.data() );
+	vkEnumeratePhysicalDevices( m_vulkanInstance, &deviceCount, devices.data() );
 
-	for ( const VkPhysicalDevice& device : devices ) {
-		if ( IsDeviceSuitable( device ) ) {
-			m_selectedPhysicalDevice = device;
-			break;
+	//Headless has no surface, which leaves present support and the swapchain details empty
+	for ( VkPhysicalDevice device : devices ) {
+		m_physicalDevices.push_back( DeviceCapabilities::Query( m_vulkanInstance, device, m_windowSurface ) );
+	}
+
+	int selected = FindPreferredDevice();
+
+	if ( selected < 0 ) {
+		for ( size_t i = 0; i < m_physicalDevices.size(); ++i ) {
+			if ( IsDeviceSuitable( m_physicalDevices[ i ] ) && ( selected < 0 || m_physicalDevices[ i ].Score() > m_physicalDevices[ selected ].Score() ) ) {
+				selected = ( int )i;
+			}
 		}
 	}
 
-	if ( m_selectedPhysicalDevice == VK_NULL_HANDLE ) {
+	if ( selected < 0 ) {
 		throw std::runtime_error( "No GPU found that's suitable" );
 	}
+
+	m_deviceCapabilities	= m_physicalDevices[ selected ];
+	m_queueFamilies			= m_deviceCapabilities.FindQueueFamilies( !m_options.Headless );
 }
 /*
 ===============
-HelloTriangleApplication::IsDeviceSuitable
+HelloTriangleApplication::FindPreferredDevice
 
-	Returns if the device is suitable for what functions we need.
+	Returns the device named by --device or DEVICE_ENV, either by index or
+	by part of its name, or -1 when none was named or it is not suitable
 ===============
 */
-bool HelloTriangleApplication::IsDeviceSuitable( VkPhysicalDevice device ) {
-	QueueFamilyIndicies indicies			= FindQueueFamilies( device );
-	bool				extensionsAvailable = CheckDeviceExtensionSupport( device );
-	bool				swapChainAdequate	= false;
+int HelloTriangleApplication::FindPreferredDevice( void ) const {
+	std::string preferred = m_options.PreferredDevice;
 
-	if ( extensionsAvailable ) {
-		SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport( device );
-		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+	if ( preferred.empty() ) {
+		const char* environment = std::getenv( DEVICE_ENV );
+
+		if ( environment != nullptr ) {
+			preferred = environment;
+		}
 	}
 
-	return indicies.IsComplete() && extensionsAvailable && swapChainAdequate;
+	if ( preferred.empty() ) {
+		return -1;
+	}
+
+	char*			end		= nullptr;
+	unsigned long	index	= strtoul( preferred.c_str(), &end, 10 );
+	bool			isIndex	= *end == '\0';
+
+	for ( size_t i = 0; i < m_physicalDevices.size(); ++i ) {
+		const DeviceCapabilities& device = m_physicalDevices[ i ];
+
+		if ( isIndex ? i != index : strstr( device.Properties.deviceName, preferred.c_str() ) == nullptr ) {
+			continue;
+		}
+
+		if ( IsDeviceSuitable( device ) ) {
+			return ( int )i;
+		}
+
+		std::cerr << "Preferred device " << device.Properties.deviceName << " is not suitable, picking by score" << std::endl;
+		return -1;
+	}
+
+	std::cerr << "No device matches " << preferred << ", picking by score" << std::endl;
+	return -1;
 }
 /*
 ===============
-HelloTriangleApplication::CheckDeviceExtensionSupport
+HelloTriangleApplication::IsDeviceSuitable
 
-	Checks if all the required extensions are available
+	Returns if the device is suitable for what functions we need.
 ===============
 */
-bool HelloTriangleApplication::CheckDeviceExtensionSupport( VkPhysicalDevice device ) {
-	uint32_t deviceExtensionCount;
-	vkEnumerateDeviceExtensionProperties( device, nullptr, &deviceExtensionCount, nullptr );
+bool HelloTriangleApplication::IsDeviceSuitable( const DeviceCapabilities& device ) const {
+	QueueFamilyIndicies indicies			= device.FindQueueFamilies( !m_options.Headless );
 
-	std::vector<VkExtensionProperties> availableExtensions( deviceExtensionCount );
-	vkEnumerateDeviceExtensionProperties( device, nullptr, &deviceExtensionCount, availableExtensions.data() );
+	if ( m_options.Headless ) {
+		return indicies.HasGraphics();
+	}
 
-	std::set<std::string> requiredExtensions( DEVICE_EXTENSIONS.begin(), DEVICE_EXTENSIONS.end() );
+	bool				extensionsAvailable = true;
+	bool				swapChainAdequate	= !device.Surface.formats.empty() && !device.Surface.presentModes.empty();
 
-	for ( const VkExtensionProperties& extension : availableExtensions ) {
-		requiredExtensions.erase( extension.extensionName );
+	for ( const char* extension : DEVICE_EXTENSIONS ) {
+		extensionsAvailable = extensionsAvailable && device.HasExtension( extension );
 	}
 
-	return requiredExtensions.empty();
+	return indicies.IsComplete() && extensionsAvailable && swapChainAdequate;
 }
 /*
 ===============
-HelloTriangleApplication::FindQueueFamilies
+HelloTriangleApplication::ReportDevices
 
-	Checks if the device supports graphics queue families
+	Writes every device with its score, marking the one in use
 ===============
 */
-QueueFamilyIndicies HelloTriangleApplication::FindQueueFamilies( VkPhysicalDevice device ) {
-	QueueFamilyIndicies indicies;
-	uint32_t			queueFamilyCount = 0;
-
-	vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, nullptr );
-
-	std::vector<VkQueueFamilyProperties> queueFamilies( queueFamilyCount );
-	vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, queueFamilies.data() );
-
-	int index = 0;
-	for ( const VkQueueFamilyProperties& queueFamily : queueFamilies ) {
-		if ( queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT ) {
-			indicies.GraphicsFamily = index;
-		}
-
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR( device, index, *m_windowSurface, &presentSupport );
-		
-		if ( queueFamily.queueCount > 0 && presentSupport ) {
-			indicies.PresentFamily = index;
-		}
+void HelloTriangleApplication::ReportDevices( std::ostream& out ) const {
+	out << "Devices: " << m_physicalDevices.size() << " found" << std::endl;
 
-		if ( indicies.IsComplete() ) {
-			break;
-		}
+	for ( size_t i = 0; i < m_physicalDevices.size(); ++i ) {
+		const DeviceCapabilities& device = m_physicalDevices[ i ];
 
-		++index;
+		out << ( device.Device == m_deviceCapabilities.Device ? "  * " : "    " ) << i << ": " << device.Properties.deviceName
+			<< " (" << device.TypeName() << ", " << ( device.DeviceLocalBytes() >> 20 ) << " MiB, score " << device.Score()
+			<< ( IsDeviceSuitable( device ) ? "" : ", unsuitable" ) << ")" << std::endl;
 	}
 
-	return indicies;
+	out << "  queues: graphics " << m_queueFamilies.GraphicsFamily << ", present " << m_queueFamilies.PresentFamily
+		<< ", compute " << m_queueFamilies.ComputeFamily << ", transfer " << m_queueFamilies.TransferFamily << std::endl;
 }
 /*
 ===============
@@ -413,16 +769,27 @@ HelloTriangleApplication::CreateLogicalDevice
 ===============
 */
 void HelloTriangleApplication::CreateLogicalDevice( void ) {
-	QueueFamilyIndicies						indicies			= FindQueueFamilies( m_selectedPhysicalDevice );
+	TUT_ZONE( "CreateLogicalDevice" );
+
+	const QueueFamilyIndicies&				indicies			= m_queueFamilies;
 
 	std::vector<VkDeviceQueueCreateInfo>	queueCreateInfos;
-	std::set<int>							uniqueQueueFamilies = { indicies.GraphicsFamily, indicies.PresentFamily };
+	std::set<int>							uniqueQueueFamilies = { indicies.GraphicsFamily };
 	
 	VkPhysicalDeviceFeatures				deviceFeatures		= {};
 	VkDeviceCreateInfo						deviceCreateInfo	= {};
 
 	float									queuePriority		= 1.0f;
 
+	if ( !m_options.Headless ) {
+		uniqueQueueFamilies.insert( indicies.PresentFamily );
+	}
+
+	//Uploads get a queue of their own when the device has a transfer only family
+	if ( indicies.TransferFamily >= 0 ) {
+		uniqueQueueFamilies.insert( indicies.TransferFamily );
+	}
+
 	for ( int queueFamily : uniqueQueueFamilies ) {
 		VkDeviceQueueCreateInfo	queueCreateInfo = {};
 
@@ -438,9 +805,47 @@ void HelloTriangleApplication::CreateLogicalDevice( void ) {
 	deviceCreateInfo.pQueueCreateInfos		= queueCreateInfos.data();
 	deviceCreateInfo.queueCreateInfoCount	= ( uint32_t )queueCreateInfos.size();
 	deviceCreateInfo.pEnabledFeatures		= &deviceFeatures;
-	
-	deviceCreateInfo.enabledExtensionCount		= DEVICE_EXTENSIONS.size();
-	deviceCreateInfo.ppEnabledExtensionNames	= DEVICE_EXTENSIONS.data();
+
+	//GPU culling draws a batch's visible instances with one indirect call, each command picking its instance with firstInstance
+	deviceFeatures.multiDrawIndirect			= m_deviceCapabilities.Features.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance	= m_deviceCapabilities.Features.drawIndirectFirstInstance;
+
+	//Offscreen rendering does not need VK_KHR_swapchain
+	std::vector<const char*> deviceExtensions;
+
+	if ( !m_options.Headless ) {
+		deviceExtensions = DEVICE_EXTENSIONS;
+	}
+
+	if ( GpuCulling::HasDrawCount( m_deviceCapabilities ) ) {
+		deviceExtensions.push_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+	}
+
+	//Block compressed sampling and feedback writes for the texture streamer
+	if ( TextureStreamer::IsSupported( m_deviceCapabilities ) ) {
+		deviceFeatures.textureCompressionBC		= VK_TRUE;
+		deviceFeatures.fragmentStoresAndAtomics	= VK_TRUE;
+	}
+
+	//Only what the bindless table relies on is enabled
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexing = {};
+
+	if ( BindlessTable::IsSupported( m_deviceCapabilities ) ) {
+		descriptorIndexing.sType											= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		descriptorIndexing.runtimeDescriptorArray							= VK_TRUE;
+		descriptorIndexing.descriptorBindingPartiallyBound					= VK_TRUE;
+		descriptorIndexing.descriptorBindingUpdateUnusedWhilePending		= VK_TRUE;
+		descriptorIndexing.descriptorBindingSampledImageUpdateAfterBind		= VK_TRUE;
+		descriptorIndexing.descriptorBindingStorageBufferUpdateAfterBind	= VK_TRUE;
+
+		deviceCreateInfo.pNext = &descriptorIndexing;
+
+		deviceExtensions.push_back( VK_KHR_MAINTENANCE3_EXTENSION_NAME );
+		deviceExtensions.push_back( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME );
+	}
+
+	deviceCreateInfo.enabledExtensionCount		= ( uint32_t )deviceExtensions.size();
+	deviceCreateInfo.ppEnabledExtensionNames	= deviceExtensions.data();
 
 	if ( ENABLE_VALIDATION_LAYERS ) {
 		deviceCreateInfo.enabledLayerCount		= VALIDATION_LAYERS.size();
@@ -449,42 +854,32 @@ void HelloTriangleApplication::CreateLogicalDevice( void ) {
 		deviceCreateInfo.enabledLayerCount = 0;
 	}
 
-	m_vulkanDevice = std::make_unique<VKWrapper<VkDevice>>( vkDestroyDevice );
-	if ( vkCreateDevice( m_selectedPhysicalDevice, &deviceCreateInfo, nullptr, m_vulkanDevice->replace() ) != VK_SUCCESS ) {
+	if ( vkCreateDevice( m_deviceCapabilities.Device, &deviceCreateInfo, m_hostAllocator.Callbacks(), m_vulkanDevice.replace() ) != VK_SUCCESS ) {
 		throw std::runtime_error( "Failed to create logical device" );
 	}
 
-	vkGetDeviceQueue( *m_vulkanDevice, indicies.PresentFamily, 0, &m_presentQueue );
-}
-/*
-===============
-HelloTriangleApplication::QuerySwapChainSupport
-
-	Queries information about the swapchain support
-===============
-*/
-SwapChainSupportDetails HelloTriangleApplication::QuerySwapChainSupport( VkPhysicalDevice device ) {
-	SwapChainSupportDetails details;
+	vkGetDeviceQueue( m_vulkanDevice, indicies.GraphicsFamily, 0, &m_graphicsQueue );
 
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR( device, *m_windowSurface, &details.capabilities );
+	if ( !m_options.Headless ) {
+		vkGetDeviceQueue( m_vulkanDevice, indicies.PresentFamily, 0, &m_presentQueue );
+	}
 
-	uint32_t formatCount;
-	vkGetPhysicalDeviceSurfaceFormatsKHR( device, *m_windowSurface, &formatCount, nullptr );
+	int transferFamily = indicies.TransferFamily >= 0 ? indicies.TransferFamily : indicies.GraphicsFamily;
 
-	if ( formatCount != 0 ) {
-		details.formats.resize( formatCount );
-		vkGetPhysicalDeviceSurfaceFormatsKHR( device, *m_windowSurface, &formatCount, details.formats.data() );
-	}
+	vkGetDeviceQueue( m_vulkanDevice, transferFamily, 0, &m_transferQueue );
 
-	uint32_t presentModeCount;
-	vkGetPhysicalDeviceSurfacePresentModesKHR( device, *m_windowSurface, &presentModeCount, nullptr );
+	m_deviceMemory = std::make_unique<DeviceMemoryAllocator>( m_deviceCapabilities, m_vulkanDevice, m_framesInFlight );
+	m_pipelineCache = std::make_unique<PipelineCache>( m_deviceCapabilities, m_vulkanDevice, PIPELINE_CACHE_PATH );
+	//Here rather than in its own task since the allocator is not thread safe and other tasks allocate from it
+	m_uploads = std::make_unique<UploadQueue>( m_vulkanDevice, *m_deviceMemory, m_transferQueue, transferFamily, indicies.GraphicsFamily,
+		m_deviceCapabilities.QueueFamilies[ transferFamily ].minImageTransferGranularity, UPLOAD_RING_SIZE );
+	m_renderGraph = std::make_unique<RenderGraph>( m_vulkanDevice, *m_deviceMemory, m_deletionQueue );
+	m_descriptorLayouts = std::make_unique<DescriptorLayoutCache>( m_vulkanDevice );
+	m_descriptors = std::make_unique<DescriptorAllocator>( m_vulkanDevice, m_framesInFlight );
 
-	if ( presentModeCount != 0 ) {
-		details.presentModes.resize( presentModeCount );
-		vkGetPhysicalDeviceSurfacePresentModesKHR( device, *m_windowSurface, &presentModeCount, details.presentModes.data() );
+	if ( BindlessTable::IsSupported( m_deviceCapabilities ) ) {
+		m_bindless = std::make_unique<BindlessTable>( m_deviceCapabilities, m_vulkanDevice, *m_descriptorLayouts, m_framesInFlight );
 	}
-
-	return details;
 }
 /*
 ===============
@@ -514,9 +909,24 @@ HelloTriangleApplication::ChooseSwapPresentMode
 ===============
 */
 VkPresentModeKHR HelloTriangleApplication::ChooseSwapPresentMode( const std::vector<VkPresentModeKHR>& presentModes ) {
-	for ( const VkPresentModeKHR& presentMode : presentModes ) {
-		if ( presentMode == VK_PRESENT_MODE_MAILBOX_KHR ) {
-			return presentMode;
+	static const VkPresentModeKHR LOW_LATENCY_MODES[]	= { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+	static const VkPresentModeKHR THROUGHPUT_MODES[]	= { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+
+	//Power save wants vsync and nothing else
+	const VkPresentModeKHR*	preferred		= nullptr;
+	size_t					preferredCount	= 0;
+
+	if ( m_options.Presentation == PresentPolicy::LowLatency ) {
+		preferred		= LOW_LATENCY_MODES;
+		preferredCount	= sizeof( LOW_LATENCY_MODES ) / sizeof( LOW_LATENCY_MODES[ 0 ] );
+	} else if ( m_options.Presentation == PresentPolicy::Throughput ) {
+		preferred		= THROUGHPUT_MODES;
+		preferredCount	= sizeof( THROUGHPUT_MODES ) / sizeof( THROUGHPUT_MODES[ 0 ] );
+	}
+
+	for ( size_t i = 0; i < preferredCount; ++i ) {
+		if ( std::find( presentModes.begin(), presentModes.end(), preferred[ i ] ) != presentModes.end() ) {
+			return preferred[ i ];
 		}
 	}
 
@@ -524,6 +934,34 @@ VkPresentModeKHR HelloTriangleApplication::ChooseSwapPresentMode( const std::vec
 }
 /*
 ===============
+HelloTriangleApplication::ChooseSwapImageCount
+
+	Choose how many swapchain images to ask for. MAILBOX needs a spare image
+	to replace, throughput keeps one more than the frames in flight so the
+	GPU never waits on the display, power save asks for the minimum.
+===============
+*/
+uint32_t HelloTriangleApplication::ChooseSwapImageCount( const VkSurfaceCapabilitiesKHR& capabilities, VkPresentModeKHR presentMode ) {
+	uint32_t imageCount = capabilities.minImageCount + 1;
+
+	if ( m_options.Presentation == PresentPolicy::PowerSave ) {
+		imageCount = std::max( capabilities.minImageCount, 2u );
+	} else if ( m_options.Presentation == PresentPolicy::Throughput ) {
+		imageCount = std::max( imageCount, m_framesInFlight + 1 );
+	}
+
+	if ( presentMode == VK_PRESENT_MODE_MAILBOX_KHR ) {
+		imageCount = std::max( imageCount, 3u );
+	}
+
+	if ( capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount ) {
+		imageCount = capabilities.maxImageCount;
+	}
+
+	return imageCount;
+}
+/*
+===============
 HelloTriangleApplication::ChooseSwapExtent
 
 	Choose swap chain resolution
@@ -533,7 +971,10 @@ VkExtent2D HelloTriangleApplication::ChooseSwapExtent( const VkSurfaceCapabiliti
 	if ( capabilities.currentExtent.width != std::numeric_limits<uint32_t>().max() ) {
 		return capabilities.currentExtent;
 	} else {
-		VkExtent2D actualExtent = { WIDTH, HEIGHT };
+		int width, height;
+		glfwGetFramebufferSize( m_window, &width, &height );
+
+		VkExtent2D actualExtent = { ( uint32_t )width, ( uint32_t )height };
 
 		actualExtent.width	= std::max( capabilities.minImageExtent.width , std::min( capabilities.maxImageExtent.width , actualExtent.width  ) );
 		actualExtent.height = std::max( capabilities.minImageExtent.height, std::min( capabilities.maxImageExtent.height, actualExtent.height ) );
@@ -549,21 +990,23 @@ HelloTriangleApplication::CreateSwapChain
 ===============
 */
 void HelloTriangleApplication::CreateSwapChain( void ) {
-	SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport( m_selectedPhysicalDevice );
+	TUT_ZONE( "CreateSwapChain" );
+
+	//Only the extent limits follow the window, the formats and present modes were read at device selection
+	m_deviceCapabilities.RefreshSurfaceCapabilities( m_windowSurface );
+
+	const SwapChainSupportDetails& swapChainSupport = m_deviceCapabilities.Surface;
 
 	VkSurfaceFormatKHR		swapChainSurfaceFormat	= ChooseSwapSurfaceFormat( swapChainSupport.formats );
 	VkPresentModeKHR		swapChainPresentMode	= ChooseSwapPresentMode( swapChainSupport.presentModes );
 	VkExtent2D				swapChainExtents		= ChooseSwapExtent( swapChainSupport.capabilities );
 
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-	if ( swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount ) {
-		imageCount = swapChainSupport.capabilities.maxImageCount;
-	}
+	uint32_t				imageCount				= ChooseSwapImageCount( swapChainSupport.capabilities, swapChainPresentMode );
 
 	VkSwapchainCreateInfoKHR createInfo = {};
 
 	createInfo.sType	= VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	createInfo.surface	= *m_windowSurface;
+	createInfo.surface	= m_windowSurface;
 
 	createInfo.minImageCount	= imageCount;
 	createInfo.imageFormat		= swapChainSurfaceFormat.format;
@@ -572,7 +1015,7 @@ void HelloTriangleApplication::CreateSwapChain( void ) {
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage		= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-	QueueFamilyIndicies indicies				= FindQueueFamilies( m_selectedPhysicalDevice );
+	QueueFamilyIndicies indicies				= m_queueFamilies;
 	uint32_t			queueFamilyIndicies[]	= { ( uint32_t )indicies.GraphicsFamily, ( uint32_t )indicies.PresentFamily };
 
 	if ( indicies.GraphicsFamily != indicies.PresentFamily ) {
@@ -589,84 +1032,250 @@ void HelloTriangleApplication::CreateSwapChain( void ) {
 	createInfo.compositeAlpha	= VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode		= swapChainPresentMode;
 	createInfo.clipped			= VK_TRUE;
-	createInfo.oldSwapchain		= VK_NULL_HANDLE;
+	createInfo.oldSwapchain		= m_swapchain;	//Lets the driver hand over resources instead of starting from scratch
 
-	m_swapchain = std::make_unique<VKWrapper<VkSwapchainKHR>>( *m_vulkanDevice, vkDestroySwapchainKHR );
+	VKSwapchainHandle swapchain = VKSwapchainHandle( m_vulkanDevice );
 
-	if ( vkCreateSwapchainKHR( *m_vulkanDevice, &createInfo, nullptr, m_swapchain->replace() ) != VK_SUCCESS ) {
+	if ( vkCreateSwapchainKHR( m_vulkanDevice, &createInfo, m_hostAllocator.Callbacks(), swapchain.replace() ) != VK_SUCCESS ) {
 		throw std::runtime_error( "Could not create swapchain" );
 	}
 
+	//The previous swapchain may still be presenting frames in flight
+	m_swapchain.retire( m_deletionQueue );
+	m_swapchain = std::move( swapchain );
+
 	//Retrieve images
 	uint32_t swapChainImageCount;
-	vkGetSwapchainImagesKHR( *m_vulkanDevice, *m_swapchain, &swapChainImageCount, nullptr );
+	vkGetSwapchainImagesKHR( m_vulkanDevice, m_swapchain, &swapChainImageCount, nullptr );
 	m_swapChainImages.resize( swapChainImageCount );
-	vkGetSwapchainImagesKHR( *m_vulkanDevice, *m_swapchain, &swapChainImageCount, m_swapChainImages.data() );
+	vkGetSwapchainImagesKHR( m_vulkanDevice, m_swapchain, &swapChainImageCount, m_swapChainImages.data() );
+
+	for ( uint32_t i = 0; i < swapChainImageCount; ++i ) {
+		DebugMessenger::Name( m_vulkanDevice, VK_OBJECT_TYPE_IMAGE, m_swapChainImages[ i ], ( "Swapchain image " + std::to_string( i ) ).c_str() );
+	}
 
 	//Store these for use later
 	m_swapChainExtent		= swapChainExtents;
 	m_swapChainImageFormat	= swapChainSurfaceFormat.format;
+	m_presentMode			= swapChainPresentMode;
 }
 /*
 ===============
-HelloTriangleApplication::CreateImageViews
+HelloTriangleApplication::RecreateSwapChain
 
-	Creates image views for the swap chain
+	Rebuilds the swapchain and everything sized from it after a resize.
+	Nothing waits for the device to go idle; the old swapchain, views and
+	framebuffers are retired and destroyed once the frames using them have
+	finished. Returns false while the window is minimized.
 ===============
 */
-void HelloTriangleApplication::CreateImageViews( void ) {
-	m_swapChainImageViews.resize( m_swapChainImages.size() );
+bool HelloTriangleApplication::RecreateSwapChain( void ) {
+	TUT_ZONE( "RecreateSwapChain" );
 
-	for ( uint32_t i = 0; i < m_swapChainImageViews.size(); ++i ) {
-		m_swapChainImageViews[ i ] = std::make_unique<VKWrapper<VkImageView>>( *m_vulkanDevice, vkDestroyImageView );
+	int width, height;
+	glfwGetFramebufferSize( m_window, &width, &height );
 
-		VkImageViewCreateInfo imageViewCreateInfo = {};
+	if ( width == 0 || height == 0 ) {
+		return false;
+	}
 
-		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		imageViewCreateInfo.image = m_swapChainImages[ i ];
+	std::chrono::high_resolution_clock::time_point	start		= std::chrono::high_resolution_clock::now();
+	VkFormat										oldFormat	= m_swapChainImageFormat;
 
-		imageViewCreateInfo.viewType	= VK_IMAGE_VIEW_TYPE_2D;
-		imageViewCreateInfo.format		= m_swapChainImageFormat;
+	CreateSwapChain();
+	CreateImageViews();
 
-		imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-		imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-		imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-		imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	//Viewport and scissor are dynamic, so the pipeline only has to be rebuilt if the render pass changed
+	if ( m_swapChainImageFormat != oldFormat ) {
+		m_pipelineCompiler->Retire( m_trianglePipeline, m_deletionQueue );
 
-		imageViewCreateInfo.subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
-		imageViewCreateInfo.subresourceRange.baseMipLevel	= 0;
-		imageViewCreateInfo.subresourceRange.levelCount		= 1;
-		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-		imageViewCreateInfo.subresourceRange.layerCount		= 1;
+		if ( m_meshPipeline != PipelineCompiler::INVALID_PIPELINE ) {
+			m_pipelineCompiler->Retire( m_meshPipeline, m_deletionQueue );
+		}
 
-		if ( vkCreateImageView( *m_vulkanDevice, &imageViewCreateInfo, nullptr, m_swapChainImageViews[ i ]->replace() ) != VK_SUCCESS ) {
-			throw std::runtime_error( "Could not create image view" );
+		if ( m_bindlessPipeline != PipelineCompiler::INVALID_PIPELINE ) {
+			m_pipelineCompiler->Retire( m_bindlessPipeline, m_deletionQueue );
 		}
-	}
-}
-/*
-===============
-HelloTriangleApplication::ReadFile
 
-	Read the file at the path and returns it as a char vector
-===============
-*/
-std::vector<char> HelloTriangleApplication::ReadFile( const std::string& filePath ) {
-	std::ifstream file( filePath, std::ios::ate | std::ios::binary );
+		m_renderPass.retire( m_deletionQueue );
 
-	if ( !file.is_open() ) {
-		throw std::runtime_error( "Failed to open file" );
+		CreateRenderPass();
+		CreateGraphicsPipeline();
 	}
 
-	size_t fileSize = ( size_t )file.tellg();
-	std::vector<char> buffer( fileSize );
+	CreateFramebuffers();
 
-	file.seekg( 0 );
-	file.read( buffer.data(), fileSize );
+	m_swapChainOutOfDate = false;
+	m_frameStats.RecordSwapchainRecreation( std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count() );
 
-	file.close();
+	return true;
+}
+/*
+===============
+HelloTriangleApplication::CreateImageViews
+
+	Creates image views for the swap chain
+===============
+*/
+void HelloTriangleApplication::CreateImageViews( void ) {
+	TUT_ZONE( "CreateImageViews" );
+
+	//Views of a previous swapchain may still be in use by frames in flight
+	for ( VKImageViewHandle& imageView : m_swapChainImageViews ) {
+		imageView.retire( m_deletionQueue );
+	}
+
+	m_swapChainImageViews.clear();
+	m_swapChainImageViews.reserve( m_swapChainImages.size() );
+
+	for ( uint32_t i = 0; i < m_swapChainImages.size(); ++i ) {
+		m_swapChainImageViews.emplace_back( m_vulkanDevice );
+	}
+
+	//Views are independent of each other, and creating them does not need the device externally synchronized
+	m_jobs->ParallelFor( ( uint32_t )m_swapChainImages.size(), [this]( uint32_t i ) {
+		VkImageViewCreateInfo imageViewCreateInfo = {};
+
+		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imageViewCreateInfo.image = m_swapChainImages[ i ];
+
+		imageViewCreateInfo.viewType	= VK_IMAGE_VIEW_TYPE_2D;
+		imageViewCreateInfo.format		= m_swapChainImageFormat;
+
+		imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+		imageViewCreateInfo.subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+		imageViewCreateInfo.subresourceRange.baseMipLevel	= 0;
+		imageViewCreateInfo.subresourceRange.levelCount		= 1;
+		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		imageViewCreateInfo.subresourceRange.layerCount		= 1;
+
+		if ( vkCreateImageView( m_vulkanDevice, &imageViewCreateInfo, m_hostAllocator.Callbacks(), m_swapChainImageViews[ i ].replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create image view" );
+		}
+	} );
+}
+/*
+===============
+HelloTriangleApplication::CreateShaderStore
+
+	Maps the shader archive if there is one, otherwise falls back to the
+	shaders embedded in the executable. Loose files in SHADER_DIRECTORY_ENV
+	override both so shaders can be iterated on without a rebuild.
+===============
+*/
+void HelloTriangleApplication::CreateShaderStore( void ) {
+	TUT_ZONE( "CreateShaderStore" );
+
+	m_shaderStore = std::make_unique<ShaderStore>( m_vulkanDevice );
+
+	if ( !m_shaderStore->Open( SHADER_ARCHIVE_PATH ) ) {
+		m_shaderStore->Add( "vert.spv", EmbeddedShaders::Vertex() );
+		m_shaderStore->Add( "frag.spv", EmbeddedShaders::Fragment() );
+		m_shaderStore->Add( "mesh_vert.spv", EmbeddedShaders::MeshVertex() );
+		m_shaderStore->Add( "cull.spv", EmbeddedShaders::Cull() );
+		m_shaderStore->Add( "bindless_vert.spv", EmbeddedShaders::BindlessVertex() );
+		m_shaderStore->Add( "textured_frag.spv", EmbeddedShaders::TexturedFragment() );
+	}
+
+	const char* shaderDirectory = std::getenv( SHADER_DIRECTORY_ENV );
+
+	if ( shaderDirectory != nullptr && shaderDirectory[ 0 ] != '\0' ) {
+		m_shaderStore->Load( "vert.spv", std::string( shaderDirectory ) + "/vert.spv" );
+		m_shaderStore->Load( "frag.spv", std::string( shaderDirectory ) + "/frag.spv" );
+		m_shaderStore->Load( "mesh_vert.spv", std::string( shaderDirectory ) + "/mesh_vert.spv" );
+		m_shaderStore->Load( "cull.spv", std::string( shaderDirectory ) + "/cull.spv" );
+		m_shaderStore->Load( "bindless_vert.spv", std::string( shaderDirectory ) + "/bindless_vert.spv" );
+		m_shaderStore->Load( "textured_frag.spv", std::string( shaderDirectory ) + "/textured_frag.spv" );
+	}
+}
+/*
+===============
+HelloTriangleApplication::CreateTrace
+
+	Opens the trace file and installs the collector zones record into.
+	Without a profile path neither exists and a zone costs one atomic load.
+===============
+*/
+void HelloTriangleApplication::CreateTrace( void ) {
+	m_trace = std::make_unique<ChromeTrace>( m_options.ProfilePath );
+	m_trace->NameTrack( ChromeTrace::CurrentThreadTrack(), "CPU main" );
+
+	m_traceCollector = std::make_unique<TraceCollector>( *m_trace );
+	TraceCollector::Install( m_traceCollector.get() );
+}
+/*
+===============
+HelloTriangleApplication::CreateProfiler
+
+	Creates the GPU profiler if the graphics queue can write timestamps
+===============
+*/
+void HelloTriangleApplication::CreateProfiler( void ) {
+	TUT_ZONE( "CreateProfiler" );
+
+	QueueFamilyIndicies indicies = m_queueFamilies;
+
+	if ( !GpuProfiler::IsSupported( m_deviceCapabilities, indicies.GraphicsFamily ) ) {
+		std::cerr << "The graphics queue does not support timestamps, only CPU scopes will be traced" << std::endl;
+		return;
+	}
 
-	return buffer;
+	m_gpuProfiler = std::make_unique<GpuProfiler>( m_deviceCapabilities, m_vulkanDevice, indicies.GraphicsFamily, m_framesInFlight, *m_trace );
+}
+/*
+===============
+HelloTriangleApplication::CreateRenderPass
+
+	Creates the render pass that draws into the swapchain, or into the
+	offscreen images when running headless. The frame graph moves the image
+	in and out of COLOR_ATTACHMENT_OPTIMAL and orders the pass against the
+	rest of the frame, so the render pass does neither.
+===============
+*/
+void HelloTriangleApplication::CreateRenderPass( void ) {
+	TUT_ZONE( "CreateRenderPass" );
+
+	VkAttachmentDescription colorAttachment = {};
+
+	colorAttachment.format			= m_swapChainImageFormat;
+	colorAttachment.samples			= VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp			= VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp			= VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp	= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp	= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout	= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.finalLayout		= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentReference = {};
+
+	colorAttachmentReference.attachment	= 0;
+	colorAttachmentReference.layout		= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+
+	subpass.pipelineBindPoint		= VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount	= 1;
+	subpass.pColorAttachments		= &colorAttachmentReference;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+
+	renderPassInfo.sType			= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount	= 1;
+	renderPassInfo.pAttachments		= &colorAttachment;
+	renderPassInfo.subpassCount		= 1;
+	renderPassInfo.pSubpasses		= &subpass;
+
+	m_renderPass = VKRenderPassHandle( m_vulkanDevice );
+
+	if ( vkCreateRenderPass( m_vulkanDevice, &renderPassInfo, m_hostAllocator.Callbacks(), m_renderPass.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create render pass" );
+	}
+
+	DebugMessenger::Name( m_vulkanDevice, VK_OBJECT_TYPE_RENDER_PASS, ( VkRenderPass )m_renderPass, "Triangle render pass" );
 }
 /*
 ===============
@@ -676,59 +1285,2072 @@ HelloTriangleApplication::CreateGraphicsPipeline
 ===============
 */
 void HelloTriangleApplication::CreateGraphicsPipeline( void ) {
-	std::vector<char> vertexShader		= ReadFile( "vert.spv" );
-	std::vector<char> fragmentShader	= ReadFile( "frag.spv" );
+	TUT_ZONE( "CreateGraphicsPipeline" );
+
+	if ( !m_pipelineCompiler ) {
+		m_pipelineCompiler = std::make_unique<PipelineCompiler>( m_vulkanDevice, *m_pipelineCache, *m_shaderStore, PIPELINE_COMPILER_THREADS );
+	}
+
+	//The instance buffer and camera do not depend on the render pass, so the layout outlives render pass changes
+	if ( m_pipelineLayout == VK_NULL_HANDLE ) {
+		m_culling = std::make_unique<GpuCulling>( m_deviceCapabilities, m_vulkanDevice, *m_deviceMemory, m_deletionQueue, *m_descriptorLayouts, *m_pipelineCache, *m_shaderStore );
+
+		VkDescriptorSetLayout		setLayout			= m_culling->InstanceLayout();
+		VkPushConstantRange			pushConstantRange	= {};
+		VkPipelineLayoutCreateInfo	pipelineLayoutInfo	= {};
+
+		pushConstantRange.stageFlags	= VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset		= 0;
+		pushConstantRange.size			= sizeof( m_viewProjection );
+
+		pipelineLayoutInfo.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount			= 1;
+		pipelineLayoutInfo.pSetLayouts				= &setLayout;
+		pipelineLayoutInfo.pushConstantRangeCount	= 1;
+		pipelineLayoutInfo.pPushConstantRanges		= &pushConstantRange;
+
+		m_pipelineLayout = VKPipelineLayoutHandle( m_vulkanDevice );
+
+		if ( vkCreatePipelineLayout( m_vulkanDevice, &pipelineLayoutInfo, m_hostAllocator.Callbacks(), m_pipelineLayout.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create pipeline layout" );
+		}
+	}
+
+	GraphicsPipelineDescription description;
+
+	//The triangle is generated in the vertex shader and placed by its instance, there is no vertex input
+	description.VertexShader	= "vert.spv";
+	description.FragmentShader	= "frag.spv";
+	description.Layout			= m_pipelineLayout;
+	description.RenderPass		= m_renderPass;
+
+	//Frames are recorded without the triangle until it is ready
+	m_trianglePipeline = m_pipelineCompiler->Submit( description, []( PipelineCompiler::PipelineId /*id*/, VkPipeline pipeline, const std::string& failure ) {
+		if ( pipeline == VK_NULL_HANDLE ) {
+			std::cerr << "Could not compile the triangle pipeline: " << failure << std::endl;
+		}
+	} );
 
-	VKWrapper<VkShaderModule> vertShaderModule{ *m_vulkanDevice, vkDestroyShaderModule };
-	VKWrapper<VkShaderModule> fragShaderModule{ *m_vulkanDevice, vkDestroyShaderModule };
+	if ( m_bindless && ( m_options.Bindless || m_options.DescriptorBenchmark ) ) {
+		CreateBindlessPipeline();
+	}
+
+	if ( m_options.MeshPath.empty() ) {
+		return;
+	}
+
+	//The mesh transform follows the window's aspect ratio, so it is pushed while recording
+	if ( m_meshPipelineLayout == VK_NULL_HANDLE ) {
+		VkPushConstantRange			pushConstantRange	= {};
+		VkPipelineLayoutCreateInfo	pipelineLayoutInfo	= {};
+
+		pushConstantRange.stageFlags	= VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset		= 0;
+		pushConstantRange.size			= sizeof( MeshTransform );
+
+		pipelineLayoutInfo.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.pushConstantRangeCount	= 1;
+		pipelineLayoutInfo.pPushConstantRanges		= &pushConstantRange;
+
+		m_meshPipelineLayout = VKPipelineLayoutHandle( m_vulkanDevice );
 
-	CreateShaderModule( vertexShader, vertShaderModule );
-	CreateShaderModule( fragmentShader, fragShaderModule );
+		if ( vkCreatePipelineLayout( m_vulkanDevice, &pipelineLayoutInfo, m_hostAllocator.Callbacks(), m_meshPipelineLayout.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create mesh pipeline layout" );
+		}
+	}
+
+	GraphicsPipelineDescription meshDescription;
+
+	//OBJ winds front faces counter clockwise, which the y flip in the transform keeps on screen
+	meshDescription.VertexShader	= "mesh_vert.spv";
+	meshDescription.FragmentShader	= "frag.spv";
+	meshDescription.Layout			= m_meshPipelineLayout;
+	meshDescription.RenderPass		= m_renderPass;
+	meshDescription.FrontFace		= VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	meshDescription.Bindings		= MeshFile::VertexBindings();
+	meshDescription.Attributes		= MeshFile::VertexAttributes();
 
-	VkPipelineShaderStageCreateInfo vertShaderCreateInfo = {};
+	m_meshPipeline = m_pipelineCompiler->Submit( meshDescription, []( PipelineCompiler::PipelineId /*id*/, VkPipeline pipeline, const std::string& failure ) {
+		if ( pipeline == VK_NULL_HANDLE ) {
+			std::cerr << "Could not compile the mesh pipeline: " << failure << std::endl;
+		}
+	} );
+}
+/*
+===============
+HelloTriangleApplication::CreateBindlessPipeline
 
-	vertShaderCreateInfo.sType	= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderCreateInfo.stage	= VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderCreateInfo.module	= vertShaderModule;
-	vertShaderCreateInfo.pName	= "main";
+	Creates the triangle pipeline that reads its instances through the
+	bindless table and samples streamed textures through it. Its layout has
+	the table as the only set, with the instance buffer's and texture's
+	indices pushed beside the camera.
+===============
+*/
+void HelloTriangleApplication::CreateBindlessPipeline( void ) {
+	if ( m_bindlessPipelineLayout == VK_NULL_HANDLE ) {
+		VkDescriptorSetLayout		setLayout			= m_bindless->Layout();
+		VkPushConstantRange			pushConstantRange	= {};
+		VkPipelineLayoutCreateInfo	pipelineLayoutInfo	= {};
+
+		pushConstantRange.stageFlags	= VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset		= 0;
+		pushConstantRange.size			= sizeof( BindlessDrawConstants );
+
+		pipelineLayoutInfo.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount			= 1;
+		pipelineLayoutInfo.pSetLayouts				= &setLayout;
+		pipelineLayoutInfo.pushConstantRangeCount	= 1;
+		pipelineLayoutInfo.pPushConstantRanges		= &pushConstantRange;
+
+		m_bindlessPipelineLayout = VKPipelineLayoutHandle( m_vulkanDevice );
+
+		if ( vkCreatePipelineLayout( m_vulkanDevice, &pipelineLayoutInfo, m_hostAllocator.Callbacks(), m_bindlessPipelineLayout.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create bindless pipeline layout" );
+		}
+	}
 
-	VkPipelineShaderStageCreateInfo fragShaderCreateInfo = {};
+	GraphicsPipelineDescription description;
 
-	fragShaderCreateInfo.sType	= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderCreateInfo.stage	= VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderCreateInfo.module = fragShaderModule;
-	fragShaderCreateInfo.pName	= "main";
+	description.VertexShader	= "bindless_vert.spv";
+	description.FragmentShader	= "textured_frag.spv";
+	description.Layout			= m_bindlessPipelineLayout;
+	description.RenderPass		= m_renderPass;
 
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderCreateInfo, fragShaderCreateInfo };
+	m_bindlessPipeline = m_pipelineCompiler->Submit( description, []( PipelineCompiler::PipelineId /*id*/, VkPipeline pipeline, const std::string& failure ) {
+		if ( pipeline == VK_NULL_HANDLE ) {
+			std::cerr << "Could not compile the bindless pipeline: " << failure << std::endl;
+		}
+	} );
 }
 /*
 ===============
-HelloTriangleApplication::CreateShaderModule
+HelloTriangleApplication::CreateCommandPool
 
-	Creates a shader from the bytecode passed in
+	Creates the pool command buffers are allocated from
 ===============
 */
-void HelloTriangleApplication::CreateShaderModule( const std::vector<char>& shaderCode, VKWrapper<VkShaderModule>& shaderModule ) {
-	VkShaderModuleCreateInfo createInfo = {};
+void HelloTriangleApplication::CreateCommandPool( void ) {
+	TUT_ZONE( "CreateCommandPool" );
+
+	QueueFamilyIndicies		indicies	= m_queueFamilies;
+	VkCommandPoolCreateInfo	poolInfo	= {};
 
-	createInfo.sType	= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = shaderCode.size();
-	createInfo.pCode	= ( uint32_t* )shaderCode.data();
+	poolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags				= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex	= indicies.GraphicsFamily;
 
-	if ( vkCreateShaderModule( *m_vulkanDevice, &createInfo, nullptr, shaderModule.replace() ) != VK_SUCCESS ) {
-		throw std::runtime_error( "Could not create shader module" );
+	m_commandPool = VKCommandPoolHandle( m_vulkanDevice );
+
+	if ( vkCreateCommandPool( m_vulkanDevice, &poolInfo, m_hostAllocator.Callbacks(), m_commandPool.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create command pool" );
 	}
 }
 /*
 ===============
-HelloTriangleApplication::mainLoop
+HelloTriangleApplication::CreateFramebuffers
 
-	The main run loop for the application
+	Creates a framebuffer for every swapchain image view, along with the
+	semaphore that signals rendering to that image has finished
 ===============
 */
-void HelloTriangleApplication::MainLoop( void ) {
-	while ( !glfwWindowShouldClose( m_window ) ) {
-		glfwPollEvents();
+void HelloTriangleApplication::CreateFramebuffers( void ) {
+	TUT_ZONE( "CreateFramebuffers" );
+
+	//Framebuffers of a previous swapchain may still be in use by frames in flight
+	for ( VKFramebufferHandle& framebuffer : m_swapChainFramebuffers ) {
+		framebuffer.retire( m_deletionQueue );
+	}
+
+	m_swapChainFramebuffers.clear();
+	m_swapChainFramebuffers.reserve( m_swapChainImageViews.size() );
+
+	for ( const VKImageViewHandle& imageView : m_swapChainImageViews ) {
+		VkImageView				attachment		= imageView;
+		VkFramebufferCreateInfo	framebufferInfo	= {};
+
+		framebufferInfo.sType			= VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass		= m_renderPass;
+		framebufferInfo.attachmentCount	= 1;
+		framebufferInfo.pAttachments	= &attachment;
+		framebufferInfo.width			= m_swapChainExtent.width;
+		framebufferInfo.height			= m_swapChainExtent.height;
+		framebufferInfo.layers			= 1;
+
+		m_swapChainFramebuffers.emplace_back( m_vulkanDevice );
+
+		if ( vkCreateFramebuffer( m_vulkanDevice, &framebufferInfo, m_hostAllocator.Callbacks(), m_swapChainFramebuffers.back().replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create framebuffer" );
+		}
+	}
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for ( VKSemaphoreHandle& semaphore : m_renderFinished ) {
+		semaphore.retire( m_deletionQueue );
+	}
+
+	m_renderFinished.clear();
+	m_renderFinished.reserve( m_swapChainImageViews.size() );
+
+	for ( size_t i = 0; i < m_swapChainImageViews.size(); ++i ) {
+		m_renderFinished.emplace_back( m_vulkanDevice );
+
+		if ( vkCreateSemaphore( m_vulkanDevice, &semaphoreInfo, m_hostAllocator.Callbacks(), m_renderFinished.back().replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create render finished semaphore" );
+		}
+	}
+}
+/*
+===============
+HelloTriangleApplication::CreateFrameResources
+
+	Creates a command pool, command buffer, semaphore and fence for every
+	frame in flight. Fences start signaled so the first wait on each slot
+	returns immediately.
+===============
+*/
+void HelloTriangleApplication::CreateFrameResources( void ) {
+	TUT_ZONE( "CreateFrameResources" );
+
+	QueueFamilyIndicies indicies = m_queueFamilies;
+
+	m_frames.resize( m_framesInFlight );
+
+	for ( FrameResources& frame : m_frames ) {
+		//Command buffers are rerecorded every frame, so the whole pool is reset at once
+		VkCommandPoolCreateInfo poolInfo = {};
+
+		poolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags				= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex	= indicies.GraphicsFamily;
+
+		frame.CommandPool = VKCommandPoolHandle( m_vulkanDevice );
+
+		if ( vkCreateCommandPool( m_vulkanDevice, &poolInfo, m_hostAllocator.Callbacks(), frame.CommandPool.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create frame command pool" );
+		}
+
+		VkCommandBufferAllocateInfo allocateInfo = {};
+
+		allocateInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool		= frame.CommandPool;
+		allocateInfo.level				= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount	= 1;
+
+		if ( vkAllocateCommandBuffers( m_vulkanDevice, &allocateInfo, &frame.CommandBuffer ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not allocate frame command buffer" );
+		}
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		frame.ImageAvailable = VKSemaphoreHandle( m_vulkanDevice );
+
+		if ( vkCreateSemaphore( m_vulkanDevice, &semaphoreInfo, m_hostAllocator.Callbacks(), frame.ImageAvailable.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create image available semaphore" );
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		frame.InFlight = VKFenceHandle( m_vulkanDevice );
+
+		if ( vkCreateFence( m_vulkanDevice, &fenceInfo, m_hostAllocator.Callbacks(), frame.InFlight.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create frame fence" );
+		}
+	}
+}
+/*
+===============
+HelloTriangleApplication::CreateOffscreenFrames
+
+	Creates a device local render target for every frame in flight and the
+	readback ring their pixels are copied into
+===============
+*/
+void HelloTriangleApplication::CreateOffscreenFrames( void ) {
+	TUT_ZONE( "CreateOffscreenFrames" );
+
+	m_offscreenFrames.resize( m_framesInFlight );
+
+	std::vector<VkCommandBuffer>	commandBuffers( m_framesInFlight );
+	VkCommandBufferAllocateInfo		allocateInfo = {};
+
+	allocateInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool		= m_commandPool;
+	allocateInfo.level				= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount	= m_framesInFlight;
+
+	if ( vkAllocateCommandBuffers( m_vulkanDevice, &allocateInfo, commandBuffers.data() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not allocate offscreen command buffers" );
+	}
+
+	for ( uint32_t i = 0; i < m_framesInFlight; ++i ) {
+		OffscreenFrame& frame = m_offscreenFrames[ i ];
+
+		VkImageCreateInfo imageInfo = {};
+
+		imageInfo.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType		= VK_IMAGE_TYPE_2D;
+		imageInfo.format		= m_swapChainImageFormat;
+		imageInfo.extent		= { m_swapChainExtent.width, m_swapChainExtent.height, 1 };
+		imageInfo.mipLevels		= 1;
+		imageInfo.arrayLayers	= 1;
+		imageInfo.samples		= VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling		= VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage			= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+
+		frame.Image = VKImageHandle( m_vulkanDevice );
+
+		if ( vkCreateImage( m_vulkanDevice, &imageInfo, m_hostAllocator.Callbacks(), frame.Image.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create offscreen image" );
+		}
+
+		DebugMessenger::Name( m_vulkanDevice, VK_OBJECT_TYPE_IMAGE, ( VkImage )frame.Image, ( "Offscreen image " + std::to_string( i ) ).c_str() );
+
+		frame.ImageMemory = m_deviceMemory->AllocateForImage( frame.Image, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+		VkImageViewCreateInfo viewInfo = {};
+
+		viewInfo.sType								= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image								= frame.Image;
+		viewInfo.viewType							= VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format								= m_swapChainImageFormat;
+		viewInfo.subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.levelCount		= 1;
+		viewInfo.subresourceRange.layerCount		= 1;
+
+		frame.View = VKImageViewHandle( m_vulkanDevice );
+
+		if ( vkCreateImageView( m_vulkanDevice, &viewInfo, m_hostAllocator.Callbacks(), frame.View.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create offscreen image view" );
+		}
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+
+		framebufferInfo.sType			= VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass		= m_renderPass;
+		framebufferInfo.attachmentCount	= 1;
+		framebufferInfo.pAttachments	= &frame.View;
+		framebufferInfo.width			= m_swapChainExtent.width;
+		framebufferInfo.height			= m_swapChainExtent.height;
+		framebufferInfo.layers			= 1;
+
+		frame.Framebuffer = VKFramebufferHandle( m_vulkanDevice );
+
+		if ( vkCreateFramebuffer( m_vulkanDevice, &framebufferInfo, m_hostAllocator.Callbacks(), frame.Framebuffer.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create offscreen framebuffer" );
+		}
+
+		frame.CommandBuffer = commandBuffers[ i ];
+	}
+
+	ReadbackConsumer consumer;
+	if ( !m_options.OutputDirectory.empty() ) {
+		consumer = [this]( const ReadbackFrame& frame ) { WriteFrame( frame ); };
+	}
+
+	m_readback = std::make_unique<ReadbackStage>( m_vulkanDevice, *m_deviceMemory, m_swapChainExtent, m_swapChainImageFormat, m_framesInFlight, m_options.WriterThreads, consumer );
+}
+/*
+===============
+HelloTriangleApplication::RecordOffscreenFrame
+
+	Records the frame graph into an offscreen target, which copies it into
+	the readback slot of the same index. Finished uploads add the semaphores
+	the frame's submission has to wait on.
+===============
+*/
+void HelloTriangleApplication::RecordOffscreenFrame( uint32_t frameSlot, uint64_t frameIndex, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages ) {
+	OffscreenFrame&				frame		= m_offscreenFrames[ frameSlot ];
+	VkCommandBufferBeginInfo	beginInfo	= {};
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if ( vkBeginCommandBuffer( frame.CommandBuffer, &beginInfo ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not begin offscreen command buffer" );
+	}
+
+	if ( m_gpuProfiler ) {
+		m_gpuProfiler->BeginFrame( frame.CommandBuffer, frameSlot, frameIndex );
+	}
+
+	m_uploads->AcquireOnGraphics( frame.CommandBuffer, waitSemaphores, waitStages, m_deletionQueue );
+
+	{
+		GpuScope gpuFrame( m_gpuProfiler.get(), frame.CommandBuffer, "Frame" );
+		RecordFrameGraph( frame.CommandBuffer, frame.Image, frame.Framebuffer, frameSlot );
+	}
+
+	if ( vkEndCommandBuffer( frame.CommandBuffer ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not record offscreen command buffer" );
+	}
+}
+/*
+===============
+HelloTriangleApplication::CreateRecorder
+
+	Creates the command pools and workers for recording the draw list in
+	parallel
+===============
+*/
+void HelloTriangleApplication::CreateRecorder( void ) {
+	TUT_ZONE( "CreateRecorder" );
+
+	QueueFamilyIndicies indicies = m_queueFamilies;
+
+	m_recorder = std::make_unique<ParallelRecorder>( m_vulkanDevice, indicies.GraphicsFamily, m_framesInFlight, m_options.RecordThreads );
+}
+/*
+===============
+HelloTriangleApplication::RecordFrameGraph
+
+	Declares the frame to the render graph and records it: GPU culling when
+	enabled, the triangle pass, then the readback copy when headless. The
+	graph places every barrier between them and leaves a swapchain image
+	ready to present. Its schedule is only compiled again when the passes
+	or the target change, as they do when the swapchain is resized.
+===============
+*/
+void HelloTriangleApplication::RecordFrameGraph( VkCommandBuffer commandBuffer, VkImage target, VkFramebuffer framebuffer, uint32_t frameSlot ) {
+	RenderGraph&			graph		= *m_renderGraph;
+	bool					headless	= m_options.Headless;
+	bool					cullOnGpu	= m_options.CullOnGpu && m_mesh.IndexCount == 0;
+	RenderGraphImageDesc	targetDesc;
+
+	targetDesc.Format = m_swapChainImageFormat;
+	targetDesc.Extent = m_swapChainExtent;
+
+	graph.Reset();
+
+	RenderGraphResource frameImage = graph.ImportImage( headless ? "Offscreen image" : "Swapchain image", target, targetDesc,
+		headless ? RenderGraphAccess::None : RenderGraphAccess::Acquire, headless ? RenderGraphAccess::TransferRead : RenderGraphAccess::Present );
+
+	RenderGraphResource drawCommands	= 0;
+	RenderGraphResource drawCounts		= 0;
+
+	if ( cullOnGpu ) {
+		DeclareCullPasses( graph, drawCommands, drawCounts );
+	}
+
+	RenderGraphPass trianglePass = graph.AddPass( "Triangle pass", [this, framebuffer, frameSlot]( VkCommandBuffer passCommandBuffer ) {
+		RecordTriangle( passCommandBuffer, framebuffer, frameSlot );
+	} );
+
+	graph.Write( trianglePass, frameImage, RenderGraphAccess::ColorAttachmentWrite );
+
+	if ( cullOnGpu ) {
+		graph.Read( trianglePass, drawCommands, RenderGraphAccess::IndirectRead );
+		graph.Read( trianglePass, drawCounts, RenderGraphAccess::IndirectRead );
+	}
+
+	if ( headless ) {
+		RenderGraphResource	readbackBuffer	= graph.ImportBuffer( "Readback buffer", m_readback->Buffer( frameSlot ), RenderGraphAccess::None );
+		RenderGraphPass		readbackPass	= graph.AddPass( "Readback copy", [this, target, frameSlot]( VkCommandBuffer passCommandBuffer ) {
+			GpuScope gpuCopy( m_gpuProfiler.get(), passCommandBuffer, "Readback copy" );
+			m_readback->RecordCopy( passCommandBuffer, target, frameSlot );
+		} );
+
+		graph.Read( readbackPass, frameImage, RenderGraphAccess::TransferRead );
+		graph.Write( readbackPass, readbackBuffer, RenderGraphAccess::TransferWrite );
+	}
+
+	graph.Compile();
+	graph.Execute( commandBuffer );
+
+	if ( m_textures ) {
+		m_textures->RecordFeedbackBarrier( commandBuffer );
 	}
 }
-}
\ No newline at end of file
+/*
+===============
+HelloTriangleApplication::DeclareCullPasses
+
+	Declares the GPU culling clear and dispatch, which write the indirect
+	draws. The pass drawing them must read both buffers as IndirectRead,
+	which is also how the previous frame left them.
+===============
+*/
+void HelloTriangleApplication::DeclareCullPasses( RenderGraph& graph, RenderGraphResource& drawCommands, RenderGraphResource& drawCounts ) {
+	drawCommands	= graph.ImportBuffer( "Draw commands", m_culling->DrawCommands(), RenderGraphAccess::IndirectRead );
+	drawCounts		= graph.ImportBuffer( "Draw counts", m_culling->DrawCounts(), RenderGraphAccess::IndirectRead );
+
+	RenderGraphPass clearPass = graph.AddPass( "Cull clear", [this]( VkCommandBuffer commandBuffer ) {
+		m_culling->RecordClear( commandBuffer );
+	} );
+
+	graph.Write( clearPass, drawCounts, RenderGraphAccess::TransferWrite );
+
+	if ( !m_culling->UsesDrawCount() ) {
+		graph.Write( clearPass, drawCommands, RenderGraphAccess::TransferWrite );
+	}
+
+	RenderGraphPass cullPass = graph.AddPass( "Cull", [this]( VkCommandBuffer commandBuffer ) {
+		GpuScope gpuScope( m_gpuProfiler.get(), commandBuffer, "Cull" );
+		m_culling->RecordDispatch( commandBuffer, m_viewProjection );
+	} );
+
+	graph.Write( cullPass, drawCommands, RenderGraphAccess::ComputeWrite );
+	graph.Write( cullPass, drawCounts, RenderGraphAccess::ComputeWrite );
+}
+/*
+===============
+HelloTriangleApplication::RecordTriangle
+
+	Records the render pass that draws the triangle instances, or the mesh
+	when one is loaded, into a framebuffer. GPU culled instances take a few
+	indirect draws, which are recorded inline after the culling passes. With
+	a recorder the draws go into secondaries recorded from the frame slot's
+	pools, otherwise they are recorded inline.
+===============
+*/
+void HelloTriangleApplication::RecordTriangle( VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, uint32_t frameSlot ) {
+	VkClearValue			clearColor		= {};
+	VkRenderPassBeginInfo	renderPassInfo	= {};
+
+	clearColor.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	renderPassInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass			= m_renderPass;
+	renderPassInfo.framebuffer			= framebuffer;
+	renderPassInfo.renderArea.offset	= { 0, 0 };
+	renderPassInfo.renderArea.extent	= m_swapChainExtent;
+	renderPassInfo.clearValueCount		= 1;
+	renderPassInfo.pClearValues			= &clearColor;
+
+	GpuScope gpuScope( m_gpuProfiler.get(), commandBuffer, "Triangle pass" );
+
+	//Never wait on the compiler mid frame, until the pipeline is ready the pass only clears
+	bool		drawMesh	= m_mesh.IndexCount > 0;
+	bool		cullOnGpu	= m_options.CullOnGpu && !drawMesh;
+	bool		bindless	= m_options.Bindless && !drawMesh && !cullOnGpu;
+	VkPipeline	pipeline	= m_pipelineCompiler->Resolve( drawMesh ? m_meshPipeline : bindless ? m_bindlessPipeline : m_trianglePipeline );
+
+	ParallelRecorder::RecordSlice recordSlice = [this, pipeline, drawMesh, bindless]( VkCommandBuffer secondary, uint32_t firstDraw, uint32_t drawCount ) {
+		if ( drawMesh ) {
+			RecordMeshDraws( secondary, pipeline, firstDraw, drawCount );
+		} else if ( bindless ) {
+			RecordBindlessDraws( secondary, pipeline, firstDraw, drawCount );
+		} else {
+			RecordDraws( secondary, pipeline, firstDraw, drawCount );
+		}
+	};
+
+	if ( pipeline == VK_NULL_HANDLE ) {
+		vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+		vkCmdEndRenderPass( commandBuffer );
+	} else if ( cullOnGpu ) {
+		vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+		RecordCulledDraws( commandBuffer, pipeline );
+		vkCmdEndRenderPass( commandBuffer );
+	} else if ( m_recorder ) {
+		VkCommandBufferInheritanceInfo inheritance = {};
+
+		inheritance.sType		= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass	= m_renderPass;
+		inheritance.subpass		= 0;
+		inheritance.framebuffer	= framebuffer;
+
+		vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
+		m_recorder->Record( commandBuffer, frameSlot, inheritance, m_options.DrawsPerFrame, recordSlice );
+		vkCmdEndRenderPass( commandBuffer );
+	} else {
+		vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+		recordSlice( commandBuffer, 0, m_options.DrawsPerFrame );
+		vkCmdEndRenderPass( commandBuffer );
+	}
+}
+/*
+===============
+HelloTriangleApplication::RecordDraws
+
+	Records a slice of the draw list, one draw per instance. Secondaries
+	inherit no state, so the pipeline, instances and dynamic state are bound
+	in every command buffer. Called from the recorder's workers.
+===============
+*/
+void HelloTriangleApplication::RecordDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount ) {
+	VkViewport viewport = {};
+
+	viewport.width		= ( float )m_swapChainExtent.width;
+	viewport.height		= ( float )m_swapChainExtent.height;
+	viewport.minDepth	= 0.0f;
+	viewport.maxDepth	= 1.0f;
+
+	VkRect2D scissor = {};
+
+	scissor.offset	= { 0, 0 };
+	scissor.extent	= m_swapChainExtent;
+
+	VkDescriptorSet descriptorSet = m_culling->DescriptorSet();
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+	vkCmdPushConstants( commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( m_viewProjection ), m_viewProjection );
+
+	//The draw index is the instance index, so each draw reads its own transform
+	for ( uint32_t draw = 0; draw < drawCount; ++draw ) {
+		vkCmdDraw( commandBuffer, 3, 1, 0, firstDraw + draw );
+	}
+}
+/*
+===============
+HelloTriangleApplication::RecordPooledDraws
+
+	Records a slice of the draw list the way a renderer without bindless
+	binds per draw resources: every draw allocates a set from the frame's
+	pools, writes its instance buffer into it and binds it. Only the
+	descriptor benchmark uses it; the allocator is not thread safe, so it
+	records inline on the main thread.
+===============
+*/
+void HelloTriangleApplication::RecordPooledDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount ) {
+	VkViewport viewport = {};
+
+	viewport.width		= ( float )m_swapChainExtent.width;
+	viewport.height		= ( float )m_swapChainExtent.height;
+	viewport.minDepth	= 0.0f;
+	viewport.maxDepth	= 1.0f;
+
+	VkRect2D scissor = {};
+
+	scissor.offset	= { 0, 0 };
+	scissor.extent	= m_swapChainExtent;
+
+	VkDescriptorSetLayout	setLayout	= m_culling->InstanceLayout();
+	VkDescriptorBufferInfo	bufferInfo	= {};
+	VkWriteDescriptorSet	write		= {};
+
+	bufferInfo.buffer	= m_culling->InstanceBuffer();
+	bufferInfo.offset	= 0;
+	bufferInfo.range	= VK_WHOLE_SIZE;
+
+	write.sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstBinding		= 0;
+	write.descriptorCount	= 1;
+	write.descriptorType	= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo		= &bufferInfo;
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+	vkCmdPushConstants( commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( m_viewProjection ), m_viewProjection );
+
+	//Only the vertex shader's binding is written, the culling bindings are never read by the pipeline
+	for ( uint32_t draw = 0; draw < drawCount; ++draw ) {
+		VkDescriptorSet descriptorSet = m_descriptors->Allocate( setLayout );
+
+		write.dstSet = descriptorSet;
+
+		vkUpdateDescriptorSets( m_vulkanDevice, 1, &write, 0, nullptr );
+		vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+		vkCmdDraw( commandBuffer, 3, 1, 0, firstDraw + draw );
+	}
+}
+/*
+===============
+HelloTriangleApplication::RecordBindlessDraws
+
+	Records a slice of the draw list with the bindless pipeline. The table
+	is bound once, then each draw only pushes the indices of the buffer and
+	texture it reads, as a draw with its own resources would. Draws cycle
+	through the streamed textures when there are any. Called from the
+	recorder's workers.
+===============
+*/
+void HelloTriangleApplication::RecordBindlessDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount ) {
+	VkViewport viewport = {};
+
+	viewport.width		= ( float )m_swapChainExtent.width;
+	viewport.height		= ( float )m_swapChainExtent.height;
+	viewport.minDepth	= 0.0f;
+	viewport.maxDepth	= 1.0f;
+
+	VkRect2D scissor = {};
+
+	scissor.offset	= { 0, 0 };
+	scissor.extent	= m_swapChainExtent;
+
+	VkDescriptorSet				descriptorSet	= m_bindless->Set();
+	BindlessDrawConstants		constants		= {};
+	uint32_t					textureCount	= m_textures ? m_textures->TextureCount() : 0;
+	const VkShaderStageFlags	pushStages		= VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	const uint32_t				drawOffset		= offsetof( BindlessDrawConstants, InstanceBuffer );
+
+	memcpy( constants.ViewProjection, m_viewProjection, sizeof( m_viewProjection ) );
+	constants.FeedbackBuffer	= m_textures ? m_textures->FeedbackBuffer() : BindlessTable::INVALID_INDEX;
+	constants.InstanceBuffer	= m_bindlessInstances;
+	constants.Texture			= BindlessTable::INVALID_INDEX;
+	constants.TextureId			= TextureStreamer::INVALID_TEXTURE;
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_bindlessPipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+	vkCmdPushConstants( commandBuffer, m_bindlessPipelineLayout, pushStages, 0, sizeof( constants ), &constants );
+
+	for ( uint32_t draw = 0; draw < drawCount; ++draw ) {
+		if ( textureCount > 0 ) {
+			constants.TextureId	= ( firstDraw + draw ) % textureCount;
+			constants.Texture	= m_textures->BindlessIndex( constants.TextureId );
+		}
+
+		vkCmdPushConstants( commandBuffer, m_bindlessPipelineLayout, pushStages, drawOffset, sizeof( constants ) - drawOffset, ( const uint8_t* )&constants + drawOffset );
+		vkCmdDraw( commandBuffer, 3, 1, 0, firstDraw + draw );
+	}
+}
+/*
+===============
+HelloTriangleApplication::RecordCulledDraws
+
+	Records the indirect draws of the instances GPU culling left visible.
+	The culling pass must already be recorded in the same command buffer.
+===============
+*/
+void HelloTriangleApplication::RecordCulledDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline ) {
+	VkViewport viewport = {};
+
+	viewport.width		= ( float )m_swapChainExtent.width;
+	viewport.height		= ( float )m_swapChainExtent.height;
+	viewport.minDepth	= 0.0f;
+	viewport.maxDepth	= 1.0f;
+
+	VkRect2D scissor = {};
+
+	scissor.offset	= { 0, 0 };
+	scissor.extent	= m_swapChainExtent;
+
+	VkDescriptorSet descriptorSet = m_culling->DescriptorSet();
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+	vkCmdPushConstants( commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( m_viewProjection ), m_viewProjection );
+	vkCmdBindIndexBuffer( commandBuffer, m_triangleIndices, 0, VK_INDEX_TYPE_UINT16 );
+
+	m_culling->RecordDraws( commandBuffer );
+}
+/*
+===============
+HelloTriangleApplication::RecordMeshDraws
+
+	Records a slice of the draw list with the loaded mesh. The transform
+	fits the mesh bounds into the viewport, keeping their aspect ratio,
+	and flips y since the mesh is y up and Vulkan clip space is y down.
+	There is no depth buffer, z is only kept inside the clip volume. There
+	is a single mesh at a single place, so only the slice holding draw 0
+	records it; drawing it once per draw would only add overdraw.
+===============
+*/
+void HelloTriangleApplication::RecordMeshDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount ) {
+	if ( firstDraw > 0 || drawCount == 0 ) {
+		return;
+	}
+
+	const LoadedMesh& mesh = m_mesh;
+
+	float	sizeX	= mesh.BoundsMax[ 0 ] - mesh.BoundsMin[ 0 ];
+	float	sizeY	= mesh.BoundsMax[ 1 ] - mesh.BoundsMin[ 1 ];
+	float	fit		= 1.8f / std::max( std::max( sizeX, sizeY ), 1e-6f );
+	float	aspect	= ( float )m_swapChainExtent.width / ( float )std::max( m_swapChainExtent.height, 1u );
+	float	scaleX	= fit * std::min( 1.0f, 1.0f / aspect );
+	float	scaleY	= -fit * std::min( 1.0f, aspect );
+
+	//Positions arrive as UNORM across the bounds, so scale by the bounds' size and center them on the origin
+	MeshTransform transform = {
+		{ sizeX * scaleX, sizeY * scaleY, 1.0f, 1.0f },
+		{ -0.5f * sizeX * scaleX, -0.5f * sizeY * scaleY, 0.0f, 0.0f }
+	};
+
+	VkViewport viewport = {};
+
+	viewport.width		= ( float )m_swapChainExtent.width;
+	viewport.height		= ( float )m_swapChainExtent.height;
+	viewport.minDepth	= 0.0f;
+	viewport.maxDepth	= 1.0f;
+
+	VkRect2D scissor = {};
+
+	scissor.offset	= { 0, 0 };
+	scissor.extent	= m_swapChainExtent;
+
+	VkBuffer		vertexBuffer	= mesh.VertexBuffer;
+	VkDeviceSize	vertexOffset	= 0;
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+	vkCmdBindVertexBuffers( commandBuffer, 0, 1, &vertexBuffer, &vertexOffset );
+	vkCmdBindIndexBuffer( commandBuffer, mesh.IndexBuffer, 0, mesh.IndexType );
+	vkCmdPushConstants( commandBuffer, m_meshPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( transform ), &transform );
+
+	vkCmdDrawIndexed( commandBuffer, mesh.IndexCount, 1, 0, 0, 0 );
+}
+/*
+===============
+HelloTriangleApplication::WriteFrame
+
+	Writes a finished headless frame to the output directory. Runs on the
+	readback worker threads.
+===============
+*/
+void HelloTriangleApplication::WriteFrame( const ReadbackFrame& frame ) {
+	char fileName[ 32 ];
+	snprintf( fileName, sizeof( fileName ), "frame_%06llu.%s", ( unsigned long long )frame.FrameIndex, m_options.RawOutput ? "raw" : "ppm" );
+
+	std::string filePath = m_options.OutputDirectory + "/" + fileName;
+
+	if ( m_options.RawOutput ) {
+		ReadbackStage::WriteRaw( frame, filePath );
+	} else {
+		ReadbackStage::WritePPM( frame, filePath );
+	}
+}
+/*
+===============
+HelloTriangleApplication::mainLoop
+
+	The main run loop for the application
+===============
+*/
+void HelloTriangleApplication::MainLoop( void ) {
+	std::chrono::high_resolution_clock::time_point start			= std::chrono::high_resolution_clock::now();
+	std::chrono::high_resolution_clock::time_point lastTitleUpdate	= start;
+
+	while ( !glfwWindowShouldClose( m_window ) ) {
+		glfwPollEvents();
+
+		if ( m_options.ResizeStressSeconds > 0 ) {
+			ResizeForStressTest( std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - start ).count() );
+		}
+
+		if ( m_swapChainOutOfDate && !RecreateSwapChain() ) {
+			//Minimized, there is nothing to present to until the window comes back
+			glfwWaitEvents();
+			continue;
+		}
+
+		DrawFrame();
+
+		//Show frame and wait times in the title once a second so GPU and CPU bound phases are visible live
+		std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+
+		if ( now - lastTitleUpdate >= std::chrono::seconds( 1 ) ) {
+			char title[ 128 ];
+			snprintf( title, sizeof( title ), "Vulkan - %.2f ms/frame, %.2f ms waiting on GPU, %u frames in flight",
+				m_frameStats.LastFrameMs(), m_frameStats.LastWaitMs(), m_framesInFlight );
+
+			glfwSetWindowTitle( m_window, title );
+			lastTitleUpdate = now;
+		}
+	}
+}
+/*
+===============
+HelloTriangleApplication::DrawFrame
+
+	Records and presents one frame. The CPU only blocks on the fence of the
+	frame slot it is about to reuse, which means it is m_framesInFlight
+	frames ahead of the GPU.
+===============
+*/
+void HelloTriangleApplication::DrawFrame( void ) {
+	TUT_ZONE( "DrawFrame" );
+
+	uint32_t										frameSlot	= m_frameIndex % m_framesInFlight;
+	FrameResources&									frame		= m_frames[ frameSlot ];
+	std::chrono::high_resolution_clock::time_point	waitStart	= std::chrono::high_resolution_clock::now();
+	PresentTimestamps								timestamps;
+
+	//Events were just polled, so this is when the input this frame reacts to was sampled
+	timestamps.FrameIndex	= m_frameIndex;
+	timestamps.Input		= waitStart;
+
+	{
+		TUT_ZONE( "Wait for frame fence" );
+
+		if ( vkWaitForFences( m_vulkanDevice, 1, &frame.InFlight, VK_TRUE, std::numeric_limits<uint64_t>::max() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not wait for frame fence" );
+		}
+	}
+
+	double waitMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - waitStart ).count();
+
+	//Frame m_frameIndex - m_framesInFlight is finished, whatever it used can be recycled
+	m_hostAllocator.BeginFrame();
+	m_deletionQueue.BeginFrame( m_frameIndex );
+	m_deviceMemory->BeginFrame( m_frameIndex );
+	m_descriptors->BeginFrame( m_frameIndex );
+
+	if ( m_bindless ) {
+		m_bindless->BeginFrame( m_frameIndex );
+	}
+
+	//Before the flush below, so levels made resident go out with this frame's uploads
+	if ( m_textures ) {
+		m_textures->BeginFrame( m_frameIndex );
+	}
+
+	uint32_t imageIndex;
+	VkResult result;
+
+	{
+		TUT_ZONE( "Acquire" );
+		result = vkAcquireNextImageKHR( m_vulkanDevice, m_swapchain, std::numeric_limits<uint64_t>::max(), frame.ImageAvailable, VK_NULL_HANDLE, &imageIndex );
+	}
+
+	if ( result == VK_ERROR_OUT_OF_DATE_KHR ) {
+		//Nothing can be drawn, but the slot's fence is still signaled behind prior work so the frame retires like any other
+		vkResetFences( m_vulkanDevice, 1, &frame.InFlight );
+
+		if ( vkQueueSubmit( m_graphicsQueue, 0, nullptr, frame.InFlight ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not submit empty frame" );
+		}
+
+		++m_frameIndex;
+		m_swapChainOutOfDate = true;
+		return;
+	} else if ( result == VK_SUBOPTIMAL_KHR ) {
+		//Still presentable, finish this frame and recreate before the next one
+		m_swapChainOutOfDate = true;
+	} else if ( result != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not acquire swapchain image" );
+	}
+
+	timestamps.Acquired = std::chrono::high_resolution_clock::now();
+
+	//Only reset once work is certain to be submitted, so the next wait on this slot cannot deadlock
+	vkResetFences( m_vulkanDevice, 1, &frame.InFlight );
+
+	std::vector<VkSemaphore>			waitSemaphores	= { frame.ImageAvailable };
+	std::vector<VkPipelineStageFlags>	waitStages		= { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+
+	if ( m_options.StreamUploadMB > 0 ) {
+		StreamUpload();
+	}
+
+	//Everything uploaded while the last frame was recorded goes out in one submission
+	m_uploads->Flush();
+
+	{
+		TUT_ZONE( "Record" );
+
+		vkResetCommandPool( m_vulkanDevice, frame.CommandPool, 0 );
+
+		if ( m_recorder ) {
+			m_recorder->BeginFrame( frameSlot );
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if ( vkBeginCommandBuffer( frame.CommandBuffer, &beginInfo ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not begin frame command buffer" );
+		}
+
+		if ( m_gpuProfiler ) {
+			m_gpuProfiler->BeginFrame( frame.CommandBuffer, frameSlot, m_frameIndex );
+		}
+
+		m_uploads->AcquireOnGraphics( frame.CommandBuffer, waitSemaphores, waitStages, m_deletionQueue );
+
+		{
+			GpuScope gpuFrame( m_gpuProfiler.get(), frame.CommandBuffer, "Frame" );
+			RecordFrameGraph( frame.CommandBuffer, m_swapChainImages[ imageIndex ], m_swapChainFramebuffers[ imageIndex ], frameSlot );
+		}
+
+		if ( vkEndCommandBuffer( frame.CommandBuffer ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not record frame command buffer" );
+		}
+	}
+
+	VkSemaphore				renderFinished	= m_renderFinished[ imageIndex ];
+	VkSubmitInfo			submitInfo		= {};
+
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount	= ( uint32_t )waitSemaphores.size();
+	submitInfo.pWaitSemaphores		= waitSemaphores.data();
+	submitInfo.pWaitDstStageMask	= waitStages.data();
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &frame.CommandBuffer;
+	submitInfo.signalSemaphoreCount	= 1;
+	submitInfo.pSignalSemaphores	= &renderFinished;
+
+	{
+		TUT_ZONE( "Submit" );
+
+		if ( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, frame.InFlight ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not submit frame" );
+		}
+	}
+
+	if ( m_gpuProfiler ) {
+		m_gpuProfiler->EndFrame( frameSlot );
+	}
+
+	timestamps.Submitted = std::chrono::high_resolution_clock::now();
+
+	VkSwapchainKHR		swapchain	= m_swapchain;
+	VkPresentInfoKHR	presentInfo	= {};
+
+	presentInfo.sType				= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount	= 1;
+	presentInfo.pWaitSemaphores		= &renderFinished;
+	presentInfo.swapchainCount		= 1;
+	presentInfo.pSwapchains			= &swapchain;
+	presentInfo.pImageIndices		= &imageIndex;
+
+	{
+		TUT_ZONE( "Present" );
+		result = vkQueuePresentKHR( m_presentQueue, &presentInfo );
+	}
+
+	timestamps.Presented = std::chrono::high_resolution_clock::now();
+
+	if ( result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ) {
+		m_swapChainOutOfDate = true;
+	} else if ( result != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not present swapchain image" );
+	}
+
+	++m_frameIndex;
+	m_frameStats.Record( waitMs );
+	m_presentTimings.Record( timestamps );
+
+	if ( m_firstFrameMs == 0.0 ) {
+		m_firstFrameMs = std::chrono::duration<double, std::milli>( timestamps.Presented - m_runStart ).count();
+	}
+}
+/*
+===============
+HelloTriangleApplication::ResizeForStressTest
+
+	Sweeps the window size every frame so the swapchain is recreated
+	continuously, then closes the window once the test has run its course
+===============
+*/
+void HelloTriangleApplication::ResizeForStressTest( double elapsedSeconds ) {
+	if ( elapsedSeconds >= m_options.ResizeStressSeconds ) {
+		glfwSetWindowShouldClose( m_window, GLFW_TRUE );
+		return;
+	}
+
+	//Sizes sweep between half and full size on out of phase curves so both dimensions keep changing
+	double	phase	= elapsedSeconds * 3.0;
+	int		width	= ( int )( WIDTH  * ( 0.75 + 0.25 * std::sin( phase ) ) );
+	int		height	= ( int )( HEIGHT * ( 0.75 + 0.25 * std::cos( phase * 1.3 ) ) );
+
+	glfwSetWindowSize( m_window, width, height );
+}
+/*
+===============
+HelloTriangleApplication::CreateInstances
+
+	Lays the triangle instances out on a square grid centered on the origin
+	and hands them to GPU culling, which also holds them for per object
+	draws. The camera sees the middle quarter of the grid, so culling has
+	something to reject, and sees exactly the original clip space triangle
+	when there is only one instance. Instances are spread over CULL_BATCHES
+	batches that all draw the triangle through a three index buffer, since
+	indirect draws are indexed. The instance buffer is also registered with
+	the bindless table when there is one. Any previous instances must be
+	idle.
+===============
+*/
+void HelloTriangleApplication::CreateInstances( uint32_t instanceCount ) {
+	TUT_ZONE( "CreateInstances" );
+
+	uint32_t					side	= ( uint32_t )ceil( sqrt( ( double )instanceCount ) );
+	float						center	= ( side - 1 ) * 0.5f;
+	std::vector<CullInstance>	instances( instanceCount );
+
+	for ( uint32_t i = 0; i < instanceCount; ++i ) {
+		CullInstance& instance = instances[ i ];
+
+		instance.Transform[ 0 ]	= ( float )( i % side ) - center;
+		instance.Transform[ 1 ]	= ( float )( i / side ) - center;
+		instance.Transform[ 2 ]	= 0.0f;
+		instance.Transform[ 3 ]	= 1.0f;
+		instance.Bounds[ 0 ]	= instance.Transform[ 0 ];
+		instance.Bounds[ 1 ]	= instance.Transform[ 1 ];
+		instance.Bounds[ 2 ]	= 0.0f;
+		instance.Bounds[ 3 ]	= TRIANGLE_BOUNDS_RADIUS;
+		instance.Batch			= i % CULL_BATCHES;
+	}
+
+	std::vector<CullBatch> batches( CULL_BATCHES );
+
+	for ( CullBatch& batch : batches ) {
+		batch.IndexCount = 3;
+	}
+
+	m_culling->SetInstances( instances, batches, *m_uploads );
+
+	//The old buffer is retired, so its slot must not be handed out again until frames that read it have finished
+	if ( m_bindless ) {
+		if ( m_bindlessInstances != BindlessTable::INVALID_INDEX ) {
+			m_bindless->ReleaseBuffer( m_bindlessInstances );
+		}
+
+		m_bindlessInstances = m_bindless->AddBuffer( m_culling->InstanceBuffer(), 0, VK_WHOLE_SIZE );
+	}
+
+	if ( m_triangleIndices == VK_NULL_HANDLE ) {
+		const uint16_t		indices[ 3 ]	= { 0, 1, 2 };
+		VkBufferCreateInfo	bufferInfo		= {};
+
+		bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size			= sizeof( indices );
+		bufferInfo.usage		= VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+		bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+		m_triangleIndices = VKBufferHandle( m_vulkanDevice );
+
+		if ( vkCreateBuffer( m_vulkanDevice, &bufferInfo, m_hostAllocator.Callbacks(), m_triangleIndices.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create triangle index buffer" );
+		}
+
+		DebugMessenger::Name( m_vulkanDevice, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )m_triangleIndices, "Triangle indices" );
+
+		m_triangleIndexMemory = m_deviceMemory->AllocateForBuffer( m_triangleIndices, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 );
+		m_uploads->UploadBuffer( m_triangleIndices, 0, indices, sizeof( indices ) );
+	}
+
+	m_uploads->Flush();
+
+	//Orthographic, column major, z left at zero as the triangle always was
+	float halfExtent = std::max( 1.0f, side / 4.0f );
+
+	memset( m_viewProjection, 0, sizeof( m_viewProjection ) );
+
+	m_viewProjection[ 0 ]	= 1.0f / halfExtent;
+	m_viewProjection[ 5 ]	= 1.0f / halfExtent;
+	m_viewProjection[ 15 ]	= 1.0f;
+}
+/*
+===============
+HelloTriangleApplication::LoadMesh
+
+	Creates the mesh buffers and uploads the mesh file into them. The copy
+	into staging reads the mapping directly, so the file is paged in once
+	and never held in process memory, and each chunk is flushed as soon as
+	it is staged so the transfer queue copies it while the next one pages
+	in. Blocks until the upload has finished, then unmaps the file.
+===============
+*/
+void HelloTriangleApplication::LoadMesh( void ) {
+	TUT_ZONE( "LoadMesh" );
+
+	std::chrono::high_resolution_clock::time_point	start		= std::chrono::high_resolution_clock::now();
+	LoadedMesh&										mesh		= m_mesh;
+	MeshFile										meshFile;
+
+	if ( !meshFile.Open( m_options.MeshPath ) ) {
+		throw std::runtime_error( "Could not open mesh file " + m_options.MeshPath );
+	}
+
+	const MeshFileHeader& header = meshFile.Header();
+
+	VkBufferCreateInfo bufferInfo = {};
+
+	bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size			= header.VertexBytes;
+	bufferInfo.usage		= VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+	mesh.VertexBuffer = VKBufferHandle( m_vulkanDevice );
+
+	if ( vkCreateBuffer( m_vulkanDevice, &bufferInfo, m_hostAllocator.Callbacks(), mesh.VertexBuffer.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create mesh vertex buffer" );
+	}
+
+	DebugMessenger::Name( m_vulkanDevice, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )mesh.VertexBuffer, "Mesh vertices" );
+
+	bufferInfo.size		= header.IndexBytes;
+	bufferInfo.usage	= VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+	mesh.IndexBuffer = VKBufferHandle( m_vulkanDevice );
+
+	if ( vkCreateBuffer( m_vulkanDevice, &bufferInfo, m_hostAllocator.Callbacks(), mesh.IndexBuffer.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create mesh index buffer" );
+	}
+
+	DebugMessenger::Name( m_vulkanDevice, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )mesh.IndexBuffer, "Mesh indices" );
+
+	mesh.VertexMemory	= m_deviceMemory->AllocateForBuffer( mesh.VertexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 );
+	mesh.IndexMemory	= m_deviceMemory->AllocateForBuffer( mesh.IndexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 );
+
+	struct Section {
+		VkBuffer		Buffer;
+		const uint8_t*	Data;
+		VkDeviceSize	Size;
+	};
+
+	Section			sections[ 2 ]	= {
+		{ mesh.VertexBuffer, ( const uint8_t* )meshFile.Vertices(), header.VertexBytes },
+		{ mesh.IndexBuffer, ( const uint8_t* )meshFile.Indices(), header.IndexBytes }
+	};
+	UploadToken		lastToken		= 0;
+
+	for ( const Section& section : sections ) {
+		for ( VkDeviceSize offset = 0; offset < section.Size; offset += MESH_UPLOAD_CHUNK ) {
+			std::chrono::high_resolution_clock::time_point stageStart = std::chrono::high_resolution_clock::now();
+
+			m_uploads->UploadBuffer( section.Buffer, offset, section.Data + offset, std::min( MESH_UPLOAD_CHUNK, section.Size - offset ) );
+
+			mesh.StageMs	+= std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - stageStart ).count();
+			lastToken		= m_uploads->Flush();
+		}
+	}
+
+	//With a transfer family of its own, the first frame still records the acquire barriers for these buffers
+	m_uploads->Wait( lastToken );
+
+	mesh.VertexCount	= header.VertexCount;
+	mesh.IndexCount		= header.IndexCount;
+	mesh.IndexType		= meshFile.IndexType();
+	mesh.FileBytes		= header.IndexOffset + header.IndexBytes;
+
+	memcpy( mesh.BoundsMin, header.BoundsMin, sizeof( mesh.BoundsMin ) );
+	memcpy( mesh.BoundsMax, header.BoundsMax, sizeof( mesh.BoundsMax ) );
+
+	meshFile.Close();
+
+	mesh.LoadMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+}
+/*
+===============
+HelloTriangleApplication::StreamUpload
+
+	Uploads the next chunk of the streaming test, creating its destination
+	on the first call, and charges the frame that just ended to whether the
+	stream was still running during it
+===============
+*/
+void HelloTriangleApplication::StreamUpload( void ) {
+	TUT_ZONE( "StreamUpload" );
+
+	UploadStream&									stream	= m_uploadStream;
+	std::chrono::high_resolution_clock::time_point	now		= std::chrono::high_resolution_clock::now();
+
+	if ( stream.Started ) {
+		double frameMs = std::chrono::duration<double, std::milli>( now - stream.LastFrame ).count();
+
+		if ( stream.Active ) {
+			stream.StreamingMs += frameMs;
+			++stream.StreamingFrames;
+		} else {
+			stream.IdleMs += frameMs;
+			++stream.IdleFrames;
+		}
+	} else {
+		VkBufferCreateInfo bufferInfo = {};
+
+		bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size			= STREAM_BUFFER_SIZE;
+		bufferInfo.usage		= VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+		stream.Buffer = VKBufferHandle( m_vulkanDevice );
+
+		if ( vkCreateBuffer( m_vulkanDevice, &bufferInfo, m_hostAllocator.Callbacks(), stream.Buffer.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create upload stream buffer" );
+		}
+
+		DebugMessenger::Name( m_vulkanDevice, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )stream.Buffer, "Upload stream" );
+
+		stream.Memory		= m_deviceMemory->AllocateForBuffer( stream.Buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 );
+		stream.TotalBytes	= ( uint64_t )m_options.StreamUploadMB << 20;
+		stream.Started		= true;
+		stream.Active		= true;
+		stream.Start		= now;
+
+		stream.Chunk.resize( ( size_t )STREAM_CHUNK_SIZE );
+
+		for ( size_t i = 0; i < stream.Chunk.size(); ++i ) {
+			stream.Chunk[ i ] = ( uint8_t )( i * 31 );
+		}
+	}
+
+	stream.LastFrame = now;
+
+	if ( !stream.Active ) {
+		return;
+	}
+
+	if ( stream.SubmittedBytes == stream.TotalBytes ) {
+		if ( m_uploads->IsComplete( stream.LastToken ) ) {
+			stream.Seconds	= std::chrono::duration<double>( now - stream.Start ).count();
+			stream.Active	= false;
+		}
+
+		return;
+	}
+
+	//The destination is far smaller than the stream, so chunks wrap around it
+	VkDeviceSize chunk = std::min( STREAM_CHUNK_SIZE, stream.TotalBytes - stream.SubmittedBytes );
+
+	stream.LastToken		= m_uploads->UploadBuffer( stream.Buffer, stream.SubmittedBytes % STREAM_BUFFER_SIZE, stream.Chunk.data(), chunk );
+	stream.SubmittedBytes	+= chunk;
+}
+/*
+===============
+HelloTriangleApplication::ReportUploadStream
+
+	Writes the bandwidth of the streaming test and the frame time with and
+	without it running
+===============
+*/
+void HelloTriangleApplication::ReportUploadStream( std::ostream& out ) const {
+	const UploadStream& stream = m_uploadStream;
+
+	double mb				= stream.SubmittedBytes / ( 1024.0 * 1024.0 );
+	double streamingFrameMs	= stream.StreamingFrames > 0 ? stream.StreamingMs / stream.StreamingFrames : 0.0;
+	double idleFrameMs		= stream.IdleFrames > 0 ? stream.IdleMs / stream.IdleFrames : 0.0;
+
+	if ( stream.Active ) {
+		out << "Upload stream: unfinished, " << mb << " MB submitted over " << stream.StreamingFrames << " frames of "
+			<< streamingFrameMs << " ms" << std::endl;
+		return;
+	}
+
+	out << "Upload stream: " << mb << " MB in " << stream.Seconds << " s, " << ( stream.Seconds > 0.0 ? mb / stream.Seconds : 0.0 ) << " MB/s, "
+		<< streamingFrameMs << " ms per frame while streaming (" << stream.StreamingFrames << " frames), "
+		<< idleFrameMs << " ms per frame after (" << stream.IdleFrames << " frames)" << std::endl;
+}
+/*
+===============
+HelloTriangleApplication::HeadlessLoop
+
+	Renders the requested number of frames offscreen as fast as the device
+	allows. Acquiring a readback slot only blocks once the ring is full, so
+	frame K+N renders while frame K is being read and written out.
+===============
+*/
+void HelloTriangleApplication::HeadlessLoop( void ) {
+	//Every written frame should show the triangle, so offline rendering waits once up front rather than skipping draws
+	m_pipelineCompiler->Wait( m_trianglePipeline );
+
+	if ( m_meshPipeline != PipelineCompiler::INVALID_PIPELINE ) {
+		m_pipelineCompiler->Wait( m_meshPipeline );
+	}
+
+	if ( m_bindlessPipeline != PipelineCompiler::INVALID_PIPELINE ) {
+		m_pipelineCompiler->Wait( m_bindlessPipeline );
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for ( uint64_t frameIndex = 0; frameIndex < m_options.HeadlessFrames; ++frameIndex ) {
+		TUT_ZONE( "HeadlessFrame" );
+
+		uint32_t frameSlot;
+
+		{
+			//Once this returns the slot's previous frame has finished on the GPU and been consumed
+			TUT_ZONE( "Acquire readback slot" );
+			frameSlot = m_readback->Acquire();
+		}
+
+		m_hostAllocator.BeginFrame();
+		m_deletionQueue.BeginFrame( frameIndex );
+		m_deviceMemory->BeginFrame( frameIndex );
+		m_descriptors->BeginFrame( frameIndex );
+
+		if ( m_bindless ) {
+			m_bindless->BeginFrame( frameIndex );
+		}
+
+		if ( m_textures ) {
+			m_textures->BeginFrame( frameIndex );
+		}
+
+		if ( m_recorder ) {
+			m_recorder->BeginFrame( frameSlot );
+		}
+
+		if ( m_options.StreamUploadMB > 0 ) {
+			StreamUpload();
+		}
+
+		m_uploads->Flush();
+
+		std::vector<VkSemaphore>			waitSemaphores;
+		std::vector<VkPipelineStageFlags>	waitStages;
+
+		{
+			TUT_ZONE( "Record" );
+			RecordOffscreenFrame( frameSlot, frameIndex, waitSemaphores, waitStages );
+		}
+
+		VkSubmitInfo submitInfo = {};
+
+		submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.waitSemaphoreCount	= ( uint32_t )waitSemaphores.size();
+		submitInfo.pWaitSemaphores		= waitSemaphores.data();
+		submitInfo.pWaitDstStageMask	= waitStages.data();
+		submitInfo.commandBufferCount	= 1;
+		submitInfo.pCommandBuffers		= &m_offscreenFrames[ frameSlot ].CommandBuffer;
+
+		{
+			TUT_ZONE( "Submit" );
+
+			if ( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, m_readback->Fence( frameSlot ) ) != VK_SUCCESS ) {
+				throw std::runtime_error( "Could not submit offscreen frame" );
+			}
+		}
+
+		if ( m_gpuProfiler ) {
+			m_gpuProfiler->EndFrame( frameSlot );
+		}
+
+		m_readback->Submit( frameSlot, frameIndex );
+
+		if ( frameIndex == 0 ) {
+			m_firstFrameMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - m_runStart ).count();
+		}
+	}
+
+	m_readback->Drain();
+
+	double seconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - start ).count();
+
+	std::cout << "Headless: " << m_options.HeadlessFrames << " frames of " << m_swapChainExtent.width << "x" << m_swapChainExtent.height
+		<< " in " << seconds << " s, " << m_options.HeadlessFrames / seconds << " frames/s" << std::endl;
+}
+/*
+===============
+HelloTriangleApplication::RunRecordingBenchmark
+
+	Records the same render pass of RecordingBenchmarkDraws draws on 1 to N
+	threads and reports the speedup over one thread. Only recording is
+	timed, each recording is submitted once afterwards so a broken command
+	buffer cannot go unnoticed. Point VK_ICD_FILENAMES at lavapipe to take
+	GPU drivers out of the picture.
+===============
+*/
+void HelloTriangleApplication::RunRecordingBenchmark( void ) {
+	const uint32_t				ITERATIONS	= 5;
+	uint32_t					drawCount	= m_options.RecordingBenchmarkDraws;
+	uint32_t					maxThreads	= m_options.RecordThreads > 0 ? m_options.RecordThreads : std::max( 1u, std::thread::hardware_concurrency() );
+	QueueFamilyIndicies			indicies	= m_queueFamilies;
+	OffscreenFrame&				frame		= m_offscreenFrames[ 0 ];
+
+	std::cout << "Recording benchmark (" << drawCount << " draws, best of " << ITERATIONS << ") on " << m_deviceCapabilities.Properties.deviceName << std::endl;
+
+	VkClearValue			clearColor		= {};
+	VkRenderPassBeginInfo	renderPassInfo	= {};
+
+	clearColor.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	renderPassInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass			= m_renderPass;
+	renderPassInfo.framebuffer			= frame.Framebuffer;
+	renderPassInfo.renderArea.extent	= m_swapChainExtent;
+	renderPassInfo.clearValueCount		= 1;
+	renderPassInfo.pClearValues			= &clearColor;
+
+	VkCommandBufferInheritanceInfo inheritance = {};
+
+	inheritance.sType		= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass	= m_renderPass;
+	inheritance.framebuffer	= frame.Framebuffer;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkPipeline pipeline = m_pipelineCompiler->Wait( m_trianglePipeline );
+
+	if ( pipeline == VK_NULL_HANDLE ) {
+		throw std::runtime_error( "The recording benchmark needs the triangle pipeline" );
+	}
+
+	ParallelRecorder::RecordSlice recordSlice = [this, pipeline]( VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t count ) {
+		RecordDraws( commandBuffer, pipeline, firstDraw, count );
+	};
+
+	RenderGraphImageDesc targetDesc;
+
+	targetDesc.Format = m_swapChainImageFormat;
+	targetDesc.Extent = m_swapChainExtent;
+
+	double singleThreadMs = 0.0;
+
+	for ( uint32_t threads = 1; threads <= maxThreads; ++threads ) {
+		ParallelRecorder	recorder( m_vulkanDevice, indicies.GraphicsFamily, 1, threads );
+		double				bestMs = std::numeric_limits<double>::max();
+
+		//The first iteration allocates the secondaries and warms the driver's pools
+		for ( uint32_t iteration = 0; iteration <= ITERATIONS; ++iteration ) {
+			recorder.BeginFrame( 0 );
+			vkResetCommandBuffer( frame.CommandBuffer, 0 );
+
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			if ( vkBeginCommandBuffer( frame.CommandBuffer, &beginInfo ) != VK_SUCCESS ) {
+				throw std::runtime_error( "Could not begin benchmark command buffer" );
+			}
+
+			//The same single pass topology every time, so only the first recording compiles the graph
+			m_renderGraph->Reset();
+
+			RenderGraphResource	target	= m_renderGraph->ImportImage( "Offscreen image", frame.Image, targetDesc, RenderGraphAccess::None, RenderGraphAccess::ColorAttachmentWrite );
+			RenderGraphPass		pass	= m_renderGraph->AddPass( "Triangle pass", [&recorder, &renderPassInfo, &inheritance, &recordSlice, drawCount]( VkCommandBuffer commandBuffer ) {
+				vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
+				recorder.Record( commandBuffer, 0, inheritance, drawCount, recordSlice );
+				vkCmdEndRenderPass( commandBuffer );
+			} );
+
+			m_renderGraph->Write( pass, target, RenderGraphAccess::ColorAttachmentWrite );
+			m_renderGraph->Compile();
+			m_renderGraph->Execute( frame.CommandBuffer );
+
+			if ( vkEndCommandBuffer( frame.CommandBuffer ) != VK_SUCCESS ) {
+				throw std::runtime_error( "Could not record benchmark command buffer" );
+			}
+
+			double elapsedMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+			if ( iteration > 0 ) {
+				bestMs = std::min( bestMs, elapsedMs );
+			}
+		}
+
+		VkSubmitInfo submitInfo = {};
+
+		submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount	= 1;
+		submitInfo.pCommandBuffers		= &frame.CommandBuffer;
+
+		if ( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE ) != VK_SUCCESS || vkQueueWaitIdle( m_graphicsQueue ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not submit benchmark command buffer" );
+		}
+
+		if ( threads == 1 ) {
+			singleThreadMs = bestMs;
+		}
+
+		double speedup = singleThreadMs / bestMs;
+
+		std::cout << "  " << threads << " threads: " << bestMs << " ms, " << drawCount / bestMs / 1000.0 << " M draws/s, "
+			<< speedup << "x speedup, " << 100.0 * speedup / threads << "% scaling efficiency" << std::endl;
+	}
+}
+/*
+===============
+HelloTriangleApplication::RunCullingBenchmark
+
+	Draws 10k, 100k and 1M triangle instances with one draw call each and
+	with GPU culling, and reports the best CPU cost of recording and
+	submitting plus, when the queue has timestamps, the GPU time of the
+	frame. The per object path draws every instance, culled or not, which
+	is what the renderer did before culling.
+===============
+*/
+void HelloTriangleApplication::RunCullingBenchmark( void ) {
+	const uint32_t		ITERATIONS		= 5;
+	const uint32_t		COUNTS[]		= { 10000, 100000, 1000000 };
+	const char*			MODE_NAMES[]	= { "per object", "gpu culled" };
+	OffscreenFrame&		frame			= m_offscreenFrames[ 0 ];
+	bool				timestamps		= GpuProfiler::IsSupported( m_deviceCapabilities, m_queueFamilies.GraphicsFamily );
+
+	if ( !GpuCulling::IsSupported( m_deviceCapabilities ) ) {
+		throw std::runtime_error( "The culling benchmark needs multiDrawIndirect and drawIndirectFirstInstance" );
+	}
+
+	std::cout << "Culling benchmark (best of " << ITERATIONS << ", " << ( GpuCulling::HasDrawCount( m_deviceCapabilities ) ? "draw count" : "fixed count" )
+		<< " indirect draws) on " << m_deviceCapabilities.Properties.deviceName << std::endl;
+
+	VkPipeline pipeline = m_pipelineCompiler->Wait( m_trianglePipeline );
+
+	if ( pipeline == VK_NULL_HANDLE ) {
+		throw std::runtime_error( "The culling benchmark needs the triangle pipeline" );
+	}
+
+	VKQueryPoolHandle		queryPool	= VKQueryPoolHandle( m_vulkanDevice );
+	VkQueryPoolCreateInfo	poolInfo	= {};
+
+	poolInfo.sType		= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType	= VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount	= 2;
+
+	if ( timestamps && vkCreateQueryPool( m_vulkanDevice, &poolInfo, m_hostAllocator.Callbacks(), queryPool.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create benchmark query pool" );
+	}
+
+	VkClearValue			clearColor		= {};
+	VkRenderPassBeginInfo	renderPassInfo	= {};
+
+	clearColor.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	renderPassInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass			= m_renderPass;
+	renderPassInfo.framebuffer			= frame.Framebuffer;
+	renderPassInfo.renderArea.extent	= m_swapChainExtent;
+	renderPassInfo.clearValueCount		= 1;
+	renderPassInfo.pClearValues			= &clearColor;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	RenderGraphImageDesc targetDesc;
+
+	targetDesc.Format = m_swapChainImageFormat;
+	targetDesc.Extent = m_swapChainExtent;
+
+	for ( uint32_t instanceCount : COUNTS ) {
+		vkDeviceWaitIdle( m_vulkanDevice );
+		CreateInstances( instanceCount );
+
+		std::cout << "  " << instanceCount << " instances" << std::endl;
+
+		for ( uint32_t mode = 0; mode < 2; ++mode ) {
+			bool	culled		= mode == 1;
+			double	bestCpuMs	= std::numeric_limits<double>::max();
+			double	bestGpuMs	= std::numeric_limits<double>::max();
+
+			//The first iteration also waits on the instance upload
+			for ( uint32_t iteration = 0; iteration <= ITERATIONS; ++iteration ) {
+				std::vector<VkSemaphore>			waitSemaphores;
+				std::vector<VkPipelineStageFlags>	waitStages;
+
+				vkResetCommandBuffer( frame.CommandBuffer, 0 );
+
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+				if ( vkBeginCommandBuffer( frame.CommandBuffer, &beginInfo ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Could not begin benchmark command buffer" );
+				}
+
+				m_uploads->AcquireOnGraphics( frame.CommandBuffer, waitSemaphores, waitStages, m_deletionQueue );
+
+				if ( timestamps ) {
+					vkCmdResetQueryPool( frame.CommandBuffer, queryPool, 0, 2 );
+					vkCmdWriteTimestamp( frame.CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0 );
+				}
+
+				//Switching modes changes the topology, the first iteration of each mode recompiles the graph
+				m_renderGraph->Reset();
+
+				RenderGraphResource target			= m_renderGraph->ImportImage( "Offscreen image", frame.Image, targetDesc, RenderGraphAccess::None, RenderGraphAccess::ColorAttachmentWrite );
+				RenderGraphResource drawCommands	= 0;
+				RenderGraphResource drawCounts		= 0;
+
+				if ( culled ) {
+					DeclareCullPasses( *m_renderGraph, drawCommands, drawCounts );
+				}
+
+				RenderGraphPass trianglePass = m_renderGraph->AddPass( "Triangle pass", [this, &renderPassInfo, pipeline, culled, instanceCount]( VkCommandBuffer commandBuffer ) {
+					vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+					if ( culled ) {
+						RecordCulledDraws( commandBuffer, pipeline );
+					} else {
+						RecordDraws( commandBuffer, pipeline, 0, instanceCount );
+					}
+
+					vkCmdEndRenderPass( commandBuffer );
+				} );
+
+				m_renderGraph->Write( trianglePass, target, RenderGraphAccess::ColorAttachmentWrite );
+
+				if ( culled ) {
+					m_renderGraph->Read( trianglePass, drawCommands, RenderGraphAccess::IndirectRead );
+					m_renderGraph->Read( trianglePass, drawCounts, RenderGraphAccess::IndirectRead );
+				}
+
+				m_renderGraph->Compile();
+				m_renderGraph->Execute( frame.CommandBuffer );
+
+				if ( timestamps ) {
+					vkCmdWriteTimestamp( frame.CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1 );
+				}
+
+				if ( vkEndCommandBuffer( frame.CommandBuffer ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Could not record benchmark command buffer" );
+				}
+
+				VkSubmitInfo submitInfo = {};
+
+				submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+				submitInfo.waitSemaphoreCount	= ( uint32_t )waitSemaphores.size();
+				submitInfo.pWaitSemaphores		= waitSemaphores.data();
+				submitInfo.pWaitDstStageMask	= waitStages.data();
+				submitInfo.commandBufferCount	= 1;
+				submitInfo.pCommandBuffers		= &frame.CommandBuffer;
+
+				if ( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Could not submit benchmark command buffer" );
+				}
+
+				double cpuMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+				if ( vkQueueWaitIdle( m_graphicsQueue ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Benchmark frame did not complete" );
+				}
+
+				if ( iteration == 0 ) {
+					continue;
+				}
+
+				bestCpuMs = std::min( bestCpuMs, cpuMs );
+
+				uint64_t ticks[ 2 ] = {};
+
+				if ( timestamps && vkGetQueryPoolResults( m_vulkanDevice, queryPool, 0, 2, sizeof( ticks ), ticks, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT ) == VK_SUCCESS ) {
+					bestGpuMs = std::min( bestGpuMs, ( ticks[ 1 ] - ticks[ 0 ] ) * m_deviceCapabilities.Properties.limits.timestampPeriod / 1000000.0 );
+				}
+			}
+
+			std::cout << "    " << MODE_NAMES[ mode ] << ": " << bestCpuMs << " ms CPU";
+
+			if ( timestamps ) {
+				std::cout << ", " << bestGpuMs << " ms GPU";
+			}
+
+			std::cout << std::endl;
+		}
+	}
+
+	m_culling->Report( std::cout );
+}
+/*
+===============
+HelloTriangleApplication::RunRenderGraphBenchmark
+
+	Builds a deferred style frame the size of the offscreen images: a
+	G-buffer, lighting, bloom and a tonemap into the frame image, plus a
+	debug pass nothing reads. The passes record nothing, only the graph's
+	barriers run. Prints the compiled schedule, the transient memory
+	aliasing saves, and what a frame costs to declare and compile with and
+	without the cached schedule.
+===============
+*/
+void HelloTriangleApplication::RunRenderGraphBenchmark( void ) {
+	const uint32_t			FRAMES		= 10000;
+	OffscreenFrame&			frame		= m_offscreenFrames[ 0 ];
+	VkExtent2D				extent		= m_swapChainExtent;
+	VkExtent2D				halfExtent	= { std::max( 1u, extent.width / 2 ), std::max( 1u, extent.height / 2 ) };
+	RenderGraph				graph( m_vulkanDevice, *m_deviceMemory, m_deletionQueue );
+
+	std::cout << "Render graph benchmark (" << extent.width << "x" << extent.height << ") on " << m_deviceCapabilities.Properties.deviceName << std::endl;
+
+	RenderGraph::RecordPass nothing = []( VkCommandBuffer ) {};
+
+	//bloomExtent changes the topology, which forces a recompile
+	std::function<void( VkExtent2D )> declare = [&graph, &frame, &nothing, extent, this]( VkExtent2D bloomExtent ) {
+		RenderGraphImageDesc colorDesc;
+		RenderGraphImageDesc normalDesc;
+		RenderGraphImageDesc depthDesc;
+		RenderGraphImageDesc hdrDesc;
+		RenderGraphImageDesc bloomDesc;
+		RenderGraphImageDesc targetDesc;
+
+		colorDesc.Format	= VK_FORMAT_R8G8B8A8_UNORM;
+		colorDesc.Extent	= extent;
+		normalDesc.Format	= VK_FORMAT_R16G16B16A16_SFLOAT;
+		normalDesc.Extent	= extent;
+		depthDesc.Format	= VK_FORMAT_D32_SFLOAT;
+		depthDesc.Extent	= extent;
+		hdrDesc.Format		= VK_FORMAT_R16G16B16A16_SFLOAT;
+		hdrDesc.Extent		= extent;
+		bloomDesc.Format	= VK_FORMAT_R16G16B16A16_SFLOAT;
+		bloomDesc.Extent	= bloomExtent;
+		targetDesc.Format	= m_swapChainImageFormat;
+		targetDesc.Extent	= extent;
+
+		graph.Reset();
+
+		RenderGraphResource target		= graph.ImportImage( "Offscreen image", frame.Image, targetDesc, RenderGraphAccess::None, RenderGraphAccess::TransferRead );
+		RenderGraphResource albedo		= graph.CreateImage( "Albedo", colorDesc );
+		RenderGraphResource normal		= graph.CreateImage( "Normal", normalDesc );
+		RenderGraphResource depth		= graph.CreateImage( "Depth", depthDesc );
+		RenderGraphResource lighting	= graph.CreateImage( "Lighting", hdrDesc );
+		RenderGraphResource bloom		= graph.CreateImage( "Bloom", bloomDesc );
+		RenderGraphResource overdraw	= graph.CreateImage( "Overdraw", colorDesc );
+
+		RenderGraphPass gbufferPass = graph.AddPass( "G-buffer", nothing );
+		graph.Write( gbufferPass, albedo, RenderGraphAccess::ColorAttachmentWrite );
+		graph.Write( gbufferPass, normal, RenderGraphAccess::ColorAttachmentWrite );
+		graph.Write( gbufferPass, depth, RenderGraphAccess::DepthAttachmentWrite );
+
+		RenderGraphPass overdrawPass = graph.AddPass( "Overdraw debug", nothing );
+		graph.Read( overdrawPass, depth, RenderGraphAccess::FragmentShaderRead );
+		graph.Write( overdrawPass, overdraw, RenderGraphAccess::ColorAttachmentWrite );
+
+		RenderGraphPass lightingPass = graph.AddPass( "Lighting", nothing );
+		graph.Read( lightingPass, albedo, RenderGraphAccess::FragmentShaderRead );
+		graph.Read( lightingPass, normal, RenderGraphAccess::FragmentShaderRead );
+		graph.Read( lightingPass, depth, RenderGraphAccess::FragmentShaderRead );
+		graph.Write( lightingPass, lighting, RenderGraphAccess::ColorAttachmentWrite );
+
+		RenderGraphPass bloomPass = graph.AddPass( "Bloom", nothing );
+		graph.Read( bloomPass, lighting, RenderGraphAccess::FragmentShaderRead );
+		graph.Write( bloomPass, bloom, RenderGraphAccess::ColorAttachmentWrite );
+
+		RenderGraphPass tonemapPass = graph.AddPass( "Tonemap", nothing );
+		graph.Read( tonemapPass, lighting, RenderGraphAccess::FragmentShaderRead );
+		graph.Read( tonemapPass, bloom, RenderGraphAccess::FragmentShaderRead );
+		graph.Write( tonemapPass, target, RenderGraphAccess::ColorAttachmentWrite );
+
+		RenderGraphPass copyPass = graph.AddPass( "Copy out", nothing );
+		graph.Read( copyPass, target, RenderGraphAccess::TransferRead );
+	};
+
+	double compileMs = std::numeric_limits<double>::max();
+
+	//Alternating the bloom size makes every declaration a cache miss
+	for ( uint32_t i = 0; i < 10; ++i ) {
+		declare( i % 2 == 0 ? halfExtent : extent );
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		graph.Compile();
+		compileMs = std::min( compileMs, std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count() );
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for ( uint32_t i = 0; i < FRAMES; ++i ) {
+		declare( halfExtent );
+		graph.Compile();
+	}
+
+	double cachedUs = std::chrono::duration<double, std::micro>( std::chrono::high_resolution_clock::now() - start ).count() / FRAMES;
+
+	//Run the schedule once so a broken barrier cannot go unnoticed
+	VkCommandBufferBeginInfo beginInfo = {};
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer( frame.CommandBuffer, 0 );
+
+	if ( vkBeginCommandBuffer( frame.CommandBuffer, &beginInfo ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not begin benchmark command buffer" );
+	}
+
+	graph.Execute( frame.CommandBuffer );
+
+	if ( vkEndCommandBuffer( frame.CommandBuffer ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not record benchmark command buffer" );
+	}
+
+	VkSubmitInfo submitInfo = {};
+
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &frame.CommandBuffer;
+
+	if ( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE ) != VK_SUCCESS || vkQueueWaitIdle( m_graphicsQueue ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not submit benchmark command buffer" );
+	}
+
+	graph.WriteSchedule( std::cout );
+
+	std::cout << "  full compile: " << compileMs << " ms, declare and compile with a cached schedule: " << cachedUs << " us per frame" << std::endl;
+	graph.Report( std::cout );
+}
+/*
+===============
+HelloTriangleApplication::RunDescriptorBenchmark
+
+	Times what binding per draw resources costs at several draw counts.
+	Every mode draws the same instances one draw each: with one set bound
+	for the whole pass as the floor, with a set allocated, written and bound
+	per draw from the frame's pools, and with the bindless table bound once
+	and an index pushed per draw. Reports the best CPU record plus submit
+	time per draw and the GPU time of the pass.
+===============
+*/
+void HelloTriangleApplication::RunDescriptorBenchmark( void ) {
+	const uint32_t		ITERATIONS		= 5;
+	const uint32_t		COUNTS[]		= { 1000, 10000, 100000 };
+	const uint32_t		MAX_COUNT		= COUNTS[ sizeof( COUNTS ) / sizeof( COUNTS[ 0 ] ) - 1 ];
+	const char*			MODE_NAMES[]	= { "one shared set", "pooled set per draw", "bindless index per draw" };
+	OffscreenFrame&		frame			= m_offscreenFrames[ 0 ];
+	bool				timestamps		= GpuProfiler::IsSupported( m_deviceCapabilities, m_queueFamilies.GraphicsFamily );
+	uint32_t			modeCount		= m_bindless ? 3 : 2;
+	uint64_t			frameIndex		= 0;
+
+	std::cout << "Descriptor benchmark (best of " << ITERATIONS << ") on " << m_deviceCapabilities.Properties.deviceName << std::endl;
+
+	if ( !m_bindless ) {
+		std::cout << "  No VK_EXT_descriptor_indexing, skipping bindless" << std::endl;
+	}
+
+	VkPipeline trianglePipeline = m_pipelineCompiler->Wait( m_trianglePipeline );
+	VkPipeline bindlessPipeline = m_bindless ? m_pipelineCompiler->Wait( m_bindlessPipeline ) : VK_NULL_HANDLE;
+
+	if ( trianglePipeline == VK_NULL_HANDLE || ( m_bindless && bindlessPipeline == VK_NULL_HANDLE ) ) {
+		throw std::runtime_error( "The descriptor benchmark needs the triangle pipelines" );
+	}
+
+	VKQueryPoolHandle		queryPool	= VKQueryPoolHandle( m_vulkanDevice );
+	VkQueryPoolCreateInfo	poolInfo	= {};
+
+	poolInfo.sType		= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType	= VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount	= 2;
+
+	if ( timestamps && vkCreateQueryPool( m_vulkanDevice, &poolInfo, m_hostAllocator.Callbacks(), queryPool.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create benchmark query pool" );
+	}
+
+	VkClearValue			clearColor		= {};
+	VkRenderPassBeginInfo	renderPassInfo	= {};
+
+	clearColor.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	renderPassInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass			= m_renderPass;
+	renderPassInfo.framebuffer			= frame.Framebuffer;
+	renderPassInfo.renderArea.extent	= m_swapChainExtent;
+	renderPassInfo.clearValueCount		= 1;
+	renderPassInfo.pClearValues			= &clearColor;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	RenderGraphImageDesc targetDesc;
+
+	targetDesc.Format = m_swapChainImageFormat;
+	targetDesc.Extent = m_swapChainExtent;
+
+	vkDeviceWaitIdle( m_vulkanDevice );
+	CreateInstances( MAX_COUNT );
+
+	for ( uint32_t drawCount : COUNTS ) {
+		std::cout << "  " << drawCount << " draws" << std::endl;
+
+		for ( uint32_t mode = 0; mode < modeCount; ++mode ) {
+			double bestCpuMs = std::numeric_limits<double>::max();
+			double bestGpuMs = std::numeric_limits<double>::max();
+
+			//The first iteration also waits on the instance upload and grows the pools
+			for ( uint32_t iteration = 0; iteration <= ITERATIONS; ++iteration ) {
+				std::vector<VkSemaphore>			waitSemaphores;
+				std::vector<VkPipelineStageFlags>	waitStages;
+
+				//Every iteration waits for the queue to idle, so each one can reuse the pools the last one filled
+				m_descriptors->BeginFrame( frameIndex );
+
+				if ( m_bindless ) {
+					m_bindless->BeginFrame( frameIndex );
+				}
+
+				++frameIndex;
+
+				vkResetCommandBuffer( frame.CommandBuffer, 0 );
+
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+				if ( vkBeginCommandBuffer( frame.CommandBuffer, &beginInfo ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Could not begin benchmark command buffer" );
+				}
+
+				m_uploads->AcquireOnGraphics( frame.CommandBuffer, waitSemaphores, waitStages, m_deletionQueue );
+
+				if ( timestamps ) {
+					vkCmdResetQueryPool( frame.CommandBuffer, queryPool, 0, 2 );
+					vkCmdWriteTimestamp( frame.CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0 );
+				}
+
+				m_renderGraph->Reset();
+
+				RenderGraphResource target = m_renderGraph->ImportImage( "Offscreen image", frame.Image, targetDesc, RenderGraphAccess::None, RenderGraphAccess::ColorAttachmentWrite );
+
+				RenderGraphPass trianglePass = m_renderGraph->AddPass( "Triangle pass", [this, &renderPassInfo, trianglePipeline, bindlessPipeline, mode, drawCount]( VkCommandBuffer commandBuffer ) {
+					vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+					if ( mode == 0 ) {
+						RecordDraws( commandBuffer, trianglePipeline, 0, drawCount );
+					} else if ( mode == 1 ) {
+						RecordPooledDraws( commandBuffer, trianglePipeline, 0, drawCount );
+					} else {
+						RecordBindlessDraws( commandBuffer, bindlessPipeline, 0, drawCount );
+					}
+
+					vkCmdEndRenderPass( commandBuffer );
+				} );
+
+				m_renderGraph->Write( trianglePass, target, RenderGraphAccess::ColorAttachmentWrite );
+				m_renderGraph->Compile();
+				m_renderGraph->Execute( frame.CommandBuffer );
+
+				if ( timestamps ) {
+					vkCmdWriteTimestamp( frame.CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1 );
+				}
+
+				if ( vkEndCommandBuffer( frame.CommandBuffer ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Could not record benchmark command buffer" );
+				}
+
+				VkSubmitInfo submitInfo = {};
+
+				submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+				submitInfo.waitSemaphoreCount	= ( uint32_t )waitSemaphores.size();
+				submitInfo.pWaitSemaphores		= waitSemaphores.data();
+				submitInfo.pWaitDstStageMask	= waitStages.data();
+				submitInfo.commandBufferCount	= 1;
+				submitInfo.pCommandBuffers		= &frame.CommandBuffer;
+
+				if ( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Could not submit benchmark command buffer" );
+				}
+
+				double cpuMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+				if ( vkQueueWaitIdle( m_graphicsQueue ) != VK_SUCCESS ) {
+					throw std::runtime_error( "Benchmark frame did not complete" );
+				}
+
+				if ( iteration == 0 ) {
+					continue;
+				}
+
+				bestCpuMs = std::min( bestCpuMs, cpuMs );
+
+				uint64_t ticks[ 2 ] = {};
+
+				if ( timestamps && vkGetQueryPoolResults( m_vulkanDevice, queryPool, 0, 2, sizeof( ticks ), ticks, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT ) == VK_SUCCESS ) {
+					bestGpuMs = std::min( bestGpuMs, ( ticks[ 1 ] - ticks[ 0 ] ) * m_deviceCapabilities.Properties.limits.timestampPeriod / 1000000.0 );
+				}
+			}
+
+			std::cout << "    " << MODE_NAMES[ mode ] << ": " << bestCpuMs << " ms CPU (" << bestCpuMs * 1000000.0 / drawCount << " ns per draw)";
+
+			if ( timestamps ) {
+				std::cout << ", " << bestGpuMs << " ms GPU";
+			}
+
+			std::cout << std::endl;
+		}
+	}
+
+	m_descriptorLayouts->Report( std::cout );
+	m_descriptors->Report( std::cout );
+
+	if ( m_bindless ) {
+		m_bindless->Report( std::cout );
+	}
+}
+}
@@ -4,22 +4,63 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <chrono>
 #include <memory>
+#include <ostream>
+#include <string>
 #include <vector>
 
-#include "VKWrapper.h"
+#include "VKHandle.h"
+#include "ApplicationOptions.h"
+#include "BindlessTable.h"
+#include "ChromeTrace.h"
+#include "DebugMessenger.h"
+#include "DeletionQueue.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorLayoutCache.h"
+#include "DeviceCapabilities.h"
+#include "DeviceMemoryAllocator.h"
+#include "EmbeddedShaders.h"
+#include "FrameStats.h"
+#include "GpuCulling.h"
+#include "GpuProfiler.h"
+#include "HostAllocator.h"
+#include "JobSystem.h"
+#include "MeshFile.h"
+#include "ParallelRecorder.h"
+#include "PipelineCache.h"
+#include "PipelineCompiler.h"
+#include "PresentTimings.h"
+#include "ShaderStore.h"
 #include "QueueFamilyIndicies.h"
+#include "ReadbackStage.h"
+#include "RenderGraph.h"
 #include "SwapChainSupportDetails.h"
+#include "TaskGraph.h"
+#include "TextureStreamer.h"
+#include "TraceCollector.h"
+#include "UploadQueue.h"
 
 namespace tut {
 
 class HelloTriangleApplication {
 public:
-															HelloTriangleApplication( void );
+	explicit												HelloTriangleApplication( const ApplicationOptions& options = ApplicationOptions() );
 
 	int														Run( void );
 private:
 	void													MainLoop( void );
+	void													DrawFrame( void );
+	void													ResizeForStressTest( double elapsedSeconds );
+	void													CreateInstances( uint32_t instanceCount );
+	void													LoadMesh( void );
+	void													StreamUpload( void );
+	void													ReportUploadStream( std::ostream& out ) const;
+	void													HeadlessLoop( void );
+	void													RunRecordingBenchmark( void );
+	void													RunCullingBenchmark( void );
+	void													RunRenderGraphBenchmark( void );
+	void													RunDescriptorBenchmark( void );
 
 	void													InitVulkan( void );
 	void													InitWindow( void );
@@ -34,58 +75,204 @@ private:
 	bool													CheckValidationLayerSupport( void );
 	bool													CheckExtensionSupport( const std::unique_ptr<std::vector<const char*>>& requiredExtensions );
 
-	void													SetupDebugCallback( void );
-
-	static VKAPI_ATTR VkBool32 VKAPI_CALL					DebugCallback(
-																VkDebugReportFlagsEXT flags,
-																VkDebugReportObjectTypeEXT objType,
-																uint64_t obj,
-																size_t location,
-																int32_t code,
-																const char* layerPrefix,
-																const char* msg,
-																void* userData
-															);
+	void													SetupDebugMessenger( void );
 
 	void													PickPhysicalDevice( void );
-	bool													IsDeviceSuitable( VkPhysicalDevice device );
-	bool													CheckDeviceExtensionSupport( VkPhysicalDevice device );
-	QueueFamilyIndicies										FindQueueFamilies( VkPhysicalDevice device );
+	int														FindPreferredDevice( void ) const;
+	bool													IsDeviceSuitable( const DeviceCapabilities& device ) const;
+	void													ReportDevices( std::ostream& out ) const;
 
 	void													CreateLogicalDevice( void );
 
 	void													CreateSurface( void );
 	
-	SwapChainSupportDetails									QuerySwapChainSupport( VkPhysicalDevice device );
 	VkSurfaceFormatKHR										ChooseSwapSurfaceFormat( const std::vector<VkSurfaceFormatKHR>& formats );
 	VkPresentModeKHR										ChooseSwapPresentMode( const std::vector<VkPresentModeKHR>& presentModes );
 	VkExtent2D												ChooseSwapExtent( const VkSurfaceCapabilitiesKHR& capabilites );
+	uint32_t												ChooseSwapImageCount( const VkSurfaceCapabilitiesKHR& capabilities, VkPresentModeKHR presentMode );
 	void													CreateSwapChain( void );
+	bool													RecreateSwapChain( void );
+
+	static void												FramebufferResized( GLFWwindow* window, int width, int height );
+	static void												KeyPressed( GLFWwindow* window, int key, int scancode, int action, int mods );
 
 	void													CreateImageViews( void );
 
+	void													CreateRenderPass( void );
 	void													CreateGraphicsPipeline( void );
-	std::vector<char>										ReadFile( const std::string& filePath );
-	void													CreateShaderModule( const std::vector<char>& code, VKWrapper<VkShaderModule>& shaderModule );
+	void													CreateBindlessPipeline( void );
+	void													CreateCommandPool( void );
+	void													CreateFramebuffers( void );
+	void													CreateFrameResources( void );
+	void													CreateRecorder( void );
+	void													RecordFrameGraph( VkCommandBuffer commandBuffer, VkImage target, VkFramebuffer framebuffer, uint32_t frameSlot );
+	void													DeclareCullPasses( RenderGraph& graph, RenderGraphResource& drawCommands, RenderGraphResource& drawCounts );
+	void													RecordTriangle( VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, uint32_t frameSlot );
+	void													RecordDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount );
+	void													RecordCulledDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline );
+	void													RecordPooledDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount );
+	void													RecordBindlessDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount );
+	void													RecordMeshDraws( VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstDraw, uint32_t drawCount );
+
+	void													CreateOffscreenFrames( void );
+	void													RecordOffscreenFrame( uint32_t frameSlot, uint64_t frameIndex, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages );
+	void													WriteFrame( const ReadbackFrame& frame );
+	void													CreateShaderStore( void );
+	void													CreateTrace( void );
+	void													CreateProfiler( void );
+
+	/*
+		Everything one windowed frame in flight records into and synchronizes
+		with. The slot is reused once its fence has been waited on.
+	*/
+	struct FrameResources {
+		VKCommandPoolHandle									CommandPool;
+		VkCommandBuffer										CommandBuffer	= VK_NULL_HANDLE;
+		VKSemaphoreHandle									ImageAvailable;
+		VKFenceHandle										InFlight;
+	};
+
+	/*
+		Render target for one headless frame in flight. Its pixels are read
+		back through the ReadbackStage slot of the same index.
+	*/
+	struct OffscreenFrame {
+		VKImageHandle										Image;
+		DeviceAllocation*									ImageMemory		= nullptr;
+		VKImageViewHandle									View;
+		VKFramebufferHandle									Framebuffer;
+		VkCommandBuffer										CommandBuffer	= VK_NULL_HANDLE;
+	};
 
-	std::unique_ptr<VKWrapper<VkInstance>>					m_vulkanInstance{ nullptr };
-	std::unique_ptr<VKWrapper<VkDevice>>					m_vulkanDevice{ nullptr };
-	std::unique_ptr<VKWrapper<VkDebugReportCallbackEXT>>	m_vulkanDebugCallback{ nullptr };
-	std::unique_ptr<VKWrapper<VkSurfaceKHR>>				m_windowSurface{ nullptr };
-	std::unique_ptr<VKWrapper<VkSwapchainKHR>>				m_swapchain{ nullptr };
+	/*
+		The --mesh geometry, uploaded once before the first frame straight
+		from the file mapping
+	*/
+	struct LoadedMesh {
+		VKBufferHandle										VertexBuffer;
+		DeviceAllocation*									VertexMemory	= nullptr;
+		VKBufferHandle										IndexBuffer;
+		DeviceAllocation*									IndexMemory		= nullptr;
+		uint32_t											VertexCount		= 0;
+		uint32_t											IndexCount		= 0;
+		VkIndexType											IndexType		= VK_INDEX_TYPE_UINT16;
+		float												BoundsMin[ 3 ]	= {};
+		float												BoundsMax[ 3 ]	= {};
+		uint64_t											FileBytes		= 0;
+		double												LoadMs			= 0.0;
+		double												StageMs			= 0.0;
+	};
+
+	/*
+		The --stream-upload test: a chunk a frame is uploaded into one device
+		local buffer until the requested size has gone through, to measure
+		upload bandwidth and what it costs the frames rendered beside it.
+	*/
+	struct UploadStream {
+		VKBufferHandle										Buffer;
+		DeviceAllocation*									Memory			= nullptr;
+		std::vector<uint8_t>								Chunk;
+		uint64_t											TotalBytes		= 0;
+		uint64_t											SubmittedBytes	= 0;
+		UploadToken											LastToken		= 0;
+		bool												Started			= false;
+		bool												Active			= false;
+		std::chrono::high_resolution_clock::time_point		Start;
+		std::chrono::high_resolution_clock::time_point		LastFrame;
+		double												Seconds			= 0.0;
+		double												StreamingMs		= 0.0;
+		uint64_t											StreamingFrames	= 0;
+		double												IdleMs			= 0.0;
+		uint64_t											IdleFrames		= 0;
+	};
+
+	ApplicationOptions										m_options;
+	uint32_t												m_framesInFlight;
+	HostAllocator											m_hostAllocator;
+	std::unique_ptr<JobSystem>								m_jobs;
+	TaskGraph												m_initGraph;
+	std::chrono::high_resolution_clock::time_point			m_runStart;
+	double													m_firstFrameMs{ 0.0 };
+
+	VKInstanceHandle										m_vulkanInstance;
+	VKDeviceHandle											m_vulkanDevice;
+	std::unique_ptr<DeviceMemoryAllocator>					m_deviceMemory;
+	std::unique_ptr<PipelineCache>							m_pipelineCache;
+	std::unique_ptr<UploadQueue>							m_uploads;
+	std::unique_ptr<DescriptorLayoutCache>					m_descriptorLayouts;
+	std::unique_ptr<GpuCulling>								m_culling;
+	std::unique_ptr<RenderGraph>							m_renderGraph;
+	std::unique_ptr<DescriptorAllocator>					m_descriptors;
+	std::unique_ptr<BindlessTable>							m_bindless;		//Null without descriptor indexing
+	std::unique_ptr<TextureStreamer>						m_textures;		//Null without texture paths
+	VKBufferHandle											m_triangleIndices;
+	DeviceAllocation*										m_triangleIndexMemory{ nullptr };
+	float													m_viewProjection[ 16 ]{};
+	uint32_t												m_bindlessInstances{ BindlessTable::INVALID_INDEX };	//The instance buffer's slot in m_bindless
+	UploadStream											m_uploadStream;
+	LoadedMesh												m_mesh;
+	std::unique_ptr<ShaderStore>							m_shaderStore;
+	std::unique_ptr<ChromeTrace>							m_trace;
+	std::unique_ptr<TraceCollector>							m_traceCollector;
+	std::unique_ptr<GpuProfiler>							m_gpuProfiler;
+	std::unique_ptr<DebugMessenger>							m_debugMessenger;	//Null without validation layers
+	VKSurfaceHandle											m_windowSurface;
+	VKSwapchainHandle										m_swapchain;
+	//Below the surface so swapchains retired by RecreateSwapChain are destroyed before it
+	DeletionQueue											m_deletionQueue{ m_framesInFlight };
 
 	std::vector<VkImage>									m_swapChainImages;
-	std::vector<std::unique_ptr<VKWrapper<VkImageView>>>	m_swapChainImageViews;
+	std::vector<VKImageViewHandle>							m_swapChainImageViews;
+	std::vector<VKFramebufferHandle>						m_swapChainFramebuffers;
+	//Signaled when rendering to a swapchain image is done, indexed by image since presentation holds it until the image is reacquired
+	std::vector<VKSemaphoreHandle>							m_renderFinished;
+
+	VKRenderPassHandle										m_renderPass;
+	VKPipelineLayoutHandle									m_pipelineLayout;
+	std::unique_ptr<PipelineCompiler>						m_pipelineCompiler;
+	PipelineCompiler::PipelineId							m_trianglePipeline{ PipelineCompiler::INVALID_PIPELINE };
+	VKPipelineLayoutHandle									m_meshPipelineLayout;
+	PipelineCompiler::PipelineId							m_meshPipeline{ PipelineCompiler::INVALID_PIPELINE };
+	VKPipelineLayoutHandle									m_bindlessPipelineLayout;
+	PipelineCompiler::PipelineId							m_bindlessPipeline{ PipelineCompiler::INVALID_PIPELINE };
+	VKCommandPoolHandle										m_commandPool;
+	std::unique_ptr<ParallelRecorder>						m_recorder;
+	std::vector<FrameResources>								m_frames;
+	std::vector<OffscreenFrame>								m_offscreenFrames;
+	std::unique_ptr<ReadbackStage>							m_readback;
 
 	VkFormat												m_swapChainImageFormat;
 	VkExtent2D												m_swapChainExtent;
-	VkPhysicalDevice										m_selectedPhysicalDevice{ VK_NULL_HANDLE };
+	std::vector<DeviceCapabilities>							m_physicalDevices;
+	DeviceCapabilities										m_deviceCapabilities;
+	QueueFamilyIndicies										m_queueFamilies;
+	VkQueue													m_graphicsQueue{ VK_NULL_HANDLE };
 	VkQueue													m_presentQueue{ VK_NULL_HANDLE };
+	VkQueue													m_transferQueue{ VK_NULL_HANDLE };
+
+	uint64_t												m_frameIndex{ 0 };
+	bool													m_swapChainOutOfDate{ false };
+	FrameStats												m_frameStats;
+	PresentTimings											m_presentTimings{ PRESENT_TIMING_FRAMES };
+	VkPresentModeKHR										m_presentMode{ VK_PRESENT_MODE_FIFO_KHR };
 
 	GLFWwindow*												m_window{ nullptr };
 
+	static const uint32_t									MAX_FRAMES_IN_FLIGHT{ 3 };
+	static const size_t										PRESENT_TIMING_FRAMES{ 1 << 16 };
+	static const uint32_t									PIPELINE_COMPILER_THREADS{ 2 };
+	static const VkDeviceSize								UPLOAD_RING_SIZE{ 32 << 20 };
+	static const VkDeviceSize								STREAM_BUFFER_SIZE{ 64 << 20 };
+	static const VkDeviceSize								STREAM_CHUNK_SIZE{ 4 << 20 };
+	static const VkDeviceSize								MESH_UPLOAD_CHUNK{ 8 << 20 };
+	static const uint32_t									TEXTURE_IO_THREADS{ 2 };
 	const uint32_t											WIDTH { 800 };
 	const uint32_t											HEIGHT{ 600 };
+	const VkFormat											OFFSCREEN_FORMAT{ VK_FORMAT_R8G8B8A8_UNORM };
+	const std::string										PIPELINE_CACHE_PATH{ "pipeline_cache.bin" };
+	const std::string										SHADER_ARCHIVE_PATH{ "shaders.pak" };
+	const char*												SHADER_DIRECTORY_ENV{ "TUT_SHADER_DIR" };
+	const char*												DEVICE_ENV{ "TUT_DEVICE" };
 	const std::vector<const char*>							VALIDATION_LAYERS{ "VK_LAYER_LUNARG_standard_validation" };
 	const std::vector<const char*>							DEVICE_EXTENSIONS{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
@@ -0,0 +1,501 @@
+#include "HostAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace tut {
+
+namespace {
+
+/*
+	Every allocation is preceded by this header so Free and Reallocate can find
+	where the memory came from without a lookup.
+*/
+struct AllocationHeader {
+	uint64_t	Size;
+	uint32_t	Offset;
+	uint8_t		Source;
+	uint8_t		Scope;
+	uint16_t	Padding;
+};
+
+static_assert( sizeof( AllocationHeader ) == 16, "Allocation header must stay 16 bytes" );
+
+const size_t	HEADER_SIZE{ sizeof( AllocationHeader ) };
+const uint8_t	SOURCE_ARENA{ 0xFE };
+const uint8_t	SOURCE_SYSTEM{ 0xFF };
+
+//Arena state packing, the offset never exceeds ARENA_SIZE so 32 bits are plenty
+const uint64_t	ARENA_OFFSET_MASK{ 0xFFFFFFFFull };
+const uint64_t	ARENA_LIVE_ONE{ 1ull << 32 };
+
+HostAllocator*	s_installedAllocator{ nullptr };
+
+/*
+===============
+AlignUp
+
+	Rounds value up to the next multiple of alignment (a power of two)
+===============
+*/
+uintptr_t AlignUp( uintptr_t value, size_t alignment ) {
+	return ( value + alignment - 1 ) & ~( ( uintptr_t )alignment - 1 );
+}
+/*
+===============
+HeaderOf
+
+	Returns the header in front of a user allocation
+===============
+*/
+AllocationHeader* HeaderOf( void* memory ) {
+	return ( AllocationHeader* )( ( uint8_t* )memory - HEADER_SIZE );
+}
+/*
+===============
+PlaceAllocation
+
+	Aligns the user pointer inside a block and writes its header
+===============
+*/
+void* PlaceAllocation( uint8_t* block, size_t size, size_t alignment, uint8_t source ) {
+	uint8_t*			memory	= ( uint8_t* )AlignUp( ( uintptr_t )block + HEADER_SIZE, std::max( alignment, HEADER_SIZE ) );
+	AllocationHeader*	header	= HeaderOf( memory );
+
+	header->Size	= size;
+	header->Offset	= ( uint32_t )( memory - block );
+	header->Source	= source;
+
+	return memory;
+}
+
+}
+
+/*
+===============
+HostAllocator::HostAllocator
+
+	Sets up the pools, the frame arena and the callback table
+===============
+*/
+HostAllocator::HostAllocator( void ) {
+	size_t blockSize = 32;
+	for ( Pool& pool : m_pools ) {
+		pool.BlockSize = blockSize;
+		blockSize *= 2;
+	}
+
+	m_arenaMemory = malloc( ARENA_SIZE + HEADER_SIZE );
+	if ( m_arenaMemory == nullptr ) {
+		throw std::runtime_error( "Failed to allocate host arena" );
+	}
+
+	m_arenaBase = ( uint8_t* )AlignUp( ( uintptr_t )m_arenaMemory, HEADER_SIZE );
+
+	m_callbacks.pUserData				= this;
+	m_callbacks.pfnAllocation			= AllocationCallback;
+	m_callbacks.pfnReallocation			= ReallocationCallback;
+	m_callbacks.pfnFree					= FreeCallback;
+	m_callbacks.pfnInternalAllocation	= InternalAllocationCallback;
+	m_callbacks.pfnInternalFree			= InternalFreeCallback;
+}
+/*
+===============
+HostAllocator::~HostAllocator
+
+	Releases all pool chunks and the arena. Every Vulkan object created with
+	these callbacks must be destroyed by now.
+===============
+*/
+HostAllocator::~HostAllocator( void ) {
+	if ( s_installedAllocator == this ) {
+		s_installedAllocator = nullptr;
+	}
+
+	for ( Pool& pool : m_pools ) {
+		for ( void* chunk : pool.Chunks ) {
+			free( chunk );
+		}
+	}
+
+	free( m_arenaMemory );
+}
+/*
+===============
+HostAllocator::Callbacks
+
+	Returns the callbacks to pass to the vkCreate and vkDestroy functions
+===============
+*/
+const VkAllocationCallbacks* HostAllocator::Callbacks( void ) const {
+	return &m_callbacks;
+}
+/*
+===============
+HostAllocator::Install
+
+	Makes the allocator the one used by the handle deleters
+===============
+*/
+void HostAllocator::Install( HostAllocator* allocator ) {
+	s_installedAllocator = allocator;
+}
+/*
+===============
+HostAllocator::Installed
+
+	Returns the installed callbacks, or nullptr to use the driver's own
+===============
+*/
+const VkAllocationCallbacks* HostAllocator::Installed( void ) {
+	return s_installedAllocator != nullptr ? s_installedAllocator->Callbacks() : nullptr;
+}
+/*
+===============
+HostAllocator::BeginFrame
+
+	Snapshots the per frame counters and rewinds the command arena. Command
+	scoped allocations never outlive the call that made them, so the arena is
+	only rewound once none of them are live. The check and the rewind are one
+	compare and swap on the packed state, so an allocation landing in between
+	makes it fail rather than being handed memory that's about to be reused.
+===============
+*/
+void HostAllocator::BeginFrame( void ) {
+	uint64_t systemAllocations		= m_systemAllocations.load();
+	uint64_t callbackAllocations	= m_callbackAllocations.load();
+
+	m_lastFrameSystemAllocations	= systemAllocations - m_frameStartSystemAllocations;
+	m_lastFrameCallbackAllocations	= callbackAllocations - m_frameStartCallbackAllocations;
+	m_frameStartSystemAllocations	= systemAllocations;
+	m_frameStartCallbackAllocations	= callbackAllocations;
+
+	uint64_t state = m_arenaState.load();
+
+	while ( state != 0 && ( state & ~ARENA_OFFSET_MASK ) == 0 ) {
+		if ( m_arenaState.compare_exchange_weak( state, 0 ) ) {
+			break;
+		}
+	}
+}
+/*
+===============
+HostAllocator::Allocate
+
+	Routes an allocation to the arena, a pool or the system heap
+===============
+*/
+void* HostAllocator::Allocate( size_t size, size_t alignment, VkSystemAllocationScope scope ) {
+	if ( size == 0 ) {
+		return nullptr;
+	}
+
+	void* memory = nullptr;
+
+	if ( scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND ) {
+		memory = AllocateFromArena( size, alignment );
+	}
+
+	if ( memory == nullptr ) {
+		size_t required = size + std::max( alignment, HEADER_SIZE );
+
+		for ( uint32_t i = 0; i < POOL_CLASS_COUNT; ++i ) {
+			if ( required <= m_pools[ i ].BlockSize ) {
+				memory = AllocateFromPool( i, size, alignment );
+				break;
+			}
+		}
+	}
+
+	if ( memory == nullptr ) {
+		memory = AllocateFromSystem( size, alignment );
+	}
+
+	if ( memory != nullptr ) {
+		HeaderOf( memory )->Scope = ( uint8_t )scope;
+		TrackAllocation( scope, size );
+	}
+
+	return memory;
+}
+/*
+===============
+HostAllocator::Reallocate
+
+	Implements the pfnReallocation semantics on top of Allocate/Free
+===============
+*/
+void* HostAllocator::Reallocate( void* original, size_t size, size_t alignment, VkSystemAllocationScope scope ) {
+	if ( original == nullptr ) {
+		return Allocate( size, alignment, scope );
+	}
+
+	if ( size == 0 ) {
+		Free( original );
+		return nullptr;
+	}
+
+	void* memory = Allocate( size, alignment, scope );
+	if ( memory != nullptr ) {
+		memcpy( memory, original, ( size_t )std::min<uint64_t>( size, HeaderOf( original )->Size ) );
+		Free( original );
+	}
+
+	return memory;
+}
+/*
+===============
+HostAllocator::Free
+
+	Returns memory to wherever it was allocated from
+===============
+*/
+void HostAllocator::Free( void* memory ) {
+	if ( memory == nullptr ) {
+		return;
+	}
+
+	AllocationHeader*	header	= HeaderOf( memory );
+	uint8_t*			block	= ( uint8_t* )memory - header->Offset;
+
+	TrackFree( ( VkSystemAllocationScope )header->Scope, ( size_t )header->Size );
+
+	if ( header->Source == SOURCE_ARENA ) {
+		m_arenaState.fetch_sub( ARENA_LIVE_ONE );
+	} else if ( header->Source == SOURCE_SYSTEM ) {
+		free( block );
+	} else {
+		Pool& pool = m_pools[ header->Source ];
+
+		std::lock_guard<std::mutex> lock( pool.Lock );
+		*( void** )block	= pool.FreeList;
+		pool.FreeList		= block;
+	}
+}
+/*
+===============
+HostAllocator::AllocateFromArena
+
+	Bump allocates from the frame arena, returns nullptr when it's full
+===============
+*/
+void* HostAllocator::AllocateFromArena( size_t size, size_t alignment ) {
+	uint64_t state = m_arenaState.load();
+
+	for ( ;; ) {
+		size_t		offset	= ( size_t )( state & ARENA_OFFSET_MASK );
+		uintptr_t	start	= AlignUp( ( uintptr_t )m_arenaBase + offset + HEADER_SIZE, std::max( alignment, HEADER_SIZE ) ) - HEADER_SIZE;
+		size_t		end		= ( size_t )( start - ( uintptr_t )m_arenaBase ) + HEADER_SIZE + size;
+
+		if ( end > ARENA_SIZE ) {
+			return nullptr;
+		}
+
+		if ( m_arenaState.compare_exchange_weak( state, ( state & ~ARENA_OFFSET_MASK ) + ARENA_LIVE_ONE + end ) ) {
+			return PlaceAllocation( ( uint8_t* )start, size, alignment, SOURCE_ARENA );
+		}
+	}
+}
+/*
+===============
+HostAllocator::AllocateFromPool
+
+	Pops a block off a size class free list, carving a new chunk if needed
+===============
+*/
+void* HostAllocator::AllocateFromPool( uint32_t poolIndex, size_t size, size_t alignment ) {
+	Pool&		pool	= m_pools[ poolIndex ];
+	uint8_t*	block	= nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock( pool.Lock );
+
+		if ( pool.FreeList == nullptr ) {
+			void* chunk = malloc( POOL_CHUNK_SIZE + HEADER_SIZE );
+			if ( chunk == nullptr ) {
+				return nullptr;
+			}
+
+			m_systemAllocations.fetch_add( 1 );
+			pool.Chunks.push_back( chunk );
+
+			uint8_t*	first		= ( uint8_t* )AlignUp( ( uintptr_t )chunk, HEADER_SIZE );
+			size_t		blockCount	= POOL_CHUNK_SIZE / pool.BlockSize;
+
+			for ( size_t i = 0; i < blockCount; ++i ) {
+				uint8_t* freeBlock = first + i * pool.BlockSize;
+
+				*( void** )freeBlock	= pool.FreeList;
+				pool.FreeList			= freeBlock;
+			}
+		}
+
+		block			= ( uint8_t* )pool.FreeList;
+		pool.FreeList	= *( void** )block;
+	}
+
+	return PlaceAllocation( block, size, alignment, ( uint8_t )poolIndex );
+}
+/*
+===============
+HostAllocator::AllocateFromSystem
+
+	Allocates directly from the system heap for large requests
+===============
+*/
+void* HostAllocator::AllocateFromSystem( size_t size, size_t alignment ) {
+	uint8_t* block = ( uint8_t* )malloc( size + std::max( alignment, HEADER_SIZE ) + HEADER_SIZE );
+	if ( block == nullptr ) {
+		return nullptr;
+	}
+
+	m_systemAllocations.fetch_add( 1 );
+
+	return PlaceAllocation( block, size, alignment, SOURCE_SYSTEM );
+}
+/*
+===============
+HostAllocator::TrackAllocation
+
+	Updates the counters of a scope after an allocation
+===============
+*/
+void HostAllocator::TrackAllocation( VkSystemAllocationScope scope, size_t size ) {
+	ScopeCounters&	counters	= m_scopes[ scope ];
+	uint64_t		live		= counters.LiveBytes.fetch_add( size ) + size;
+	uint64_t		peak		= counters.PeakBytes.load();
+
+	while ( live > peak && !counters.PeakBytes.compare_exchange_weak( peak, live ) ) {
+	}
+
+	counters.Allocations.fetch_add( 1 );
+	counters.LiveAllocations.fetch_add( 1 );
+	m_callbackAllocations.fetch_add( 1 );
+}
+/*
+===============
+HostAllocator::TrackFree
+
+	Updates the counters of a scope after a free
+===============
+*/
+void HostAllocator::TrackFree( VkSystemAllocationScope scope, size_t size ) {
+	ScopeCounters& counters = m_scopes[ scope ];
+
+	counters.LiveBytes.fetch_sub( size );
+	counters.LiveAllocations.fetch_sub( 1 );
+}
+/*
+===============
+HostAllocator::GetStats
+
+	Returns a snapshot of the counters of a scope
+===============
+*/
+HostAllocationStats HostAllocator::GetStats( VkSystemAllocationScope scope ) const {
+	const ScopeCounters&	counters = m_scopes[ scope ];
+	HostAllocationStats		stats;
+
+	stats.LiveBytes			= counters.LiveBytes.load();
+	stats.PeakBytes			= counters.PeakBytes.load();
+	stats.Allocations		= counters.Allocations.load();
+	stats.LiveAllocations	= counters.LiveAllocations.load();
+
+	return stats;
+}
+/*
+===============
+HostAllocator::GetFrameSystemAllocations
+
+	Returns how many allocations reached the system heap during the last frame
+===============
+*/
+uint64_t HostAllocator::GetFrameSystemAllocations( void ) const {
+	return m_lastFrameSystemAllocations;
+}
+/*
+===============
+HostAllocator::GetFrameCallbackAllocations
+
+	Returns how many allocations the driver asked for during the last frame
+===============
+*/
+uint64_t HostAllocator::GetFrameCallbackAllocations( void ) const {
+	return m_lastFrameCallbackAllocations;
+}
+/*
+===============
+HostAllocator::Report
+
+	Writes the per scope statistics in a human readable form
+===============
+*/
+void HostAllocator::Report( std::ostream& out ) const {
+	const char* scopeNames[ SCOPE_COUNT ] = { "command", "object", "cache", "device", "instance" };
+
+	out << "Host allocations:" << std::endl;
+	for ( uint32_t i = 0; i < SCOPE_COUNT; ++i ) {
+		HostAllocationStats stats = GetStats( ( VkSystemAllocationScope )i );
+
+		out << "  " << scopeNames[ i ] << ": " << stats.LiveBytes << " live bytes, "
+			<< stats.PeakBytes << " peak bytes, " << stats.LiveAllocations << " live / "
+			<< stats.Allocations << " total allocations" << std::endl;
+	}
+
+	out << "  internal: " << m_internalBytes.load() << " bytes" << std::endl;
+	out << "  last frame: " << m_lastFrameCallbackAllocations << " driver allocations, "
+		<< m_lastFrameSystemAllocations << " system heap allocations" << std::endl;
+}
+/*
+===============
+HostAllocator::AllocationCallback
+
+	pfnAllocation entry point
+===============
+*/
+void* VKAPI_PTR HostAllocator::AllocationCallback( void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope ) {
+	return ( ( HostAllocator* )userData )->Allocate( size, alignment, scope );
+}
+/*
+===============
+HostAllocator::ReallocationCallback
+
+	pfnReallocation entry point
+===============
+*/
+void* VKAPI_PTR HostAllocator::ReallocationCallback( void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope ) {
+	return ( ( HostAllocator* )userData )->Reallocate( original, size, alignment, scope );
+}
+/*
+===============
+HostAllocator::FreeCallback
+
+	pfnFree entry point
+===============
+*/
+void VKAPI_PTR HostAllocator::FreeCallback( void* userData, void* memory ) {
+	( ( HostAllocator* )userData )->Free( memory );
+}
+/*
+===============
+HostAllocator::InternalAllocationCallback
+
+	Tracks allocations the driver makes on its own (e.g. executable memory)
+===============
+*/
+void VKAPI_PTR HostAllocator::InternalAllocationCallback( void* userData, size_t size, VkInternalAllocationType /*type*/, VkSystemAllocationScope /*scope*/ ) {
+	( ( HostAllocator* )userData )->m_internalBytes.fetch_add( size );
+}
+/*
+===============
+HostAllocator::InternalFreeCallback
+
+	Tracks frees of allocations the driver made on its own
+===============
+*/
+void VKAPI_PTR HostAllocator::InternalFreeCallback( void* userData, size_t size, VkInternalAllocationType /*type*/, VkSystemAllocationScope /*scope*/ ) {
+	( ( HostAllocator* )userData )->m_internalBytes.fetch_sub( size );
+}
+}
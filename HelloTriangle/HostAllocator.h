@@ -0,0 +1,109 @@
+#ifndef __HOSTALLOCATOR_H__
+#define __HOSTALLOCATOR_H__
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace tut {
+
+struct HostAllocationStats {
+	uint64_t	LiveBytes		= 0;
+	uint64_t	PeakBytes		= 0;
+	uint64_t	Allocations		= 0;
+	uint64_t	LiveAllocations	= 0;
+};
+
+/*
+===============
+HostAllocator
+
+	Provides VkAllocationCallbacks for the driver's host allocations.
+	Small allocations come from size-classed free lists, command scoped
+	allocations from a linear arena that is reset every frame, and anything
+	larger falls back to the system heap. Stats are kept per allocation scope.
+===============
+*/
+class HostAllocator {
+public:
+											HostAllocator( void );
+											~HostAllocator( void );
+
+	HostAllocator( const HostAllocator& ) = delete;
+	HostAllocator& operator=( const HostAllocator& ) = delete;
+
+	const VkAllocationCallbacks*			Callbacks( void ) const;
+
+	void									BeginFrame( void );
+
+	HostAllocationStats						GetStats( VkSystemAllocationScope scope ) const;
+	uint64_t								GetFrameSystemAllocations( void ) const;
+	uint64_t								GetFrameCallbackAllocations( void ) const;
+	void									Report( std::ostream& out ) const;
+
+	static void								Install( HostAllocator* allocator );
+	static const VkAllocationCallbacks*		Installed( void );
+
+private:
+	static const uint32_t					SCOPE_COUNT{ VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1 };
+	static const uint32_t					POOL_CLASS_COUNT{ 8 };
+	static const size_t						POOL_CHUNK_SIZE{ 64 * 1024 };
+	static const size_t						ARENA_SIZE{ 256 * 1024 };
+
+	struct ScopeCounters {
+		std::atomic<uint64_t>				LiveBytes{ 0 };
+		std::atomic<uint64_t>				PeakBytes{ 0 };
+		std::atomic<uint64_t>				Allocations{ 0 };
+		std::atomic<uint64_t>				LiveAllocations{ 0 };
+	};
+
+	struct Pool {
+		size_t								BlockSize = 0;
+		void*								FreeList = nullptr;
+		std::vector<void*>					Chunks;
+		std::mutex							Lock;
+	};
+
+	void*									Allocate( size_t size, size_t alignment, VkSystemAllocationScope scope );
+	void*									Reallocate( void* original, size_t size, size_t alignment, VkSystemAllocationScope scope );
+	void									Free( void* memory );
+
+	void*									AllocateFromArena( size_t size, size_t alignment );
+	void*									AllocateFromPool( uint32_t poolIndex, size_t size, size_t alignment );
+	void*									AllocateFromSystem( size_t size, size_t alignment );
+
+	void									TrackAllocation( VkSystemAllocationScope scope, size_t size );
+	void									TrackFree( VkSystemAllocationScope scope, size_t size );
+
+	static void* VKAPI_PTR					AllocationCallback( void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope );
+	static void* VKAPI_PTR					ReallocationCallback( void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope );
+	static void VKAPI_PTR					FreeCallback( void* userData, void* memory );
+	static void VKAPI_PTR					InternalAllocationCallback( void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope );
+	static void VKAPI_PTR					InternalFreeCallback( void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope );
+
+	VkAllocationCallbacks					m_callbacks;
+
+	Pool									m_pools[ POOL_CLASS_COUNT ];
+
+	void*									m_arenaMemory{ nullptr };
+	uint8_t*								m_arenaBase{ nullptr };
+	//Bump offset in the low half, live allocations in the high half, so a rewind can't race a bump
+	std::atomic<uint64_t>					m_arenaState{ 0 };
+
+	ScopeCounters							m_scopes[ SCOPE_COUNT ];
+	std::atomic<uint64_t>					m_internalBytes{ 0 };
+	std::atomic<uint64_t>					m_systemAllocations{ 0 };
+	std::atomic<uint64_t>					m_callbackAllocations{ 0 };
+
+	uint64_t								m_frameStartSystemAllocations{ 0 };
+	uint64_t								m_frameStartCallbackAllocations{ 0 };
+	uint64_t								m_lastFrameSystemAllocations{ 0 };
+	uint64_t								m_lastFrameCallbackAllocations{ 0 };
+};
+
+}
+
+#endif // !__HOSTALLOCATOR_H__
@@ -0,0 +1,257 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace tut {
+
+namespace {
+
+thread_local const JobSystem*	s_currentSystem	= nullptr;
+thread_local uint32_t			s_workerIndex	= 0;
+
+}
+
+/*
+===============
+JobSystem::JobSystem
+
+	Starts the workers, zero means one fewer than the hardware threads since
+	the submitting thread helps while it waits
+===============
+*/
+JobSystem::JobSystem( uint32_t workerCount ) {
+	if ( workerCount == 0 ) {
+		workerCount = std::max( 2u, std::thread::hardware_concurrency() ) - 1;
+	}
+
+	for ( uint32_t i = 0; i <= workerCount; ++i ) {
+		m_queues.push_back( std::make_unique<WorkQueue>() );
+	}
+
+	m_threads.reserve( workerCount );
+	for ( uint32_t i = 0; i < workerCount; ++i ) {
+		m_threads.emplace_back( &JobSystem::WorkerMain, this, i );
+	}
+}
+/*
+===============
+JobSystem::~JobSystem
+
+	Finishes the queued jobs and joins the workers
+===============
+*/
+JobSystem::~JobSystem( void ) {
+	{
+		std::lock_guard<std::mutex> lock( m_sleepLock );
+		m_stopping = true;
+	}
+
+	m_jobAvailable.notify_all();
+
+	for ( std::thread& thread : m_threads ) {
+		thread.join();
+	}
+}
+/*
+===============
+JobSystem::Submit
+
+	Queues a job on the calling worker's deque, or on the injection deque
+	when called from outside the pool
+===============
+*/
+void JobSystem::Submit( Job job ) {
+	WorkQueue& queue = *m_queues[ CurrentQueue() ];
+
+	{
+		std::lock_guard<std::mutex> lock( queue.Lock );
+		queue.Jobs.push_back( std::move( job ) );
+
+		//Counted under the sleep lock so a worker about to sleep cannot miss it
+		std::lock_guard<std::mutex> sleepLock( m_sleepLock );
+		++m_queuedJobs;
+	}
+
+	m_jobAvailable.notify_one();
+}
+/*
+===============
+JobSystem::TryRunOne
+
+	Runs one queued job on the calling thread if there is any, own work
+	first. Returns false when every deque was empty.
+===============
+*/
+bool JobSystem::TryRunOne( void ) {
+	uint32_t	queueIndex = CurrentQueue();
+	Job			job;
+
+	if ( !PopOwn( queueIndex, job ) && !Steal( queueIndex, job ) ) {
+		return false;
+	}
+
+	job();
+
+	return true;
+}
+/*
+===============
+JobSystem::ParallelFor
+
+	Runs job for every index in [0, count) across the pool and returns once
+	all have finished, rethrowing the first exception one of them threw
+===============
+*/
+void JobSystem::ParallelFor( uint32_t count, const IndexedJob& job ) {
+	std::atomic<uint32_t>	remaining{ count };
+	std::exception_ptr		failure;
+	std::mutex				failureLock;
+
+	//The caller takes index zero itself
+	for ( uint32_t index = 1; index < count; ++index ) {
+		Submit( [&job, &remaining, &failure, &failureLock, index]() {
+			try {
+				job( index );
+			} catch ( ... ) {
+				std::lock_guard<std::mutex> lock( failureLock );
+				if ( !failure ) {
+					failure = std::current_exception();
+				}
+			}
+			--remaining;
+		} );
+	}
+
+	if ( count > 0 ) {
+		try {
+			job( 0 );
+		} catch ( ... ) {
+			std::lock_guard<std::mutex> lock( failureLock );
+			if ( !failure ) {
+				failure = std::current_exception();
+			}
+		}
+		--remaining;
+	}
+
+	while ( remaining > 0 ) {
+		if ( !TryRunOne() ) {
+			std::this_thread::yield();
+		}
+	}
+
+	if ( failure ) {
+		std::rethrow_exception( failure );
+	}
+}
+/*
+===============
+JobSystem::WorkerCount
+
+	Returns the number of worker threads, not counting helping callers
+===============
+*/
+uint32_t JobSystem::WorkerCount( void ) const {
+	return ( uint32_t )m_threads.size();
+}
+/*
+===============
+JobSystem::StealCount
+
+	Returns how many jobs ran on a thread other than the one that queued them
+===============
+*/
+uint64_t JobSystem::StealCount( void ) const {
+	return m_steals;
+}
+/*
+===============
+JobSystem::CurrentQueue
+
+	Returns the calling worker's deque, or the injection deque for threads
+	outside the pool
+===============
+*/
+uint32_t JobSystem::CurrentQueue( void ) const {
+	if ( s_currentSystem == this ) {
+		return s_workerIndex;
+	}
+
+	return ( uint32_t )m_queues.size() - 1;
+}
+/*
+===============
+JobSystem::PopOwn
+
+	Takes the newest job from a deque
+===============
+*/
+bool JobSystem::PopOwn( uint32_t queueIndex, Job& job ) {
+	WorkQueue&					queue = *m_queues[ queueIndex ];
+	std::lock_guard<std::mutex>	lock( queue.Lock );
+
+	if ( queue.Jobs.empty() ) {
+		return false;
+	}
+
+	job = std::move( queue.Jobs.back() );
+	queue.Jobs.pop_back();
+	--m_queuedJobs;
+
+	return true;
+}
+/*
+===============
+JobSystem::Steal
+
+	Takes the oldest job from the first other deque that has one, starting
+	after the thief's own so thieves spread across victims
+===============
+*/
+bool JobSystem::Steal( uint32_t thiefIndex, Job& job ) {
+	uint32_t queueCount = ( uint32_t )m_queues.size();
+
+	for ( uint32_t offset = 1; offset < queueCount; ++offset ) {
+		WorkQueue&					queue = *m_queues[ ( thiefIndex + offset ) % queueCount ];
+		std::lock_guard<std::mutex>	lock( queue.Lock );
+
+		if ( queue.Jobs.empty() ) {
+			continue;
+		}
+
+		job = std::move( queue.Jobs.front() );
+		queue.Jobs.pop_front();
+		--m_queuedJobs;
+		++m_steals;
+
+		return true;
+	}
+
+	return false;
+}
+/*
+===============
+JobSystem::WorkerMain
+
+	Runs and steals jobs, sleeping while every deque is empty
+===============
+*/
+void JobSystem::WorkerMain( uint32_t workerIndex ) {
+	s_currentSystem	= this;
+	s_workerIndex	= workerIndex;
+
+	for ( ;; ) {
+		if ( TryRunOne() ) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_sleepLock );
+		m_jobAvailable.wait( lock, [this]() { return m_stopping || m_queuedJobs > 0; } );
+
+		if ( m_stopping && m_queuedJobs == 0 ) {
+			return;
+		}
+	}
+}
+}
@@ -0,0 +1,73 @@
+#ifndef __JOBSYSTEM_H__
+#define __JOBSYSTEM_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tut {
+
+/*
+===============
+JobSystem
+
+	Work stealing scheduler for fine grained jobs. Every worker owns a deque
+	it pushes to and pops from at the back, so a job spawned by a job runs on
+	the same core while its data is warm, and idle workers steal the oldest
+	job from the front of someone else's deque. Jobs submitted from outside
+	the pool land in a shared injection deque that everyone steals from.
+
+	Threads waiting on jobs help run them instead of blocking, so a job may
+	wait on jobs it spawned without deadlocking the pool. Jobs must not
+	throw; ParallelFor and TaskGraph rethrow on the waiting thread instead.
+===============
+*/
+class JobSystem {
+public:
+	typedef std::function<void( void )>					Job;
+	typedef std::function<void( uint32_t index )>		IndexedJob;
+
+														JobSystem( uint32_t workerCount );
+														~JobSystem( void );
+
+	JobSystem( const JobSystem& ) = delete;
+	JobSystem& operator=( const JobSystem& ) = delete;
+
+	void												Submit( Job job );
+	bool												TryRunOne( void );
+	void												ParallelFor( uint32_t count, const IndexedJob& job );
+
+	uint32_t											WorkerCount( void ) const;
+	uint64_t											StealCount( void ) const;
+
+private:
+	//Plain locked deque, the lock is only contended while a thief is stealing
+	struct WorkQueue {
+		std::mutex										Lock;
+		std::deque<Job>									Jobs;
+	};
+
+	uint32_t											CurrentQueue( void ) const;
+	bool												PopOwn( uint32_t queueIndex, Job& job );
+	bool												Steal( uint32_t thiefIndex, Job& job );
+	void												WorkerMain( uint32_t workerIndex );
+
+	std::vector<std::unique_ptr<WorkQueue>>				m_queues;	//One per worker, then the injection queue
+	std::vector<std::thread>							m_threads;
+
+	std::mutex											m_sleepLock;
+	std::condition_variable								m_jobAvailable;
+	std::atomic<uint64_t>								m_queuedJobs{ 0 };
+	std::atomic<uint64_t>								m_steals{ 0 };
+	bool												m_stopping{ false };
+};
+
+}
+
+#endif // !__JOBSYSTEM_H__
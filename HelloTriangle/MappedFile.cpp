@@ -0,0 +1,157 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tut {
+/*
+===============
+MappedFile::MappedFile
+
+	Creates a closed mapping
+===============
+*/
+MappedFile::MappedFile( void )
+#ifdef _WIN32
+	: m_file( INVALID_HANDLE_VALUE )
+#endif
+{
+}
+/*
+===============
+MappedFile::~MappedFile
+
+	Unmaps the file
+===============
+*/
+MappedFile::~MappedFile( void ) {
+	Close();
+}
+/*
+===============
+MappedFile::Open
+
+	Maps the whole file read only. Returns false if it could not be opened or
+	is empty.
+===============
+*/
+bool MappedFile::Open( const std::string& filePath ) {
+	Close();
+
+#ifdef _WIN32
+	m_file = CreateFileA( filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr );
+	if ( m_file == INVALID_HANDLE_VALUE ) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( m_file, &fileSize ) || fileSize.QuadPart == 0 ) {
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( m_mapping == nullptr ) {
+		Close();
+		return false;
+	}
+
+	m_data = ( const uint8_t* )MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 );
+	m_size = ( size_t )fileSize.QuadPart;
+#else
+	m_file = open( filePath.c_str(), O_RDONLY );
+	if ( m_file < 0 ) {
+		return false;
+	}
+
+	struct stat fileStat;
+	if ( fstat( m_file, &fileStat ) != 0 || fileStat.st_size == 0 ) {
+		Close();
+		return false;
+	}
+
+	void* data = mmap( nullptr, ( size_t )fileStat.st_size, PROT_READ, MAP_PRIVATE, m_file, 0 );
+
+	m_data = data == MAP_FAILED ? nullptr : ( const uint8_t* )data;
+	m_size = ( size_t )fileStat.st_size;
+#endif
+
+	if ( m_data == nullptr ) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+/*
+===============
+MappedFile::Close
+
+	Unmaps the file and closes it
+===============
+*/
+void MappedFile::Close( void ) {
+#ifdef _WIN32
+	if ( m_data != nullptr ) {
+		UnmapViewOfFile( m_data );
+	}
+	if ( m_mapping != nullptr ) {
+		CloseHandle( m_mapping );
+		m_mapping = nullptr;
+	}
+	if ( m_file != INVALID_HANDLE_VALUE ) {
+		CloseHandle( m_file );
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if ( m_data != nullptr ) {
+		munmap( ( void* )m_data, m_size );
+	}
+	if ( m_file >= 0 ) {
+		close( m_file );
+		m_file = -1;
+	}
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
+/*
+===============
+MappedFile::IsOpen
+
+	Returns if a file is mapped
+===============
+*/
+bool MappedFile::IsOpen( void ) const {
+	return m_data != nullptr;
+}
+/*
+===============
+MappedFile::Data
+
+	Returns the start of the mapping
+===============
+*/
+const uint8_t* MappedFile::Data( void ) const {
+	return m_data;
+}
+/*
+===============
+MappedFile::Size
+
+	Returns the size of the mapping in bytes
+===============
+*/
+size_t MappedFile::Size( void ) const {
+	return m_size;
+}
+}
@@ -0,0 +1,47 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tut {
+
+/*
+===============
+MappedFile
+
+	Read only memory mapping of a whole file. The mapping lives until Close
+	or destruction, pointers into Data() are valid for that long.
+===============
+*/
+class MappedFile {
+public:
+							MappedFile( void );
+							~MappedFile( void );
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	bool					Open( const std::string& filePath );
+	void					Close( void );
+
+	bool					IsOpen( void ) const;
+	const uint8_t*			Data( void ) const;
+	size_t					Size( void ) const;
+
+private:
+	const uint8_t*			m_data{ nullptr };
+	size_t					m_size{ 0 };
+
+#ifdef _WIN32
+	void*					m_file;
+	void*					m_mapping{ nullptr };
+#else
+	int						m_file{ -1 };
+#endif
+};
+
+}
+
+#endif // !__MAPPEDFILE_H__
@@ -0,0 +1,567 @@
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace tut {
+
+namespace {
+
+const uint32_t	NO_NORMAL{ 0xffffffff };
+const uint32_t	NO_VERTEX{ 0xffffffff };
+const size_t	INDEX_WRITE_CHUNK{ 1 << 16 };
+
+/*
+===============
+AlignUp
+
+	Rounds value up to a power of two alignment
+===============
+*/
+uint64_t AlignUp( uint64_t value, uint64_t alignment ) {
+	return ( value + alignment - 1 ) & ~( alignment - 1 );
+}
+/*
+===============
+IsSeparator
+
+	Returns if a character ends an OBJ token
+===============
+*/
+bool IsSeparator( char c ) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\0';
+}
+/*
+===============
+ResolveIndex
+
+	Turns a one based or negative, relative OBJ index into a zero based one.
+	Returns false if it points outside the elements read so far.
+===============
+*/
+bool ResolveIndex( long index, size_t count, uint32_t& resolved ) {
+	if ( index > 0 && ( size_t )index <= count ) {
+		resolved = ( uint32_t )( index - 1 );
+		return true;
+	}
+
+	if ( index < 0 && ( size_t )-index <= count ) {
+		resolved = ( uint32_t )( count + index );
+		return true;
+	}
+
+	return false;
+}
+/*
+===============
+ParseFloats
+
+	Reads count floats and advances past them
+===============
+*/
+bool ParseFloats( const char*& cursor, float* values, uint32_t count ) {
+	for ( uint32_t i = 0; i < count; ++i ) {
+		char* end;
+		values[ i ] = strtof( cursor, &end );
+
+		if ( end == cursor ) {
+			return false;
+		}
+
+		cursor = end;
+	}
+
+	return true;
+}
+/*
+===============
+ParseCorner
+
+	Reads one face corner, v, v/vt, v//vn or v/vt/vn, and advances past it.
+	Texture coordinates are skipped, the mesh format has none.
+===============
+*/
+bool ParseCorner( const char*& cursor, size_t positionCount, size_t normalCount, uint32_t& position, uint32_t& normal ) {
+	char* end;
+	long index = strtol( cursor, &end, 10 );
+
+	if ( end == cursor || !ResolveIndex( index, positionCount, position ) ) {
+		return false;
+	}
+
+	cursor = end;
+	normal = NO_NORMAL;
+
+	if ( *cursor == '/' ) {
+		strtol( ++cursor, &end, 10 );
+		cursor = end;
+
+		if ( *cursor == '/' ) {
+			index = strtol( ++cursor, &end, 10 );
+
+			if ( end == cursor || !ResolveIndex( index, normalCount, normal ) ) {
+				return false;
+			}
+
+			cursor = end;
+		}
+	}
+
+	return IsSeparator( *cursor );
+}
+/*
+===============
+VertexTable
+
+	Hands out one vertex per distinct position and normal pair. Corners
+	without a normal share a vertex per position, which gets the smoothed
+	normal, and are looked up by position alone since scanned meshes often
+	have no normals and tens of millions of positions.
+===============
+*/
+class VertexTable {
+public:
+	uint32_t								Find( uint32_t position, uint32_t normal ) {
+		if ( normal == NO_NORMAL ) {
+			if ( position >= m_smoothVertices.size() ) {
+				m_smoothVertices.resize( position + 1, NO_VERTEX );
+			}
+
+			uint32_t& vertex = m_smoothVertices[ position ];
+			if ( vertex == NO_VERTEX ) {
+				vertex = Add( position, normal );
+			}
+
+			return vertex;
+		}
+
+		uint64_t key = ( ( uint64_t )position << 32 ) | normal;
+
+		std::unordered_map<uint64_t, uint32_t>::const_iterator existing = m_normalVertices.find( key );
+		if ( existing != m_normalVertices.end() ) {
+			return existing->second;
+		}
+
+		uint32_t vertex = Add( position, normal );
+		m_normalVertices[ key ] = vertex;
+
+		return vertex;
+	}
+
+	std::vector<uint32_t>					Positions;
+	std::vector<uint32_t>					Normals;	//NO_NORMAL for smoothed vertices
+
+private:
+	uint32_t								Add( uint32_t position, uint32_t normal ) {
+		Positions.push_back( position );
+		Normals.push_back( normal );
+		return ( uint32_t )Positions.size() - 1;
+	}
+
+	std::vector<uint32_t>					m_smoothVertices;
+	std::unordered_map<uint64_t, uint32_t>	m_normalVertices;
+};
+/*
+===============
+Quantize
+
+	Maps a coordinate inside [min, max] to the full 16 bit UNORM range
+===============
+*/
+uint16_t Quantize( float value, float min, float max ) {
+	if ( max <= min ) {
+		return 0;
+	}
+
+	float normalized = std::min( 1.0f, std::max( 0.0f, ( value - min ) / ( max - min ) ) );
+	return ( uint16_t )( normalized * 65535.0f + 0.5f );
+}
+
+}
+
+/*
+===============
+MeshFile::Open
+
+	Maps a mesh file and checks its header and section bounds. Returns false
+	if the file cannot be opened and throws if it is not a valid mesh.
+===============
+*/
+bool MeshFile::Open( const std::string& filePath ) {
+	Close();
+
+	if ( !m_file.Open( filePath ) ) {
+		return false;
+	}
+
+	MeshFileHeader	header;
+	uint64_t		fileSize = m_file.Size();
+
+	if ( fileSize >= sizeof( header ) ) {
+		memcpy( &header, m_file.Data(), sizeof( header ) );
+	}
+
+	bool valid = fileSize >= sizeof( header ) && header.Magic == MESH_MAGIC && header.Version == MESH_VERSION &&
+		header.VertexStride == sizeof( MeshVertex ) && ( header.IndexSize == 2 || header.IndexSize == 4 ) &&
+		header.VertexCount > 0 && header.IndexCount > 0 && header.IndexCount % 3 == 0 &&
+		header.VertexBytes == ( uint64_t )header.VertexCount * header.VertexStride &&
+		header.IndexBytes == ( uint64_t )header.IndexCount * header.IndexSize &&
+		header.VertexOffset % SECTION_ALIGNMENT == 0 && header.IndexOffset % SECTION_ALIGNMENT == 0 &&
+		header.VertexOffset <= fileSize && header.VertexBytes <= fileSize - header.VertexOffset &&
+		header.IndexOffset <= fileSize && header.IndexBytes <= fileSize - header.IndexOffset;
+
+	if ( !valid ) {
+		m_file.Close();
+		throw std::runtime_error( "Mesh file is corrupt or from another version: " + filePath );
+	}
+
+	m_header = header;
+
+	return true;
+}
+/*
+===============
+MeshFile::Close
+
+	Unmaps the file, pointers from Vertices and Indices become invalid
+===============
+*/
+void MeshFile::Close( void ) {
+	m_file.Close();
+	m_header = MeshFileHeader();
+}
+/*
+===============
+MeshFile::IsOpen
+
+	Returns if a mesh is mapped
+===============
+*/
+bool MeshFile::IsOpen( void ) const {
+	return m_file.IsOpen();
+}
+/*
+===============
+MeshFile::Header
+
+	Returns the header of the mapped mesh
+===============
+*/
+const MeshFileHeader& MeshFile::Header( void ) const {
+	return m_header;
+}
+/*
+===============
+MeshFile::Vertices
+
+	Returns the vertex section, laid out as the vertex buffer expects it
+===============
+*/
+const void* MeshFile::Vertices( void ) const {
+	return m_file.Data() + m_header.VertexOffset;
+}
+/*
+===============
+MeshFile::Indices
+
+	Returns the index section, laid out as the index buffer expects it
+===============
+*/
+const void* MeshFile::Indices( void ) const {
+	return m_file.Data() + m_header.IndexOffset;
+}
+/*
+===============
+MeshFile::IndexType
+
+	Returns the index type to bind the index section with
+===============
+*/
+VkIndexType MeshFile::IndexType( void ) const {
+	return m_header.IndexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+/*
+===============
+MeshFile::VertexBindings
+
+	Returns the vertex buffer binding of MeshVertex
+===============
+*/
+std::vector<VkVertexInputBindingDescription> MeshFile::VertexBindings( void ) {
+	VkVertexInputBindingDescription binding = {};
+
+	binding.binding		= 0;
+	binding.stride		= sizeof( MeshVertex );
+	binding.inputRate	= VK_VERTEX_INPUT_RATE_VERTEX;
+
+	return { binding };
+}
+/*
+===============
+MeshFile::VertexAttributes
+
+	Returns the attributes of MeshVertex. The fixed function fetch expands
+	the quantized values, so the vertex shader sees plain floats.
+===============
+*/
+std::vector<VkVertexInputAttributeDescription> MeshFile::VertexAttributes( void ) {
+	VkVertexInputAttributeDescription attributes[ 2 ] = {};
+
+	attributes[ 0 ].location	= 0;
+	attributes[ 0 ].binding		= 0;
+	attributes[ 0 ].format		= VK_FORMAT_R16G16B16A16_UNORM;
+	attributes[ 0 ].offset		= offsetof( MeshVertex, Position );
+
+	attributes[ 1 ].location	= 1;
+	attributes[ 1 ].binding		= 0;
+	attributes[ 1 ].format		= VK_FORMAT_R16G16_SNORM;
+	attributes[ 1 ].offset		= offsetof( MeshVertex, Normal );
+
+	return { attributes[ 0 ], attributes[ 1 ] };
+}
+/*
+===============
+MeshFile::EncodeOctahedral
+
+	Projects a normal onto the octahedron and folds the lower half over the
+	upper, giving two SNORM values. mesh.vert undoes this.
+===============
+*/
+void MeshFile::EncodeOctahedral( const float normal[ 3 ], int16_t encoded[ 2 ] ) {
+	float length = fabsf( normal[ 0 ] ) + fabsf( normal[ 1 ] ) + fabsf( normal[ 2 ] );
+
+	if ( length == 0.0f ) {
+		encoded[ 0 ] = 0;
+		encoded[ 1 ] = 0;
+		return;
+	}
+
+	float x = normal[ 0 ] / length;
+	float y = normal[ 1 ] / length;
+
+	if ( normal[ 2 ] < 0.0f ) {
+		float foldedX = ( 1.0f - fabsf( y ) ) * ( x >= 0.0f ? 1.0f : -1.0f );
+		float foldedY = ( 1.0f - fabsf( x ) ) * ( y >= 0.0f ? 1.0f : -1.0f );
+
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[ 0 ] = ( int16_t )floorf( std::min( 1.0f, std::max( -1.0f, x ) ) * 32767.0f + 0.5f );
+	encoded[ 1 ] = ( int16_t )floorf( std::min( 1.0f, std::max( -1.0f, y ) ) * 32767.0f + 0.5f );
+}
+/*
+===============
+MeshFile::Convert
+
+	Converts a Wavefront OBJ into a mesh file. Faces are fan triangulated,
+	corners sharing a position and normal become one vertex, and corners
+	without a normal get the area weighted normal of the faces around their
+	position. Indices are 16 bit when the vertex count allows it.
+===============
+*/
+bool MeshFile::Convert( const std::string& objPath, const std::string& meshPath, std::ostream& out ) {
+	std::ifstream obj( objPath );
+
+	if ( !obj.is_open() ) {
+		out << "Could not read OBJ file " << objPath << std::endl;
+		return false;
+	}
+
+	std::vector<float>		positions;
+	std::vector<float>		normals;
+	std::vector<uint32_t>	indices;
+	std::vector<uint32_t>	face;
+	VertexTable				vertexTable;
+	std::string				line;
+	uint64_t				lineNumber = 0;
+
+	while ( std::getline( obj, line ) ) {
+		const char* cursor = line.c_str();
+		++lineNumber;
+
+		while ( *cursor == ' ' || *cursor == '\t' ) {
+			++cursor;
+		}
+
+		if ( cursor[ 0 ] == 'v' && IsSeparator( cursor[ 1 ] ) ) {
+			float position[ 3 ];
+
+			cursor += 1;
+			if ( !ParseFloats( cursor, position, 3 ) ) {
+				out << objPath << ":" << lineNumber << ": bad position" << std::endl;
+				return false;
+			}
+
+			positions.insert( positions.end(), position, position + 3 );
+		} else if ( cursor[ 0 ] == 'v' && cursor[ 1 ] == 'n' && IsSeparator( cursor[ 2 ] ) ) {
+			float normal[ 3 ];
+
+			cursor += 2;
+			if ( !ParseFloats( cursor, normal, 3 ) ) {
+				out << objPath << ":" << lineNumber << ": bad normal" << std::endl;
+				return false;
+			}
+
+			normals.insert( normals.end(), normal, normal + 3 );
+		} else if ( cursor[ 0 ] == 'f' && IsSeparator( cursor[ 1 ] ) ) {
+			face.clear();
+			cursor += 1;
+
+			for ( ;; ) {
+				while ( *cursor == ' ' || *cursor == '\t' ) {
+					++cursor;
+				}
+
+				if ( *cursor == '\0' || *cursor == '\r' || *cursor == '#' ) {
+					break;
+				}
+
+				uint32_t position, normal;
+
+				if ( !ParseCorner( cursor, positions.size() / 3, normals.size() / 3, position, normal ) ) {
+					out << objPath << ":" << lineNumber << ": bad face corner" << std::endl;
+					return false;
+				}
+
+				face.push_back( vertexTable.Find( position, normal ) );
+			}
+
+			if ( face.size() < 3 ) {
+				out << objPath << ":" << lineNumber << ": face with fewer than three corners" << std::endl;
+				return false;
+			}
+
+			for ( size_t i = 1; i + 1 < face.size(); ++i ) {
+				indices.push_back( face[ 0 ] );
+				indices.push_back( face[ i ] );
+				indices.push_back( face[ i + 1 ] );
+			}
+		}
+	}
+
+	if ( indices.empty() ) {
+		out << objPath << " has no faces" << std::endl;
+		return false;
+	}
+
+	MeshFileHeader header;
+
+	header.Magic		= MESH_MAGIC;
+	header.Version		= MESH_VERSION;
+	header.VertexCount	= ( uint32_t )vertexTable.Positions.size();
+	header.VertexStride	= sizeof( MeshVertex );
+	header.IndexCount	= ( uint32_t )indices.size();
+	header.IndexSize	= header.VertexCount <= 0x10000 ? 2 : 4;
+
+	for ( uint32_t axis = 0; axis < 3; ++axis ) {
+		header.BoundsMin[ axis ] = positions[ axis ];
+		header.BoundsMax[ axis ] = positions[ axis ];
+	}
+
+	for ( size_t i = 0; i < positions.size(); i += 3 ) {
+		for ( uint32_t axis = 0; axis < 3; ++axis ) {
+			header.BoundsMin[ axis ] = std::min( header.BoundsMin[ axis ], positions[ i + axis ] );
+			header.BoundsMax[ axis ] = std::max( header.BoundsMax[ axis ], positions[ i + axis ] );
+		}
+	}
+
+	//Only positions used by a corner without a normal need a smoothed one
+	std::vector<float> smoothNormals;
+
+	for ( size_t i = 0; i < indices.size(); i += 3 ) {
+		const uint32_t* triangle = &indices[ i ];
+
+		if ( vertexTable.Normals[ triangle[ 0 ] ] != NO_NORMAL && vertexTable.Normals[ triangle[ 1 ] ] != NO_NORMAL && vertexTable.Normals[ triangle[ 2 ] ] != NO_NORMAL ) {
+			continue;
+		}
+
+		if ( smoothNormals.empty() ) {
+			smoothNormals.resize( positions.size(), 0.0f );
+		}
+
+		const float* a = &positions[ vertexTable.Positions[ triangle[ 0 ] ] * 3 ];
+		const float* b = &positions[ vertexTable.Positions[ triangle[ 1 ] ] * 3 ];
+		const float* c = &positions[ vertexTable.Positions[ triangle[ 2 ] ] * 3 ];
+
+		//The unnormalized cross product weights each face by its area
+		float ab[ 3 ] = { b[ 0 ] - a[ 0 ], b[ 1 ] - a[ 1 ], b[ 2 ] - a[ 2 ] };
+		float ac[ 3 ] = { c[ 0 ] - a[ 0 ], c[ 1 ] - a[ 1 ], c[ 2 ] - a[ 2 ] };
+		float faceNormal[ 3 ] = {
+			ab[ 1 ] * ac[ 2 ] - ab[ 2 ] * ac[ 1 ],
+			ab[ 2 ] * ac[ 0 ] - ab[ 0 ] * ac[ 2 ],
+			ab[ 0 ] * ac[ 1 ] - ab[ 1 ] * ac[ 0 ]
+		};
+
+		for ( uint32_t corner = 0; corner < 3; ++corner ) {
+			float* sum = &smoothNormals[ vertexTable.Positions[ triangle[ corner ] ] * 3 ];
+
+			sum[ 0 ] += faceNormal[ 0 ];
+			sum[ 1 ] += faceNormal[ 1 ];
+			sum[ 2 ] += faceNormal[ 2 ];
+		}
+	}
+
+	std::vector<MeshVertex> vertices( header.VertexCount );
+
+	for ( uint32_t i = 0; i < header.VertexCount; ++i ) {
+		const float*	position	= &positions[ vertexTable.Positions[ i ] * 3 ];
+		const float*	normal		= vertexTable.Normals[ i ] == NO_NORMAL ? &smoothNormals[ vertexTable.Positions[ i ] * 3 ] : &normals[ vertexTable.Normals[ i ] * 3 ];
+		MeshVertex&		vertex		= vertices[ i ];
+
+		for ( uint32_t axis = 0; axis < 3; ++axis ) {
+			vertex.Position[ axis ] = Quantize( position[ axis ], header.BoundsMin[ axis ], header.BoundsMax[ axis ] );
+		}
+
+		vertex.Position[ 3 ] = 0xffff;
+		EncodeOctahedral( normal, vertex.Normal );
+	}
+
+	header.VertexOffset	= AlignUp( sizeof( header ), SECTION_ALIGNMENT );
+	header.VertexBytes	= ( uint64_t )header.VertexCount * header.VertexStride;
+	header.IndexOffset	= AlignUp( header.VertexOffset + header.VertexBytes, SECTION_ALIGNMENT );
+	header.IndexBytes	= ( uint64_t )header.IndexCount * header.IndexSize;
+
+	std::ofstream file( meshPath, std::ios::binary | std::ios::trunc );
+	if ( !file.is_open() ) {
+		out << "Could not write mesh file " << meshPath << std::endl;
+		return false;
+	}
+
+	const std::vector<char> padding( ( size_t )SECTION_ALIGNMENT, 0 );
+
+	file.write( ( const char* )&header, sizeof( header ) );
+	file.write( padding.data(), header.VertexOffset - sizeof( header ) );
+	file.write( ( const char* )vertices.data(), header.VertexBytes );
+	file.write( padding.data(), header.IndexOffset - header.VertexOffset - header.VertexBytes );
+
+	if ( header.IndexSize == 4 ) {
+		file.write( ( const char* )indices.data(), header.IndexBytes );
+	} else {
+		std::vector<uint16_t> narrowed;
+
+		for ( size_t first = 0; first < indices.size(); first += INDEX_WRITE_CHUNK ) {
+			size_t count = std::min( INDEX_WRITE_CHUNK, indices.size() - first );
+
+			narrowed.assign( indices.begin() + first, indices.begin() + first + count );
+			file.write( ( const char* )narrowed.data(), count * sizeof( uint16_t ) );
+		}
+	}
+
+	if ( file.fail() ) {
+		out << "Could not write mesh file " << meshPath << std::endl;
+		return false;
+	}
+
+	out << "Converted " << objPath << ": " << header.VertexCount << " vertices, " << header.IndexCount / 3 << " triangles, "
+		<< header.IndexSize * 8 << " bit indices, " << header.IndexOffset + header.IndexBytes << " bytes" << std::endl;
+
+	return true;
+}
+}
@@ -0,0 +1,85 @@
+#ifndef __MESHFILE_H__
+#define __MESHFILE_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace tut {
+
+/*
+	On disk layout of a mesh. Both sections start on a page boundary and hold
+	exactly what the vertex and index buffers hold, so loading is a copy out
+	of the mapping with no parsing and no intermediate buffer.
+
+	[ MeshFileHeader ][ pad ][ MeshVertex * VertexCount ][ pad ][ uint16_t or uint32_t * IndexCount ]
+*/
+struct MeshFileHeader {
+	uint32_t			Magic			= 0;
+	uint32_t			Version			= 0;
+	uint32_t			VertexCount		= 0;
+	uint32_t			VertexStride	= 0;
+	uint32_t			IndexCount		= 0;
+	uint32_t			IndexSize		= 0;	//2 or 4 bytes
+	float				BoundsMin[ 3 ]	= {};
+	float				BoundsMax[ 3 ]	= {};
+	uint64_t			VertexOffset	= 0;
+	uint64_t			VertexBytes		= 0;
+	uint64_t			IndexOffset		= 0;
+	uint64_t			IndexBytes		= 0;
+};
+
+/*
+	Position is UNORM across the header bounds with w fixed at one, the
+	normal is octahedral encoded SNORM
+*/
+struct MeshVertex {
+	uint16_t			Position[ 4 ];
+	int16_t				Normal[ 2 ];
+};
+
+static_assert( sizeof( MeshVertex ) == 12, "MeshVertex must match the vertex input layout" );
+
+/*
+===============
+MeshFile
+
+	Memory mapped mesh. Only the header is read when opening, the vertex and
+	index sections are touched as they are copied, so the resident cost of a
+	mesh is the pages in flight to staging memory rather than its file size.
+	Indices are not range checked, that would mean reading every one of them.
+===============
+*/
+class MeshFile {
+public:
+	static const uint32_t								MESH_MAGIC{ 0x48534d54 };	//"TMSH"
+	static const uint32_t								MESH_VERSION{ 1 };
+	static const uint64_t								SECTION_ALIGNMENT{ 4096 };
+
+	bool												Open( const std::string& filePath );
+	void												Close( void );
+
+	bool												IsOpen( void ) const;
+	const MeshFileHeader&								Header( void ) const;
+	const void*											Vertices( void ) const;
+	const void*											Indices( void ) const;
+	VkIndexType											IndexType( void ) const;
+
+	static std::vector<VkVertexInputBindingDescription>	VertexBindings( void );
+	static std::vector<VkVertexInputAttributeDescription>	VertexAttributes( void );
+
+	static void											EncodeOctahedral( const float normal[ 3 ], int16_t encoded[ 2 ] );
+	static bool											Convert( const std::string& objPath, const std::string& meshPath, std::ostream& out );
+
+private:
+	MappedFile											m_file;
+	MeshFileHeader										m_header;
+};
+
+}
+
+#endif // !__MESHFILE_H__
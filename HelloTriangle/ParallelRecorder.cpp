@@ -0,0 +1,192 @@
+#include "ParallelRecorder.h"
+#include "HostAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace tut {
+
+const uint32_t ParallelRecorder::MIN_DRAWS_PER_SLICE;
+
+/*
+===============
+ParallelRecorder::ParallelRecorder
+
+	Creates a command pool per slice and frame slot. Zero threads means one
+	per hardware thread, and the calling thread counts as one of them.
+===============
+*/
+ParallelRecorder::ParallelRecorder( VkDevice device, uint32_t queueFamily, uint32_t frameSlots, uint32_t threadCount ) :
+	m_device( device ),
+	m_threadCount( threadCount == 0 ? std::max( 1u, std::thread::hardware_concurrency() ) : threadCount ),
+	m_slicePools( frameSlots * m_threadCount )
+{
+	for ( SlicePool& slicePool : m_slicePools ) {
+		VkCommandPoolCreateInfo poolInfo = {};
+
+		poolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags				= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex	= queueFamily;
+
+		slicePool.Pool = VKCommandPoolHandle( m_device );
+
+		if ( vkCreateCommandPool( m_device, &poolInfo, HostAllocator::Installed(), slicePool.Pool.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create recording command pool" );
+		}
+	}
+
+	if ( m_threadCount > 1 ) {
+		m_workers = std::make_unique<ThreadPool>( m_threadCount - 1 );
+	}
+}
+/*
+===============
+ParallelRecorder::BeginFrame
+
+	Resets every pool of the frame slot. The slot's previous submission
+	must have completed.
+===============
+*/
+void ParallelRecorder::BeginFrame( uint32_t frameSlot ) {
+	for ( uint32_t slice = 0; slice < m_threadCount; ++slice ) {
+		SlicePool& slicePool = m_slicePools[ frameSlot * m_threadCount + slice ];
+
+		if ( slicePool.Used == 0 ) {
+			continue;
+		}
+
+		if ( vkResetCommandPool( m_device, slicePool.Pool, 0 ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not reset recording command pool" );
+		}
+
+		slicePool.Used = 0;
+	}
+}
+/*
+===============
+ParallelRecorder::Record
+
+	Records drawCount draws into secondaries on the workers and executes them
+	from the primary in slice order. The primary must be inside the
+	inheritance render pass, begun with SECONDARY_COMMAND_BUFFERS contents.
+===============
+*/
+void ParallelRecorder::Record( VkCommandBuffer primary, uint32_t frameSlot, const VkCommandBufferInheritanceInfo& inheritance, uint32_t drawCount, const RecordSlice& recordSlice ) {
+	//Tiny slices cost more in secondary overhead than they save
+	uint32_t						sliceCount	= std::max( 1u, std::min( m_threadCount, ( drawCount + MIN_DRAWS_PER_SLICE - 1 ) / MIN_DRAWS_PER_SLICE ) );
+	std::vector<VkCommandBuffer>	buffers( sliceCount );
+
+	m_failed = false;
+
+	for ( uint32_t slice = 0; slice < sliceCount; ++slice ) {
+		buffers[ slice ] = NextBuffer( m_slicePools[ frameSlot * m_threadCount + slice ] );
+	}
+
+	for ( uint32_t slice = 1; slice < sliceCount; ++slice ) {
+		uint32_t		first		= ( uint32_t )( ( uint64_t )drawCount * slice / sliceCount );
+		uint32_t		last		= ( uint32_t )( ( uint64_t )drawCount * ( slice + 1 ) / sliceCount );
+		VkCommandBuffer	buffer		= buffers[ slice ];
+
+		m_workers->Enqueue( [this, buffer, &inheritance, first, last, &recordSlice]() {
+			if ( !RecordSliceBuffer( buffer, inheritance, first, last - first, recordSlice ) ) {
+				m_failed = true;
+			}
+		} );
+	}
+
+	bool recorded = RecordSliceBuffer( buffers[ 0 ], inheritance, 0, ( uint32_t )( ( uint64_t )drawCount / sliceCount ), recordSlice );
+
+	if ( m_workers ) {
+		m_workers->WaitIdle();
+	}
+
+	if ( !recorded || m_failed ) {
+		throw std::runtime_error( "Could not record secondary command buffer" );
+	}
+
+	vkCmdExecuteCommands( primary, sliceCount, buffers.data() );
+
+	m_passes		+= 1;
+	m_draws			+= drawCount;
+	m_secondaries	+= sliceCount;
+}
+/*
+===============
+ParallelRecorder::ThreadCount
+
+	Returns the number of threads recording, including the caller
+===============
+*/
+uint32_t ParallelRecorder::ThreadCount( void ) const {
+	return m_threadCount;
+}
+/*
+===============
+ParallelRecorder::Report
+
+	Writes how much was recorded and how it was split
+===============
+*/
+void ParallelRecorder::Report( std::ostream& out ) const {
+	out << "Recording: " << m_threadCount << " threads, " << m_passes << " passes, " << m_draws << " draws in "
+		<< m_secondaries << " secondary command buffers ("
+		<< ( m_passes > 0 ? ( double )m_secondaries / m_passes : 0.0 ) << " per pass)" << std::endl;
+}
+/*
+===============
+ParallelRecorder::NextBuffer
+
+	Returns an unused secondary from the pool, allocating one when every
+	buffer has been handed out since the last reset
+===============
+*/
+VkCommandBuffer ParallelRecorder::NextBuffer( SlicePool& slicePool ) {
+	if ( slicePool.Used == slicePool.Buffers.size() ) {
+		VkCommandBufferAllocateInfo	allocateInfo	= {};
+		VkCommandBuffer				buffer			= VK_NULL_HANDLE;
+
+		allocateInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool		= slicePool.Pool;
+		allocateInfo.level				= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocateInfo.commandBufferCount	= 1;
+
+		if ( vkAllocateCommandBuffers( m_device, &allocateInfo, &buffer ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not allocate secondary command buffer" );
+		}
+
+		slicePool.Buffers.push_back( buffer );
+	}
+
+	return slicePool.Buffers[ slicePool.Used++ ];
+}
+/*
+===============
+ParallelRecorder::RecordSliceBuffer
+
+	Begins a secondary inside the inherited render pass, records one slice
+	into it and ends it. Runs on the workers, so failures are returned
+	rather than thrown.
+===============
+*/
+bool ParallelRecorder::RecordSliceBuffer( VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritance, uint32_t firstDraw, uint32_t drawCount, const RecordSlice& recordSlice ) {
+	VkCommandBufferBeginInfo beginInfo = {};
+
+	beginInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags				= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo	= &inheritance;
+
+	if ( vkBeginCommandBuffer( commandBuffer, &beginInfo ) != VK_SUCCESS ) {
+		return false;
+	}
+
+	try {
+		recordSlice( commandBuffer, firstDraw, drawCount );
+	} catch ( const std::exception& ) {
+		vkEndCommandBuffer( commandBuffer );
+		return false;
+	}
+
+	return vkEndCommandBuffer( commandBuffer ) == VK_SUCCESS;
+}
+}
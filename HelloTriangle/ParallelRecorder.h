@@ -0,0 +1,79 @@
+#ifndef __PARALLELRECORDER_H__
+#define __PARALLELRECORDER_H__
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+===============
+ParallelRecorder
+
+	Records one render pass worth of draws across several threads. The draw
+	list is cut into contiguous slices, each recorded into a secondary command
+	buffer from a command pool owned by that slice for the frame slot, and the
+	secondaries are executed from the primary in slice order so the result
+	does not depend on which thread finished first. The calling thread records
+	the first slice itself.
+
+	Pools are never shared between threads and are reset in bulk once the
+	frame slot's fence has been waited on, so no command buffer is freed or
+	reset individually.
+===============
+*/
+class ParallelRecorder {
+public:
+	//Records draws [firstDraw, firstDraw + drawCount) into a secondary command buffer that has already begun
+	typedef std::function<void( VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount )>	RecordSlice;
+
+	static const uint32_t					MIN_DRAWS_PER_SLICE{ 64 };
+
+											ParallelRecorder( VkDevice device, uint32_t queueFamily, uint32_t frameSlots, uint32_t threadCount );
+
+	ParallelRecorder( const ParallelRecorder& ) = delete;
+	ParallelRecorder& operator=( const ParallelRecorder& ) = delete;
+
+	void									BeginFrame( uint32_t frameSlot );
+	void									Record( VkCommandBuffer primary, uint32_t frameSlot, const VkCommandBufferInheritanceInfo& inheritance, uint32_t drawCount, const RecordSlice& recordSlice );
+
+	uint32_t								ThreadCount( void ) const;
+	void									Report( std::ostream& out ) const;
+
+private:
+	/*
+		Command pool of one slice for one frame slot, and the secondaries
+		allocated from it. Used counts the buffers handed out since the last
+		reset, so a frame may record several passes.
+	*/
+	struct SlicePool {
+		VKCommandPoolHandle					Pool;
+		std::vector<VkCommandBuffer>		Buffers;
+		uint32_t							Used		= 0;
+	};
+
+	VkCommandBuffer							NextBuffer( SlicePool& slicePool );
+	bool									RecordSliceBuffer( VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritance, uint32_t firstDraw, uint32_t drawCount, const RecordSlice& recordSlice );
+
+	VkDevice								m_device;
+	uint32_t								m_threadCount;
+	std::vector<SlicePool>					m_slicePools;	//frameSlot * m_threadCount + slice
+	std::unique_ptr<ThreadPool>				m_workers;
+
+	std::atomic<bool>						m_failed{ false };
+	uint64_t								m_passes{ 0 };
+	uint64_t								m_draws{ 0 };
+	uint64_t								m_secondaries{ 0 };
+};
+
+}
+
+#endif // !__PARALLELRECORDER_H__
@@ -0,0 +1,385 @@
+#include "PipelineCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tut {
+
+namespace {
+
+/*
+	Layout of VkPipelineCacheHeaderVersionOne as it appears at the start of
+	the blob returned by vkGetPipelineCacheData
+*/
+const size_t PIPELINE_CACHE_HEADER_SIZE{ 16 + VK_UUID_SIZE };
+
+/*
+===============
+ReadUint32
+
+	Reads a uint32_t from an unaligned position in a blob
+===============
+*/
+uint32_t ReadUint32( const std::vector<char>& data, size_t offset ) {
+	uint32_t value;
+	memcpy( &value, data.data() + offset, sizeof( value ) );
+	return value;
+}
+/*
+===============
+WriteFileDurably
+
+	Writes data to a new file and flushes it to the disk before returning,
+	so a rename that follows can never expose a file whose contents are
+	still in the page cache
+===============
+*/
+bool WriteFileDurably( const std::string& path, const char* data, size_t size ) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA( path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE ) {
+		return false;
+	}
+
+	DWORD	written	= 0;
+	bool	success	= WriteFile( file, data, ( DWORD )size, &written, nullptr ) != 0 && written == size && FlushFileBuffers( file ) != 0;
+
+	CloseHandle( file );
+
+	return success;
+#else
+	int file = open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if ( file < 0 ) {
+		return false;
+	}
+
+	bool success = true;
+
+	while ( size > 0 ) {
+		ssize_t written = write( file, data, size );
+
+		if ( written < 0 && errno == EINTR ) {
+			continue;
+		}
+
+		if ( written <= 0 ) {
+			success = false;
+			break;
+		}
+
+		data += written;
+		size -= ( size_t )written;
+	}
+
+	success = success && fsync( file ) == 0;
+	success = close( file ) == 0 && success;
+
+	return success;
+#endif
+}
+/*
+===============
+ReplaceFile
+
+	Moves source over destination in one step so a crash never leaves a
+	half written cache behind. On POSIX the rename itself is only durable
+	once the directory holding both names is flushed too.
+===============
+*/
+bool ReplaceFile( const std::string& source, const std::string& destination ) {
+#ifdef _WIN32
+	return MoveFileExA( source.c_str(), destination.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0;
+#else
+	if ( std::rename( source.c_str(), destination.c_str() ) != 0 ) {
+		return false;
+	}
+
+	size_t		separator	= destination.find_last_of( '/' );
+	std::string	directory	= separator == std::string::npos ? "." : destination.substr( 0, std::max<size_t>( separator, 1 ) );
+	int			handle		= open( directory.c_str(), O_RDONLY );
+
+	if ( handle < 0 ) {
+		return false;
+	}
+
+	bool success = fsync( handle ) == 0;
+	close( handle );
+
+	return success;
+#endif
+}
+
+}
+
+/*
+===============
+PipelineCache::PipelineCache
+
+	Creates the pipeline cache, seeded from disk when the blob matches
+===============
+*/
+PipelineCache::PipelineCache( const DeviceCapabilities& capabilities, VkDevice device, const std::string& filePath ) :
+	m_device( device ),
+	m_deviceProperties( capabilities.Properties ),
+	m_filePath( filePath ),
+	m_cache( device )
+{
+	std::chrono::high_resolution_clock::time_point	start		= std::chrono::high_resolution_clock::now();
+	std::vector<char>								initialData	= LoadFile();
+
+	if ( !initialData.empty() && !IsCompatible( initialData ) ) {
+		std::cout << "Discarding pipeline cache " << m_filePath << ", it was written for another device or driver" << std::endl;
+		initialData.clear();
+	}
+
+	VkPipelineCacheCreateInfo createInfo = {};
+
+	createInfo.sType			= VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize	= initialData.size();
+	createInfo.pInitialData		= initialData.empty() ? nullptr : initialData.data();
+
+	if ( vkCreatePipelineCache( m_device, &createInfo, HostAllocator::Installed(), m_cache.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create pipeline cache" );
+	}
+
+	m_warm			= !initialData.empty();
+	m_loadedBytes	= initialData.size();
+	m_loadMs		= std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+}
+/*
+===============
+PipelineCache::operator VkPipelineCache
+
+	Returns the cache to pass to pipeline creation
+===============
+*/
+PipelineCache::operator VkPipelineCache( void ) const {
+	return m_cache;
+}
+/*
+===============
+PipelineCache::AcquireWorkerCache
+
+	Hands a compile thread a cache nobody else uses until it is released,
+	an idle one or a new one seeded with what the main cache holds
+===============
+*/
+VkPipelineCache PipelineCache::AcquireWorkerCache( void ) {
+	{
+		std::lock_guard<std::mutex> lock( m_workerCacheLock );
+
+		if ( !m_idleWorkerCaches.empty() ) {
+			VkPipelineCache workerCache = m_idleWorkerCaches.back();
+			m_idleWorkerCaches.pop_back();
+			return workerCache;
+		}
+	}
+
+	//Reading the main cache is internally synchronized, only merging into it is not
+	std::vector<char>	initialData;
+	size_t				dataSize	= 0;
+
+	if ( vkGetPipelineCacheData( m_device, m_cache, &dataSize, nullptr ) == VK_SUCCESS && dataSize > 0 ) {
+		initialData.resize( dataSize );
+
+		if ( vkGetPipelineCacheData( m_device, m_cache, &dataSize, initialData.data() ) != VK_SUCCESS ) {
+			initialData.clear();
+		}
+
+		initialData.resize( std::min( initialData.size(), dataSize ) );
+	}
+
+	VkPipelineCacheCreateInfo	createInfo	= {};
+	VKPipelineCacheHandle		workerCache	= VKPipelineCacheHandle( m_device );
+
+	createInfo.sType			= VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize	= initialData.size();
+	createInfo.pInitialData		= initialData.empty() ? nullptr : initialData.data();
+
+	if ( vkCreatePipelineCache( m_device, &createInfo, HostAllocator::Installed(), workerCache.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create worker pipeline cache" );
+	}
+
+	std::lock_guard<std::mutex> lock( m_workerCacheLock );
+
+	m_workerCaches.push_back( std::move( workerCache ) );
+
+	return m_workerCaches.back();
+}
+/*
+===============
+PipelineCache::ReleaseWorkerCache
+
+	Returns a cache from AcquireWorkerCache once the thread is done
+	compiling into it
+===============
+*/
+void PipelineCache::ReleaseWorkerCache( VkPipelineCache workerCache ) {
+	std::lock_guard<std::mutex> lock( m_workerCacheLock );
+
+	m_idleWorkerCaches.push_back( workerCache );
+}
+/*
+===============
+PipelineCache::MergeWorkerCaches
+
+	Merges the idle worker caches into the main cache and destroys them, so
+	later compiles start from caches seeded with everything. Caches acquired
+	right now are left for the next merge. Must not run alongside pipeline
+	creation with the main cache itself.
+===============
+*/
+void PipelineCache::MergeWorkerCaches( void ) {
+	std::lock_guard<std::mutex> lock( m_workerCacheLock );
+
+	if ( m_idleWorkerCaches.empty() ) {
+		return;
+	}
+
+	if ( vkMergePipelineCaches( m_device, m_cache, ( uint32_t )m_idleWorkerCaches.size(), m_idleWorkerCaches.data() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not merge pipeline caches" );
+	}
+
+	m_workerCaches.erase( std::remove_if( m_workerCaches.begin(), m_workerCaches.end(), [this]( const VKPipelineCacheHandle& workerCache ) {
+		return std::find( m_idleWorkerCaches.begin(), m_idleWorkerCaches.end(), ( VkPipelineCache )workerCache ) != m_idleWorkerCaches.end();
+	} ), m_workerCaches.end() );
+
+	m_idleWorkerCaches.clear();
+}
+/*
+===============
+PipelineCache::Save
+
+	Writes the cache to a temporary file, flushed to the disk, and swaps it
+	in place of the old one
+===============
+*/
+void PipelineCache::Save( void ) {
+	MergeWorkerCaches();
+
+	size_t dataSize = 0;
+	if ( vkGetPipelineCacheData( m_device, m_cache, &dataSize, nullptr ) != VK_SUCCESS || dataSize == 0 ) {
+		return;
+	}
+
+	std::vector<char> data( dataSize );
+	if ( vkGetPipelineCacheData( m_device, m_cache, &dataSize, data.data() ) != VK_SUCCESS ) {
+		std::cerr << "Could not read back pipeline cache data" << std::endl;
+		return;
+	}
+
+	std::string temporaryPath = m_filePath + ".tmp";
+
+	if ( !WriteFileDurably( temporaryPath, data.data(), dataSize ) ) {
+		std::cerr << "Could not write pipeline cache " << temporaryPath << std::endl;
+		std::remove( temporaryPath.c_str() );
+		return;
+	}
+
+	if ( !ReplaceFile( temporaryPath, m_filePath ) ) {
+		std::cerr << "Could not replace pipeline cache " << m_filePath << std::endl;
+		std::remove( temporaryPath.c_str() );
+	}
+}
+/*
+===============
+PipelineCache::IsWarm
+
+	Returns if the cache was seeded from disk
+===============
+*/
+bool PipelineCache::IsWarm( void ) const {
+	return m_warm;
+}
+/*
+===============
+PipelineCache::RecordPipelineCreation
+
+	Adds a pipeline creation time to the startup report
+===============
+*/
+void PipelineCache::RecordPipelineCreation( double milliseconds ) {
+	std::lock_guard<std::mutex> lock( m_timingLock );
+
+	++m_pipelineCount;
+	m_totalCreationMs	+= milliseconds;
+	m_maxCreationMs		= std::max( m_maxCreationMs, milliseconds );
+}
+/*
+===============
+PipelineCache::Report
+
+	Writes whether the cache was warm and how long pipeline creation took
+===============
+*/
+void PipelineCache::Report( std::ostream& out ) const {
+	out << "Pipeline cache: " << ( m_warm ? "warm" : "cold" ) << ", "
+		<< m_loadedBytes << " bytes loaded in " << m_loadMs << " ms; "
+		<< m_pipelineCount << " pipelines created in " << m_totalCreationMs << " ms (max "
+		<< m_maxCreationMs << " ms)" << std::endl;
+}
+/*
+===============
+PipelineCache::IsCompatible
+
+	Checks the blob header against the device the cache is created on
+===============
+*/
+bool PipelineCache::IsCompatible( const std::vector<char>& data ) const {
+	if ( data.size() < PIPELINE_CACHE_HEADER_SIZE ) {
+		return false;
+	}
+
+	uint32_t headerSize		= ReadUint32( data, 0 );
+	uint32_t headerVersion	= ReadUint32( data, 4 );
+	uint32_t vendorID		= ReadUint32( data, 8 );
+	uint32_t deviceID		= ReadUint32( data, 12 );
+
+	return headerSize >= PIPELINE_CACHE_HEADER_SIZE && headerSize <= data.size() &&
+		headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		vendorID == m_deviceProperties.vendorID &&
+		deviceID == m_deviceProperties.deviceID &&
+		memcmp( data.data() + 16, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+}
+/*
+===============
+PipelineCache::LoadFile
+
+	Reads the cache blob, returns an empty vector if there is none
+===============
+*/
+std::vector<char> PipelineCache::LoadFile( void ) const {
+	std::ifstream file( m_filePath, std::ios::ate | std::ios::binary );
+
+	if ( !file.is_open() ) {
+		return std::vector<char>();
+	}
+
+	size_t				fileSize = ( size_t )file.tellg();
+	std::vector<char>	buffer( fileSize );
+
+	file.seekg( 0 );
+	file.read( buffer.data(), fileSize );
+
+	if ( file.fail() ) {
+		return std::vector<char>();
+	}
+
+	return buffer;
+}
+}
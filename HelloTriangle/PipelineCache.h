@@ -0,0 +1,69 @@
+#ifndef __PIPELINECACHE_H__
+#define __PIPELINECACHE_H__
+
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DeviceCapabilities.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+===============
+PipelineCache
+
+	VkPipelineCache persisted between runs. The blob on disk is only used if
+	its header matches the vendor, device and pipelineCacheUUID of the device
+	it is loaded on. Threads compiling in the background acquire worker
+	caches of their own, seeded from the main cache, so they don't contend
+	on its internal lock; MergeWorkerCaches folds the idle ones back in.
+===============
+*/
+class PipelineCache {
+public:
+										PipelineCache( const DeviceCapabilities& capabilities, VkDevice device, const std::string& filePath );
+
+	PipelineCache( const PipelineCache& ) = delete;
+	PipelineCache& operator=( const PipelineCache& ) = delete;
+
+										operator VkPipelineCache( void ) const;
+
+	VkPipelineCache						AcquireWorkerCache( void );
+	void								ReleaseWorkerCache( VkPipelineCache workerCache );
+	void								MergeWorkerCaches( void );
+	void								Save( void );
+
+	bool								IsWarm( void ) const;
+	void								RecordPipelineCreation( double milliseconds );
+	void								Report( std::ostream& out ) const;
+
+private:
+	bool								IsCompatible( const std::vector<char>& data ) const;
+	std::vector<char>					LoadFile( void ) const;
+
+	VkDevice							m_device;
+	VkPhysicalDeviceProperties			m_deviceProperties;
+	std::string							m_filePath;
+
+	VKPipelineCacheHandle				m_cache;
+	std::vector<VKPipelineCacheHandle>	m_workerCaches;
+	std::vector<VkPipelineCache>		m_idleWorkerCaches;		//Of m_workerCaches, those no thread has acquired
+	std::mutex							m_workerCacheLock;
+
+	bool								m_warm{ false };
+	size_t								m_loadedBytes{ 0 };
+	double								m_loadMs{ 0.0 };
+
+	std::mutex							m_timingLock;
+	uint32_t							m_pipelineCount{ 0 };
+	double								m_totalCreationMs{ 0.0 };
+	double								m_maxCreationMs{ 0.0 };
+};
+
+}
+
+#endif // !__PIPELINECACHE_H__
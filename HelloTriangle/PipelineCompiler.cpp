@@ -0,0 +1,370 @@
+#include "PipelineCompiler.h"
+#include "HostAllocator.h"
+#include "TraceCollector.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tut {
+
+const PipelineCompiler::PipelineId PipelineCompiler::INVALID_PIPELINE;
+
+/*
+===============
+PipelineCompiler::PipelineCompiler
+
+	Starts the compile threads
+===============
+*/
+PipelineCompiler::PipelineCompiler( VkDevice device, PipelineCache& cache, ShaderStore& shaders, uint32_t threadCount ) :
+	m_device( device ),
+	m_cache( cache ),
+	m_shaders( shaders ),
+	m_workers( threadCount )
+{
+}
+/*
+===============
+PipelineCompiler::Submit
+
+	Queues a pipeline for compilation and returns its id. onReady is called
+	on the compile thread once it is ready or has failed.
+===============
+*/
+PipelineCompiler::PipelineId PipelineCompiler::Submit( const GraphicsPipelineDescription& description, ReadyCallback onReady ) {
+	PipelineId id;
+
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+
+		if ( m_freeIds.empty() ) {
+			id = ( PipelineId )m_entries.size();
+			m_entries.emplace_back();
+		} else {
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+		}
+
+		Entry& entry = m_entries[ id ];
+
+		entry.Description	= description;
+		entry.OnReady		= std::move( onReady );
+		entry.Pipeline		= VKPipelineHandle( m_device );
+		entry.Submitted		= std::chrono::high_resolution_clock::now();
+
+		++m_queueDepth;
+		m_maxQueueDepth = std::max( m_maxQueueDepth, m_queueDepth );
+	}
+
+	m_workers.Enqueue( [this, id]() { Compile( id ); } );
+
+	return id;
+}
+/*
+===============
+PipelineCompiler::Resolve
+
+	Returns the pipeline if it is ready, else VK_NULL_HANDLE. Never waits
+	for a compile.
+===============
+*/
+VkPipeline PipelineCompiler::Resolve( PipelineId id ) {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	if ( id == INVALID_PIPELINE ) {
+		return VK_NULL_HANDLE;
+	}
+
+	const Entry& entry = m_entries[ id ];
+
+	if ( entry.Status == State::Ready ) {
+		return entry.Pipeline;
+	}
+
+	++m_misses;
+
+	return VK_NULL_HANDLE;
+}
+/*
+===============
+PipelineCompiler::Wait
+
+	Blocks until the pipeline has compiled, for callers that cannot do
+	anything useful without it. Returns VK_NULL_HANDLE if the compile failed.
+===============
+*/
+VkPipeline PipelineCompiler::Wait( PipelineId id ) {
+	std::unique_lock<std::mutex> lock( m_lock );
+
+	Entry& entry = m_entries[ id ];
+
+	m_compiled.wait( lock, [&entry]() { return entry.Status != State::Queued && entry.Status != State::Compiling; } );
+
+	return entry.Status == State::Ready ? ( VkPipeline )entry.Pipeline : VK_NULL_HANDLE;
+}
+/*
+===============
+PipelineCompiler::Failure
+
+	Returns why the compile failed, empty unless it has
+===============
+*/
+std::string PipelineCompiler::Failure( PipelineId id ) const {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	return m_entries[ id ].Failure;
+}
+/*
+===============
+PipelineCompiler::Retire
+
+	Hands a pipeline to the deletion queue and frees its id. A compile that
+	has not started is dropped and frees the id when its turn comes; one that
+	is running is waited for, since it still reads the description's render
+	pass and layout.
+===============
+*/
+void PipelineCompiler::Retire( PipelineId id, DeletionQueue& deletionQueue ) {
+	std::unique_lock<std::mutex> lock( m_lock );
+
+	Entry& entry = m_entries[ id ];
+
+	m_compiled.wait( lock, [&entry]() { return entry.Status != State::Compiling; } );
+
+	if ( entry.Status == State::Ready ) {
+		entry.Pipeline.retire( deletionQueue );
+	}
+
+	if ( entry.Status == State::Queued ) {
+		entry.Status = State::Retired;
+	} else {
+		Reclaim( id );
+	}
+}
+/*
+===============
+PipelineCompiler::QueueDepth
+
+	Returns the number of pipelines queued or compiling
+===============
+*/
+uint32_t PipelineCompiler::QueueDepth( void ) const {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	return m_queueDepth;
+}
+/*
+===============
+PipelineCompiler::Report
+
+	Writes how many pipelines compiled, how deep the queue got, how long a
+	pipeline took from submit to ready, and how often a frame had to go without
+===============
+*/
+void PipelineCompiler::Report( std::ostream& out ) const {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	uint64_t finished = m_compiledCount + m_failedCount;
+
+	out << "Pipeline compiler: " << m_compiledCount << " compiled, " << m_failedCount << " failed on "
+		<< m_workers.ThreadCount() << " threads, queue depth max " << m_maxQueueDepth << ", latency "
+		<< ( finished > 0 ? m_totalLatencyMs / finished : 0.0 ) << " ms average (max " << m_maxLatencyMs << " ms), compile "
+		<< ( finished > 0 ? m_totalCompileMs / finished : 0.0 ) << " ms average (max " << m_maxCompileMs << " ms); "
+		<< m_misses << " lookups not ready" << std::endl;
+}
+/*
+===============
+PipelineCompiler::Compile
+
+	Runs on a compile thread
+===============
+*/
+void PipelineCompiler::Compile( PipelineId id ) {
+	TUT_ZONE( "Compile pipeline" );
+
+	GraphicsPipelineDescription description;
+
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+
+		Entry& entry = m_entries[ id ];
+
+		if ( entry.Status == State::Retired ) {
+			--m_queueDepth;
+			Reclaim( id );
+			return;
+		}
+
+		entry.Status	= State::Compiling;
+		description		= entry.Description;
+	}
+
+	std::chrono::high_resolution_clock::time_point	start		= std::chrono::high_resolution_clock::now();
+	VKPipelineHandle								pipeline	= VKPipelineHandle( m_device );
+	VkPipelineCache									workerCache	= VK_NULL_HANDLE;
+	bool											compiled	= true;
+	std::string										failure;
+
+	try {
+		workerCache = m_cache.AcquireWorkerCache();
+		CreatePipeline( description, workerCache, pipeline );
+	} catch ( const std::exception& e ) {
+		compiled	= false;
+		failure		= e.what();
+	}
+
+	if ( workerCache != VK_NULL_HANDLE ) {
+		m_cache.ReleaseWorkerCache( workerCache );
+	}
+
+	std::chrono::high_resolution_clock::time_point	end			= std::chrono::high_resolution_clock::now();
+	double											compileMs	= std::chrono::duration<double, std::milli>( end - start ).count();
+	ReadyCallback									onReady;
+	VkPipeline										ready		= VK_NULL_HANDLE;
+
+	if ( compiled ) {
+		m_cache.RecordPipelineCreation( compileMs );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+
+		Entry&	entry		= m_entries[ id ];
+		double	latencyMs	= std::chrono::duration<double, std::milli>( end - entry.Submitted ).count();
+
+		--m_queueDepth;
+		m_totalLatencyMs	+= latencyMs;
+		m_maxLatencyMs		= std::max( m_maxLatencyMs, latencyMs );
+		m_totalCompileMs	+= compileMs;
+		m_maxCompileMs		= std::max( m_maxCompileMs, compileMs );
+
+		if ( compiled ) {
+			entry.Pipeline	= std::move( pipeline );
+			entry.Status	= State::Ready;
+			ready			= entry.Pipeline;
+			++m_compiledCount;
+		} else {
+			entry.Status	= State::Failed;
+			entry.Failure	= failure;
+			++m_failedCount;
+		}
+
+		onReady = entry.OnReady;
+	}
+
+	m_compiled.notify_all();
+
+	if ( onReady ) {
+		onReady( id, ready, failure );
+	}
+}
+/*
+===============
+PipelineCompiler::Reclaim
+
+	Empties a retired entry and frees its id for the next Submit. Called
+	with the lock held.
+===============
+*/
+void PipelineCompiler::Reclaim( PipelineId id ) {
+	m_entries[ id ] = Entry();
+	m_freeIds.push_back( id );
+}
+/*
+===============
+PipelineCompiler::CreatePipeline
+
+	Creates a pipeline from a description, throwing if the driver refuses
+===============
+*/
+void PipelineCompiler::CreatePipeline( const GraphicsPipelineDescription& description, VkPipelineCache cache, VKPipelineHandle& pipeline ) {
+	VkPipelineShaderStageCreateInfo shaderStages[ 2 ] = {};
+
+	shaderStages[ 0 ].sType		= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[ 0 ].stage		= VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[ 0 ].module	= m_shaders.GetModule( description.VertexShader );
+	shaderStages[ 0 ].pName		= "main";
+
+	shaderStages[ 1 ].sType		= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[ 1 ].stage		= VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[ 1 ].module	= m_shaders.GetModule( description.FragmentShader );
+	shaderStages[ 1 ].pName		= "main";
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+
+	vertexInputInfo.sType							= VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount	= ( uint32_t )description.Bindings.size();
+	vertexInputInfo.pVertexBindingDescriptions		= description.Bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount	= ( uint32_t )description.Attributes.size();
+	vertexInputInfo.pVertexAttributeDescriptions	= description.Attributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+
+	inputAssembly.sType						= VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology					= description.Topology;
+	inputAssembly.primitiveRestartEnable	= VK_FALSE;
+
+	//Viewport and scissor are set while recording so the pipeline survives a resize
+	VkPipelineViewportStateCreateInfo viewportState = {};
+
+	viewportState.sType			= VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount	= 1;
+	viewportState.scissorCount	= 1;
+
+	VkDynamicState						dynamicStates[]	= { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo	dynamicState	= {};
+
+	dynamicState.sType				= VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount	= 2;
+	dynamicState.pDynamicStates		= dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+
+	rasterizer.sType					= VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable			= VK_FALSE;
+	rasterizer.rasterizerDiscardEnable	= VK_FALSE;
+	rasterizer.polygonMode				= description.PolygonMode;
+	rasterizer.lineWidth				= 1.0f;
+	rasterizer.cullMode					= description.CullMode;
+	rasterizer.frontFace				= description.FrontFace;
+	rasterizer.depthBiasEnable			= VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+
+	multisampling.sType					= VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable	= VK_FALSE;
+	multisampling.rasterizationSamples	= VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+
+	colorBlendAttachment.colorWriteMask	= VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable	= VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+
+	colorBlending.sType				= VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable		= VK_FALSE;
+	colorBlending.attachmentCount	= 1;
+	colorBlending.pAttachments		= &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+
+	pipelineInfo.sType					= VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount				= 2;
+	pipelineInfo.pStages				= shaderStages;
+	pipelineInfo.pVertexInputState		= &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState	= &inputAssembly;
+	pipelineInfo.pViewportState			= &viewportState;
+	pipelineInfo.pRasterizationState	= &rasterizer;
+	pipelineInfo.pMultisampleState		= &multisampling;
+	pipelineInfo.pColorBlendState		= &colorBlending;
+	pipelineInfo.pDynamicState			= &dynamicState;
+	pipelineInfo.layout					= description.Layout;
+	pipelineInfo.renderPass				= description.RenderPass;
+	pipelineInfo.subpass				= description.Subpass;
+
+	if ( vkCreateGraphicsPipelines( m_device, cache, 1, &pipelineInfo, HostAllocator::Installed(), pipeline.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create graphics pipeline" );
+	}
+}
+}
@@ -0,0 +1,129 @@
+#ifndef __PIPELINECOMPILER_H__
+#define __PIPELINECOMPILER_H__
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "PipelineCache.h"
+#include "ShaderStore.h"
+#include "ThreadPool.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+	Everything needed to compile a graphics pipeline, held by value so it
+	outlives the caller's stack. Shaders are ShaderStore names. Viewport and
+	scissor are always dynamic. Without bindings the vertex shader generates
+	its own vertices.
+*/
+struct GraphicsPipelineDescription {
+	std::string				VertexShader;
+	std::string				FragmentShader;
+	VkPipelineLayout		Layout		= VK_NULL_HANDLE;
+	VkRenderPass			RenderPass	= VK_NULL_HANDLE;
+	uint32_t				Subpass		= 0;
+	VkPrimitiveTopology		Topology	= VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode			PolygonMode	= VK_POLYGON_MODE_FILL;
+	VkCullModeFlags			CullMode	= VK_CULL_MODE_BACK_BIT;
+	VkFrontFace				FrontFace	= VK_FRONT_FACE_CLOCKWISE;
+
+	std::vector<VkVertexInputBindingDescription>	Bindings;
+	std::vector<VkVertexInputAttributeDescription>	Attributes;
+};
+
+/*
+===============
+PipelineCompiler
+
+	Compiles graphics pipelines on background threads. Submit returns an id
+	at once; Resolve turns it into a pipeline without ever blocking, giving
+	VK_NULL_HANDLE while the compile is still queued or running, so a frame
+	can skip the draw instead of stalling.
+	Each compile borrows a worker cache from the PipelineCache, so the
+	threads never wait on each other inside the driver's cache; saving the
+	cache merges them back.
+
+	The layout and render pass of a description must stay alive until the
+	pipeline is ready or has been retired. Retiring frees the id for a later
+	Submit, so it must not be used afterwards.
+===============
+*/
+class PipelineCompiler {
+public:
+	typedef uint32_t													PipelineId;
+	//Runs on the compile thread, pipeline is VK_NULL_HANDLE and failure says why when the compile failed
+	typedef std::function<void( PipelineId id, VkPipeline pipeline, const std::string& failure )>	ReadyCallback;
+
+	static const PipelineId												INVALID_PIPELINE{ 0xffffffff };
+
+																		PipelineCompiler( VkDevice device, PipelineCache& cache, ShaderStore& shaders, uint32_t threadCount );
+
+	PipelineCompiler( const PipelineCompiler& ) = delete;
+	PipelineCompiler& operator=( const PipelineCompiler& ) = delete;
+
+	PipelineId															Submit( const GraphicsPipelineDescription& description, ReadyCallback onReady = ReadyCallback() );
+	VkPipeline															Resolve( PipelineId id );
+	VkPipeline															Wait( PipelineId id );
+	std::string															Failure( PipelineId id ) const;
+	void																Retire( PipelineId id, DeletionQueue& deletionQueue );
+
+	uint32_t															QueueDepth( void ) const;
+	void																Report( std::ostream& out ) const;
+
+private:
+	enum class State {
+		Queued,
+		Compiling,
+		Ready,
+		Failed,
+		Retired
+	};
+
+	struct Entry {
+		GraphicsPipelineDescription										Description;
+		ReadyCallback													OnReady;
+		VKPipelineHandle												Pipeline;
+		State															Status		= State::Queued;
+		std::string														Failure;	//Why the compile failed
+		std::chrono::high_resolution_clock::time_point					Submitted;
+	};
+
+	void																Compile( PipelineId id );
+	void																Reclaim( PipelineId id );
+	void																CreatePipeline( const GraphicsPipelineDescription& description, VkPipelineCache cache, VKPipelineHandle& pipeline );
+
+	VkDevice															m_device;
+	PipelineCache&														m_cache;
+	ShaderStore&														m_shaders;
+
+	mutable std::mutex													m_lock;
+	std::condition_variable												m_compiled;
+	std::deque<Entry>													m_entries;	//Indexed by PipelineId, a deque so entries never move
+	std::vector<PipelineId>												m_freeIds;	//Retired entries Submit reuses
+
+	uint32_t															m_queueDepth{ 0 };
+	uint32_t															m_maxQueueDepth{ 0 };
+	uint64_t															m_compiledCount{ 0 };
+	uint64_t															m_failedCount{ 0 };
+	uint64_t															m_misses{ 0 };
+	double																m_totalLatencyMs{ 0.0 };
+	double																m_maxLatencyMs{ 0.0 };
+	double																m_totalCompileMs{ 0.0 };
+	double																m_maxCompileMs{ 0.0 };
+
+	ThreadPool															m_workers;	//Last, so it finishes its compiles before anything they touch is destroyed
+};
+
+}
+
+#endif // !__PIPELINECOMPILER_H__
@@ -0,0 +1,150 @@
+#include "PresentTimings.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace tut {
+
+namespace {
+
+/*
+===============
+Percentile
+
+	Returns the value below which the given fraction of a sorted series lies
+===============
+*/
+float Percentile( const std::vector<float>& sorted, double fraction ) {
+	size_t index = ( size_t )( fraction * ( sorted.size() - 1 ) + 0.5 );
+	return sorted[ std::min( index, sorted.size() - 1 ) ];
+}
+/*
+===============
+ReportSeries
+
+	Writes the distribution of one timing series
+===============
+*/
+void ReportSeries( std::ostream& out, const char* name, std::vector<float> values ) {
+	std::sort( values.begin(), values.end() );
+
+	out << "  " << name << ": p50 " << Percentile( values, 0.5 ) << " ms, p90 " << Percentile( values, 0.9 )
+		<< " ms, p99 " << Percentile( values, 0.99 ) << " ms, max " << values.back() << " ms" << std::endl;
+}
+/*
+===============
+MillisecondsBetween
+
+	Returns the time from start to end in milliseconds
+===============
+*/
+float MillisecondsBetween( std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end ) {
+	return std::chrono::duration<float, std::milli>( end - start ).count();
+}
+
+}
+
+/*
+===============
+PresentTimings::PresentTimings
+
+	Keeps up to capacity frames, older frames are overwritten
+===============
+*/
+PresentTimings::PresentTimings( size_t capacity ) :
+	m_capacity( std::max( capacity, ( size_t )1 ) )
+{
+	m_samples.reserve( m_capacity );
+}
+/*
+===============
+PresentTimings::Record
+
+	Stores a frame's timestamps relative to its input time
+===============
+*/
+void PresentTimings::Record( const PresentTimestamps& timestamps ) {
+	Sample sample;
+
+	sample.FrameIndex	= timestamps.FrameIndex;
+	sample.AcquireMs	= MillisecondsBetween( timestamps.Input, timestamps.Acquired );
+	sample.SubmitMs		= MillisecondsBetween( timestamps.Input, timestamps.Submitted );
+	sample.PresentMs	= MillisecondsBetween( timestamps.Input, timestamps.Presented );
+
+	if ( m_samples.size() < m_capacity ) {
+		m_samples.push_back( sample );
+	} else {
+		m_samples[ m_next ] = sample;
+	}
+
+	m_next = ( m_next + 1 ) % m_capacity;
+}
+/*
+===============
+PresentTimings::Report
+
+	Writes the latency distributions of the kept frames
+===============
+*/
+void PresentTimings::Report( std::ostream& out ) const {
+	if ( m_samples.empty() ) {
+		return;
+	}
+
+	std::vector<float> acquire, submit, present;
+
+	acquire.reserve( m_samples.size() );
+	submit.reserve( m_samples.size() );
+	present.reserve( m_samples.size() );
+
+	for ( const Sample& sample : m_samples ) {
+		acquire.push_back( sample.AcquireMs );
+		submit.push_back( sample.SubmitMs );
+		present.push_back( sample.PresentMs );
+	}
+
+	out << "Present latency over the last " << m_samples.size() << " frames:" << std::endl;
+	ReportSeries( out, "input to acquire", acquire );
+	ReportSeries( out, "input to submit ", submit );
+	ReportSeries( out, "input to present", present );
+}
+/*
+===============
+PresentTimings::WriteCsv
+
+	Writes one line per kept frame, oldest first
+===============
+*/
+bool PresentTimings::WriteCsv( const std::string& filePath ) const {
+	std::ofstream file( filePath, std::ios::trunc );
+
+	if ( !file.is_open() ) {
+		return false;
+	}
+
+	file << "frame,acquire_ms,submit_ms,present_ms\n";
+
+	for ( const Sample& sample : OrderedSamples() ) {
+		file << sample.FrameIndex << "," << sample.AcquireMs << "," << sample.SubmitMs << "," << sample.PresentMs << "\n";
+	}
+
+	return !file.fail();
+}
+/*
+===============
+PresentTimings::OrderedSamples
+
+	Returns the kept frames in the order they were recorded
+===============
+*/
+std::vector<PresentTimings::Sample> PresentTimings::OrderedSamples( void ) const {
+	if ( m_samples.size() < m_capacity ) {
+		return m_samples;
+	}
+
+	std::vector<Sample> ordered( m_samples.begin() + m_next, m_samples.end() );
+	ordered.insert( ordered.end(), m_samples.begin(), m_samples.begin() + m_next );
+
+	return ordered;
+}
+}
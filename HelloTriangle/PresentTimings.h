@@ -0,0 +1,62 @@
+#ifndef __PRESENTTIMINGS_H__
+#define __PRESENTTIMINGS_H__
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tut {
+
+/*
+	CPU timestamps taken along one frame. Input is when the frame started,
+	right after window events were polled. Presented is when
+	vkQueuePresentKHR returned, which is the closest point to the screen the
+	core API exposes.
+*/
+struct PresentTimestamps {
+	uint64_t										FrameIndex	= 0;
+	std::chrono::high_resolution_clock::time_point	Input;
+	std::chrono::high_resolution_clock::time_point	Acquired;
+	std::chrono::high_resolution_clock::time_point	Submitted;
+	std::chrono::high_resolution_clock::time_point	Presented;
+};
+
+/*
+===============
+PresentTimings
+
+	Keeps the acquire, submit and present timestamps of the most recent
+	frames so latency distributions can be compared between present
+	policies. Reports percentiles and can dump every kept frame as CSV.
+===============
+*/
+class PresentTimings {
+public:
+												PresentTimings( size_t capacity );
+
+	void										Record( const PresentTimestamps& timestamps );
+
+	void										Report( std::ostream& out ) const;
+	bool										WriteCsv( const std::string& filePath ) const;
+
+private:
+	//Milliseconds since Input, floats keep a long history small
+	struct Sample {
+		uint64_t								FrameIndex;
+		float									AcquireMs;
+		float									SubmitMs;
+		float									PresentMs;
+	};
+
+	std::vector<Sample>							OrderedSamples( void ) const;
+
+	std::vector<Sample>							m_samples;
+	size_t										m_capacity;
+	size_t										m_next{ 0 };
+};
+
+}
+
+#endif // !__PRESENTTIMINGS_H__
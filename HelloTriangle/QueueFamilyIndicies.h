@@ -6,10 +6,18 @@ namespace tut {
 struct QueueFamilyIndicies {
 	int GraphicsFamily	= -1;
 	int PresentFamily	= -1;
+	//Families without graphics, for async compute and uploads. -1 when the device has none.
+	int ComputeFamily	= -1;
+	int TransferFamily	= -1;
 
 	bool IsComplete() {
 		return GraphicsFamily >= 0 && PresentFamily >= 0;
 	}
+
+	//Offscreen rendering has nothing to present to
+	bool HasGraphics() {
+		return GraphicsFamily >= 0;
+	}
 };
 
 }
@@ -0,0 +1,348 @@
+#include "ReadbackStage.h"
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include "DebugMessenger.h"
+
+namespace tut {
+/*
+===============
+ReadbackStage::ReadbackStage
+
+	Creates the staging ring and starts the completion thread
+===============
+*/
+ReadbackStage::ReadbackStage( VkDevice device, DeviceMemoryAllocator& deviceMemory, VkExtent2D extent, VkFormat format, uint32_t ringSize, uint32_t workerCount, ReadbackConsumer consumer ) :
+	m_device( device ),
+	m_deviceMemory( deviceMemory ),
+	m_extent( extent ),
+	m_format( format ),
+	m_frameBytes( ( VkDeviceSize )extent.width * extent.height * 4 ),
+	m_consumer( consumer ),
+	m_slots( ringSize ),
+	m_workers( workerCount )
+{
+	for ( Slot& slot : m_slots ) {
+		VkBufferCreateInfo bufferInfo = {};
+
+		bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size			= m_frameBytes;
+		bufferInfo.usage		= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+		slot.Buffer = VKBufferHandle( m_device );
+
+		if ( vkCreateBuffer( m_device, &bufferInfo, HostAllocator::Installed(), slot.Buffer.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create readback buffer" );
+		}
+
+		DebugMessenger::Name( m_device, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )slot.Buffer, "Readback staging" );
+
+		//Coherent so finished frames can be read without an invalidate, cached so reading them is fast
+		slot.Memory = m_deviceMemory.AllocateForBuffer( slot.Buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT );
+
+		VkFenceCreateInfo fenceInfo = {};
+
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		slot.Fence = VKFenceHandle( m_device );
+
+		if ( vkCreateFence( m_device, &fenceInfo, HostAllocator::Installed(), slot.Fence.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create readback fence" );
+		}
+	}
+
+	m_completionThread = std::thread( &ReadbackStage::CompletionMain, this );
+}
+/*
+===============
+ReadbackStage::~ReadbackStage
+
+	Waits for every submitted frame to be consumed
+===============
+*/
+ReadbackStage::~ReadbackStage( void ) {
+	Drain();
+
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+		m_stopping = true;
+	}
+
+	m_submitted.notify_all();
+	m_completionThread.join();
+
+	for ( Slot& slot : m_slots ) {
+		slot.Buffer.reset();
+		m_deviceMemory.Free( slot.Memory );
+	}
+}
+/*
+===============
+ReadbackStage::Acquire
+
+	Returns the next slot in the ring with its fence reset, blocking while
+	that slot's previous frame is still being rendered or consumed
+===============
+*/
+uint32_t ReadbackStage::Acquire( void ) {
+	uint32_t						slotIndex	= m_nextSlot;
+	Slot&							slot		= m_slots[ slotIndex ];
+	std::unique_lock<std::mutex>	lock( m_lock );
+
+	if ( slot.Busy ) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		m_slotReleased.wait( lock, [&slot]() { return !slot.Busy; } );
+
+		m_acquireStallMs += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	}
+
+	m_nextSlot = ( m_nextSlot + 1 ) % ( uint32_t )m_slots.size();
+
+	vkResetFences( m_device, 1, &slot.Fence );
+
+	return slotIndex;
+}
+/*
+===============
+ReadbackStage::RecordCopy
+
+	Copies an image in TRANSFER_SRC_OPTIMAL into the slot's staging buffer
+	and makes the result visible to the host
+===============
+*/
+void ReadbackStage::RecordCopy( VkCommandBuffer commandBuffer, VkImage image, uint32_t slot ) {
+	VkBufferImageCopy region = {};
+
+	region.imageSubresource.aspectMask	= VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount	= 1;
+	region.imageExtent					= { m_extent.width, m_extent.height, 1 };
+
+	vkCmdCopyImageToBuffer( commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_slots[ slot ].Buffer, 1, &region );
+
+	VkBufferMemoryBarrier hostBarrier = {};
+
+	hostBarrier.sType				= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask		= VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask		= VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex	= VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex	= VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer				= m_slots[ slot ].Buffer;
+	hostBarrier.size				= VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr );
+}
+/*
+===============
+ReadbackStage::Fence
+
+	Returns the fence the frame's submission must signal
+===============
+*/
+VkFence ReadbackStage::Fence( uint32_t slot ) const {
+	return m_slots[ slot ].Fence;
+}
+/*
+===============
+ReadbackStage::Buffer
+
+	Returns the staging buffer RecordCopy writes the slot's frame into
+===============
+*/
+VkBuffer ReadbackStage::Buffer( uint32_t slot ) const {
+	return m_slots[ slot ].Buffer;
+}
+/*
+===============
+ReadbackStage::Submit
+
+	Hands a submitted slot to the completion thread
+===============
+*/
+void ReadbackStage::Submit( uint32_t slot, uint64_t frameIndex ) {
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+
+		if ( m_completedFrames == 0 && m_pending.empty() ) {
+			m_firstSubmit = std::chrono::high_resolution_clock::now();
+		}
+
+		m_slots[ slot ].FrameIndex	= frameIndex;
+		m_slots[ slot ].Busy		= true;
+		m_pending.push_back( slot );
+	}
+
+	m_submitted.notify_one();
+}
+/*
+===============
+ReadbackStage::Drain
+
+	Blocks until every submitted frame has been consumed
+===============
+*/
+void ReadbackStage::Drain( void ) {
+	std::unique_lock<std::mutex> lock( m_lock );
+
+	m_slotReleased.wait( lock, [this]() {
+		for ( const Slot& slot : m_slots ) {
+			if ( slot.Busy ) {
+				return false;
+			}
+		}
+		return true;
+	} );
+}
+/*
+===============
+ReadbackStage::RingSize
+
+	Returns the number of staging buffers
+===============
+*/
+uint32_t ReadbackStage::RingSize( void ) const {
+	return ( uint32_t )m_slots.size();
+}
+/*
+===============
+ReadbackStage::Report
+
+	Writes the readback throughput
+===============
+*/
+void ReadbackStage::Report( std::ostream& out ) const {
+	uint64_t	frames	= m_completedFrames;
+	double		seconds	= frames == 0 ? 0.0 : std::chrono::duration<double>( m_lastCompletion - m_firstSubmit ).count();
+	double		mb		= frames * ( double )m_frameBytes / ( 1024.0 * 1024.0 );
+
+	out << "Readback: " << frames << " frames through a ring of " << m_slots.size() << " with "
+		<< m_workers.ThreadCount() << " workers, "
+		<< ( seconds > 0.0 ? frames / seconds : 0.0 ) << " frames/s, "
+		<< ( seconds > 0.0 ? mb / seconds : 0.0 ) << " MB/s, "
+		<< m_acquireStallMs << " ms stalled waiting for a free slot, " << m_failedFrames << " frames lost to failed fence waits" << std::endl;
+}
+/*
+===============
+ReadbackStage::WritePPM
+
+	Writes an 8 bit RGBA or BGRA frame as a binary PPM, dropping alpha
+===============
+*/
+void ReadbackStage::WritePPM( const ReadbackFrame& frame, const std::string& filePath ) {
+	bool					bgra = frame.Format == VK_FORMAT_B8G8R8A8_UNORM || frame.Format == VK_FORMAT_B8G8R8A8_SRGB;
+	std::vector<uint8_t>	rgb( ( size_t )frame.Width * frame.Height * 3 );
+
+	for ( uint32_t y = 0; y < frame.Height; ++y ) {
+		const uint8_t*	source		= frame.Pixels + ( size_t )y * frame.RowPitch;
+		uint8_t*		destination	= rgb.data() + ( size_t )y * frame.Width * 3;
+
+		for ( uint32_t x = 0; x < frame.Width; ++x ) {
+			destination[ x * 3 + 0 ] = source[ x * 4 + ( bgra ? 2 : 0 ) ];
+			destination[ x * 3 + 1 ] = source[ x * 4 + 1 ];
+			destination[ x * 3 + 2 ] = source[ x * 4 + ( bgra ? 0 : 2 ) ];
+		}
+	}
+
+	std::ofstream file( filePath, std::ios::binary | std::ios::trunc );
+
+	file << "P6\n" << frame.Width << " " << frame.Height << "\n255\n";
+	file.write( ( const char* )rgb.data(), rgb.size() );
+
+	if ( file.fail() ) {
+		std::cerr << "Could not write " << filePath << std::endl;
+	}
+}
+/*
+===============
+ReadbackStage::WriteRaw
+
+	Writes the frame's pixels exactly as they were read back
+===============
+*/
+void ReadbackStage::WriteRaw( const ReadbackFrame& frame, const std::string& filePath ) {
+	std::ofstream file( filePath, std::ios::binary | std::ios::trunc );
+
+	file.write( ( const char* )frame.Pixels, ( size_t )frame.RowPitch * frame.Height );
+
+	if ( file.fail() ) {
+		std::cerr << "Could not write " << filePath << std::endl;
+	}
+}
+/*
+===============
+ReadbackStage::CompletionMain
+
+	Waits on fences in submission order and queues the consumer for each
+	finished frame
+===============
+*/
+void ReadbackStage::CompletionMain( void ) {
+	for ( ;; ) {
+		uint32_t slotIndex;
+
+		{
+			std::unique_lock<std::mutex> lock( m_lock );
+			m_submitted.wait( lock, [this]() { return m_stopping || !m_pending.empty(); } );
+
+			if ( m_pending.empty() ) {
+				return;
+			}
+
+			slotIndex = m_pending.front();
+			m_pending.pop_front();
+		}
+
+		Slot& slot = m_slots[ slotIndex ];
+
+		if ( vkWaitForFences( m_device, 1, &slot.Fence, VK_TRUE, std::numeric_limits<uint64_t>::max() ) != VK_SUCCESS ) {
+			std::cerr << "Waiting for readback of frame " << slot.FrameIndex << " failed" << std::endl;
+			Release( slotIndex, false );
+			continue;
+		}
+
+		ReadbackFrame frame;
+
+		frame.FrameIndex	= slot.FrameIndex;
+		frame.Pixels		= ( const uint8_t* )slot.Memory->Mapped;
+		frame.Width			= m_extent.width;
+		frame.Height		= m_extent.height;
+		frame.RowPitch		= m_extent.width * 4;
+		frame.Format		= m_format;
+
+		m_workers.Enqueue( [this, frame, slotIndex]() {
+			if ( m_consumer ) {
+				m_consumer( frame );
+			}
+			Release( slotIndex, true );
+		} );
+	}
+}
+/*
+===============
+ReadbackStage::Release
+
+	Returns a slot to the ring, counting its frame as completed only if it
+	reached the consumer
+===============
+*/
+void ReadbackStage::Release( uint32_t slot, bool completed ) {
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+
+		m_slots[ slot ].Busy = false;
+
+		if ( completed ) {
+			m_lastCompletion = std::chrono::high_resolution_clock::now();
+			++m_completedFrames;
+		} else {
+			++m_failedFrames;
+		}
+	}
+
+	m_slotReleased.notify_all();
+}
+}
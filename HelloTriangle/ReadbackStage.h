@@ -0,0 +1,109 @@
+#ifndef __READBACKSTAGE_H__
+#define __READBACKSTAGE_H__
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DeviceMemoryAllocator.h"
+#include "ThreadPool.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+	A finished frame in host memory. Pixels point into a mapped staging
+	buffer and are only valid for the duration of the consumer call.
+*/
+struct ReadbackFrame {
+	uint64_t				FrameIndex	= 0;
+	const uint8_t*			Pixels		= nullptr;
+	uint32_t				Width		= 0;
+	uint32_t				Height		= 0;
+	uint32_t				RowPitch	= 0;
+	VkFormat				Format		= VK_FORMAT_UNDEFINED;
+};
+
+typedef std::function<void( const ReadbackFrame& )>	ReadbackConsumer;
+
+/*
+===============
+ReadbackStage
+
+	Ring of persistently mapped staging buffers that frames are copied into.
+	A completion thread waits on each slot's fence in submission order and
+	hands the frame to the consumer on a worker pool, so frame K+N renders
+	while frame K is being read. A slot is reused only once its consumer has
+	returned.
+===============
+*/
+class ReadbackStage {
+public:
+											ReadbackStage( VkDevice device, DeviceMemoryAllocator& deviceMemory, VkExtent2D extent, VkFormat format, uint32_t ringSize, uint32_t workerCount, ReadbackConsumer consumer );
+											~ReadbackStage( void );
+
+	ReadbackStage( const ReadbackStage& ) = delete;
+	ReadbackStage& operator=( const ReadbackStage& ) = delete;
+
+	uint32_t								Acquire( void );
+	void									RecordCopy( VkCommandBuffer commandBuffer, VkImage image, uint32_t slot );
+	VkFence									Fence( uint32_t slot ) const;
+	VkBuffer								Buffer( uint32_t slot ) const;
+	void									Submit( uint32_t slot, uint64_t frameIndex );
+	void									Drain( void );
+
+	uint32_t								RingSize( void ) const;
+	void									Report( std::ostream& out ) const;
+
+	static void								WritePPM( const ReadbackFrame& frame, const std::string& filePath );
+	static void								WriteRaw( const ReadbackFrame& frame, const std::string& filePath );
+
+private:
+	struct Slot {
+		VKBufferHandle						Buffer;
+		DeviceAllocation*					Memory		= nullptr;
+		VKFenceHandle						Fence;
+		uint64_t							FrameIndex	= 0;
+		bool								Busy		= false;
+	};
+
+	void									CompletionMain( void );
+	void									Release( uint32_t slot, bool completed );
+
+	VkDevice								m_device;
+	DeviceMemoryAllocator&					m_deviceMemory;
+	VkExtent2D								m_extent;
+	VkFormat								m_format;
+	VkDeviceSize							m_frameBytes;
+	ReadbackConsumer						m_consumer;
+
+	std::vector<Slot>						m_slots;
+	uint32_t								m_nextSlot{ 0 };
+
+	std::mutex								m_lock;
+	std::condition_variable					m_slotReleased;
+	std::condition_variable					m_submitted;
+	std::deque<uint32_t>					m_pending;
+	bool									m_stopping{ false };
+
+	std::thread								m_completionThread;
+	ThreadPool								m_workers;
+
+	std::chrono::high_resolution_clock::time_point	m_firstSubmit;
+	std::chrono::high_resolution_clock::time_point	m_lastCompletion;
+	std::atomic<uint64_t>					m_completedFrames{ 0 };
+	std::atomic<uint64_t>					m_failedFrames{ 0 };		//Fence waits that failed, the frame never reached the consumer
+	double									m_acquireStallMs{ 0.0 };
+};
+
+}
+
+#endif // !__READBACKSTAGE_H__
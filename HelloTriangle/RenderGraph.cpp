@@ -0,0 +1,873 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+#include "DebugMessenger.h"
+#include "HostAllocator.h"
+
+namespace tut {
+
+namespace {
+
+const uint32_t UNUSED_PASS{ std::numeric_limits<uint32_t>::max() };
+
+struct AccessInfo {
+	const char*				Name;
+	VkPipelineStageFlags	Stages;
+	VkAccessFlags			Access;
+	VkImageLayout			Layout;
+	VkImageUsageFlags		Usage;
+	bool					Write;
+};
+
+//Indexed by RenderGraphAccess
+const AccessInfo ACCESS_INFO[] = {
+	{ "None",					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,				0,																				VK_IMAGE_LAYOUT_UNDEFINED,							0,												false },
+	{ "Acquire",				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,	0,																				VK_IMAGE_LAYOUT_UNDEFINED,							0,												false },
+	{ "ColorAttachmentWrite",	VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,	VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,			true },
+	{ "DepthAttachmentWrite",	VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+																				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+																																								VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,	VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,	true },
+	{ "VertexShaderRead",		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,			VK_ACCESS_SHADER_READ_BIT,														VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,			VK_IMAGE_USAGE_SAMPLED_BIT,						false },
+	{ "FragmentShaderRead",		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,			VK_ACCESS_SHADER_READ_BIT,														VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,			VK_IMAGE_USAGE_SAMPLED_BIT,						false },
+	{ "ComputeRead",			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,			VK_ACCESS_SHADER_READ_BIT,														VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,			VK_IMAGE_USAGE_SAMPLED_BIT,						false },
+	{ "ComputeWrite",			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,							VK_IMAGE_LAYOUT_GENERAL,							VK_IMAGE_USAGE_STORAGE_BIT,						true },
+	{ "IndirectRead",			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,			VK_ACCESS_INDIRECT_COMMAND_READ_BIT,											VK_IMAGE_LAYOUT_UNDEFINED,							0,												false },
+	{ "TransferRead",			VK_PIPELINE_STAGE_TRANSFER_BIT,					VK_ACCESS_TRANSFER_READ_BIT,													VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,				VK_IMAGE_USAGE_TRANSFER_SRC_BIT,				false },
+	{ "TransferWrite",			VK_PIPELINE_STAGE_TRANSFER_BIT,					VK_ACCESS_TRANSFER_WRITE_BIT,													VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,				VK_IMAGE_USAGE_TRANSFER_DST_BIT,				true },
+	{ "Present",				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,			0,																				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,					0,												false }
+};
+
+const AccessInfo& Info( RenderGraphAccess access ) {
+	return ACCESS_INFO[ ( size_t )access ];
+}
+
+VkImageAspectFlags AspectMask( VkFormat format ) {
+	switch ( format ) {
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+VkDeviceSize AlignUp( VkDeviceSize value, VkDeviceSize alignment ) {
+	return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+}
+
+/*
+===============
+RenderGraph::RenderGraph
+===============
+*/
+RenderGraph::RenderGraph( VkDevice device, DeviceMemoryAllocator& deviceMemory, DeletionQueue& deletionQueue ) :
+	m_device( device ),
+	m_deviceMemory( deviceMemory ),
+	m_deletionQueue( deletionQueue )
+{
+	static_assert( sizeof( ACCESS_INFO ) / sizeof( ACCESS_INFO[ 0 ] ) == ( size_t )RenderGraphAccess::Present + 1, "ACCESS_INFO must cover every RenderGraphAccess" );
+}
+/*
+===============
+RenderGraph::~RenderGraph
+
+	The device must be idle, transient memory is freed right away
+===============
+*/
+RenderGraph::~RenderGraph( void ) {
+	m_transients.clear();
+
+	if ( m_transientMemory != nullptr ) {
+		m_deviceMemory.Free( m_transientMemory );
+	}
+}
+/*
+===============
+RenderGraph::Reset
+
+	Drops the previous frame's declarations. The compiled schedule stays
+	until Compile finds the new declarations differ.
+===============
+*/
+void RenderGraph::Reset( void ) {
+	m_resources.clear();
+	m_passes.clear();
+	m_topology.clear();
+}
+/*
+===============
+RenderGraph::ImportImage
+
+	Declares an image owned outside the graph. It comes in as initialAccess
+	left it and is transitioned to finalAccess's layout after the last pass
+	using it. Passes writing an imported resource are never culled.
+===============
+*/
+RenderGraphResource RenderGraph::ImportImage( const char* name, VkImage image, const RenderGraphImageDesc& desc, RenderGraphAccess initialAccess, RenderGraphAccess finalAccess ) {
+	Resource resource;
+
+	resource.Name			= name;
+	resource.Kind			= ResourceKind::ImportedImage;
+	resource.Desc			= desc;
+	resource.InitialAccess	= initialAccess;
+	resource.FinalAccess	= finalAccess;
+	resource.Image			= image;
+
+	m_topology.insert( m_topology.end(), { ( uint64_t )resource.Kind, ( uint64_t )desc.Format, desc.Extent.width | ( ( uint64_t )desc.Extent.height << 32 ), ( uint64_t )initialAccess, ( uint64_t )finalAccess } );
+	m_resources.push_back( resource );
+
+	return ( RenderGraphResource )m_resources.size() - 1;
+}
+/*
+===============
+RenderGraph::ImportBuffer
+
+	Declares a buffer owned outside the graph, last accessed as
+	initialAccess. Buffers have no layout, so nothing follows the last pass.
+===============
+*/
+RenderGraphResource RenderGraph::ImportBuffer( const char* name, VkBuffer buffer, RenderGraphAccess initialAccess ) {
+	Resource resource;
+
+	resource.Name			= name;
+	resource.Kind			= ResourceKind::ImportedBuffer;
+	resource.InitialAccess	= initialAccess;
+	resource.Buffer			= buffer;
+
+	m_topology.insert( m_topology.end(), { ( uint64_t )resource.Kind, ( uint64_t )initialAccess } );
+	m_resources.push_back( resource );
+
+	return ( RenderGraphResource )m_resources.size() - 1;
+}
+/*
+===============
+RenderGraph::CreateImage
+
+	Declares an image that only lives within the frame. Its usage flags come
+	from how the passes access it, its contents are undefined at the first
+	pass using it, and it may share memory with other transient images.
+===============
+*/
+RenderGraphResource RenderGraph::CreateImage( const char* name, const RenderGraphImageDesc& desc ) {
+	Resource resource;
+
+	resource.Name	= name;
+	resource.Kind	= ResourceKind::TransientImage;
+	resource.Desc	= desc;
+
+	m_topology.insert( m_topology.end(), { ( uint64_t )resource.Kind, ( uint64_t )desc.Format, desc.Extent.width | ( ( uint64_t )desc.Extent.height << 32 ) } );
+	m_resources.push_back( resource );
+
+	return ( RenderGraphResource )m_resources.size() - 1;
+}
+/*
+===============
+RenderGraph::AddPass
+
+	Declares a pass. record is called from Execute, after the barriers the
+	pass needs, and must record outside any render pass it does not begin
+	itself.
+===============
+*/
+RenderGraphPass RenderGraph::AddPass( const char* name, const RecordPass& record ) {
+	Pass pass;
+
+	pass.Name	= name;
+	pass.Record	= record;
+
+	m_topology.push_back( ~0ull );
+	m_passes.push_back( pass );
+
+	return ( RenderGraphPass )m_passes.size() - 1;
+}
+/*
+===============
+RenderGraph::Read
+===============
+*/
+void RenderGraph::Read( RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access ) {
+	AddUse( pass, resource, access, false );
+}
+/*
+===============
+RenderGraph::Write
+===============
+*/
+void RenderGraph::Write( RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access ) {
+	AddUse( pass, resource, access, true );
+}
+/*
+===============
+RenderGraph::AddUse
+===============
+*/
+void RenderGraph::AddUse( RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access, bool write ) {
+	if ( pass >= m_passes.size() || resource >= m_resources.size() ) {
+		throw std::runtime_error( "Render graph use refers to an undeclared pass or resource" );
+	}
+
+	if ( Info( access ).Write != write || access == RenderGraphAccess::None || access == RenderGraphAccess::Acquire || access == RenderGraphAccess::Present ) {
+		throw std::runtime_error( std::string( "Pass " ) + m_passes[ pass ].Name + " cannot " + ( write ? "write " : "read " ) + m_resources[ resource ].Name + " as " + AccessName( access ) );
+	}
+
+	Use use = { resource, access };
+
+	m_passes[ pass ].Uses.push_back( use );
+	m_topology.push_back( ( ( uint64_t )pass << 40 ) | ( ( uint64_t )resource << 8 ) | ( uint64_t )access );
+}
+/*
+===============
+RenderGraph::Compile
+
+	Turns this frame's declarations into a schedule, unless they match the
+	ones last compiled, in which case the schedule and transient images are
+	reused as they are
+===============
+*/
+void RenderGraph::Compile( void ) {
+	m_stats.DeclaredPasses = ( uint32_t )m_passes.size();
+
+	if ( m_compiled && m_topology == m_compiledTopology ) {
+		++m_stats.CacheHits;
+
+		for ( const Transient& transient : m_transients ) {
+			m_resources[ transient.Resource ].Image	= transient.Image;
+			m_resources[ transient.Resource ].View	= transient.View;
+		}
+
+		return;
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	ReleaseTransients();
+
+	std::vector<bool> alive;
+
+	CullPasses( alive );
+
+	m_schedule.clear();
+	m_culled.clear();
+
+	for ( uint32_t i = 0; i < m_passes.size(); ++i ) {
+		if ( alive[ i ] ) {
+			ScheduledPass scheduled;
+
+			scheduled.Pass = i;
+			m_schedule.push_back( scheduled );
+		} else {
+			m_culled.push_back( i );
+		}
+	}
+
+	CreateTransients();
+	PlaceTransients();
+	BuildBarriers();
+
+	m_compiledTopology	= m_topology;
+	m_compiled			= true;
+
+	m_stats.CulledPasses	= ( uint32_t )m_culled.size();
+	m_stats.BarrierCalls	= 0;
+	m_stats.ImageBarriers	= 0;
+
+	for ( const ScheduledPass& scheduled : m_schedule ) {
+		m_stats.BarrierCalls	+= scheduled.Barriers.SrcStages != 0 ? 1 : 0;
+		m_stats.ImageBarriers	+= ( uint32_t )scheduled.Barriers.Images.size();
+	}
+
+	m_stats.BarrierCalls	+= m_finalBarriers.SrcStages != 0 ? 1 : 0;
+	m_stats.ImageBarriers	+= ( uint32_t )m_finalBarriers.Images.size();
+
+	++m_stats.Compiles;
+	m_stats.LastCompileMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+}
+/*
+===============
+RenderGraph::Execute
+
+	Records the compiled schedule: each pass's batched barrier, then the
+	pass itself, then the transitions imported images end the frame with
+===============
+*/
+void RenderGraph::Execute( VkCommandBuffer commandBuffer ) {
+	if ( !m_compiled || m_topology != m_compiledTopology ) {
+		throw std::runtime_error( "Render graph must be compiled before it is executed" );
+	}
+
+	for ( const ScheduledPass& scheduled : m_schedule ) {
+		RecordBarriers( commandBuffer, scheduled.Barriers );
+		m_passes[ scheduled.Pass ].Record( commandBuffer );
+	}
+
+	RecordBarriers( commandBuffer, m_finalBarriers );
+}
+/*
+===============
+RenderGraph::Image
+
+	Returns the image behind a resource; transient images exist once the
+	graph has been compiled
+===============
+*/
+VkImage RenderGraph::Image( RenderGraphResource resource ) const {
+	return m_resources[ resource ].Image;
+}
+/*
+===============
+RenderGraph::ImageView
+
+	Returns the view of a transient image, imported images have none
+===============
+*/
+VkImageView RenderGraph::ImageView( RenderGraphResource resource ) const {
+	return m_resources[ resource ].View;
+}
+/*
+===============
+RenderGraph::Buffer
+===============
+*/
+VkBuffer RenderGraph::Buffer( RenderGraphResource resource ) const {
+	return m_resources[ resource ].Buffer;
+}
+/*
+===============
+RenderGraph::GetStats
+===============
+*/
+RenderGraphStats RenderGraph::GetStats( void ) const {
+	return m_stats;
+}
+/*
+===============
+RenderGraph::WriteSchedule
+
+	Writes the compiled schedule: the barrier batch before each pass with
+	the dependencies it covers, the culled passes and where each transient
+	image sits in the shared allocation
+===============
+*/
+void RenderGraph::WriteSchedule( std::ostream& out ) const {
+	out << "Render graph schedule: " << m_schedule.size() << " of " << m_passes.size() << " passes, " << m_stats.BarrierCalls << " barrier calls, "
+		<< m_stats.ImageBarriers << " image barriers" << std::endl;
+
+	for ( size_t i = 0; i < m_schedule.size(); ++i ) {
+		const Pass& pass = m_passes[ m_schedule[ i ].Pass ];
+
+		out << "  " << i << ": " << pass.Name << std::endl;
+		WriteBarriers( out, m_schedule[ i ].Barriers );
+
+		for ( const Use& use : pass.Uses ) {
+			out << "      " << ( Info( use.Access ).Write ? "writes " : "reads  " ) << m_resources[ use.Resource ].Name << " as " << AccessName( use.Access ) << std::endl;
+		}
+	}
+
+	if ( m_finalBarriers.SrcStages != 0 ) {
+		out << "  end of frame" << std::endl;
+		WriteBarriers( out, m_finalBarriers );
+	}
+
+	for ( uint32_t culled : m_culled ) {
+		out << "  culled: " << m_passes[ culled ].Name << std::endl;
+	}
+
+	for ( const Transient& transient : m_transients ) {
+		if ( transient.FirstPass == UNUSED_PASS ) {
+			out << "  transient " << m_resources[ transient.Resource ].Name << ": unused" << std::endl;
+			continue;
+		}
+
+		out << "  transient " << m_resources[ transient.Resource ].Name << ": passes " << transient.FirstPass << "-" << transient.LastPass
+			<< ", " << transient.Requirements.size / 1024 << " KB at offset " << transient.Offset / 1024 << " KB" << std::endl;
+	}
+
+	if ( m_stats.TransientBytes > 0 ) {
+		out << "  transient memory: " << m_stats.TransientBytes / ( 1024.0 * 1024.0 ) << " MB unaliased, " << m_stats.AliasedBytes / ( 1024.0 * 1024.0 ) << " MB aliased, "
+			<< 100.0 * ( m_stats.TransientBytes - m_stats.AliasedBytes ) / m_stats.TransientBytes << "% saved" << std::endl;
+	}
+}
+/*
+===============
+RenderGraph::Report
+===============
+*/
+void RenderGraph::Report( std::ostream& out ) const {
+	out << "Render graph: " << m_stats.DeclaredPasses - m_stats.CulledPasses << " passes, " << m_stats.CulledPasses << " culled, "
+		<< m_stats.BarrierCalls << " barrier calls per frame, " << m_stats.Compiles << " compiles, " << m_stats.CacheHits << " cache hits, last compile "
+		<< m_stats.LastCompileMs << " ms, " << m_stats.TransientImages << " transient images in " << m_stats.AliasedBytes / ( 1024.0 * 1024.0 ) << " MB of "
+		<< m_stats.TransientBytes / ( 1024.0 * 1024.0 ) << " MB" << std::endl;
+}
+/*
+===============
+RenderGraph::AccessName
+===============
+*/
+const char* RenderGraph::AccessName( RenderGraphAccess access ) {
+	return Info( access ).Name;
+}
+/*
+===============
+RenderGraph::CullPasses
+
+	Walks the passes backwards keeping those that write an imported resource
+	or something a kept pass reads. Everything a kept pass reads becomes
+	needed in turn.
+===============
+*/
+void RenderGraph::CullPasses( std::vector<bool>& alive ) const {
+	std::vector<bool> needed( m_resources.size(), false );
+
+	alive.assign( m_passes.size(), false );
+
+	for ( size_t i = m_passes.size(); i-- > 0; ) {
+		for ( const Use& use : m_passes[ i ].Uses ) {
+			if ( Info( use.Access ).Write && ( needed[ use.Resource ] || m_resources[ use.Resource ].Kind != ResourceKind::TransientImage ) ) {
+				alive[ i ] = true;
+				break;
+			}
+		}
+
+		if ( !alive[ i ] ) {
+			continue;
+		}
+
+		for ( const Use& use : m_passes[ i ].Uses ) {
+			if ( !Info( use.Access ).Write ) {
+				needed[ use.Resource ] = true;
+			}
+		}
+	}
+}
+/*
+===============
+RenderGraph::CreateTransients
+
+	Creates an image for every transient resource a scheduled pass uses,
+	with the union of the usages the passes need, and records the span of
+	the schedule it is alive for
+===============
+*/
+void RenderGraph::CreateTransients( void ) {
+	for ( RenderGraphResource i = 0; i < m_resources.size(); ++i ) {
+		if ( m_resources[ i ].Kind != ResourceKind::TransientImage ) {
+			continue;
+		}
+
+		m_resources[ i ].Transient = ( uint32_t )m_transients.size();
+		m_transients.emplace_back();
+
+		Transient& transient = m_transients.back();
+
+		transient.Resource	= i;
+		transient.FirstPass	= UNUSED_PASS;
+	}
+
+	for ( uint32_t i = 0; i < m_schedule.size(); ++i ) {
+		for ( const Use& use : m_passes[ m_schedule[ i ].Pass ].Uses ) {
+			const Resource& resource = m_resources[ use.Resource ];
+
+			if ( resource.Kind != ResourceKind::TransientImage ) {
+				continue;
+			}
+
+			Transient& transient = m_transients[ resource.Transient ];
+
+			transient.Usage		|= Info( use.Access ).Usage;
+			transient.FirstPass	= std::min( transient.FirstPass, i );
+			transient.LastPass	= i;
+		}
+	}
+
+	for ( Transient& transient : m_transients ) {
+		if ( transient.FirstPass == UNUSED_PASS ) {
+			continue;
+		}
+
+		Resource&			resource	= m_resources[ transient.Resource ];
+		VkImageCreateInfo	imageInfo	= {};
+
+		imageInfo.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType		= VK_IMAGE_TYPE_2D;
+		imageInfo.format		= resource.Desc.Format;
+		imageInfo.extent		= { resource.Desc.Extent.width, resource.Desc.Extent.height, 1 };
+		imageInfo.mipLevels		= 1;
+		imageInfo.arrayLayers	= 1;
+		imageInfo.samples		= VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling		= VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage			= transient.Usage;
+		imageInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+
+		transient.Image = VKImageHandle( m_device );
+
+		if ( vkCreateImage( m_device, &imageInfo, HostAllocator::Installed(), transient.Image.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create transient image " + resource.Name );
+		}
+
+		DebugMessenger::Name( m_device, VK_OBJECT_TYPE_IMAGE, ( VkImage )transient.Image, resource.Name.c_str() );
+
+		vkGetImageMemoryRequirements( m_device, transient.Image, &transient.Requirements );
+
+		resource.Image = transient.Image;
+	}
+}
+/*
+===============
+RenderGraph::PlaceTransients
+
+	Packs the transient images into one allocation. Largest first, each
+	image takes the lowest offset that does not overlap an image already
+	placed whose lifetime overlaps its own, so images alive at different
+	times end up on the same memory.
+===============
+*/
+void RenderGraph::PlaceTransients( void ) {
+	std::vector<Transient*> order;
+
+	m_stats.TransientImages	= 0;
+	m_stats.TransientBytes	= 0;
+	m_stats.AliasedBytes	= 0;
+
+	for ( Transient& transient : m_transients ) {
+		if ( transient.FirstPass != UNUSED_PASS ) {
+			order.push_back( &transient );
+		}
+	}
+
+	if ( order.empty() ) {
+		return;
+	}
+
+	std::sort( order.begin(), order.end(), []( const Transient* a, const Transient* b ) {
+		return a->Requirements.size > b->Requirements.size;
+	} );
+
+	VkMemoryRequirements heapRequirements = {};
+
+	heapRequirements.alignment		= 1;
+	heapRequirements.memoryTypeBits	= ~0u;
+
+	for ( size_t i = 0; i < order.size(); ++i ) {
+		Transient&		transient	= *order[ i ];
+		VkDeviceSize	offset		= 0;
+		bool			moved		= true;
+
+		//Bump past every conflicting image until a pass finds none
+		while ( moved ) {
+			moved = false;
+
+			for ( size_t j = 0; j < i; ++j ) {
+				const Transient& placed = *order[ j ];
+
+				bool livesTogether	= transient.FirstPass <= placed.LastPass && placed.FirstPass <= transient.LastPass;
+				bool sharesMemory	= offset < placed.Offset + placed.Requirements.size && placed.Offset < offset + transient.Requirements.size;
+
+				if ( livesTogether && sharesMemory ) {
+					offset	= AlignUp( placed.Offset + placed.Requirements.size, transient.Requirements.alignment );
+					moved	= true;
+				}
+			}
+		}
+
+		transient.Offset = offset;
+
+		heapRequirements.size			= std::max( heapRequirements.size, offset + transient.Requirements.size );
+		heapRequirements.alignment		= std::max( heapRequirements.alignment, transient.Requirements.alignment );
+		heapRequirements.memoryTypeBits	&= transient.Requirements.memoryTypeBits;
+
+		++m_stats.TransientImages;
+		m_stats.TransientBytes += transient.Requirements.size;
+	}
+
+	if ( heapRequirements.memoryTypeBits == 0 ) {
+		throw std::runtime_error( "Transient images have no memory type in common" );
+	}
+
+	m_transientMemory		= m_deviceMemory.Allocate( heapRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, DeviceResourceKind::Optimal );
+	m_stats.AliasedBytes	= heapRequirements.size;
+
+	for ( Transient* transient : order ) {
+		Resource& resource = m_resources[ transient->Resource ];
+
+		if ( vkBindImageMemory( m_device, transient->Image, m_transientMemory->Memory, m_transientMemory->Offset + transient->Offset ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not bind transient image " + resource.Name );
+		}
+
+		VkImageViewCreateInfo viewInfo = {};
+
+		viewInfo.sType								= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image								= transient->Image;
+		viewInfo.viewType							= VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format								= resource.Desc.Format;
+		viewInfo.subresourceRange.aspectMask		= AspectMask( resource.Desc.Format );
+		viewInfo.subresourceRange.levelCount		= 1;
+		viewInfo.subresourceRange.layerCount		= 1;
+
+		transient->View = VKImageViewHandle( m_device );
+
+		if ( vkCreateImageView( m_device, &viewInfo, HostAllocator::Installed(), transient->View.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create transient image view " + resource.Name );
+		}
+
+		resource.View = transient->View;
+	}
+}
+/*
+===============
+RenderGraph::BuildBarriers
+
+	Replays the schedule tracking each resource's layout, last write and
+	reads since, and gathers the barriers every pass needs into one batch.
+
+	A transient image starts out waiting on the last use of the images it
+	shares memory with: those earlier in the frame, or when it is the first
+	on its memory, those of the previous frame, which ran the same schedule.
+===============
+*/
+void RenderGraph::BuildBarriers( void ) {
+	std::vector<TrackedState>			states( m_resources.size() );
+	std::vector<VkPipelineStageFlags>	lastStages( m_transients.size(), 0 );
+	std::vector<VkAccessFlags>			lastWrites( m_transients.size(), 0 );
+
+	for ( uint32_t i = 0; i < m_schedule.size(); ++i ) {
+		for ( const Use& use : m_passes[ m_schedule[ i ].Pass ].Uses ) {
+			const Resource& resource = m_resources[ use.Resource ];
+
+			if ( resource.Kind == ResourceKind::TransientImage && m_transients[ resource.Transient ].LastPass == i ) {
+				lastStages[ resource.Transient ] |= Info( use.Access ).Stages;
+				lastWrites[ resource.Transient ] |= Info( use.Access ).Write ? Info( use.Access ).Access : 0;
+			}
+		}
+	}
+
+	for ( RenderGraphResource i = 0; i < m_resources.size(); ++i ) {
+		const Resource&	resource	= m_resources[ i ];
+		TrackedState&	state		= states[ i ];
+
+		if ( resource.Kind != ResourceKind::TransientImage ) {
+			const AccessInfo& initial = Info( resource.InitialAccess );
+
+			state.Layout		= resource.Kind == ResourceKind::ImportedImage ? initial.Layout : VK_IMAGE_LAYOUT_UNDEFINED;
+			state.LastAccess	= resource.InitialAccess;
+
+			if ( initial.Write ) {
+				state.WriteStages	= initial.Stages;
+				state.WriteAccess	= initial.Access;
+			} else {
+				state.ReadStages	= initial.Stages;
+			}
+
+			continue;
+		}
+
+		const Transient& transient = m_transients[ resource.Transient ];
+
+		if ( transient.FirstPass == UNUSED_PASS ) {
+			continue;
+		}
+
+		bool earlier = false;
+
+		for ( const Transient& other : m_transients ) {
+			if ( &other != &transient && other.FirstPass != UNUSED_PASS && other.LastPass < transient.FirstPass && Overlaps( transient, other ) ) {
+				earlier = true;
+			}
+		}
+
+		for ( uint32_t j = 0; j < m_transients.size(); ++j ) {
+			const Transient&	other		= m_transients[ j ];
+			bool				previous	= earlier ? other.LastPass < transient.FirstPass : other.LastPass >= transient.FirstPass;
+
+			if ( other.FirstPass != UNUSED_PASS && previous && Overlaps( transient, other ) ) {
+				state.ReadStages	|= lastStages[ j ];
+				state.WriteAccess	|= lastWrites[ j ];
+			}
+		}
+
+		state.Aliased = true;
+	}
+
+	for ( ScheduledPass& scheduled : m_schedule ) {
+		for ( const Use& use : m_passes[ scheduled.Pass ].Uses ) {
+			Transition( scheduled.Barriers, use.Resource, states[ use.Resource ], use.Access );
+		}
+	}
+
+	m_finalBarriers = BarrierBatch();
+
+	for ( RenderGraphResource i = 0; i < m_resources.size(); ++i ) {
+		const Resource& resource = m_resources[ i ];
+
+		if ( resource.Kind == ResourceKind::ImportedImage && states[ i ].Layout != Info( resource.FinalAccess ).Layout ) {
+			Transition( m_finalBarriers, i, states[ i ], resource.FinalAccess );
+		}
+	}
+}
+/*
+===============
+RenderGraph::Transition
+
+	Adds what one access needs to a batch. A read after a write needs the
+	write made visible to its stage, once; a write or a layout change waits
+	for the last write and every read since. Reads of a layout already in
+	place need nothing.
+===============
+*/
+void RenderGraph::Transition( BarrierBatch& batch, RenderGraphResource resource, TrackedState& state, RenderGraphAccess access ) const {
+	const AccessInfo&	info			= Info( access );
+	bool				image			= m_resources[ resource ].Kind != ResourceKind::ImportedBuffer;
+	bool				layoutChange	= image && info.Layout != state.Layout;
+	Dependency			dependency		= { resource, state.LastAccess, access, state.Aliased };
+
+	state.LastAccess	= access;
+	state.Aliased		= false;
+
+	if ( !info.Write && !layoutChange ) {
+		bool visible = ( state.VisibleStages & info.Stages ) == info.Stages && ( state.VisibleAccess & info.Access ) == info.Access;
+
+		if ( state.WriteStages != 0 && !visible ) {
+			batch.SrcStages	|= state.WriteStages;
+			batch.SrcAccess	|= state.WriteAccess;
+			batch.DstStages	|= info.Stages;
+			batch.DstAccess	|= info.Access;
+			batch.Dependencies.push_back( dependency );
+
+			state.VisibleStages |= info.Stages;
+			state.VisibleAccess |= info.Access;
+		}
+
+		state.ReadStages |= info.Stages;
+		return;
+	}
+
+	VkPipelineStageFlags	srcStages	= state.WriteStages | state.ReadStages;
+	bool					waits		= ( srcStages & ~VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT ) != 0 || state.WriteAccess != 0;
+
+	if ( layoutChange ) {
+		ImageTransition transition = { resource, dependency.Aliased ? VK_IMAGE_LAYOUT_UNDEFINED : state.Layout, info.Layout, state.WriteAccess, info.Access };
+
+		batch.Images.push_back( transition );
+		batch.SrcStages |= srcStages != 0 ? srcStages : ( VkPipelineStageFlags )VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		batch.DstStages |= info.Stages;
+		batch.Dependencies.push_back( dependency );
+	} else if ( waits ) {
+		batch.SrcStages	|= srcStages;
+		batch.SrcAccess	|= state.WriteAccess;
+		batch.DstStages	|= info.Stages;
+		batch.DstAccess	|= info.Access;
+		batch.Dependencies.push_back( dependency );
+	}
+
+	//A layout transition is a write as far as later accesses are concerned
+	state.Layout		= image ? info.Layout : state.Layout;
+	state.WriteStages	= info.Stages;
+	state.WriteAccess	= info.Write ? info.Access : 0;
+	state.ReadStages	= info.Write ? 0 : info.Stages;
+	state.VisibleStages	= info.Stages;
+	state.VisibleAccess	= info.Access;
+}
+/*
+===============
+RenderGraph::RecordBarriers
+
+	Records a batch as a single vkCmdPipelineBarrier: buffers and images
+	keeping their layout share one global memory barrier, layout changes
+	get an image barrier each
+===============
+*/
+void RenderGraph::RecordBarriers( VkCommandBuffer commandBuffer, const BarrierBatch& batch ) const {
+	if ( batch.SrcStages == 0 ) {
+		return;
+	}
+
+	VkMemoryBarrier						memoryBarrier	= {};
+	std::vector<VkImageMemoryBarrier>	imageBarriers( batch.Images.size() );
+
+	memoryBarrier.sType			= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask	= batch.SrcAccess;
+	memoryBarrier.dstAccessMask	= batch.DstAccess;
+
+	for ( size_t i = 0; i < batch.Images.size(); ++i ) {
+		const ImageTransition&	transition	= batch.Images[ i ];
+		const Resource&			resource	= m_resources[ transition.Resource ];
+		VkImageMemoryBarrier&	barrier		= imageBarriers[ i ];
+
+		barrier.sType							= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask					= transition.SrcAccess;
+		barrier.dstAccessMask					= transition.DstAccess;
+		barrier.oldLayout						= transition.OldLayout;
+		barrier.newLayout						= transition.NewLayout;
+		barrier.srcQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+		barrier.image							= resource.Image;
+		barrier.subresourceRange.aspectMask		= AspectMask( resource.Desc.Format );
+		barrier.subresourceRange.levelCount		= VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.layerCount		= VK_REMAINING_ARRAY_LAYERS;
+	}
+
+	uint32_t memoryBarrierCount = ( batch.SrcAccess | batch.DstAccess ) != 0 ? 1 : 0;
+
+	vkCmdPipelineBarrier( commandBuffer, batch.SrcStages, batch.DstStages, 0, memoryBarrierCount, &memoryBarrier, 0, nullptr,
+		( uint32_t )imageBarriers.size(), imageBarriers.data() );
+}
+/*
+===============
+RenderGraph::WriteBarriers
+
+	Writes a batch's stage masks and the dependency of each resource in it
+===============
+*/
+void RenderGraph::WriteBarriers( std::ostream& out, const BarrierBatch& batch ) const {
+	if ( batch.SrcStages == 0 ) {
+		return;
+	}
+
+	out << "      barrier" << std::hex << " stages 0x" << batch.SrcStages << " -> 0x" << batch.DstStages << std::dec
+		<< ", " << batch.Images.size() << " image transitions" << std::endl;
+
+	for ( const Dependency& dependency : batch.Dependencies ) {
+		out << "        " << m_resources[ dependency.Resource ].Name << ": " << ( dependency.Aliased ? "aliased memory" : AccessName( dependency.From ) )
+			<< " -> " << AccessName( dependency.To ) << std::endl;
+	}
+}
+/*
+===============
+RenderGraph::ReleaseTransients
+
+	Retires the transient images and their memory, which frames in flight
+	may still be using
+===============
+*/
+void RenderGraph::ReleaseTransients( void ) {
+	for ( Transient& transient : m_transients ) {
+		transient.View.retire( m_deletionQueue );
+		transient.Image.retire( m_deletionQueue );
+	}
+
+	m_transients.clear();
+
+	m_deviceMemory.Retire( m_deletionQueue, m_transientMemory );
+	m_transientMemory = nullptr;
+}
+/*
+===============
+RenderGraph::Overlaps
+
+	Whether two placed transient images share any memory
+===============
+*/
+bool RenderGraph::Overlaps( const Transient& a, const Transient& b ) const {
+	return a.Offset < b.Offset + b.Requirements.size && b.Offset < a.Offset + a.Requirements.size;
+}
+}
@@ -0,0 +1,233 @@
+#ifndef __RENDERGRAPH_H__
+#define __RENDERGRAPH_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "DeviceMemoryAllocator.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+/*
+	How a pass touches a resource. Each access stands for a pipeline stage,
+	access mask and, for images, a layout. None and Acquire only describe
+	the state an imported resource comes in with: None is for resources the
+	host already waited on, Acquire for swapchain images whose semaphore is
+	waited on at the color attachment output stage. Both leave image
+	contents undefined.
+*/
+enum class RenderGraphAccess {
+	None,
+	Acquire,
+	ColorAttachmentWrite,
+	DepthAttachmentWrite,
+	VertexShaderRead,
+	FragmentShaderRead,
+	ComputeRead,
+	ComputeWrite,
+	IndirectRead,
+	TransferRead,
+	TransferWrite,
+	Present
+};
+
+struct RenderGraphImageDesc {
+	VkFormat			Format	= VK_FORMAT_UNDEFINED;
+	VkExtent2D			Extent	= {};
+};
+
+typedef uint32_t		RenderGraphResource;
+typedef uint32_t		RenderGraphPass;
+
+struct RenderGraphStats {
+	uint32_t			DeclaredPasses		= 0;
+	uint32_t			CulledPasses		= 0;
+	uint32_t			BarrierCalls		= 0;	//Per execution
+	uint32_t			ImageBarriers		= 0;	//Per execution
+	uint32_t			TransientImages		= 0;
+	uint64_t			TransientBytes		= 0;	//What the transient images would take unaliased
+	uint64_t			AliasedBytes		= 0;	//What they take sharing memory
+	uint64_t			Compiles			= 0;
+	uint64_t			CacheHits			= 0;
+	double				LastCompileMs		= 0.0;
+};
+
+/*
+===============
+RenderGraph
+
+	Rebuilt every frame: passes are declared in submission order along with
+	the resources they read and write, then Compile turns the declarations
+	into a schedule and Execute records it. Compiling culls passes whose
+	writes nothing reads and that write no imported resource, works out one
+	batched vkCmdPipelineBarrier before each pass that needs one, and places
+	transient images whose lifetimes do not overlap at the same offset of a
+	single allocation.
+
+	The compiled schedule is kept while the declarations stay the same, so
+	a frame with the same topology as the last only pays for comparing the
+	declarations. Imported handles are not part of the topology; they may
+	change every frame, as swapchain images do.
+===============
+*/
+class RenderGraph {
+public:
+	typedef std::function<void( VkCommandBuffer commandBuffer )>	RecordPass;
+
+												RenderGraph( VkDevice device, DeviceMemoryAllocator& deviceMemory, DeletionQueue& deletionQueue );
+												~RenderGraph( void );
+
+	RenderGraph( const RenderGraph& ) = delete;
+	RenderGraph& operator=( const RenderGraph& ) = delete;
+
+	void										Reset( void );
+
+	RenderGraphResource							ImportImage( const char* name, VkImage image, const RenderGraphImageDesc& desc, RenderGraphAccess initialAccess, RenderGraphAccess finalAccess );
+	RenderGraphResource							ImportBuffer( const char* name, VkBuffer buffer, RenderGraphAccess initialAccess );
+	RenderGraphResource							CreateImage( const char* name, const RenderGraphImageDesc& desc );
+
+	RenderGraphPass								AddPass( const char* name, const RecordPass& record );
+	void										Read( RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access );
+	void										Write( RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access );
+
+	void										Compile( void );
+	void										Execute( VkCommandBuffer commandBuffer );
+
+	VkImage										Image( RenderGraphResource resource ) const;
+	VkImageView									ImageView( RenderGraphResource resource ) const;
+	VkBuffer									Buffer( RenderGraphResource resource ) const;
+
+	RenderGraphStats							GetStats( void ) const;
+	void										WriteSchedule( std::ostream& out ) const;
+	void										Report( std::ostream& out ) const;
+
+	static const char*							AccessName( RenderGraphAccess access );
+
+private:
+	enum class ResourceKind {
+		ImportedImage,
+		ImportedBuffer,
+		TransientImage
+	};
+
+	struct Resource {
+		std::string								Name;
+		ResourceKind							Kind			= ResourceKind::ImportedImage;
+		RenderGraphImageDesc					Desc;
+		RenderGraphAccess						InitialAccess	= RenderGraphAccess::None;
+		RenderGraphAccess						FinalAccess		= RenderGraphAccess::None;
+		VkImage									Image			= VK_NULL_HANDLE;
+		VkImageView								View			= VK_NULL_HANDLE;
+		VkBuffer								Buffer			= VK_NULL_HANDLE;
+		uint32_t								Transient		= 0;	//Index into m_transients
+	};
+
+	struct Use {
+		RenderGraphResource						Resource;
+		RenderGraphAccess						Access;
+	};
+
+	struct Pass {
+		std::string								Name;
+		RecordPass								Record;
+		std::vector<Use>						Uses;
+	};
+
+	//One resource's part in a barrier, kept for WriteSchedule
+	struct Dependency {
+		RenderGraphResource						Resource;
+		RenderGraphAccess						From;
+		RenderGraphAccess						To;
+		bool									Aliased;
+	};
+
+	struct ImageTransition {
+		RenderGraphResource						Resource;
+		VkImageLayout							OldLayout;
+		VkImageLayout							NewLayout;
+		VkAccessFlags							SrcAccess;
+		VkAccessFlags							DstAccess;
+	};
+
+	struct BarrierBatch {
+		VkPipelineStageFlags					SrcStages		= 0;
+		VkPipelineStageFlags					DstStages		= 0;
+		VkAccessFlags							SrcAccess		= 0;
+		VkAccessFlags							DstAccess		= 0;
+		std::vector<ImageTransition>			Images;
+		std::vector<Dependency>					Dependencies;
+	};
+
+	struct ScheduledPass {
+		uint32_t								Pass;
+		BarrierBatch							Barriers;
+	};
+
+	//Where a resource stands while the schedule is worked out
+	struct TrackedState {
+		VkImageLayout							Layout			= VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags					WriteStages		= 0;
+		VkAccessFlags							WriteAccess		= 0;
+		VkPipelineStageFlags					ReadStages		= 0;	//Reads since the last write
+		VkPipelineStageFlags					VisibleStages	= 0;	//Stages the last write has been made visible to
+		VkAccessFlags							VisibleAccess	= 0;
+		RenderGraphAccess						LastAccess		= RenderGraphAccess::None;
+		bool									Aliased			= false;
+	};
+
+	/*
+		A transient image and where it lives in the shared allocation.
+		FirstPass and LastPass index the schedule.
+	*/
+	struct Transient {
+		RenderGraphResource						Resource;
+		VKImageHandle							Image;
+		VKImageViewHandle						View;
+		VkImageUsageFlags						Usage			= 0;
+		VkMemoryRequirements					Requirements	= {};
+		VkDeviceSize							Offset			= 0;
+		uint32_t								FirstPass		= 0;
+		uint32_t								LastPass		= 0;
+	};
+
+	void										AddUse( RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access, bool write );
+	void										CullPasses( std::vector<bool>& alive ) const;
+	void										CreateTransients( void );
+	void										PlaceTransients( void );
+	void										BuildBarriers( void );
+	void										Transition( BarrierBatch& batch, RenderGraphResource resource, TrackedState& state, RenderGraphAccess access ) const;
+	void										RecordBarriers( VkCommandBuffer commandBuffer, const BarrierBatch& batch ) const;
+	void										WriteBarriers( std::ostream& out, const BarrierBatch& batch ) const;
+	void										ReleaseTransients( void );
+	bool										Overlaps( const Transient& a, const Transient& b ) const;
+
+	VkDevice									m_device;
+	DeviceMemoryAllocator&						m_deviceMemory;
+	DeletionQueue&								m_deletionQueue;
+
+	//Declared this frame
+	std::vector<Resource>						m_resources;
+	std::vector<Pass>							m_passes;
+	std::vector<uint64_t>						m_topology;
+
+	//Compiled, kept while the topology stays the same
+	std::vector<uint64_t>						m_compiledTopology;
+	std::vector<ScheduledPass>					m_schedule;
+	std::vector<uint32_t>						m_culled;
+	BarrierBatch								m_finalBarriers;
+	std::vector<Transient>						m_transients;
+	DeviceAllocation*							m_transientMemory{ nullptr };
+	bool										m_compiled{ false };
+
+	RenderGraphStats							m_stats;
+};
+
+}
+
+#endif // !__RENDERGRAPH_H__
@@ -0,0 +1,439 @@
+#include "ShaderStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace tut {
+
+namespace {
+
+const uint64_t ARCHIVE_DATA_ALIGNMENT{ 16 };
+
+/*
+===============
+BaseName
+
+	Strips the directories from a path
+===============
+*/
+std::string BaseName( const std::string& filePath ) {
+	size_t separator = filePath.find_last_of( "/\\" );
+	return separator == std::string::npos ? filePath : filePath.substr( separator + 1 );
+}
+/*
+===============
+ReadWords
+
+	Reads a SPIR-V file into words, returns false if it is missing or not
+	a whole number of words
+===============
+*/
+bool ReadWords( const std::string& filePath, std::vector<uint32_t>& words ) {
+	std::ifstream file( filePath, std::ios::ate | std::ios::binary );
+
+	if ( !file.is_open() ) {
+		return false;
+	}
+
+	size_t fileSize = ( size_t )file.tellg();
+	if ( fileSize == 0 || fileSize % sizeof( uint32_t ) != 0 ) {
+		return false;
+	}
+
+	words.resize( fileSize / sizeof( uint32_t ) );
+
+	file.seekg( 0 );
+	file.read( ( char* )words.data(), fileSize );
+
+	return !file.fail();
+}
+
+}
+
+/*
+===============
+ShaderStore::ShaderStore
+
+	Creates an empty store for the device
+===============
+*/
+ShaderStore::ShaderStore( VkDevice device ) :
+	m_device( device )
+{
+}
+/*
+===============
+ShaderStore::Open
+
+	Maps a shader archive. Only the header is checked here, entries are
+	validated when they are looked up so opening stays constant time no
+	matter how many shaders the archive holds.
+===============
+*/
+bool ShaderStore::Open( const std::string& archivePath ) {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	if ( !m_archive.Open( archivePath ) ) {
+		return false;
+	}
+
+	ShaderArchiveHeader header = {};
+	if ( m_archive.Size() >= sizeof( header ) ) {
+		memcpy( &header, m_archive.Data(), sizeof( header ) );
+	}
+
+	uint64_t tablesSize = sizeof( header ) + ( uint64_t )header.NameCount * sizeof( ShaderArchiveName ) + ( uint64_t )header.BlobCount * sizeof( ShaderArchiveBlob );
+
+	if ( m_archive.Size() < sizeof( header ) || header.Magic != ARCHIVE_MAGIC || header.Version != ARCHIVE_VERSION || tablesSize > m_archive.Size() ) {
+		m_archive.Close();
+		throw std::runtime_error( "Shader archive is corrupt or from another version: " + archivePath );
+	}
+
+	m_stats.ArchiveBytes = m_archive.Size();
+	m_stats.ArchiveNames = header.NameCount;
+	m_stats.ArchiveBlobs = header.BlobCount;
+
+	return true;
+}
+/*
+===============
+ShaderStore::Add
+
+	Registers bytecode the caller keeps alive, such as the shaders embedded
+	in the executable. Takes priority over the archive.
+===============
+*/
+void ShaderStore::Add( const std::string& name, const ShaderBytecode& code ) {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	Entry entry = { code, Hash( code.Code, code.Size ) };
+	m_entries[ name ] = entry;
+}
+/*
+===============
+ShaderStore::Load
+
+	Reads a loose SPIR-V file and registers it under name. Meant for
+	iterating on shaders during development.
+===============
+*/
+void ShaderStore::Load( const std::string& name, const std::string& filePath ) {
+	std::vector<uint32_t> words;
+
+	if ( !ReadWords( filePath, words ) ) {
+		throw std::runtime_error( "Could not read SPIR-V file " + filePath );
+	}
+
+	ShaderBytecode code = { words.data(), words.size() * sizeof( uint32_t ) };
+
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+		m_loadedCode.push_back( std::move( words ) );
+	}
+
+	Add( name, code );
+}
+/*
+===============
+ShaderStore::Find
+
+	Looks up the bytecode registered under name
+===============
+*/
+bool ShaderStore::Find( const std::string& name, ShaderBytecode& code, uint64_t& contentHash ) {
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	++m_stats.Lookups;
+
+	std::unordered_map<std::string, Entry>::const_iterator entry = m_entries.find( name );
+	if ( entry != m_entries.end() ) {
+		code		= entry->second.Code;
+		contentHash	= entry->second.ContentHash;
+		return true;
+	}
+
+	return FindInArchive( name, code, contentHash );
+}
+/*
+===============
+ShaderStore::GetModule
+
+	Returns the shader module for name, creating it the first time its
+	bytecode is requested. The create info points straight into the mapping.
+	A cached module is only reused when its bytecode matches byte for byte,
+	bytecode that merely shares the hash gets a module of its own.
+===============
+*/
+VkShaderModule ShaderStore::GetModule( const std::string& name ) {
+	ShaderBytecode	code;
+	uint64_t		contentHash;
+
+	if ( !Find( name, code, contentHash ) ) {
+		throw std::runtime_error( "Shader not found: " + name );
+	}
+
+	std::lock_guard<std::mutex> lock( m_lock );
+
+	typedef std::unordered_multimap<uint64_t, Module>::const_iterator ModuleIterator;
+
+	std::pair<ModuleIterator, ModuleIterator> cached = m_modules.equal_range( contentHash );
+	for ( ModuleIterator module = cached.first; module != cached.second; ++module ) {
+		const ShaderBytecode& cachedCode = module->second.Code;
+
+		if ( cachedCode.Size == code.Size && ( cachedCode.Code == code.Code || memcmp( cachedCode.Code, code.Code, code.Size ) == 0 ) ) {
+			++m_stats.ModuleCacheHits;
+			return module->second.Handle;
+		}
+	}
+
+	VkShaderModuleCreateInfo	createInfo		= {};
+	VKShaderModuleHandle		shaderModule	= VKShaderModuleHandle( m_device );
+
+	createInfo.sType	= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize	= code.Size;
+	createInfo.pCode	= code.Code;
+
+	if ( vkCreateShaderModule( m_device, &createInfo, HostAllocator::Installed(), shaderModule.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create shader module " + name );
+	}
+
+	++m_stats.ModulesCreated;
+
+	VkShaderModule	result	= shaderModule;
+	Module			module	= { code, std::move( shaderModule ) };
+
+	m_modules.insert( std::make_pair( contentHash, std::move( module ) ) );
+
+	return result;
+}
+/*
+===============
+ShaderStore::GetStats
+
+	Returns a snapshot of the lookup counters
+===============
+*/
+ShaderStoreStats ShaderStore::GetStats( void ) const {
+	std::lock_guard<std::mutex> lock( m_lock );
+	return m_stats;
+}
+/*
+===============
+ShaderStore::Report
+
+	Writes the lookup counters
+===============
+*/
+void ShaderStore::Report( std::ostream& out ) const {
+	ShaderStoreStats stats = GetStats();
+
+	out << "Shader store: " << stats.Lookups << " lookups, " << stats.ModulesCreated << " modules created, "
+		<< stats.ModuleCacheHits << " module cache hits; archive " << stats.ArchiveBytes << " bytes, "
+		<< stats.ArchiveNames << " names, " << stats.ArchiveBlobs << " unique blobs" << std::endl;
+}
+/*
+===============
+ShaderStore::Hash
+
+	64 bit FNV-1a, used for both names and content
+===============
+*/
+uint64_t ShaderStore::Hash( const void* data, size_t size ) {
+	const uint8_t*	bytes	= ( const uint8_t* )data;
+	uint64_t		hash	= 0xcbf29ce484222325ull;
+
+	for ( size_t i = 0; i < size; ++i ) {
+		hash ^= bytes[ i ];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+/*
+===============
+ShaderStore::Pack
+
+	Writes the SPIR-V files into one archive named by their file names.
+	Files with identical content are stored once, content hashes are
+	confirmed by comparing the words.
+===============
+*/
+bool ShaderStore::Pack( const std::string& archivePath, const std::vector<std::string>& filePaths, std::ostream& out ) {
+	std::vector<ShaderArchiveName>			names;
+	std::vector<std::string>				nameStrings;
+	std::vector<ShaderArchiveBlob>			blobs;
+	std::vector<std::vector<uint32_t>>		blobCode;
+	std::unordered_map<uint64_t, uint32_t>	blobIndices;
+	uint64_t								dataOffset = 0;
+
+	for ( const std::string& filePath : filePaths ) {
+		std::vector<uint32_t> words;
+
+		if ( !ReadWords( filePath, words ) ) {
+			out << "Could not read SPIR-V file " << filePath << std::endl;
+			return false;
+		}
+
+		std::string			name		= BaseName( filePath );
+		ShaderArchiveName	nameEntry;
+
+		//NameOffset indexes nameStrings until the table is sorted and laid out
+		nameEntry.NameHash		= Hash( name.data(), name.size() );
+		nameEntry.NameOffset	= nameStrings.size();
+		nameEntry.NameSize		= ( uint32_t )name.size();
+		nameStrings.push_back( name );
+
+		uint64_t contentHash = Hash( words.data(), words.size() * sizeof( uint32_t ) );
+		std::unordered_map<uint64_t, uint32_t>::const_iterator existing = blobIndices.find( contentHash );
+
+		if ( existing != blobIndices.end() ) {
+			if ( blobCode[ existing->second ] != words ) {
+				out << "Content hash collision between " << filePath << " and an earlier shader" << std::endl;
+				return false;
+			}
+			nameEntry.BlobIndex = existing->second;
+		} else {
+			ShaderArchiveBlob blob;
+
+			blob.ContentHash	= contentHash;
+			blob.Offset			= dataOffset;
+			blob.Size			= words.size() * sizeof( uint32_t );
+
+			dataOffset = ( dataOffset + blob.Size + ARCHIVE_DATA_ALIGNMENT - 1 ) & ~( ARCHIVE_DATA_ALIGNMENT - 1 );
+
+			nameEntry.BlobIndex = ( uint32_t )blobs.size();
+			blobIndices[ contentHash ] = nameEntry.BlobIndex;
+			blobs.push_back( blob );
+			blobCode.push_back( std::move( words ) );
+		}
+
+		names.push_back( nameEntry );
+	}
+
+	std::sort( names.begin(), names.end(), []( const ShaderArchiveName& a, const ShaderArchiveName& b ) {
+		return a.NameHash < b.NameHash;
+	} );
+
+	//Names sharing a hash sit next to each other, lookups compare each of them
+	for ( size_t i = 1; i < names.size(); ++i ) {
+		for ( size_t j = i; j > 0 && names[ j - 1 ].NameHash == names[ i ].NameHash; --j ) {
+			if ( nameStrings[ ( size_t )names[ j - 1 ].NameOffset ] == nameStrings[ ( size_t )names[ i ].NameOffset ] ) {
+				out << "Two shaders are named " << nameStrings[ ( size_t )names[ i ].NameOffset ] << ", names must be unique" << std::endl;
+				return false;
+			}
+		}
+	}
+
+	ShaderArchiveHeader header = {};
+
+	header.Magic		= ARCHIVE_MAGIC;
+	header.Version		= ARCHIVE_VERSION;
+	header.NameCount	= ( uint32_t )names.size();
+	header.BlobCount	= ( uint32_t )blobs.size();
+
+	uint64_t	tablesSize	= sizeof( header ) + names.size() * sizeof( ShaderArchiveName ) + blobs.size() * sizeof( ShaderArchiveBlob );
+	std::string	nameData;
+
+	for ( ShaderArchiveName& nameEntry : names ) {
+		const std::string& name = nameStrings[ ( size_t )nameEntry.NameOffset ];
+
+		nameEntry.NameOffset = tablesSize + nameData.size();
+		nameData += name;
+	}
+
+	uint64_t dataStart = ( tablesSize + nameData.size() + ARCHIVE_DATA_ALIGNMENT - 1 ) & ~( ARCHIVE_DATA_ALIGNMENT - 1 );
+
+	for ( ShaderArchiveBlob& blob : blobs ) {
+		blob.Offset += dataStart;
+	}
+
+	std::ofstream file( archivePath, std::ios::binary | std::ios::trunc );
+	if ( !file.is_open() ) {
+		out << "Could not write shader archive " << archivePath << std::endl;
+		return false;
+	}
+
+	const char padding[ ARCHIVE_DATA_ALIGNMENT ] = {};
+
+	file.write( ( const char* )&header, sizeof( header ) );
+	file.write( ( const char* )names.data(), names.size() * sizeof( ShaderArchiveName ) );
+	file.write( ( const char* )blobs.data(), blobs.size() * sizeof( ShaderArchiveBlob ) );
+	file.write( nameData.data(), nameData.size() );
+	file.write( padding, dataStart - tablesSize - nameData.size() );
+
+	uint64_t position = dataStart;
+	for ( size_t i = 0; i < blobs.size(); ++i ) {
+		file.write( padding, blobs[ i ].Offset - position );
+		file.write( ( const char* )blobCode[ i ].data(), blobs[ i ].Size );
+		position = blobs[ i ].Offset + blobs[ i ].Size;
+	}
+
+	if ( file.fail() ) {
+		out << "Could not write shader archive " << archivePath << std::endl;
+		return false;
+	}
+
+	out << "Packed " << names.size() << " shaders into " << blobs.size() << " unique blobs, " << position << " bytes" << std::endl;
+
+	return true;
+}
+/*
+===============
+ShaderStore::FindInArchive
+
+	Binary searches the mapped name table by hash, then compares the names
+	of the entries sharing it. Must be called with m_lock held.
+===============
+*/
+bool ShaderStore::FindInArchive( const std::string& name, ShaderBytecode& code, uint64_t& contentHash ) const {
+	if ( !m_archive.IsOpen() ) {
+		return false;
+	}
+
+	ShaderArchiveHeader header = {};
+	memcpy( &header, m_archive.Data(), sizeof( header ) );
+
+	const ShaderArchiveName*	namesBegin	= ( const ShaderArchiveName* )( m_archive.Data() + sizeof( header ) );
+	const ShaderArchiveName*	namesEnd	= namesBegin + header.NameCount;
+	const ShaderArchiveBlob*	blobs		= ( const ShaderArchiveBlob* )namesEnd;
+
+	uint64_t nameHash = Hash( name.data(), name.size() );
+
+	const ShaderArchiveName* nameEntry = std::lower_bound( namesBegin, namesEnd, nameHash, []( const ShaderArchiveName& entry, uint64_t hash ) {
+		return entry.NameHash < hash;
+	} );
+
+	for ( ; nameEntry != namesEnd && nameEntry->NameHash == nameHash; ++nameEntry ) {
+		if ( nameEntry->NameOffset > m_archive.Size() || nameEntry->NameSize > m_archive.Size() - nameEntry->NameOffset ) {
+			throw std::runtime_error( "Shader archive name lies outside the archive" );
+		}
+
+		if ( nameEntry->NameSize == name.size() && memcmp( m_archive.Data() + nameEntry->NameOffset, name.data(), name.size() ) == 0 ) {
+			break;
+		}
+	}
+
+	if ( nameEntry == namesEnd || nameEntry->NameHash != nameHash ) {
+		return false;
+	}
+
+	if ( nameEntry->BlobIndex >= header.BlobCount ) {
+		throw std::runtime_error( "Shader archive name entry points past the blob table" );
+	}
+
+	const ShaderArchiveBlob& blob = blobs[ nameEntry->BlobIndex ];
+
+	if ( blob.Offset % sizeof( uint32_t ) != 0 || blob.Size % sizeof( uint32_t ) != 0 || blob.Size == 0 ||
+		blob.Offset > m_archive.Size() || blob.Size > m_archive.Size() - blob.Offset ) {
+		throw std::runtime_error( "Shader archive blob lies outside the archive" );
+	}
+
+	code.Code	= ( const uint32_t* )( m_archive.Data() + blob.Offset );
+	code.Size	= ( size_t )blob.Size;
+	contentHash	= blob.ContentHash;
+
+	return true;
+}
+}
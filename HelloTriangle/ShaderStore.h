@@ -0,0 +1,121 @@
+#ifndef __SHADERSTORE_H__
+#define __SHADERSTORE_H__
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+struct ShaderBytecode {
+	const uint32_t*		Code;
+	size_t				Size;	//In bytes, as VkShaderModuleCreateInfo wants it
+};
+
+/*
+	On disk layout of a shader archive. The name table is sorted by name hash
+	so lookups can binary search the mapping without building an index, and
+	blob data is word aligned so it can be handed to Vulkan in place. Each
+	name entry points at its name's characters, which a lookup compares so
+	two names sharing a hash are told apart.
+
+	[ ShaderArchiveHeader ][ ShaderArchiveName * NameCount ][ ShaderArchiveBlob * BlobCount ][ names ... ][ SPIR-V ... ]
+*/
+struct ShaderArchiveHeader {
+	uint32_t			Magic			= 0;
+	uint32_t			Version			= 0;
+	uint32_t			NameCount		= 0;
+	uint32_t			BlobCount		= 0;
+};
+
+struct ShaderArchiveName {
+	uint64_t			NameHash		= 0;
+	uint64_t			NameOffset		= 0;	//From the start of the archive, not null terminated
+	uint32_t			NameSize		= 0;
+	uint32_t			BlobIndex		= 0;
+};
+
+struct ShaderArchiveBlob {
+	uint64_t			ContentHash		= 0;
+	uint64_t			Offset			= 0;
+	uint64_t			Size			= 0;
+};
+
+struct ShaderStoreStats {
+	uint64_t			Lookups			= 0;
+	uint64_t			ModulesCreated	= 0;
+	uint64_t			ModuleCacheHits	= 0;
+	uint64_t			ArchiveBytes	= 0;
+	uint64_t			ArchiveNames	= 0;
+	uint64_t			ArchiveBlobs	= 0;
+};
+
+/*
+===============
+ShaderStore
+
+	Content addressed SPIR-V lookup. Shaders come from a memory mapped archive
+	or are registered directly, and are found by name. Shader modules are
+	created on first request and cached by content hash, so names that share
+	bytecode share one VkShaderModule. Hashes only narrow the search, names
+	and bytecode are compared in full before a match is used.
+===============
+*/
+class ShaderStore {
+public:
+	static const uint32_t								ARCHIVE_MAGIC{ 0x4b505354 };	//"TSPK"
+	static const uint32_t								ARCHIVE_VERSION{ 2 };
+
+														ShaderStore( VkDevice device );
+
+	ShaderStore( const ShaderStore& ) = delete;
+	ShaderStore& operator=( const ShaderStore& ) = delete;
+
+	bool												Open( const std::string& archivePath );
+	void												Add( const std::string& name, const ShaderBytecode& code );
+	void												Load( const std::string& name, const std::string& filePath );
+
+	bool												Find( const std::string& name, ShaderBytecode& code, uint64_t& contentHash );
+	VkShaderModule										GetModule( const std::string& name );
+
+	ShaderStoreStats									GetStats( void ) const;
+	void												Report( std::ostream& out ) const;
+
+	static uint64_t										Hash( const void* data, size_t size );
+	static bool											Pack( const std::string& archivePath, const std::vector<std::string>& filePaths, std::ostream& out );
+
+private:
+	struct Entry {
+		ShaderBytecode									Code;
+		uint64_t										ContentHash;
+	};
+
+	//Code is the bytecode the module was created from, kept to compare against
+	struct Module {
+		ShaderBytecode									Code;
+		VKShaderModuleHandle							Handle;
+	};
+
+	bool												FindInArchive( const std::string& name, ShaderBytecode& code, uint64_t& contentHash ) const;
+
+	VkDevice											m_device;
+	MappedFile											m_archive;
+
+	mutable std::mutex									m_lock;
+	std::unordered_map<std::string, Entry>				m_entries;
+	std::vector<std::vector<uint32_t>>					m_loadedCode;
+	std::unordered_multimap<uint64_t, Module>			m_modules;
+	ShaderStoreStats									m_stats;
+};
+
+}
+
+#endif // !__SHADERSTORE_H__
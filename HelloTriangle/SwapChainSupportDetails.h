@@ -1,7 +1,7 @@
 #ifndef __SWAPCHAINSUPPORTDETAILS_H__
 #define __SWAPCHAINSUPPORTDETAILS_H__
 
-#include <vulkan\vulkan.h>
+#include <vulkan/vulkan.h>
 #include <vector>
 
 namespace tut {
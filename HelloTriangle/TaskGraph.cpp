@@ -0,0 +1,276 @@
+#include "TaskGraph.h"
+
+#include <stdexcept>
+#include <thread>
+
+namespace tut {
+/*
+===============
+TaskGraph::Add
+
+	Adds a task that may run on any thread once its dependencies finished.
+	Dependencies must have been added before it.
+===============
+*/
+TaskGraph::TaskId TaskGraph::Add( const char* name, Task task, std::initializer_list<TaskId> dependencies ) {
+	return AddNode( name, std::move( task ), dependencies, false );
+}
+/*
+===============
+TaskGraph::AddMainThread
+
+	Adds a task that only the thread calling Run may execute
+===============
+*/
+TaskGraph::TaskId TaskGraph::AddMainThread( const char* name, Task task, std::initializer_list<TaskId> dependencies ) {
+	return AddNode( name, std::move( task ), dependencies, true );
+}
+/*
+===============
+TaskGraph::Run
+
+	Runs every task on the job system, the calling thread helping with
+	ordinary tasks while no main thread task is ready. Rethrows the first
+	exception a task threw; tasks that had not started by then are skipped.
+===============
+*/
+void TaskGraph::Run( JobSystem& jobs ) {
+	m_start			= std::chrono::high_resolution_clock::now();
+	m_remaining		= ( uint32_t )m_nodes.size();
+	m_threadCount	= jobs.WorkerCount() + 1;
+	m_failed		= false;
+	m_failure		= nullptr;
+
+	for ( Node& node : m_nodes ) {
+		node.Waiting = ( uint32_t )node.Dependencies.size();
+	}
+
+	for ( TaskId id = 0; id < m_nodes.size(); ++id ) {
+		if ( m_nodes[ id ].Dependencies.empty() ) {
+			Schedule( jobs, id );
+		}
+	}
+
+	while ( m_remaining > 0 ) {
+		TaskId id;
+
+		if ( PopMainThread( id ) ) {
+			Execute( jobs, id );
+		} else if ( !jobs.TryRunOne() ) {
+			std::this_thread::yield();
+		}
+	}
+
+	m_wallMs = ElapsedMs();
+
+	if ( m_failure ) {
+		std::rethrow_exception( m_failure );
+	}
+}
+/*
+===============
+TaskGraph::RunSerial
+
+	Runs every task on the calling thread in the order they were added,
+	which is a valid order since dependencies are added first
+===============
+*/
+void TaskGraph::RunSerial( void ) {
+	m_start			= std::chrono::high_resolution_clock::now();
+	m_threadCount	= 1;
+
+	for ( Node& node : m_nodes ) {
+		node.StartMs = ElapsedMs();
+		node.Work();
+		node.EndMs = ElapsedMs();
+	}
+
+	m_wallMs = ElapsedMs();
+}
+/*
+===============
+TaskGraph::WallMs
+
+	Returns how long the last run took from start to the last task finishing
+===============
+*/
+double TaskGraph::WallMs( void ) const {
+	return m_wallMs;
+}
+/*
+===============
+TaskGraph::Report
+
+	Writes the run time against the summed task time, and the critical path:
+	the dependency chain with the largest summed task time, which no number
+	of threads can make shorter
+===============
+*/
+void TaskGraph::Report( std::ostream& out ) const {
+	if ( m_nodes.empty() ) {
+		return;
+	}
+
+	std::vector<double>	pathMs( m_nodes.size() );
+	std::vector<TaskId>	previous( m_nodes.size() );
+	double				workMs	= 0.0;
+	TaskId				last	= 0;
+
+	//Nodes are in dependency order, so one pass finds the longest chain ending at each
+	for ( TaskId id = 0; id < m_nodes.size(); ++id ) {
+		const Node&	node		= m_nodes[ id ];
+		double		durationMs	= node.EndMs - node.StartMs;
+
+		previous[ id ]	= id;
+		pathMs[ id ]	= durationMs;
+
+		for ( TaskId dependency : node.Dependencies ) {
+			if ( pathMs[ dependency ] + durationMs > pathMs[ id ] ) {
+				pathMs[ id ]	= pathMs[ dependency ] + durationMs;
+				previous[ id ]	= dependency;
+			}
+		}
+
+		workMs += durationMs;
+
+		if ( pathMs[ id ] > pathMs[ last ] ) {
+			last = id;
+		}
+	}
+
+	std::vector<TaskId> path;
+
+	for ( TaskId id = last; ; id = previous[ id ] ) {
+		path.push_back( id );
+
+		if ( previous[ id ] == id ) {
+			break;
+		}
+	}
+
+	out << "Init: " << m_nodes.size() << " tasks on " << m_threadCount << " threads in " << m_wallMs << " ms, "
+		<< workMs << " ms of work (" << ( m_wallMs > 0.0 ? workMs / m_wallMs : 0.0 ) << "x overlap)" << std::endl;
+	out << "  critical path " << pathMs[ last ] << " ms:";
+
+	for ( size_t i = path.size(); i-- > 0; ) {
+		const Node& node = m_nodes[ path[ i ] ];
+
+		out << ( i + 1 == path.size() ? " " : " -> " ) << node.Name << " (" << node.EndMs - node.StartMs << " ms)";
+	}
+
+	out << std::endl;
+}
+/*
+===============
+TaskGraph::AddNode
+
+	Adds a task and links it to its dependencies
+===============
+*/
+TaskGraph::TaskId TaskGraph::AddNode( const char* name, Task task, std::initializer_list<TaskId> dependencies, bool mainThread ) {
+	TaskId id = ( TaskId )m_nodes.size();
+
+	for ( TaskId dependency : dependencies ) {
+		if ( dependency >= id ) {
+			throw std::runtime_error( "Task dependencies must be added before the task" );
+		}
+	}
+
+	m_nodes.emplace_back();
+
+	Node& node = m_nodes.back();
+
+	node.Name			= name;
+	node.Work			= std::move( task );
+	node.MainThread		= mainThread;
+	node.Dependencies	= dependencies;
+
+	for ( TaskId dependency : dependencies ) {
+		m_nodes[ dependency ].Successors.push_back( id );
+	}
+
+	return id;
+}
+/*
+===============
+TaskGraph::Schedule
+
+	Queues a task whose dependencies have all finished
+===============
+*/
+void TaskGraph::Schedule( JobSystem& jobs, TaskId id ) {
+	if ( m_nodes[ id ].MainThread ) {
+		std::lock_guard<std::mutex> lock( m_mainThreadLock );
+		m_mainThreadReady.push_back( id );
+		return;
+	}
+
+	jobs.Submit( [this, &jobs, id]() { Execute( jobs, id ); } );
+}
+/*
+===============
+TaskGraph::Execute
+
+	Runs a task, unless an earlier one failed, then releases its successors
+===============
+*/
+void TaskGraph::Execute( JobSystem& jobs, TaskId id ) {
+	Node& node = m_nodes[ id ];
+
+	node.StartMs = ElapsedMs();
+
+	if ( !m_failed ) {
+		try {
+			node.Work();
+		} catch ( ... ) {
+			std::lock_guard<std::mutex> lock( m_failureLock );
+
+			if ( !m_failure ) {
+				m_failure = std::current_exception();
+			}
+
+			m_failed = true;
+		}
+	}
+
+	node.EndMs = ElapsedMs();
+
+	for ( TaskId successor : node.Successors ) {
+		if ( --m_nodes[ successor ].Waiting == 0 ) {
+			Schedule( jobs, successor );
+		}
+	}
+
+	//Last, so Run cannot return while this task still touches the graph
+	--m_remaining;
+}
+/*
+===============
+TaskGraph::PopMainThread
+
+	Takes the next ready main thread task
+===============
+*/
+bool TaskGraph::PopMainThread( TaskId& id ) {
+	std::lock_guard<std::mutex> lock( m_mainThreadLock );
+
+	if ( m_mainThreadReady.empty() ) {
+		return false;
+	}
+
+	id = m_mainThreadReady.front();
+	m_mainThreadReady.pop_front();
+
+	return true;
+}
+/*
+===============
+TaskGraph::ElapsedMs
+
+	Returns the time since the run started
+===============
+*/
+double TaskGraph::ElapsedMs( void ) const {
+	return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - m_start ).count();
+}
+}
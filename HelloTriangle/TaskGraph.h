@@ -0,0 +1,79 @@
+#ifndef __TASKGRAPH_H__
+#define __TASKGRAPH_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "JobSystem.h"
+
+namespace tut {
+
+/*
+===============
+TaskGraph
+
+	Named tasks with dependencies, run once on a JobSystem. A task is queued
+	as soon as the last task it depends on finishes. Main thread tasks, for
+	APIs such as window creation that must stay on the thread that runs the
+	message loop, are only ever run by the thread that called Run.
+
+	Every task is timed, so after a run the report can name the chain of
+	tasks that bounded the total time.
+===============
+*/
+class TaskGraph {
+public:
+	typedef uint32_t									TaskId;
+	typedef std::function<void( void )>					Task;
+
+	TaskId												Add( const char* name, Task task, std::initializer_list<TaskId> dependencies = {} );
+	TaskId												AddMainThread( const char* name, Task task, std::initializer_list<TaskId> dependencies = {} );
+
+	void												Run( JobSystem& jobs );
+	void												RunSerial( void );
+
+	double												WallMs( void ) const;
+	void												Report( std::ostream& out ) const;
+
+private:
+	struct Node {
+		const char*										Name			= nullptr;
+		Task											Work;
+		bool											MainThread		= false;
+		std::vector<TaskId>								Dependencies;
+		std::vector<TaskId>								Successors;
+		std::atomic<uint32_t>							Waiting{ 0 };
+		double											StartMs			= 0.0;
+		double											EndMs			= 0.0;
+	};
+
+	TaskId												AddNode( const char* name, Task task, std::initializer_list<TaskId> dependencies, bool mainThread );
+	void												Schedule( JobSystem& jobs, TaskId id );
+	void												Execute( JobSystem& jobs, TaskId id );
+	bool												PopMainThread( TaskId& id );
+	double												ElapsedMs( void ) const;
+
+	std::deque<Node>									m_nodes;	//Deque so nodes never move, they hold atomics
+
+	std::chrono::high_resolution_clock::time_point		m_start;
+	std::atomic<uint32_t>								m_remaining{ 0 };
+	std::mutex											m_mainThreadLock;
+	std::deque<TaskId>									m_mainThreadReady;
+	std::mutex											m_failureLock;
+	std::exception_ptr									m_failure;
+	std::atomic<bool>									m_failed{ false };
+	double												m_wallMs{ 0.0 };
+	uint32_t											m_threadCount{ 0 };
+};
+
+}
+
+#endif // !__TASKGRAPH_H__
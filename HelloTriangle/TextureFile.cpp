@@ -0,0 +1,296 @@
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace tut {
+
+namespace {
+
+/*
+	A tint per level, so which level is being sampled can be seen on screen.
+	RGB565, the endpoint format of a BC1 block.
+*/
+const uint16_t LEVEL_COLORS[] = {
+	0xffff, 0xf800, 0x07e0, 0x001f, 0xffe0, 0xf81f, 0x07ff, 0xfc00,
+	0x841f, 0x87f0, 0xfc10, 0x8410, 0x4208, 0xc618, 0x2104
+};
+
+//Checker squares across a level, whatever its size
+const uint32_t CHECKER_SQUARES{ 8 };
+
+/*
+===============
+AlignUp
+
+	Rounds value up to a power of two alignment
+===============
+*/
+uint64_t AlignUp( uint64_t value, uint64_t alignment ) {
+	return ( value + alignment - 1 ) & ~( alignment - 1 );
+}
+/*
+===============
+Blocks
+
+	Returns how many blocks cover a level dimension
+===============
+*/
+uint32_t Blocks( uint32_t texels ) {
+	return ( texels + TextureFile::BLOCK_SIZE - 1 ) / TextureFile::BLOCK_SIZE;
+}
+
+}
+
+/*
+===============
+TextureFile::Open
+
+	Maps a texture file and checks its header and level index against the
+	file size. Returns false if the file cannot be opened and throws if it
+	is not a texture of this version.
+===============
+*/
+bool TextureFile::Open( const std::string& filePath ) {
+	Close();
+
+	if ( !m_file.Open( filePath ) ) {
+		return false;
+	}
+
+	TextureFileHeader	header;
+	uint64_t			fileSize = m_file.Size();
+
+	if ( fileSize >= sizeof( header ) ) {
+		memcpy( &header, m_file.Data(), sizeof( header ) );
+	}
+
+	bool valid = fileSize >= sizeof( header ) && header.Magic == TEXTURE_MAGIC && header.Version == TEXTURE_VERSION &&
+		header.BlockBytes != 0 && header.BlockBytes == BlockBytes( ( VkFormat )header.Format ) &&
+		header.Width > 0 && header.Height > 0 && header.LevelCount > 0 && header.LevelCount <= MAX_LEVELS &&
+		( std::max( header.Width, header.Height ) >> ( header.LevelCount - 1 ) ) > 0 &&
+		fileSize - sizeof( header ) >= header.LevelCount * sizeof( TextureFileLevel );
+
+	if ( valid ) {
+		m_levels.resize( header.LevelCount );
+		memcpy( m_levels.data(), m_file.Data() + sizeof( header ), header.LevelCount * sizeof( TextureFileLevel ) );
+		m_header = header;
+
+		for ( uint32_t level = 0; level < header.LevelCount && valid; ++level ) {
+			const TextureFileLevel&	entry		= m_levels[ level ];
+			VkExtent3D				extent		= LevelExtent( level );
+			uint64_t				expected	= ( uint64_t )Blocks( extent.width ) * Blocks( extent.height ) * header.BlockBytes;
+
+			valid = entry.Bytes == expected && entry.Offset % LEVEL_ALIGNMENT == 0 && entry.Offset <= fileSize && entry.Bytes <= fileSize - entry.Offset;
+		}
+	}
+
+	if ( !valid ) {
+		Close();
+		throw std::runtime_error( "Texture file is corrupt or from another version: " + filePath );
+	}
+
+	return true;
+}
+/*
+===============
+TextureFile::Close
+
+	Unmaps the file, pointers from LevelData become invalid
+===============
+*/
+void TextureFile::Close( void ) {
+	m_file.Close();
+	m_header = TextureFileHeader();
+	m_levels.clear();
+}
+/*
+===============
+TextureFile::IsOpen
+
+	Returns if a texture is mapped
+===============
+*/
+bool TextureFile::IsOpen( void ) const {
+	return m_file.IsOpen();
+}
+/*
+===============
+TextureFile::Header
+
+	Returns the header of the mapped texture
+===============
+*/
+const TextureFileHeader& TextureFile::Header( void ) const {
+	return m_header;
+}
+/*
+===============
+TextureFile::Format
+
+	Returns the format to create the image with
+===============
+*/
+VkFormat TextureFile::Format( void ) const {
+	return ( VkFormat )m_header.Format;
+}
+/*
+===============
+TextureFile::LevelExtent
+
+	Returns the size of a level in texels
+===============
+*/
+VkExtent3D TextureFile::LevelExtent( uint32_t level ) const {
+	VkExtent3D extent;
+
+	extent.width	= std::max( m_header.Width >> level, 1u );
+	extent.height	= std::max( m_header.Height >> level, 1u );
+	extent.depth	= 1;
+
+	return extent;
+}
+/*
+===============
+TextureFile::LevelData
+
+	Returns a level's blocks, laid out as the copy into the image expects
+===============
+*/
+const void* TextureFile::LevelData( uint32_t level ) const {
+	return m_file.Data() + m_levels[ level ].Offset;
+}
+/*
+===============
+TextureFile::LevelBytes
+
+	Returns the size of a level's blocks
+===============
+*/
+uint64_t TextureFile::LevelBytes( uint32_t level ) const {
+	return m_levels[ level ].Bytes;
+}
+/*
+===============
+TextureFile::BlockBytes
+
+	Returns the size of a 4x4 block of a supported format, zero for any
+	other format
+===============
+*/
+uint32_t TextureFile::BlockBytes( VkFormat format ) {
+	switch ( format ) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
+/*
+===============
+TextureFile::Generate
+
+	Writes a square BC1 texture with a full mip chain, a checkerboard tinted
+	per level. The tree has no image decoder, so this is how test textures
+	are made. Size must be a power of two.
+===============
+*/
+bool TextureFile::Generate( const std::string& texturePath, uint32_t size, std::ostream& out ) {
+	if ( size < BLOCK_SIZE || ( size & ( size - 1 ) ) != 0 || size > ( 1u << ( MAX_LEVELS - 1 ) ) ) {
+		out << "Texture size must be a power of two from " << BLOCK_SIZE << " to " << ( 1u << ( MAX_LEVELS - 1 ) ) << std::endl;
+		return false;
+	}
+
+	TextureFileHeader header;
+
+	header.Magic		= TEXTURE_MAGIC;
+	header.Version		= TEXTURE_VERSION;
+	header.Format		= VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	header.Width		= size;
+	header.Height		= size;
+	header.BlockBytes	= 8;
+
+	while ( ( size >> header.LevelCount ) > 0 ) {
+		++header.LevelCount;
+	}
+
+	std::vector<TextureFileLevel>	levels( header.LevelCount );
+	uint64_t						offset = sizeof( header ) + header.LevelCount * sizeof( TextureFileLevel );
+
+	//Smallest first, see TextureFileHeader
+	for ( uint32_t level = header.LevelCount; level-- > 0; ) {
+		uint32_t blocks = Blocks( std::max( size >> level, 1u ) );
+
+		offset					= AlignUp( offset, LEVEL_ALIGNMENT );
+		levels[ level ].Offset	= offset;
+		levels[ level ].Bytes	= ( uint64_t )blocks * blocks * header.BlockBytes;
+		offset					+= levels[ level ].Bytes;
+	}
+
+	std::ofstream file( texturePath, std::ios::binary | std::ios::trunc );
+	if ( !file.is_open() ) {
+		out << "Could not write texture file " << texturePath << std::endl;
+		return false;
+	}
+
+	const std::vector<char>	padding( ( size_t )LEVEL_ALIGNMENT, 0 );
+	uint64_t				written = sizeof( header ) + header.LevelCount * sizeof( TextureFileLevel );
+	std::vector<uint8_t>	blockRow;
+
+	file.write( ( const char* )&header, sizeof( header ) );
+	file.write( ( const char* )levels.data(), header.LevelCount * sizeof( TextureFileLevel ) );
+
+	for ( uint32_t level = header.LevelCount; level-- > 0; ) {
+		uint32_t blocks		= Blocks( std::max( size >> level, 1u ) );
+		uint32_t square		= std::max( blocks / CHECKER_SQUARES, 1u );
+		uint16_t light		= LEVEL_COLORS[ level ];
+		uint16_t dark		= ( uint16_t )( ( light >> 1 ) & 0x7bef );	//Each channel halved
+
+		file.write( padding.data(), levels[ level ].Offset - written );
+
+		//A BC1 block with both endpoints set to one color and every index zero is that color throughout
+		blockRow.assign( blocks * 8, 0 );
+
+		for ( uint32_t y = 0; y < blocks; ++y ) {
+			for ( uint32_t x = 0; x < blocks; ++x ) {
+				uint16_t color = ( ( x / square + y / square ) & 1 ) != 0 ? dark : light;
+
+				memcpy( &blockRow[ x * 8 ], &color, sizeof( color ) );
+				memcpy( &blockRow[ x * 8 + 2 ], &color, sizeof( color ) );
+			}
+
+			file.write( ( const char* )blockRow.data(), blockRow.size() );
+		}
+
+		written = levels[ level ].Offset + levels[ level ].Bytes;
+	}
+
+	if ( file.fail() ) {
+		out << "Could not write texture file " << texturePath << std::endl;
+		return false;
+	}
+
+	out << "Wrote " << size << "x" << size << " BC1 texture with " << header.LevelCount << " levels, " << written / ( 1024.0 * 1024.0 ) << " MB, to " << texturePath << std::endl;
+
+	return true;
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef __TEXTUREFILE_H__
+#define __TEXTUREFILE_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace tut {
+
+/*
+	On disk layout of a texture, modelled on KTX2: a header, a level index
+	with an entry per mip, then the levels themselves, each exactly what the
+	copy into the image expects. Level 0 is the largest, but the levels are
+	stored smallest first, so the mip tail loaded up front is one short
+	range at the start of the file and every level streamed in later is one
+	contiguous read.
+
+	[ TextureFileHeader ][ TextureFileLevel * LevelCount ][ pad ][ level LevelCount - 1 ] ... [ pad ][ level 0 ]
+*/
+struct TextureFileHeader {
+	uint32_t			Magic			= 0;
+	uint32_t			Version			= 0;
+	uint32_t			Format			= 0;	//A block compressed VkFormat
+	uint32_t			Width			= 0;
+	uint32_t			Height			= 0;
+	uint32_t			LevelCount		= 0;
+	uint32_t			BlockBytes		= 0;	//Bytes per 4x4 block
+	uint32_t			Reserved		= 0;
+};
+
+struct TextureFileLevel {
+	uint64_t			Offset			= 0;
+	uint64_t			Bytes			= 0;
+};
+
+/*
+===============
+TextureFile
+
+	Memory mapped, block compressed texture. Only the header and level index
+	are read when opening, a level's pages are touched when it is copied,
+	so a texture costs the levels actually streamed rather than its file
+	size.
+===============
+*/
+class TextureFile {
+public:
+	static const uint32_t								TEXTURE_MAGIC{ 0x58455454 };	//"TTEX"
+	static const uint32_t								TEXTURE_VERSION{ 1 };
+	static const uint32_t								BLOCK_SIZE{ 4 };
+	static const uint32_t								MAX_LEVELS{ 15 };				//16384 texels down to one
+	static const uint64_t								LEVEL_ALIGNMENT{ 16 };
+
+	bool												Open( const std::string& filePath );
+	void												Close( void );
+
+	bool												IsOpen( void ) const;
+	const TextureFileHeader&							Header( void ) const;
+	VkFormat											Format( void ) const;
+	VkExtent3D											LevelExtent( uint32_t level ) const;
+	const void*											LevelData( uint32_t level ) const;
+	uint64_t											LevelBytes( uint32_t level ) const;
+
+	static uint32_t										BlockBytes( VkFormat format );
+	static bool											Generate( const std::string& texturePath, uint32_t size, std::ostream& out );
+
+private:
+	MappedFile											m_file;
+	TextureFileHeader									m_header;
+	std::vector<TextureFileLevel>						m_levels;
+};
+
+}
+
+#endif // !__TEXTUREFILE_H__
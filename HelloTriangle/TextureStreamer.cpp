@@ -0,0 +1,689 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "DebugMessenger.h"
+#include "HostAllocator.h"
+
+namespace tut {
+
+const TextureId TextureStreamer::INVALID_TEXTURE;
+const uint32_t TextureStreamer::MAX_TEXTURES;
+const uint32_t TextureStreamer::TAIL_SIZE;
+const uint32_t TextureStreamer::MAX_READS_IN_FLIGHT;
+const uint32_t TextureStreamer::DEFRAGMENT_INTERVAL;
+const uint32_t TextureStreamer::MAX_DEFRAGMENT_MOVES;
+const uint32_t TextureStreamer::NOT_LOADING;
+
+namespace {
+
+//Feedback entries no fragment wrote to, larger than the bits of any finite float
+const uint32_t	NO_FEEDBACK{ 0xffffffff };
+const uint64_t	PAGE_SIZE{ 4096 };
+
+/*
+===============
+StreamedImageInfo
+
+	Describes the image holding a texture's levels from firstLevel down
+===============
+*/
+VkImageCreateInfo StreamedImageInfo( const TextureFile& file, uint32_t firstLevel ) {
+	VkImageCreateInfo imageInfo = {};
+
+	imageInfo.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType		= VK_IMAGE_TYPE_2D;
+	imageInfo.format		= file.Format();
+	imageInfo.extent		= file.LevelExtent( firstLevel );
+	imageInfo.mipLevels		= file.Header().LevelCount - firstLevel;
+	imageInfo.arrayLayers	= 1;
+	imageInfo.samples		= VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling		= VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage			= VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+
+	return imageInfo;
+}
+/*
+===============
+EndDefragmentationDeferred
+
+	DeletionQueue callback releasing the ranges a defragmentation pass moved
+	images out of
+===============
+*/
+void EndDefragmentationDeferred( uint64_t allocator, uint64_t moves ) {
+	std::unique_ptr<std::vector<DefragmentationMove>> finished( DeletionQueue::FromRaw<std::vector<DefragmentationMove>*>( moves ) );
+
+	DeletionQueue::FromRaw<DeviceMemoryAllocator*>( allocator )->EndDefragmentation( *finished );
+}
+/*
+===============
+TouchPages
+
+	Reads a byte of every page in the range, so any page faults and the
+	disk reads behind them happen on the calling thread
+===============
+*/
+void TouchPages( const void* data, uint64_t bytes ) {
+	const volatile uint8_t*	bytePointer	= ( const volatile uint8_t* )data;
+	uint8_t					sink		= 0;
+
+	for ( uint64_t offset = 0; offset < bytes; offset += PAGE_SIZE ) {
+		sink ^= bytePointer[ offset ];
+	}
+
+	if ( bytes > 0 ) {
+		sink ^= bytePointer[ bytes - 1 ];
+	}
+
+	( void )sink;
+}
+
+}
+
+/*
+===============
+TextureStreamer::TextureStreamer
+
+	Creates a feedback buffer per frame in flight and the I/O threads
+===============
+*/
+TextureStreamer::TextureStreamer( VkDevice device, DeviceMemoryAllocator& deviceMemory, UploadQueue& uploads, BindlessTable& bindless, DeletionQueue& deletionQueue,
+	uint32_t framesInFlight, VkDeviceSize budget, uint32_t ioThreads ) :
+	m_device( device ),
+	m_deviceMemory( deviceMemory ),
+	m_uploads( uploads ),
+	m_bindless( bindless ),
+	m_deletionQueue( deletionQueue ),
+	m_budget( budget ),
+	m_feedback( std::max( framesInFlight, 1u ) ),
+	m_lastFrame( std::chrono::high_resolution_clock::now() ),
+	m_io( std::max( ioThreads, 1u ) )
+{
+	for ( Feedback& feedback : m_feedback ) {
+		VkBufferCreateInfo bufferInfo = {};
+
+		bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size			= MAX_TEXTURES * sizeof( uint32_t );
+		bufferInfo.usage		= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+		feedback.Buffer = VKBufferHandle( m_device );
+
+		if ( vkCreateBuffer( m_device, &bufferInfo, HostAllocator::Installed(), feedback.Buffer.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create texture feedback buffer" );
+		}
+
+		DebugMessenger::Name( m_device, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )feedback.Buffer, "Texture feedback" );
+
+		//Read back by the host every frame, so cached where the device allows it
+		feedback.Memory			= m_deviceMemory.AllocateForBuffer( feedback.Buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT );
+		feedback.Mapped			= ( uint32_t* )feedback.Memory->Mapped;
+		feedback.BindlessIndex	= m_bindless.AddBuffer( feedback.Buffer, 0, VK_WHOLE_SIZE );
+
+		std::fill( feedback.Mapped, feedback.Mapped + MAX_TEXTURES, NO_FEEDBACK );
+	}
+
+	m_stats.BudgetBytes = m_budget;
+}
+/*
+===============
+TextureStreamer::~TextureStreamer
+
+	The device must be idle. Waits for the I/O threads, then frees every
+	image right away.
+===============
+*/
+TextureStreamer::~TextureStreamer( void ) {
+	m_io.WaitIdle();
+
+	for ( std::unique_ptr<Texture>& texture : m_textures ) {
+		texture->View.reset();
+		texture->Image.reset();
+		m_deviceMemory.Free( texture->Memory );
+	}
+
+	for ( Feedback& feedback : m_feedback ) {
+		feedback.Buffer.reset();
+		m_deviceMemory.Free( feedback.Memory );
+	}
+}
+/*
+===============
+TextureStreamer::IsSupported
+
+	Returns if the device can sample block compressed textures through the
+	bindless table and write feedback from fragment shaders
+===============
+*/
+bool TextureStreamer::IsSupported( const DeviceCapabilities& capabilities ) {
+	return capabilities.Features.textureCompressionBC && capabilities.Features.fragmentStoresAndAtomics && BindlessTable::IsSupported( capabilities );
+}
+/*
+===============
+TextureStreamer::Add
+
+	Maps a texture file and makes its mip tail resident. Throws if the file
+	cannot be read or there is no room for another texture.
+===============
+*/
+TextureId TextureStreamer::Add( const std::string& filePath ) {
+	if ( m_textures.size() >= MAX_TEXTURES ) {
+		throw std::runtime_error( "Too many streamed textures" );
+	}
+
+	std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+
+	if ( !texture->File.Open( filePath ) ) {
+		throw std::runtime_error( "Could not open texture file " + filePath );
+	}
+
+	const TextureFileHeader& header = texture->File.Header();
+
+	texture->Path		= filePath;
+	texture->TailLevel	= header.LevelCount - 1;
+	texture->ImageBytes.resize( header.LevelCount, 0 );
+
+	//The first level no larger than TAIL_SIZE, or the smallest level the file has
+	while ( texture->TailLevel > 0 ) {
+		VkExtent3D extent = texture->File.LevelExtent( texture->TailLevel - 1 );
+
+		if ( extent.width > TAIL_SIZE || extent.height > TAIL_SIZE ) {
+			break;
+		}
+
+		--texture->TailLevel;
+	}
+
+	texture->WantedLevel = texture->TailLevel;
+
+	MakeResident( *texture, texture->TailLevel );
+	m_textures.push_back( std::move( texture ) );
+
+	return ( TextureId )( m_textures.size() - 1 );
+}
+/*
+===============
+TextureStreamer::TextureCount
+
+	Returns how many textures were added, ids run from zero to one less
+===============
+*/
+uint32_t TextureStreamer::TextureCount( void ) const {
+	return ( uint32_t )m_textures.size();
+}
+/*
+===============
+TextureStreamer::BindlessIndex
+
+	Returns the texture's slot in the bindless image array. It changes
+	whenever the resident levels do, so it must be fetched every frame.
+===============
+*/
+uint32_t TextureStreamer::BindlessIndex( TextureId texture ) const {
+	return m_textures[ texture ]->BindlessIndex;
+}
+/*
+===============
+TextureStreamer::BeginFrame
+
+	Reads the feedback the frame slot's last frame wrote, makes the levels
+	whose reads have finished resident and sends new requests to the I/O
+	threads, defragmenting every DEFRAGMENT_INTERVAL frames. The caller must have waited on the frame slot's fence, and the
+	uploads must be flushed before the frame's graphics submission acquires
+	them.
+===============
+*/
+void TextureStreamer::BeginFrame( uint64_t frameIndex ) {
+	std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+
+	if ( m_stats.ReadsInFlight > 0 || m_stats.QueuedRequests > 0 ) {
+		m_stats.StreamingSeconds += std::chrono::duration<double>( now - m_lastFrame ).count();
+	}
+
+	m_lastFrame		= now;
+	m_frameIndex	= frameIndex;
+	m_feedbackSlot	= ( uint32_t )( frameIndex % m_feedback.size() );
+
+	ReadFeedback( m_feedback[ m_feedbackSlot ] );
+	FinishReads();
+	IssueRequests();
+
+	if ( frameIndex % DEFRAGMENT_INTERVAL == 0 ) {
+		Defragment();
+	}
+}
+/*
+===============
+TextureStreamer::FeedbackBuffer
+
+	Returns the bindless buffer index the current frame writes feedback to
+===============
+*/
+uint32_t TextureStreamer::FeedbackBuffer( void ) const {
+	return m_feedback[ m_feedbackSlot ].BindlessIndex;
+}
+/*
+===============
+TextureStreamer::RecordFeedbackBarrier
+
+	Makes the frame's feedback writes visible to the host. Recorded after
+	the last draw that samples a streamed texture.
+===============
+*/
+void TextureStreamer::RecordFeedbackBarrier( VkCommandBuffer commandBuffer ) const {
+	VkMemoryBarrier barrier = {};
+
+	barrier.sType			= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask	= VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask	= VK_ACCESS_HOST_READ_BIT;
+
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+/*
+===============
+TextureStreamer::GetStats
+
+	Returns a snapshot of the counters
+===============
+*/
+TextureStreamerStats TextureStreamer::GetStats( void ) const {
+	TextureStreamerStats stats = m_stats;
+
+	stats.Textures = ( uint32_t )m_textures.size();
+
+	return stats;
+}
+/*
+===============
+TextureStreamer::Report
+
+	Writes what is resident against the budget, how fast levels streamed in
+	and what is still pending
+===============
+*/
+void TextureStreamer::Report( std::ostream& out ) const {
+	TextureStreamerStats	stats	= GetStats();
+	const double			MB		= 1024.0 * 1024.0;
+
+	out << "Texture streaming: " << stats.Textures << " textures, " << stats.ResidentBytes / MB << " of " << stats.BudgetBytes / MB << " MB resident (peak "
+		<< stats.PeakResidentBytes / MB << " MB), " << stats.StreamedBytes / MB << " MB streamed in " << stats.Requests << " requests at "
+		<< ( stats.StreamingSeconds > 0.0 ? stats.StreamedBytes / MB / stats.StreamingSeconds : 0.0 ) << " MB/s, " << stats.UploadedBytes / MB << " MB uploaded, "
+		<< stats.Evictions << " evictions, " << stats.Relocations << " relocations, " << stats.BudgetDenials << " requests over budget, "
+		<< stats.ReadsInFlight << " reads in flight and " << stats.QueuedRequests << " queued" << std::endl;
+}
+/*
+===============
+TextureStreamer::ReadFeedback
+
+	Turns each texture's smallest texture coordinate step per pixel into
+	the level whose texels come closest to one per pixel without going
+	over, measured along the texture's larger side, then clears the buffer
+	for the frame about to use it
+===============
+*/
+void TextureStreamer::ReadFeedback( Feedback& feedback ) {
+	for ( uint32_t id = 0; id < m_textures.size(); ++id ) {
+		Texture&	texture	= *m_textures[ id ];
+		uint32_t	bits	= feedback.Mapped[ id ];
+
+		texture.Seen = bits != NO_FEEDBACK;
+
+		if ( !texture.Seen ) {
+			continue;
+		}
+
+		const TextureFileHeader&	header			= texture.File.Header();
+		float						step;
+
+		memcpy( &step, &bits, sizeof( step ) );
+
+		float						texelsPerPixel	= step * std::max( header.Width, header.Height );
+		uint32_t					level			= 0;
+
+		if ( texelsPerPixel > 1.0f ) {
+			level = std::min( ( uint32_t )std::floor( std::log2( texelsPerPixel ) ), texture.TailLevel );
+		}
+
+		texture.WantedLevel	= level;
+		texture.LastSeen	= m_frameIndex;
+		feedback.Mapped[ id ] = NO_FEEDBACK;
+	}
+}
+/*
+===============
+TextureStreamer::FinishReads
+
+	Makes the levels of every finished read resident
+===============
+*/
+void TextureStreamer::FinishReads( void ) {
+	for ( std::unique_ptr<Texture>& texturePointer : m_textures ) {
+		Texture& texture = *texturePointer;
+
+		if ( texture.LoadingLevel == NOT_LOADING || !texture.ReadComplete.load( std::memory_order_acquire ) ) {
+			continue;
+		}
+
+		uint64_t newBytes = LevelBytesFrom( texture, texture.LoadingLevel ) - LevelBytesFrom( texture, texture.ResidentLevel );
+
+		m_reservedBytes -= texture.ReservedBytes;
+		texture.ReservedBytes = 0;
+
+		MakeResident( texture, texture.LoadingLevel );
+
+		texture.LoadingLevel	= NOT_LOADING;
+		m_stats.StreamedBytes	+= newBytes;
+		--m_stats.ReadsInFlight;
+	}
+}
+/*
+===============
+TextureStreamer::IssueRequests
+
+	Sends a read to the I/O threads for every seen texture missing levels
+	it asked for, those missing the most first, as long as reads are free
+	and the levels fit the budget
+===============
+*/
+void TextureStreamer::IssueRequests( void ) {
+	std::vector<Texture*> wanting;
+
+	for ( std::unique_ptr<Texture>& texture : m_textures ) {
+		if ( texture->Seen && texture->LoadingLevel == NOT_LOADING && texture->WantedLevel < texture->ResidentLevel ) {
+			wanting.push_back( texture.get() );
+		}
+	}
+
+	std::sort( wanting.begin(), wanting.end(), []( const Texture* a, const Texture* b ) {
+		return a->ResidentLevel - a->WantedLevel > b->ResidentLevel - b->WantedLevel;
+	} );
+
+	m_stats.QueuedRequests = 0;
+
+	for ( Texture* texturePointer : wanting ) {
+		Texture& texture = *texturePointer;
+
+		if ( m_stats.ReadsInFlight >= MAX_READS_IN_FLIGHT ) {
+			++m_stats.QueuedRequests;
+			continue;
+		}
+
+		uint32_t firstLevel	= texture.WantedLevel;
+		uint64_t extraBytes	= ImageBytesFrom( texture, firstLevel ) - texture.Memory->Size;
+
+		if ( !MakeRoom( extraBytes, texture ) ) {
+			//Take the largest levels that do fit
+			while ( firstLevel < texture.ResidentLevel && m_stats.ResidentBytes + m_reservedBytes + extraBytes > m_budget ) {
+				++firstLevel;
+				extraBytes = ImageBytesFrom( texture, firstLevel ) - texture.Memory->Size;
+			}
+
+			++m_stats.BudgetDenials;
+
+			if ( firstLevel == texture.ResidentLevel ) {
+				continue;
+			}
+		}
+
+		Texture*	target		= &texture;
+		uint32_t	lastLevel	= texture.ResidentLevel;
+
+		texture.LoadingLevel	= firstLevel;
+		texture.ReservedBytes	= extraBytes;
+		texture.ReadComplete.store( false, std::memory_order_relaxed );
+
+		m_reservedBytes += extraBytes;
+		++m_stats.ReadsInFlight;
+		++m_stats.Requests;
+
+		m_io.Enqueue( [target, firstLevel, lastLevel]() {
+			for ( uint32_t level = firstLevel; level < lastLevel; ++level ) {
+				TouchPages( target->File.LevelData( level ), target->File.LevelBytes( level ) );
+			}
+
+			target->ReadComplete.store( true, std::memory_order_release );
+		} );
+	}
+}
+/*
+===============
+TextureStreamer::MakeRoom
+
+	Cuts the least recently seen textures back until the bytes fit the
+	budget, first to the level they were last asked for, or their tail when
+	they were not seen, then to their tails. Returns false when the bytes
+	still do not fit with every other texture down to its tail.
+===============
+*/
+bool TextureStreamer::MakeRoom( uint64_t bytes, const Texture& requester ) {
+	for ( uint32_t pass = 0; pass < 2; ++pass ) {
+		while ( m_stats.ResidentBytes + m_reservedBytes + bytes > m_budget ) {
+			Texture*	victim		= nullptr;
+			uint32_t	victimLevel	= 0;
+
+			for ( std::unique_ptr<Texture>& texture : m_textures ) {
+				uint32_t keepLevel = pass == 0 && texture->Seen ? texture->WantedLevel : texture->TailLevel;
+
+				if ( texture.get() == &requester || texture->LoadingLevel != NOT_LOADING || texture->ResidentLevel >= keepLevel ) {
+					continue;
+				}
+
+				if ( victim == nullptr || texture->LastSeen < victim->LastSeen ) {
+					victim		= texture.get();
+					victimLevel	= keepLevel;
+				}
+			}
+
+			if ( victim == nullptr ) {
+				break;
+			}
+
+			MakeResident( *victim, victimLevel );
+			++m_stats.Evictions;
+		}
+	}
+
+	return m_stats.ResidentBytes + m_reservedBytes + bytes <= m_budget;
+}
+/*
+===============
+TextureStreamer::MakeResident
+
+	Replaces the texture's image with one holding the levels from firstLevel
+	down, uploaded from the mapping, and moves the texture to a new bindless
+	slot. Frames in flight keep sampling the old image through the old slot
+	until both are retired.
+===============
+*/
+void TextureStreamer::MakeResident( Texture& texture, uint32_t firstLevel ) {
+	VKImageHandle		image;
+	VKImageViewHandle	view;
+	DeviceAllocation*	memory		= BuildImage( texture, firstLevel, nullptr, image, view );
+	DeviceAllocation*	oldMemory	= texture.Memory;
+
+	SwapImage( texture, image, view );
+
+	if ( oldMemory != nullptr ) {
+		m_stats.ResidentBytes -= oldMemory->Size;
+		m_deviceMemory.Retire( m_deletionQueue, oldMemory );
+	}
+
+	texture.Memory					= memory;
+	texture.ResidentLevel			= firstLevel;
+	texture.ImageBytes[ firstLevel ]	= memory->Size;
+
+	m_stats.ResidentBytes		+= memory->Size;
+	m_stats.PeakResidentBytes	= std::max( m_stats.PeakResidentBytes, m_stats.ResidentBytes );
+}
+/*
+===============
+TextureStreamer::Defragment
+
+	Lets the allocator move a few images out of the emptiest block holding
+	only streamed textures. Images can't be rebound, so each moved one is
+	created again at its new place and uploaded from the mapping, like any
+	other replacement. The old ranges are released once the frames in
+	flight sampling the old images are done.
+===============
+*/
+void TextureStreamer::Defragment( void ) {
+	std::vector<DefragmentationMove> moves = m_deviceMemory.BeginDefragmentation( this, MAX_DEFRAGMENT_MOVES );
+
+	if ( moves.empty() ) {
+		return;
+	}
+
+	for ( const DefragmentationMove& move : moves ) {
+		std::vector<std::unique_ptr<Texture>>::iterator texture = std::find_if( m_textures.begin(), m_textures.end(), [&move]( const std::unique_ptr<Texture>& candidate ) {
+			return candidate->Memory == move.Allocation;
+		} );
+
+		if ( texture == m_textures.end() ) {
+			throw std::runtime_error( "Defragmentation moved memory of an unknown streamed texture" );
+		}
+
+		VKImageHandle		image;
+		VKImageViewHandle	view;
+
+		BuildImage( **texture, ( *texture )->ResidentLevel, move.Allocation, image, view );
+		SwapImage( **texture, image, view );
+
+		++m_stats.Relocations;
+	}
+
+	m_deletionQueue.Push( EndDefragmentationDeferred, DeletionQueue::ToRaw( &m_deviceMemory ), DeletionQueue::ToRaw( new std::vector<DefragmentationMove>( std::move( moves ) ) ) );
+}
+/*
+===============
+TextureStreamer::BuildImage
+
+	Creates an image holding the levels from firstLevel down, uploads them
+	from the mapping and creates its view. The image gets new memory, or is
+	bound to placement when given. Returns the image's memory.
+===============
+*/
+DeviceAllocation* TextureStreamer::BuildImage( const Texture& texture, uint32_t firstLevel, DeviceAllocation* placement, VKImageHandle& image, VKImageViewHandle& view ) {
+	const TextureFile&	file		= texture.File;
+	uint32_t			levelCount	= file.Header().LevelCount - firstLevel;
+	VkImageCreateInfo	imageInfo	= StreamedImageInfo( file, firstLevel );
+
+	image = VKImageHandle( m_device );
+
+	if ( vkCreateImage( m_device, &imageInfo, HostAllocator::Installed(), image.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create streamed texture image for " + texture.Path );
+	}
+
+	DebugMessenger::Name( m_device, VK_OBJECT_TYPE_IMAGE, ( VkImage )image, texture.Path.c_str() );
+
+	DeviceAllocation* memory = placement;
+
+	if ( memory == nullptr ) {
+		memory			= m_deviceMemory.AllocateForImage( image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 );
+		memory->Owner	= this;
+	} else if ( vkBindImageMemory( m_device, image, memory->Memory, memory->Offset ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not bind relocated texture image for " + texture.Path );
+	}
+
+	std::vector<UploadImageLevel> levels( levelCount );
+
+	for ( uint32_t i = 0; i < levelCount; ++i ) {
+		levels[ i ].MipLevel	= i;
+		levels[ i ].Extent		= file.LevelExtent( firstLevel + i );
+		levels[ i ].Data		= file.LevelData( firstLevel + i );
+		levels[ i ].Size		= file.LevelBytes( firstLevel + i );
+
+		m_stats.UploadedBytes += levels[ i ].Size;
+	}
+
+	m_uploads.UploadImage( image, levelCount, TextureFile::BLOCK_SIZE, levels );
+
+	VkImageViewCreateInfo viewInfo = {};
+
+	viewInfo.sType								= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image								= image;
+	viewInfo.viewType							= VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format								= imageInfo.format;
+	viewInfo.subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel		= 0;
+	viewInfo.subresourceRange.levelCount		= levelCount;
+	viewInfo.subresourceRange.baseArrayLayer	= 0;
+	viewInfo.subresourceRange.layerCount		= 1;
+
+	view = VKImageViewHandle( m_device );
+
+	if ( vkCreateImageView( m_device, &viewInfo, HostAllocator::Installed(), view.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create streamed texture view for " + texture.Path );
+	}
+
+	return memory;
+}
+/*
+===============
+TextureStreamer::SwapImage
+
+	Retires the texture's image and bindless slot, if it has one, and puts
+	the new image in a new slot
+===============
+*/
+void TextureStreamer::SwapImage( Texture& texture, VKImageHandle& image, VKImageViewHandle& view ) {
+	if ( texture.BindlessIndex != BindlessTable::INVALID_INDEX ) {
+		texture.View.retire( m_deletionQueue );
+		texture.Image.retire( m_deletionQueue );
+		m_bindless.ReleaseImage( texture.BindlessIndex );
+	}
+
+	texture.Image			= std::move( image );
+	texture.View			= std::move( view );
+	texture.BindlessIndex	= m_bindless.AddImage( texture.View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+}
+/*
+===============
+TextureStreamer::ImageBytesFrom
+
+	Returns the device memory an image with the levels from firstLevel down
+	takes. Block compressed levels are padded and aligned as the driver
+	sees fit, so it asks with an image that never gets memory, once per
+	level.
+===============
+*/
+uint64_t TextureStreamer::ImageBytesFrom( Texture& texture, uint32_t firstLevel ) {
+	if ( texture.ImageBytes[ firstLevel ] == 0 ) {
+		VkImageCreateInfo	imageInfo	= StreamedImageInfo( texture.File, firstLevel );
+		VKImageHandle		image		= VKImageHandle( m_device );
+
+		if ( vkCreateImage( m_device, &imageInfo, HostAllocator::Installed(), image.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create streamed texture image for " + texture.Path );
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements( m_device, image, &requirements );
+
+		texture.ImageBytes[ firstLevel ] = requirements.size;
+	}
+
+	return texture.ImageBytes[ firstLevel ];
+}
+/*
+===============
+TextureStreamer::LevelBytesFrom
+
+	Returns the size of the levels from firstLevel to the smallest
+===============
+*/
+uint64_t TextureStreamer::LevelBytesFrom( const Texture& texture, uint32_t firstLevel ) {
+	uint64_t bytes = 0;
+
+	for ( uint32_t level = firstLevel; level < texture.File.Header().LevelCount; ++level ) {
+		bytes += texture.File.LevelBytes( level );
+	}
+
+	return bytes;
+}
+
+}
@@ -0,0 +1,164 @@
+#ifndef __TEXTURESTREAMER_H__
+#define __TEXTURESTREAMER_H__
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "BindlessTable.h"
+#include "DeletionQueue.h"
+#include "DeviceCapabilities.h"
+#include "DeviceMemoryAllocator.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+#include "UploadQueue.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+typedef uint32_t TextureId;
+
+struct TextureStreamerStats {
+	uint32_t			Textures			= 0;
+	uint64_t			BudgetBytes			= 0;
+	uint64_t			ResidentBytes		= 0;
+	uint64_t			PeakResidentBytes	= 0;
+	uint32_t			ReadsInFlight		= 0;	//Requests on the I/O threads
+	uint32_t			QueuedRequests		= 0;	//Wanted levels waiting for a free read slot
+	uint64_t			Requests			= 0;
+	uint64_t			StreamedBytes		= 0;	//Levels newly made resident
+	uint64_t			UploadedBytes		= 0;	//Also counting levels copied again into a replacement image
+	uint64_t			Evictions			= 0;
+	uint64_t			Relocations			= 0;	//Images rebuilt where defragmentation moved their memory
+	uint64_t			BudgetDenials		= 0;	//Requests cut short because nothing more could be evicted
+	double				StreamingSeconds	= 0.0;	//Time with at least one request pending
+};
+
+/*
+===============
+TextureStreamer
+
+	Keeps the mip levels the screen needs resident within a device memory
+	budget. Adding a texture maps its file and uploads only the mip tail,
+	the levels of TAIL_SIZE texels and smaller, which stays resident for
+	good. Everything above it is streamed on demand.
+
+	Demand comes from the GPU: fragment shaders sampling a streamed texture
+	write how far their texture coordinates move per pixel into a feedback
+	buffer, one entry per texture kept with an atomic min, and BeginFrame
+	reads the buffer back once the frame that wrote it has finished. That
+	gives the sharpest level any pixel asked for. When it is not resident a
+	request goes to the I/O threads, which touch the level's pages so that
+	faulting them in from disk happens off the render thread, and a later
+	BeginFrame creates an image holding the new levels down to the tail,
+	uploads it straight from the mapping and swaps it into the bindless
+	table. Levels that are already resident are copied again, which costs at
+	most a third on top of the new level.
+
+	The budget counts what the images take in device memory, not in the
+	file. When a request does not fit it the least recently seen textures
+	are cut back to what they were last asked for, or to their tail when
+	they were not seen at all, and if that is not enough, to their tails
+	regardless. All this replacing leaves holes in the device
+	memory blocks, so every so often the streamer defragments its images,
+	rebuilding the few that moved in their new place. Retired images and
+	the ranges they moved out of are released through the deletion queue.
+	Main thread only, apart from the I/O threads.
+===============
+*/
+class TextureStreamer {
+public:
+	static const TextureId								INVALID_TEXTURE{ 0xffffffff };
+	static const uint32_t								MAX_TEXTURES{ 4096 };
+	static const uint32_t								TAIL_SIZE{ 64 };
+	static const uint32_t								MAX_READS_IN_FLIGHT{ 8 };
+	static const uint32_t								DEFRAGMENT_INTERVAL{ 60 };		//Frames between defragmentation passes
+	static const uint32_t								MAX_DEFRAGMENT_MOVES{ 4 };		//Images rebuilt per pass
+
+														TextureStreamer( VkDevice device, DeviceMemoryAllocator& deviceMemory, UploadQueue& uploads, BindlessTable& bindless, DeletionQueue& deletionQueue,
+															uint32_t framesInFlight, VkDeviceSize budget, uint32_t ioThreads );
+														~TextureStreamer( void );
+
+	TextureStreamer( const TextureStreamer& ) = delete;
+	TextureStreamer& operator=( const TextureStreamer& ) = delete;
+
+	static bool											IsSupported( const DeviceCapabilities& capabilities );
+
+	TextureId											Add( const std::string& filePath );
+	uint32_t											TextureCount( void ) const;
+	uint32_t											BindlessIndex( TextureId texture ) const;
+
+	void												BeginFrame( uint64_t frameIndex );
+	uint32_t											FeedbackBuffer( void ) const;
+	void												RecordFeedbackBarrier( VkCommandBuffer commandBuffer ) const;
+
+	TextureStreamerStats								GetStats( void ) const;
+	void												Report( std::ostream& out ) const;
+
+private:
+	static const uint32_t								NOT_LOADING{ 0xffffffff };
+
+	struct Texture {
+		TextureFile										File;
+		std::string										Path;
+		VKImageHandle									Image;
+		DeviceAllocation*								Memory			= nullptr;
+		VKImageViewHandle								View;
+		uint32_t										BindlessIndex	= BindlessTable::INVALID_INDEX;
+		uint32_t										TailLevel		= 0;			//First level of the tail
+		uint32_t										ResidentLevel	= 0;			//First level of the image
+		uint32_t										WantedLevel		= 0;			//From the last feedback that saw the texture
+		uint32_t										LoadingLevel	= NOT_LOADING;	//First level of the read in flight
+		uint64_t										ReservedBytes	= 0;			//Budget held for the read in flight
+		std::vector<uint64_t>							ImageBytes;						//Allocation size of an image from each first level, zero until queried
+		uint64_t										LastSeen		= 0;			//Frame of the last feedback that saw the texture
+		bool											Seen			= false;		//By the last feedback read
+		std::atomic<bool>								ReadComplete{ false };
+	};
+
+	//Per frame in flight, written by the GPU and read back once the frame's fence has been waited on
+	struct Feedback {
+		VKBufferHandle									Buffer;
+		DeviceAllocation*								Memory			= nullptr;
+		uint32_t*										Mapped			= nullptr;
+		uint32_t										BindlessIndex	= BindlessTable::INVALID_INDEX;
+	};
+
+	void												ReadFeedback( Feedback& feedback );
+	void												FinishReads( void );
+	void												IssueRequests( void );
+	bool												MakeRoom( uint64_t bytes, const Texture& requester );
+	void												MakeResident( Texture& texture, uint32_t firstLevel );
+	void												Defragment( void );
+	DeviceAllocation*									BuildImage( const Texture& texture, uint32_t firstLevel, DeviceAllocation* placement, VKImageHandle& image, VKImageViewHandle& view );
+	void												SwapImage( Texture& texture, VKImageHandle& image, VKImageViewHandle& view );
+	uint64_t											ImageBytesFrom( Texture& texture, uint32_t firstLevel );
+	static uint64_t										LevelBytesFrom( const Texture& texture, uint32_t firstLevel );
+
+	VkDevice											m_device;
+	DeviceMemoryAllocator&								m_deviceMemory;
+	UploadQueue&										m_uploads;
+	BindlessTable&										m_bindless;
+	DeletionQueue&										m_deletionQueue;
+	VkDeviceSize										m_budget;
+
+	std::vector<std::unique_ptr<Texture>>				m_textures;
+	std::vector<Feedback>								m_feedback;
+	uint32_t											m_feedbackSlot{ 0 };
+	uint64_t											m_frameIndex{ 0 };
+	uint64_t											m_reservedBytes{ 0 };
+
+	TextureStreamerStats								m_stats;
+	std::chrono::high_resolution_clock::time_point		m_lastFrame;
+
+	ThreadPool											m_io;	//Last, so it is destroyed first and the I/O threads stop before the textures they read
+};
+
+}
+
+#endif // !__TEXTURESTREAMER_H__
@@ -0,0 +1,109 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace tut {
+/*
+===============
+ThreadPool::ThreadPool
+
+	Starts the workers, zero threads means one per hardware thread
+===============
+*/
+ThreadPool::ThreadPool( uint32_t threadCount ) {
+	if ( threadCount == 0 ) {
+		threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+	}
+
+	m_threads.reserve( threadCount );
+	for ( uint32_t i = 0; i < threadCount; ++i ) {
+		m_threads.emplace_back( &ThreadPool::WorkerMain, this );
+	}
+}
+/*
+===============
+ThreadPool::~ThreadPool
+
+	Finishes the queued jobs and joins the workers
+===============
+*/
+ThreadPool::~ThreadPool( void ) {
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+		m_stopping = true;
+	}
+
+	m_jobAvailable.notify_all();
+
+	for ( std::thread& thread : m_threads ) {
+		thread.join();
+	}
+}
+/*
+===============
+ThreadPool::Enqueue
+
+	Queues a job to run on the next free worker
+===============
+*/
+void ThreadPool::Enqueue( Job job ) {
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+		m_jobs.push_back( std::move( job ) );
+	}
+
+	m_jobAvailable.notify_one();
+}
+/*
+===============
+ThreadPool::WaitIdle
+
+	Blocks until the queue is empty and no job is running
+===============
+*/
+void ThreadPool::WaitIdle( void ) {
+	std::unique_lock<std::mutex> lock( m_lock );
+	m_idle.wait( lock, [this]() { return m_jobs.empty() && m_activeJobs == 0; } );
+}
+/*
+===============
+ThreadPool::ThreadCount
+
+	Returns the number of workers
+===============
+*/
+uint32_t ThreadPool::ThreadCount( void ) const {
+	return ( uint32_t )m_threads.size();
+}
+/*
+===============
+ThreadPool::WorkerMain
+
+	Runs jobs until the pool is destroyed and the queue is drained
+===============
+*/
+void ThreadPool::WorkerMain( void ) {
+	std::unique_lock<std::mutex> lock( m_lock );
+
+	for ( ;; ) {
+		m_jobAvailable.wait( lock, [this]() { return m_stopping || !m_jobs.empty(); } );
+
+		if ( m_jobs.empty() ) {
+			return;
+		}
+
+		Job job = std::move( m_jobs.front() );
+		m_jobs.pop_front();
+		++m_activeJobs;
+
+		lock.unlock();
+		job();
+		lock.lock();
+
+		--m_activeJobs;
+		if ( m_jobs.empty() && m_activeJobs == 0 ) {
+			m_idle.notify_all();
+		}
+	}
+}
+}
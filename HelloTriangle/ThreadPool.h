@@ -0,0 +1,51 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tut {
+
+/*
+===============
+ThreadPool
+
+	Fixed set of worker threads pulling jobs off one FIFO queue. Meant for
+	coarse jobs such as encoding a frame, not fine grained parallelism.
+===============
+*/
+class ThreadPool {
+public:
+	typedef std::function<void( void )>		Job;
+
+											ThreadPool( uint32_t threadCount );
+											~ThreadPool( void );
+
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+
+	void									Enqueue( Job job );
+	void									WaitIdle( void );
+
+	uint32_t								ThreadCount( void ) const;
+
+private:
+	void									WorkerMain( void );
+
+	std::vector<std::thread>				m_threads;
+	std::deque<Job>							m_jobs;
+	std::mutex								m_lock;
+	std::condition_variable					m_jobAvailable;
+	std::condition_variable					m_idle;
+	uint32_t								m_activeJobs{ 0 };
+	bool									m_stopping{ false };
+};
+
+}
+
+#endif // !__THREADPOOL_H__
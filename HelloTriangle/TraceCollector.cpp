@@ -0,0 +1,278 @@
+#include "TraceCollector.h"
+
+#include <stdexcept>
+
+namespace tut {
+
+const uint32_t TraceCollector::RING_CAPACITY;
+std::atomic<TraceCollector*> TraceCollector::s_installedCollector{ nullptr };
+
+namespace {
+
+//Distinguishes collectors so a thread never reuses a ring cached for one that was destroyed
+std::atomic<uint64_t> s_nextCollectorId{ 1 };
+
+/*
+	Ring the calling thread records into, cached per thread
+*/
+struct ThreadRingCache {
+	uint64_t	CollectorId	= 0;
+	TraceRing*	Ring		= nullptr;
+};
+
+thread_local ThreadRingCache s_threadRing;
+
+}
+
+/*
+===============
+TraceRing::TraceRing
+
+	Creates a ring holding capacity events, capacity must be a power of two
+===============
+*/
+TraceRing::TraceRing( uint32_t capacity, uint32_t track ) :
+	m_events( capacity ),
+	m_mask( capacity - 1 ),
+	m_track( track )
+{
+	if ( capacity == 0 || ( capacity & ( capacity - 1 ) ) != 0 ) {
+		throw std::runtime_error( "Trace ring capacity must be a power of two" );
+	}
+}
+/*
+===============
+TraceRing::Push
+
+	Appends an event, called only by the owning thread
+===============
+*/
+bool TraceRing::Push( const TraceRingEvent& event ) {
+	uint64_t head = m_head.load( std::memory_order_relaxed );
+
+	if ( head - m_tail.load( std::memory_order_acquire ) > m_mask ) {
+		m_dropped.store( m_dropped.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	m_events[ head & m_mask ] = event;
+	m_head.store( head + 1, std::memory_order_release );
+
+	return true;
+}
+/*
+===============
+TraceRing::Drain
+
+	Moves every published event into events, called only by the drain thread
+===============
+*/
+size_t TraceRing::Drain( std::vector<TraceRingEvent>& events ) {
+	uint64_t tail = m_tail.load( std::memory_order_relaxed );
+	uint64_t head = m_head.load( std::memory_order_acquire );
+
+	for ( uint64_t i = tail; i < head; ++i ) {
+		events.push_back( m_events[ i & m_mask ] );
+	}
+
+	m_tail.store( head, std::memory_order_release );
+
+	return ( size_t )( head - tail );
+}
+/*
+===============
+TraceRing::Track
+
+	Returns the trace track of the owning thread
+===============
+*/
+uint32_t TraceRing::Track( void ) const {
+	return m_track;
+}
+/*
+===============
+TraceRing::Dropped
+
+	Returns how many events were lost to a full ring
+===============
+*/
+uint64_t TraceRing::Dropped( void ) const {
+	return m_dropped.load( std::memory_order_relaxed );
+}
+/*
+===============
+TraceCollector::TraceCollector
+
+	Starts the drain thread
+===============
+*/
+TraceCollector::TraceCollector( ChromeTrace& trace ) :
+	m_trace( trace ),
+	m_id( s_nextCollectorId++ )
+{
+	m_drainThread = std::thread( &TraceCollector::DrainMain, this );
+}
+/*
+===============
+TraceCollector::~TraceCollector
+
+	Drains what is left. Must not be installed or recorded into anymore.
+===============
+*/
+TraceCollector::~TraceCollector( void ) {
+	Stop();
+}
+/*
+===============
+TraceCollector::Install
+
+	Makes the collector the one zones record into, nullptr turns zones off
+===============
+*/
+void TraceCollector::Install( TraceCollector* collector ) {
+	s_installedCollector.store( collector, std::memory_order_release );
+}
+/*
+===============
+TraceCollector::Installed
+
+	Returns the collector zones record into, or nullptr
+===============
+*/
+TraceCollector* TraceCollector::Installed( void ) {
+	return s_installedCollector.load( std::memory_order_acquire );
+}
+/*
+===============
+TraceCollector::Record
+
+	Pushes a finished zone into the calling thread's ring
+===============
+*/
+void TraceCollector::Record( const char* name, Clock::rep start, Clock::rep end ) {
+	TraceRingEvent event;
+
+	event.Name	= name;
+	event.Start	= start;
+	event.End	= end;
+
+	ThreadRing()->Push( event );
+}
+/*
+===============
+TraceCollector::Stop
+
+	Uninstalls the collector, joins the drain thread and drains the rings
+	one last time
+===============
+*/
+void TraceCollector::Stop( void ) {
+	if ( Installed() == this ) {
+		Install( nullptr );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_drainLock );
+
+		if ( m_stopping ) {
+			return;
+		}
+
+		m_stopping = true;
+	}
+
+	m_drainWake.notify_all();
+	m_drainThread.join();
+
+	DrainRings();
+}
+/*
+===============
+TraceCollector::Report
+
+	Writes how many zones were traced and lost
+===============
+*/
+void TraceCollector::Report( std::ostream& out ) const {
+	std::lock_guard<std::mutex> lock( m_ringsLock );
+
+	uint64_t dropped = 0;
+	for ( const std::unique_ptr<TraceRing>& ring : m_rings ) {
+		dropped += ring->Dropped();
+	}
+
+	out << "CPU zones: " << m_drainedEvents << " traced from " << m_rings.size() << " threads, " << dropped << " dropped on full rings" << std::endl;
+}
+/*
+===============
+TraceCollector::ThreadRing
+
+	Returns the calling thread's ring, creating it on first use
+===============
+*/
+TraceRing* TraceCollector::ThreadRing( void ) {
+	if ( s_threadRing.CollectorId == m_id ) {
+		return s_threadRing.Ring;
+	}
+
+	std::lock_guard<std::mutex> lock( m_ringsLock );
+
+	m_rings.push_back( std::make_unique<TraceRing>( RING_CAPACITY, ChromeTrace::CurrentThreadTrack() ) );
+
+	s_threadRing.CollectorId	= m_id;
+	s_threadRing.Ring			= m_rings.back().get();
+
+	return s_threadRing.Ring;
+}
+/*
+===============
+TraceCollector::DrainMain
+
+	Drains the rings every few milliseconds until stopped
+===============
+*/
+void TraceCollector::DrainMain( void ) {
+	std::unique_lock<std::mutex> lock( m_drainLock );
+
+	while ( !m_stopping ) {
+		m_drainWake.wait_for( lock, std::chrono::milliseconds( 5 ) );
+
+		lock.unlock();
+		DrainRings();
+		lock.lock();
+	}
+}
+/*
+===============
+TraceCollector::DrainRings
+
+	Writes every published event to the trace. Only one thread drains at
+	a time: the drain thread, or Stop once it has been joined.
+===============
+*/
+void TraceCollector::DrainRings( void ) {
+	std::vector<TraceRing*> rings;
+
+	{
+		std::lock_guard<std::mutex> lock( m_ringsLock );
+
+		for ( const std::unique_ptr<TraceRing>& ring : m_rings ) {
+			rings.push_back( ring.get() );
+		}
+	}
+
+	for ( TraceRing* ring : rings ) {
+		m_drainBuffer.clear();
+		ring->Drain( m_drainBuffer );
+
+		for ( const TraceRingEvent& event : m_drainBuffer ) {
+			double startUs	= m_trace.ToMicroseconds( Clock::time_point( Clock::duration( event.Start ) ) );
+			double endUs	= m_trace.ToMicroseconds( Clock::time_point( Clock::duration( event.End ) ) );
+
+			m_trace.AddEvent( event.Name, ring->Track(), startUs, endUs - startUs );
+		}
+
+		m_drainedEvents += m_drainBuffer.size();
+	}
+}
+}
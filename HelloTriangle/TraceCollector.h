@@ -0,0 +1,179 @@
+#ifndef __TRACECOLLECTOR_H__
+#define __TRACECOLLECTOR_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "ChromeTrace.h"
+
+/*
+	TUT_ZONE( "Name" ) times the rest of the enclosing block. Zones are on in
+	debug builds and compile to nothing in release builds unless the project
+	defines TUT_TRACE_ZONES=1. When compiled in but no collector is
+	installed a zone costs one atomic load.
+*/
+#ifndef TUT_TRACE_ZONES
+#ifdef NDEBUG
+#define TUT_TRACE_ZONES 0
+#else
+#define TUT_TRACE_ZONES 1
+#endif
+#endif
+
+#define TUT_ZONE_CONCAT_INNER( a, b )	a##b
+#define TUT_ZONE_CONCAT( a, b )			TUT_ZONE_CONCAT_INNER( a, b )
+
+#if TUT_TRACE_ZONES
+#define TUT_ZONE( name )				::tut::TraceZone TUT_ZONE_CONCAT( traceZone, __LINE__ )( name )
+#else
+#define TUT_ZONE( name )				( ( void )0 )
+#endif
+
+namespace tut {
+
+struct TraceRingEvent {
+	const char*							Name;
+	std::chrono::high_resolution_clock::rep	Start;
+	std::chrono::high_resolution_clock::rep	End;
+};
+
+/*
+===============
+TraceRing
+
+	Fixed size single producer, single consumer ring of zone events. The
+	owning thread pushes, the collector's drain thread pops. Neither side
+	takes a lock; a full ring drops the event and counts it.
+===============
+*/
+class TraceRing {
+public:
+										TraceRing( uint32_t capacity, uint32_t track );
+
+	TraceRing( const TraceRing& ) = delete;
+	TraceRing& operator=( const TraceRing& ) = delete;
+
+	bool								Push( const TraceRingEvent& event );
+	size_t								Drain( std::vector<TraceRingEvent>& events );
+
+	uint32_t							Track( void ) const;
+	uint64_t							Dropped( void ) const;
+
+private:
+	std::vector<TraceRingEvent>			m_events;
+	uint64_t							m_mask;
+	uint32_t							m_track;
+
+	//Producer and consumer indices live on separate cache lines
+	alignas( 64 ) std::atomic<uint64_t>	m_head{ 0 };
+	alignas( 64 ) std::atomic<uint64_t>	m_tail{ 0 };
+	std::atomic<uint64_t>				m_dropped{ 0 };
+};
+
+/*
+===============
+TraceCollector
+
+	Owns one TraceRing per thread that records zones and a background
+	thread that drains them into a ChromeTrace. Rings are created the first
+	time a thread records into this collector, which is the only time a
+	lock is taken on the recording side.
+===============
+*/
+class TraceCollector {
+public:
+	typedef std::chrono::high_resolution_clock	Clock;
+
+	static const uint32_t				RING_CAPACITY{ 4096 };
+
+										TraceCollector( ChromeTrace& trace );
+										~TraceCollector( void );
+
+	TraceCollector( const TraceCollector& ) = delete;
+	TraceCollector& operator=( const TraceCollector& ) = delete;
+
+	static void							Install( TraceCollector* collector );
+	static TraceCollector*				Installed( void );
+
+	void								Record( const char* name, Clock::rep start, Clock::rep end );
+	void								Stop( void );
+
+	void								Report( std::ostream& out ) const;
+
+private:
+	TraceRing*							ThreadRing( void );
+	void								DrainMain( void );
+	void								DrainRings( void );
+
+	ChromeTrace&						m_trace;
+	uint64_t							m_id;
+
+	mutable std::mutex					m_ringsLock;
+	std::vector<std::unique_ptr<TraceRing>>	m_rings;
+
+	std::mutex							m_drainLock;
+	std::condition_variable				m_drainWake;
+	bool								m_stopping{ false };
+	std::thread							m_drainThread;
+	std::vector<TraceRingEvent>			m_drainBuffer;
+	uint64_t							m_drainedEvents{ 0 };
+
+	static std::atomic<TraceCollector*>	s_installedCollector;
+};
+
+/*
+===============
+TraceZone
+
+	Records its lifetime into the installed collector. Use through TUT_ZONE.
+===============
+*/
+class TraceZone {
+public:
+	/*
+	===============
+	TraceZone::TraceZone
+
+		Starts the zone if a collector is installed
+	===============
+	*/
+	explicit TraceZone( const char* name ) :
+		m_collector( TraceCollector::Installed() ),
+		m_name( name )
+	{
+		if ( m_collector != nullptr ) {
+			m_start = TraceCollector::Clock::now().time_since_epoch().count();
+		}
+	}
+	/*
+	===============
+	TraceZone::~TraceZone
+
+		Ends the zone
+	===============
+	*/
+	~TraceZone( void ) {
+		if ( m_collector != nullptr ) {
+			m_collector->Record( m_name, m_start, TraceCollector::Clock::now().time_since_epoch().count() );
+		}
+	}
+
+	TraceZone( const TraceZone& ) = delete;
+	TraceZone& operator=( const TraceZone& ) = delete;
+
+private:
+	TraceCollector*						m_collector;
+	const char*							m_name;
+	TraceCollector::Clock::rep			m_start{ 0 };
+};
+
+}
+
+#endif // !__TRACECOLLECTOR_H__
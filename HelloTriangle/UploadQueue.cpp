@@ -0,0 +1,612 @@
+#include "UploadQueue.h"
+#include "DebugMessenger.h"
+#include "HostAllocator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace tut {
+
+namespace {
+
+const uint32_t				BATCH_COUNT{ 8 };
+const VkDeviceSize			COPY_ALIGNMENT{ 16 };	//Enough for any texel size and the usual optimal copy offset alignment
+const VkPipelineStageFlags	CONSUMER_STAGES{ VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+								VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT };
+const VkAccessFlags			CONSUMER_ACCESS{ VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+								VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT };
+
+}
+
+/*
+===============
+UploadQueue::UploadQueue
+
+	Creates the staging ring and the command buffers batches are recorded into
+===============
+*/
+UploadQueue::UploadQueue( VkDevice device, DeviceMemoryAllocator& deviceMemory, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily, VkExtent3D imageGranularity, VkDeviceSize ringSize ) :
+	m_device( device ),
+	m_deviceMemory( deviceMemory ),
+	m_queue( queue ),
+	m_queueFamily( queueFamily ),
+	m_graphicsFamily( graphicsFamily ),
+	m_imageGranularity( imageGranularity ),
+	m_staging( device ),
+	m_ringSize( ringSize ),
+	m_batches( BATCH_COUNT )
+{
+	VkBufferCreateInfo bufferInfo = {};
+
+	bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size			= m_ringSize;
+	bufferInfo.usage		= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+	if ( vkCreateBuffer( m_device, &bufferInfo, HostAllocator::Installed(), m_staging.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create upload staging buffer" );
+	}
+
+	DebugMessenger::Name( m_device, VK_OBJECT_TYPE_BUFFER, ( VkBuffer )m_staging, "Upload staging ring" );
+
+	//Coherent so writes need no flush, and never cached since the host only writes
+	m_stagingMemory	= m_deviceMemory.AllocateForBuffer( m_staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0 );
+	m_mapped		= ( uint8_t* )m_stagingMemory->Mapped;
+
+	for ( Batch& batch : m_batches ) {
+		VkCommandPoolCreateInfo poolInfo = {};
+
+		poolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags				= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex	= m_queueFamily;
+
+		batch.CommandPool = VKCommandPoolHandle( m_device );
+
+		if ( vkCreateCommandPool( m_device, &poolInfo, HostAllocator::Installed(), batch.CommandPool.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create upload command pool" );
+		}
+
+		VkCommandBufferAllocateInfo allocateInfo = {};
+
+		allocateInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool		= batch.CommandPool;
+		allocateInfo.level				= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount	= 1;
+
+		if ( vkAllocateCommandBuffers( m_device, &allocateInfo, &batch.CommandBuffer ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not allocate upload command buffer" );
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		batch.Fence		= VKFenceHandle( m_device );
+		batch.Semaphore	= VKSemaphoreHandle( m_device );
+
+		if ( vkCreateFence( m_device, &fenceInfo, HostAllocator::Installed(), batch.Fence.replace() ) != VK_SUCCESS ) {
+			throw std::runtime_error( "Could not create upload fence" );
+		}
+	}
+}
+/*
+===============
+UploadQueue::~UploadQueue
+
+	Waits for every submitted batch before the ring goes away
+===============
+*/
+UploadQueue::~UploadQueue( void ) {
+	while ( !m_inFlight.empty() ) {
+		RetireOldest();
+	}
+
+	m_staging.reset();
+	m_deviceMemory.Free( m_stagingMemory );
+}
+/*
+===============
+UploadQueue::UploadBuffer
+
+	Stages data for a copy into a buffer and returns the token of the batch
+	it will go out in. Uploads larger than a quarter of the ring are split so
+	they can stream through it while earlier parts are still in flight.
+===============
+*/
+UploadToken UploadQueue::UploadBuffer( VkBuffer destination, VkDeviceSize offset, const void* data, VkDeviceSize size ) {
+	const uint8_t*	source		= ( const uint8_t* )data;
+	VkDeviceSize	maxChunk	= m_ringSize / 4;
+
+	while ( size > 0 ) {
+		VkDeviceSize	chunk			= std::min( size, maxChunk );
+		uint64_t		stagingOffset	= AllocateStaging( chunk );
+
+		memcpy( m_mapped + stagingOffset, source, ( size_t )chunk );
+
+		Copy copy;
+
+		copy.Destination		= destination;
+		copy.Region.srcOffset	= stagingOffset;
+		copy.Region.dstOffset	= offset;
+		copy.Region.size		= chunk;
+
+		OpenBatch().Copies.push_back( copy );
+
+		source			+= chunk;
+		offset			+= chunk;
+		size			-= chunk;
+		m_uploadedBytes	+= chunk;
+	}
+
+	return m_nextToken;
+}
+/*
+===============
+UploadQueue::UploadImage
+
+	Stages every mip level of a freshly created image and returns the token
+	of the batch the last copy goes out in. The image must be in the
+	UNDEFINED layout and every level must be given. Levels larger than a
+	quarter of the ring are split into bands of block rows, each starting
+	on a multiple of the queue family's transfer granularity.
+===============
+*/
+UploadToken UploadQueue::UploadImage( VkImage destination, uint32_t mipLevels, uint32_t blockHeight, const std::vector<UploadImageLevel>& levels ) {
+	if ( levels.empty() ) {
+		throw std::runtime_error( "Image upload without levels" );
+	}
+
+	VkDeviceSize			maxChunk	= m_ringSize / 4;
+	uint32_t				bandRows	= std::max( blockHeight, m_imageGranularity.height ) / blockHeight;	//Block rows a split band is a multiple of
+	bool					prepared	= false;
+	VkImageMemoryBarrier	barrier		= {};
+
+	barrier.sType							= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask					= 0;
+	barrier.dstAccessMask					= VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout						= VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout						= VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.image							= destination;
+	barrier.subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel	= 0;
+	barrier.subresourceRange.levelCount		= mipLevels;
+	barrier.subresourceRange.baseArrayLayer	= 0;
+	barrier.subresourceRange.layerCount		= 1;
+
+	for ( const UploadImageLevel& level : levels ) {
+		uint32_t		blockRows	= ( level.Extent.height + blockHeight - 1 ) / blockHeight;
+		VkDeviceSize	rowBytes	= level.Size / blockRows;
+		uint32_t		chunkRows	= blockRows;
+
+		if ( level.Size > maxChunk ) {
+			if ( m_imageGranularity.height == 0 ) {
+				//The family can only copy whole levels, which then have to fit the ring in one piece
+				if ( level.Size > m_ringSize ) {
+					throw std::runtime_error( "Image level does not fit the upload ring" );
+				}
+			} else {
+				chunkRows = std::max( bandRows, ( uint32_t )( maxChunk / rowBytes ) / bandRows * bandRows );
+			}
+		}
+
+		for ( uint32_t row = 0; row < blockRows; row += chunkRows ) {
+			uint32_t		rows			= std::min( chunkRows, blockRows - row );
+			VkDeviceSize	chunk			= rows * rowBytes;
+			uint64_t		stagingOffset	= AllocateStaging( chunk );
+
+			memcpy( m_mapped + stagingOffset, ( const uint8_t* )level.Data + row * rowBytes, ( size_t )chunk );
+
+			ImageCopy copy = {};
+
+			copy.Destination							= destination;
+			copy.Region.bufferOffset					= stagingOffset;
+			copy.Region.imageSubresource.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+			copy.Region.imageSubresource.mipLevel		= level.MipLevel;
+			copy.Region.imageSubresource.layerCount		= 1;
+			copy.Region.imageOffset.y					= ( int32_t )( row * blockHeight );
+			copy.Region.imageExtent.width				= level.Extent.width;
+			copy.Region.imageExtent.height				= std::min( rows * blockHeight, level.Extent.height - row * blockHeight );
+			copy.Region.imageExtent.depth				= level.Extent.depth;
+
+			Batch& batch = OpenBatch();
+
+			//In the batch of the first copy, later batches are ordered after it on the queue
+			if ( !prepared ) {
+				batch.ImagePrepares.push_back( barrier );
+				prepared = true;
+			}
+
+			batch.ImageCopies.push_back( copy );
+			m_uploadedBytes += chunk;
+		}
+	}
+
+	barrier.srcAccessMask	= VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask	= 0;
+	barrier.oldLayout		= VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout		= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	if ( IsDedicated() ) {
+		barrier.srcQueueFamilyIndex = m_queueFamily;
+		barrier.dstQueueFamilyIndex = m_graphicsFamily;
+	}
+
+	OpenBatch().ImageReleases.push_back( barrier );
+
+	return m_nextToken;
+}
+/*
+===============
+UploadQueue::Flush
+
+	Submits every copy made since the last flush as one batch and returns its
+	token, or the last submitted token when there was nothing to submit
+===============
+*/
+UploadToken UploadQueue::Flush( void ) {
+	Batch& batch = m_batches[ m_recording ];
+
+	if ( batch.InFlight || ( batch.Copies.empty() && batch.ImageCopies.empty() ) ) {
+		return m_nextToken - 1;
+	}
+
+	Submit( batch );
+
+	m_recording = ( m_recording + 1 ) % BATCH_COUNT;
+
+	return m_nextToken++;
+}
+/*
+===============
+UploadQueue::AcquireOnGraphics
+
+	Adds the semaphore of every batch submitted since the last call to the
+	graphics submission's waits and records the acquire half of their
+	ownership transfers. The command buffer must be submitted with those
+	waits before the next Flush, outside of a render pass.
+===============
+*/
+void UploadQueue::AcquireOnGraphics( VkCommandBuffer commandBuffer, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages, DeletionQueue& deletionQueue ) {
+	for ( uint32_t index : m_unacquired ) {
+		Batch& batch = m_batches[ index ];
+
+		waitSemaphores.push_back( batch.Semaphore );
+		waitStages.push_back( CONSUMER_STAGES );
+
+		//Destroyed once the frame that waits on it has finished
+		batch.Semaphore.retire( deletionQueue );
+
+		m_pendingAcquires.insert( m_pendingAcquires.end(), batch.Acquires.begin(), batch.Acquires.end() );
+		m_pendingImageAcquires.insert( m_pendingImageAcquires.end(), batch.ImageAcquires.begin(), batch.ImageAcquires.end() );
+		batch.Acquires.clear();
+		batch.ImageAcquires.clear();
+	}
+
+	m_unacquired.clear();
+
+	if ( m_pendingAcquires.empty() && m_pendingImageAcquires.empty() ) {
+		return;
+	}
+
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, CONSUMER_STAGES, 0, 0, nullptr,
+		( uint32_t )m_pendingAcquires.size(), m_pendingAcquires.data(), ( uint32_t )m_pendingImageAcquires.size(), m_pendingImageAcquires.data() );
+
+	m_pendingAcquires.clear();
+	m_pendingImageAcquires.clear();
+}
+/*
+===============
+UploadQueue::IsComplete
+
+	Returns if the batch with the token has finished copying, without blocking
+===============
+*/
+bool UploadQueue::IsComplete( UploadToken token ) {
+	RetireCompleted();
+
+	return token <= m_completedToken;
+}
+/*
+===============
+UploadQueue::Wait
+
+	Blocks until the batch with the token has finished copying, submitting
+	it first if it is still being recorded
+===============
+*/
+void UploadQueue::Wait( UploadToken token ) {
+	if ( token >= m_nextToken ) {
+		Flush();
+	}
+
+	while ( m_completedToken < token && !m_inFlight.empty() ) {
+		RetireOldest();
+	}
+}
+/*
+===============
+UploadQueue::IsDedicated
+
+	Returns if uploads run on a queue family of their own
+===============
+*/
+bool UploadQueue::IsDedicated( void ) const {
+	return m_queueFamily != m_graphicsFamily;
+}
+/*
+===============
+UploadQueue::Report
+
+	Writes how much was uploaded and how well it batched
+===============
+*/
+void UploadQueue::Report( std::ostream& out ) const {
+	double mb = m_uploadedBytes / ( 1024.0 * 1024.0 );
+
+	out << "Uploads: " << mb << " MB in " << m_copyCount << " copies over " << m_batchCount << " submissions ("
+		<< ( m_batchCount > 0 ? ( double )m_copyCount / m_batchCount : 0.0 ) << " copies per submission, at most " << m_maxBatchCopies << "), "
+		<< ( IsDedicated() ? "dedicated transfer family " : "graphics family " ) << m_queueFamily << ", "
+		<< m_ringSize / ( 1024 * 1024 ) << " MB ring, " << m_stallMs << " ms stalled waiting for ring space" << std::endl;
+}
+/*
+===============
+UploadQueue::AllocateStaging
+
+	Reserves ring space for a copy and returns its offset in the staging
+	buffer. Copies never wrap around the end of the ring, and when the ring
+	is full the recorded copies are submitted and the oldest batch waited on
+	until enough space comes back.
+===============
+*/
+uint64_t UploadQueue::AllocateStaging( VkDeviceSize size ) {
+	for ( ;; ) {
+		uint64_t start = ( m_head + COPY_ALIGNMENT - 1 ) / COPY_ALIGNMENT * COPY_ALIGNMENT;
+
+		if ( start % m_ringSize + size > m_ringSize ) {
+			start = ( start / m_ringSize + 1 ) * m_ringSize;
+		}
+
+		if ( start + size - m_tail <= m_ringSize ) {
+			m_head = start + size;
+			return start % m_ringSize;
+		}
+
+		if ( m_inFlight.empty() && m_batches[ m_recording ].Copies.empty() && m_batches[ m_recording ].ImageCopies.empty() ) {
+			//Nothing reads the ring, so it may start over wherever the copy fits
+			m_tail = start;
+			continue;
+		}
+
+		std::chrono::high_resolution_clock::time_point stallStart = std::chrono::high_resolution_clock::now();
+
+		if ( m_inFlight.empty() ) {
+			Flush();
+		}
+
+		RetireOldest();
+
+		m_stallMs += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - stallStart ).count();
+	}
+}
+/*
+===============
+UploadQueue::OpenBatch
+
+	Returns the batch being recorded, waiting for its previous submission
+	if every batch is in flight
+===============
+*/
+UploadQueue::Batch& UploadQueue::OpenBatch( void ) {
+	Batch& batch = m_batches[ m_recording ];
+
+	//Batches are reused in submission order, so this one is the oldest in flight
+	while ( batch.InFlight ) {
+		RetireOldest();
+	}
+
+	return batch;
+}
+/*
+===============
+UploadQueue::Submit
+
+	Records a batch's copies, releasing the written ranges to the graphics
+	family when uploads have a family of their own, and submits it
+===============
+*/
+void UploadQueue::Submit( Batch& batch ) {
+	vkResetCommandPool( m_device, batch.CommandPool, 0 );
+
+	VkCommandBufferBeginInfo beginInfo = {};
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if ( vkBeginCommandBuffer( batch.CommandBuffer, &beginInfo ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not begin upload command buffer" );
+	}
+
+	if ( !batch.ImagePrepares.empty() ) {
+		vkCmdPipelineBarrier( batch.CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			( uint32_t )batch.ImagePrepares.size(), batch.ImagePrepares.data() );
+	}
+
+	std::vector<VkBufferCopy>			regions;
+	std::vector<VkBufferMemoryBarrier>	releases;
+
+	for ( size_t i = 0; i < batch.Copies.size(); ++i ) {
+		const Copy& copy = batch.Copies[ i ];
+
+		regions.push_back( copy.Region );
+
+		//Consecutive copies into one buffer go out as a single command
+		if ( i + 1 == batch.Copies.size() || batch.Copies[ i + 1 ].Destination != copy.Destination ) {
+			vkCmdCopyBuffer( batch.CommandBuffer, m_staging, copy.Destination, ( uint32_t )regions.size(), regions.data() );
+			regions.clear();
+		}
+
+		if ( !IsDedicated() ) {
+			continue;
+		}
+
+		//Ranges written back to back, as split uploads are, need only one transfer
+		if ( !releases.empty() && releases.back().buffer == copy.Destination && releases.back().offset + releases.back().size == copy.Region.dstOffset ) {
+			releases.back().size += copy.Region.size;
+			continue;
+		}
+
+		VkBufferMemoryBarrier release = {};
+
+		release.sType				= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		release.srcAccessMask		= VK_ACCESS_TRANSFER_WRITE_BIT;
+		release.dstAccessMask		= 0;
+		release.srcQueueFamilyIndex	= m_queueFamily;
+		release.dstQueueFamilyIndex	= m_graphicsFamily;
+		release.buffer				= copy.Destination;
+		release.offset				= copy.Region.dstOffset;
+		release.size				= copy.Region.size;
+
+		releases.push_back( release );
+	}
+
+	std::vector<VkBufferImageCopy> imageRegions;
+
+	for ( size_t i = 0; i < batch.ImageCopies.size(); ++i ) {
+		const ImageCopy& copy = batch.ImageCopies[ i ];
+
+		imageRegions.push_back( copy.Region );
+
+		if ( i + 1 == batch.ImageCopies.size() || batch.ImageCopies[ i + 1 ].Destination != copy.Destination ) {
+			vkCmdCopyBufferToImage( batch.CommandBuffer, m_staging, copy.Destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ( uint32_t )imageRegions.size(), imageRegions.data() );
+			imageRegions.clear();
+		}
+	}
+
+	//Images need their layout transition even without an ownership transfer
+	if ( !releases.empty() || !batch.ImageReleases.empty() ) {
+		vkCmdPipelineBarrier( batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+			( uint32_t )releases.size(), releases.data(), ( uint32_t )batch.ImageReleases.size(), batch.ImageReleases.data() );
+
+		//The acquire must match the release, only the access masks differ
+		for ( VkBufferMemoryBarrier& acquire : releases ) {
+			acquire.srcAccessMask = 0;
+			acquire.dstAccessMask = CONSUMER_ACCESS;
+		}
+
+		batch.Acquires = std::move( releases );
+
+		if ( IsDedicated() ) {
+			for ( VkImageMemoryBarrier& acquire : batch.ImageReleases ) {
+				acquire.srcAccessMask = 0;
+				acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			}
+
+			batch.ImageAcquires = std::move( batch.ImageReleases );
+		}
+
+		batch.ImageReleases.clear();
+	}
+
+	if ( vkEndCommandBuffer( batch.CommandBuffer ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not record upload command buffer" );
+	}
+
+	//A fresh semaphore per batch, the last one may still be waited on by a graphics frame in flight
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	batch.Semaphore = VKSemaphoreHandle( m_device );
+
+	if ( vkCreateSemaphore( m_device, &semaphoreInfo, HostAllocator::Installed(), batch.Semaphore.replace() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not create upload semaphore" );
+	}
+
+	VkSemaphore		semaphore	= batch.Semaphore;
+	VkSubmitInfo	submitInfo	= {};
+
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &batch.CommandBuffer;
+	submitInfo.signalSemaphoreCount	= 1;
+	submitInfo.pSignalSemaphores	= &semaphore;
+
+	vkResetFences( m_device, 1, &batch.Fence );
+
+	if ( vkQueueSubmit( m_queue, 1, &submitInfo, batch.Fence ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not submit uploads" );
+	}
+
+	m_copyCount			+= batch.Copies.size() + batch.ImageCopies.size();
+	m_maxBatchCopies	= std::max( m_maxBatchCopies, ( uint64_t )( batch.Copies.size() + batch.ImageCopies.size() ) );
+	++m_batchCount;
+
+	batch.Token		= m_nextToken;
+	batch.RingEnd	= m_head;
+	batch.InFlight	= true;
+	batch.Copies.clear();
+	batch.ImageCopies.clear();
+	batch.ImagePrepares.clear();
+
+	m_inFlight.push_back( m_recording );
+	m_unacquired.push_back( m_recording );
+}
+/*
+===============
+UploadQueue::RetireCompleted
+
+	Retires every batch that has finished, without blocking
+===============
+*/
+void UploadQueue::RetireCompleted( void ) {
+	while ( !m_inFlight.empty() && vkGetFenceStatus( m_device, m_batches[ m_inFlight.front() ].Fence ) == VK_SUCCESS ) {
+		Retire( m_batches[ m_inFlight.front() ] );
+	}
+}
+/*
+===============
+UploadQueue::RetireOldest
+
+	Blocks until the oldest batch in flight has finished and retires it
+===============
+*/
+void UploadQueue::RetireOldest( void ) {
+	Batch& batch = m_batches[ m_inFlight.front() ];
+
+	if ( vkWaitForFences( m_device, 1, &batch.Fence, VK_TRUE, std::numeric_limits<uint64_t>::max() ) != VK_SUCCESS ) {
+		throw std::runtime_error( "Could not wait for uploads" );
+	}
+
+	Retire( batch );
+}
+/*
+===============
+UploadQueue::Retire
+
+	Returns a finished batch's ring space. A batch the graphics queue never
+	waited on has its semaphore destroyed, the host having seen its fence
+	is ordering enough, but its acquire barriers are still owed.
+===============
+*/
+void UploadQueue::Retire( Batch& batch ) {
+	if ( !m_unacquired.empty() && m_unacquired.front() == m_inFlight.front() ) {
+		m_pendingAcquires.insert( m_pendingAcquires.end(), batch.Acquires.begin(), batch.Acquires.end() );
+		m_pendingImageAcquires.insert( m_pendingImageAcquires.end(), batch.ImageAcquires.begin(), batch.ImageAcquires.end() );
+		batch.Acquires.clear();
+		batch.ImageAcquires.clear();
+		batch.Semaphore.reset();
+
+		m_unacquired.pop_front();
+	}
+
+	m_tail				= batch.RingEnd;
+	m_completedToken	= batch.Token;
+	batch.InFlight		= false;
+
+	m_inFlight.pop_front();
+}
+}
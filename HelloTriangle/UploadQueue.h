@@ -0,0 +1,133 @@
+#ifndef __UPLOADQUEUE_H__
+#define __UPLOADQUEUE_H__
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "DeviceMemoryAllocator.h"
+#include "VKHandle.h"
+
+namespace tut {
+
+//The batch an upload went out in, later batches have larger tokens
+typedef uint64_t UploadToken;
+
+/*
+	One mip level of an image upload. Data holds tightly packed rows of
+	texel blocks, the last row and column padded out to whole blocks.
+*/
+struct UploadImageLevel {
+	uint32_t			MipLevel	= 0;
+	VkExtent3D			Extent		= {};	//In texels
+	const void*			Data		= nullptr;
+	VkDeviceSize		Size		= 0;
+};
+
+/*
+===============
+UploadQueue
+
+	Copies host data into device buffers on the transfer queue. Data is
+	written into a persistently mapped staging ring and every copy made
+	before a Flush goes out in one submission. When the transfer queue has
+	a family of its own, each batch releases its ranges to the graphics
+	family and signals a semaphore; AcquireOnGraphics hands the semaphores
+	and matching acquire barriers to the next graphics submission. Images
+	are uploaded whole, right after creation, and end up in
+	SHADER_READ_ONLY_OPTIMAL.
+
+	A destination range must not be in use by the GPU while it is uploaded
+	to. Only one thread may use the queue.
+===============
+*/
+class UploadQueue {
+public:
+											UploadQueue( VkDevice device, DeviceMemoryAllocator& deviceMemory, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily, VkExtent3D imageGranularity, VkDeviceSize ringSize );
+											~UploadQueue( void );
+
+	UploadQueue( const UploadQueue& ) = delete;
+	UploadQueue& operator=( const UploadQueue& ) = delete;
+
+	UploadToken								UploadBuffer( VkBuffer destination, VkDeviceSize offset, const void* data, VkDeviceSize size );
+	UploadToken								UploadImage( VkImage destination, uint32_t mipLevels, uint32_t blockHeight, const std::vector<UploadImageLevel>& levels );
+	UploadToken								Flush( void );
+	void									AcquireOnGraphics( VkCommandBuffer commandBuffer, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages, DeletionQueue& deletionQueue );
+
+	bool									IsComplete( UploadToken token );
+	void									Wait( UploadToken token );
+
+	bool									IsDedicated( void ) const;
+	void									Report( std::ostream& out ) const;
+
+private:
+	struct Copy {
+		VkBuffer							Destination;
+		VkBufferCopy						Region;
+	};
+
+	struct ImageCopy {
+		VkImage								Destination;
+		VkBufferImageCopy					Region;
+	};
+
+	struct Batch {
+		VKCommandPoolHandle					CommandPool;
+		VkCommandBuffer						CommandBuffer	= VK_NULL_HANDLE;
+		VKFenceHandle						Fence;
+		VKSemaphoreHandle					Semaphore;
+		std::vector<Copy>					Copies;
+		std::vector<ImageCopy>				ImageCopies;
+		std::vector<VkImageMemoryBarrier>	ImagePrepares;	//To TRANSFER_DST_OPTIMAL, before the first copy into an image
+		std::vector<VkImageMemoryBarrier>	ImageReleases;	//To SHADER_READ_ONLY_OPTIMAL, after the last copy into an image
+		std::vector<VkBufferMemoryBarrier>	Acquires;
+		std::vector<VkImageMemoryBarrier>	ImageAcquires;
+		UploadToken							Token			= 0;
+		uint64_t							RingEnd			= 0;
+		bool								InFlight		= false;
+	};
+
+	uint64_t								AllocateStaging( VkDeviceSize size );
+	Batch&									OpenBatch( void );
+	void									Submit( Batch& batch );
+	void									RetireCompleted( void );
+	void									RetireOldest( void );
+	void									Retire( Batch& batch );
+
+	VkDevice								m_device;
+	DeviceMemoryAllocator&					m_deviceMemory;
+	VkQueue									m_queue;
+	uint32_t								m_queueFamily;
+	uint32_t								m_graphicsFamily;
+	VkExtent3D								m_imageGranularity;	//All zero when only whole mip levels may be copied
+
+	VKBufferHandle							m_staging;
+	DeviceAllocation*						m_stagingMemory{ nullptr };
+	uint8_t*								m_mapped{ nullptr };
+	VkDeviceSize							m_ringSize;
+	uint64_t								m_head{ 0 };	//Ring positions only ever grow, the offset is the position modulo the ring size
+	uint64_t								m_tail{ 0 };
+
+	std::vector<Batch>						m_batches;
+	uint32_t								m_recording{ 0 };
+	std::deque<uint32_t>					m_inFlight;		//Submission order, so the front always finishes first
+	std::deque<uint32_t>					m_unacquired;	//Submitted batches the graphics queue has not waited on yet
+	std::vector<VkBufferMemoryBarrier>		m_pendingAcquires;
+	std::vector<VkImageMemoryBarrier>		m_pendingImageAcquires;
+	UploadToken								m_nextToken{ 1 };
+	UploadToken								m_completedToken{ 0 };
+
+	uint64_t								m_uploadedBytes{ 0 };
+	uint64_t								m_copyCount{ 0 };
+	uint64_t								m_batchCount{ 0 };
+	uint64_t								m_maxBatchCopies{ 0 };
+	double									m_stallMs{ 0.0 };
+};
+
+}
+
+#endif // !__UPLOADQUEUE_H__
@@ -0,0 +1,368 @@
+#ifndef __VKHANDLE_H__
+#define __VKHANDLE_H__
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <utility>
+
+#include "DeletionQueue.h"
+#include "HostAllocator.h"
+#include "VulkanProxies.h"
+
+namespace tut {
+
+/*
+===============
+VKHandle
+
+	Move-only owner of a Vulkan handle. The destroy function is a template
+	argument so the handle is exactly one pointer wide and destruction is a
+	direct call.
+===============
+*/
+template<typename T, void ( VKAPI_PTR *Destroy )( T, const VkAllocationCallbacks* )>
+class VKHandle {
+public:
+	/*
+	===============
+	VKHandle::VKHandle
+
+		Default no-arg constructor
+	===============
+	*/
+	VKHandle( void )
+	{}
+	/*
+	===============
+	VKHandle::VKHandle
+
+		Move constructor, takes ownership of the other handle
+	===============
+	*/
+	VKHandle( VKHandle&& other ) :
+		m_object( other.release() )
+	{}
+	/*
+	===============
+	VKHandle::~VKHandle
+
+		Destructor for the VKHandle. Cleans up resources
+	===============
+	*/
+	~VKHandle( void ) {
+		cleanup();
+	}
+
+	VKHandle( const VKHandle& ) = delete;
+	VKHandle& operator=( const VKHandle& ) = delete;
+
+	/*
+	===============
+	VKHandle::operator=
+
+		Move assignment, destroys the current object first
+	===============
+	*/
+	VKHandle& operator=( VKHandle&& rhs ) {
+		if ( this != std::addressof( rhs ) ) {
+			cleanup();
+			m_object = rhs.release();
+		}
+
+		return *this;
+	}
+	/*
+	===============
+	VKHandle::operator&
+
+		Returns the m_object this handle is holding
+	===============
+	*/
+	const T* operator&( void ) const {
+		return &m_object;
+	}
+	/*
+	===============
+	VKHandle::operator
+
+		Casts this handle to it's source m_object
+	===============
+	*/
+	operator T( void ) const {
+		return m_object;
+	}
+	/*
+	===============
+	VKHandle::replace
+
+		Frees up the current m_object before returning a reference to it.
+	===============
+	*/
+	T* replace( void ) {
+		cleanup();
+		return &m_object;
+	}
+	/*
+	===============
+	VKHandle::release
+
+		Gives up ownership of the m_object without destroying it
+	===============
+	*/
+	T release( void ) {
+		T object = m_object;
+		m_object = VK_NULL_HANDLE;
+		return object;
+	}
+	/*
+	===============
+	VKHandle::reset
+
+		Destroys the current m_object
+	===============
+	*/
+	void reset( void ) {
+		cleanup();
+	}
+
+private:
+	T	m_object{ VK_NULL_HANDLE };
+
+	/*
+	===============
+	VKHandle::cleanup
+
+		Frees up the current m_object's resource from Vulkan
+	===============
+	*/
+	void cleanup( void ) {
+		if ( m_object != VK_NULL_HANDLE ) {
+			Destroy( m_object, HostAllocator::Installed() );
+		}
+
+		m_object = VK_NULL_HANDLE;
+	}
+};
+
+/*
+===============
+VKChildHandle
+
+	Move-only owner of a Vulkan handle that is destroyed through its parent
+	(a VkInstance or VkDevice). Stores the parent alongside the handle, so the
+	wrapper is two pointers wide.
+===============
+*/
+template<typename P, typename T, void ( VKAPI_PTR *Destroy )( P, T, const VkAllocationCallbacks* )>
+class VKChildHandle {
+public:
+	/*
+	===============
+	VKChildHandle::VKChildHandle
+
+		Default no-arg constructor
+	===============
+	*/
+	VKChildHandle( void )
+	{}
+	/*
+	===============
+	VKChildHandle::VKChildHandle
+
+		Constructor by passing in the parent the m_object is destroyed from
+	===============
+	*/
+	explicit VKChildHandle( P parent ) :
+		m_parent( parent )
+	{}
+	/*
+	===============
+	VKChildHandle::VKChildHandle
+
+		Move constructor, takes ownership of the other handle
+	===============
+	*/
+	VKChildHandle( VKChildHandle&& other ) :
+		m_parent( other.m_parent ),
+		m_object( other.release() )
+	{}
+	/*
+	===============
+	VKChildHandle::~VKChildHandle
+
+		Destructor for the VKChildHandle. Cleans up resources
+	===============
+	*/
+	~VKChildHandle( void ) {
+		cleanup();
+	}
+
+	VKChildHandle( const VKChildHandle& ) = delete;
+	VKChildHandle& operator=( const VKChildHandle& ) = delete;
+
+	/*
+	===============
+	VKChildHandle::operator=
+
+		Move assignment, destroys the current object first
+	===============
+	*/
+	VKChildHandle& operator=( VKChildHandle&& rhs ) {
+		if ( this != std::addressof( rhs ) ) {
+			cleanup();
+			m_parent = rhs.m_parent;
+			m_object = rhs.release();
+		}
+
+		return *this;
+	}
+	/*
+	===============
+	VKChildHandle::operator&
+
+		Returns the m_object this handle is holding
+	===============
+	*/
+	const T* operator&( void ) const {
+		return &m_object;
+	}
+	/*
+	===============
+	VKChildHandle::operator
+
+		Casts this handle to it's source m_object
+	===============
+	*/
+	operator T( void ) const {
+		return m_object;
+	}
+	/*
+	===============
+	VKChildHandle::parent
+
+		Returns the parent the m_object is destroyed from
+	===============
+	*/
+	P parent( void ) const {
+		return m_parent;
+	}
+	/*
+	===============
+	VKChildHandle::replace
+
+		Frees up the current m_object before returning a reference to it.
+	===============
+	*/
+	T* replace( void ) {
+		cleanup();
+		return &m_object;
+	}
+	/*
+	===============
+	VKChildHandle::replace
+
+		Hands the current m_object to the deletion queue instead of destroying
+		it, so frames still in flight can keep using it.
+	===============
+	*/
+	T* replace( DeletionQueue& deletionQueue ) {
+		retire( deletionQueue );
+		return &m_object;
+	}
+	/*
+	===============
+	VKChildHandle::retire
+
+		Moves the current m_object into the deletion queue
+	===============
+	*/
+	void retire( DeletionQueue& deletionQueue ) {
+		if ( m_object != VK_NULL_HANDLE ) {
+			deletionQueue.Push( DeferredDestroy, DeletionQueue::ToRaw( m_parent ), DeletionQueue::ToRaw( m_object ) );
+		}
+
+		m_object = VK_NULL_HANDLE;
+	}
+	/*
+	===============
+	VKChildHandle::release
+
+		Gives up ownership of the m_object without destroying it
+	===============
+	*/
+	T release( void ) {
+		T object = m_object;
+		m_object = VK_NULL_HANDLE;
+		return object;
+	}
+	/*
+	===============
+	VKChildHandle::reset
+
+		Destroys the current m_object
+	===============
+	*/
+	void reset( void ) {
+		cleanup();
+	}
+
+private:
+	P	m_parent{ VK_NULL_HANDLE };
+	T	m_object{ VK_NULL_HANDLE };
+
+	/*
+	===============
+	VKChildHandle::DeferredDestroy
+
+		Destroy thunk stored in the deletion queue
+	===============
+	*/
+	static void DeferredDestroy( uint64_t parent, uint64_t object ) {
+		Destroy( DeletionQueue::FromRaw<P>( parent ), DeletionQueue::FromRaw<T>( object ), HostAllocator::Installed() );
+	}
+
+	/*
+	===============
+	VKChildHandle::cleanup
+
+		Frees up the current m_object's resource from Vulkan
+	===============
+	*/
+	void cleanup( void ) {
+		if ( m_object != VK_NULL_HANDLE ) {
+			Destroy( m_parent, m_object, HostAllocator::Installed() );
+		}
+
+		m_object = VK_NULL_HANDLE;
+	}
+};
+
+typedef VKHandle<VkInstance, vkDestroyInstance>															VKInstanceHandle;
+typedef VKHandle<VkDevice, vkDestroyDevice>																VKDeviceHandle;
+typedef VKChildHandle<VkInstance, VkSurfaceKHR, vkDestroySurfaceKHR>									VKSurfaceHandle;
+typedef VKChildHandle<VkInstance, VkDebugUtilsMessengerEXT, VulkanProxies::DestroyDebugUtilsMessengerEXT>	VKDebugUtilsMessengerHandle;
+typedef VKChildHandle<VkDevice, VkSwapchainKHR, vkDestroySwapchainKHR>									VKSwapchainHandle;
+typedef VKChildHandle<VkDevice, VkImageView, vkDestroyImageView>										VKImageViewHandle;
+typedef VKChildHandle<VkDevice, VkShaderModule, vkDestroyShaderModule>									VKShaderModuleHandle;
+typedef VKChildHandle<VkDevice, VkDeviceMemory, vkFreeMemory>											VKDeviceMemoryHandle;
+typedef VKChildHandle<VkDevice, VkPipelineCache, vkDestroyPipelineCache>								VKPipelineCacheHandle;
+typedef VKChildHandle<VkDevice, VkImage, vkDestroyImage>												VKImageHandle;
+typedef VKChildHandle<VkDevice, VkBuffer, vkDestroyBuffer>												VKBufferHandle;
+typedef VKChildHandle<VkDevice, VkRenderPass, vkDestroyRenderPass>										VKRenderPassHandle;
+typedef VKChildHandle<VkDevice, VkFramebuffer, vkDestroyFramebuffer>									VKFramebufferHandle;
+typedef VKChildHandle<VkDevice, VkPipelineLayout, vkDestroyPipelineLayout>								VKPipelineLayoutHandle;
+typedef VKChildHandle<VkDevice, VkPipeline, vkDestroyPipeline>											VKPipelineHandle;
+typedef VKChildHandle<VkDevice, VkCommandPool, vkDestroyCommandPool>									VKCommandPoolHandle;
+typedef VKChildHandle<VkDevice, VkFence, vkDestroyFence>												VKFenceHandle;
+typedef VKChildHandle<VkDevice, VkSemaphore, vkDestroySemaphore>										VKSemaphoreHandle;
+typedef VKChildHandle<VkDevice, VkQueryPool, vkDestroyQueryPool>										VKQueryPoolHandle;
+typedef VKChildHandle<VkDevice, VkDescriptorSetLayout, vkDestroyDescriptorSetLayout>					VKDescriptorSetLayoutHandle;
+typedef VKChildHandle<VkDevice, VkDescriptorPool, vkDestroyDescriptorPool>								VKDescriptorPoolHandle;
+typedef VKChildHandle<VkDevice, VkSampler, vkDestroySampler>											VKSamplerHandle;
+
+static_assert( sizeof( VKInstanceHandle ) == sizeof( VkInstance ), "Root handles must be one pointer wide" );
+static_assert( sizeof( VKImageViewHandle ) <= 2 * sizeof( uint64_t ), "Child handles must be two handles wide" );
+
+}
+
+#endif //__VKHANDLE_H__
@@ -1,11 +1,19 @@
 #ifndef __VKWRAPPER_H__
 #define __VKWRAPPER_H__
 
-#include <vulkan\vulkan.h>
+#include <vulkan/vulkan.h>
 #include <functional>
 
 namespace tut {
 
+/*
+===============
+VKWrapper
+
+	Type-erased handle wrapper. Superseded by VKHandle/VKChildHandle and only
+	kept as the baseline for the handle benchmark.
+===============
+*/
 template<typename T>
 class VKWrapper {
 public:
@@ -56,7 +64,7 @@ public:
 		Destructor for the VKWrapper. Cleans up resources
 	===============
 	*/
-	VKWrapper::~VKWrapper( void ) {
+	~VKWrapper( void ) {
 		cleanup();
 	}
 
@@ -3,39 +3,39 @@
 namespace tut {
 /*
 ===============
-VulkanProxies::SetupDebugReportCallbackEXT
+VulkanProxies::CreateDebugUtilsMessengerEXT
 
-	Proxy for the vkCreateDebugReportCallbackEXT function
+	Proxy for the vkCreateDebugUtilsMessengerEXT function
 ===============
 */
-VkResult VulkanProxies::CreateDebugReportCallbackEXT( 
+VKAPI_ATTR VkResult VKAPI_CALL VulkanProxies::CreateDebugUtilsMessengerEXT( 
 	VkInstance instance,
-	const VkDebugReportCallbackCreateInfoEXT* pCreateInfo,
+	const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
 	const VkAllocationCallbacks* pAllocator,
-	VkDebugReportCallbackEXT* pCallback 
+	VkDebugUtilsMessengerEXT* pMessenger 
 ) {
-	PFN_vkCreateDebugReportCallbackEXT func = ( PFN_vkCreateDebugReportCallbackEXT )vkGetInstanceProcAddr( instance, "vkCreateDebugReportCallbackEXT" );
+	PFN_vkCreateDebugUtilsMessengerEXT func = ( PFN_vkCreateDebugUtilsMessengerEXT )vkGetInstanceProcAddr( instance, "vkCreateDebugUtilsMessengerEXT" );
 	if ( func != nullptr ) {
-		return func( instance, pCreateInfo, pAllocator, pCallback );
+		return func( instance, pCreateInfo, pAllocator, pMessenger );
 	} else {
 		return VK_ERROR_EXTENSION_NOT_PRESENT;
 	}
 }
 /*
 ===============
-VulkanProxies::DestroyDebugReportCallbackEXT
+VulkanProxies::DestroyDebugUtilsMessengerEXT
 
-	Proxy for the vkCreateDebugReportCallbackEXT function
+	Proxy for the vkDestroyDebugUtilsMessengerEXT function
 ===============
 */
-void VulkanProxies::DestroyDebugReportCallbackEXT( 
+VKAPI_ATTR void VKAPI_CALL VulkanProxies::DestroyDebugUtilsMessengerEXT( 
 	VkInstance instance,
-	VkDebugReportCallbackEXT callback,
+	VkDebugUtilsMessengerEXT messenger,
 	const VkAllocationCallbacks* pAllocator
 ) {
-	PFN_vkDestroyDebugReportCallbackEXT func = ( PFN_vkDestroyDebugReportCallbackEXT )vkGetInstanceProcAddr( instance, "vkDestroyDebugReportCallbackEXT" );
+	PFN_vkDestroyDebugUtilsMessengerEXT func = ( PFN_vkDestroyDebugUtilsMessengerEXT )vkGetInstanceProcAddr( instance, "vkDestroyDebugUtilsMessengerEXT" );
 	if ( func != nullptr ) {
-		func( instance, callback, pAllocator );
+		func( instance, messenger, pAllocator );
 	}
 }
 }
\ No newline at end of file
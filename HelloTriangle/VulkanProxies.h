@@ -1,22 +1,22 @@
 #ifndef __VULKANPROXIES_H__
 #define __VULKANPROXIES_H__
 
-#include <vulkan\vulkan.h>
+#include <vulkan/vulkan.h>
 
 namespace tut {
 
 class VulkanProxies {
 public:
-	static VkResult	CreateDebugReportCallbackEXT(
+	static VKAPI_ATTR VkResult VKAPI_CALL	CreateDebugUtilsMessengerEXT(
 						VkInstance instance,
-						const VkDebugReportCallbackCreateInfoEXT* pCreateInfo,
+						const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
 						const VkAllocationCallbacks* pAllocator,
-						VkDebugReportCallbackEXT* pCallback
+						VkDebugUtilsMessengerEXT* pMessenger
 					);
 
-	static void		DestroyDebugReportCallbackEXT(
+	static VKAPI_ATTR void VKAPI_CALL		DestroyDebugUtilsMessengerEXT(
 						VkInstance instance,
-						VkDebugReportCallbackEXT callback,
+						VkDebugUtilsMessengerEXT messenger,
 						const VkAllocationCallbacks* pAllocator
 					);
 };
@@ -0,0 +1,55 @@
+#version 450
+#extension GL_ARB_seperate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+//Matches CullInstance, only the transform is read here
+struct Instance {
+	vec4	transform;	//xyz translation, w uniform scale
+	vec4	bounds;
+	uint	batch;
+	uint	padding0;
+	uint	padding1;
+	uint	padding2;
+};
+
+//The bindless table's storage buffer array, see BindlessTable
+layout( std430, set = 0, binding = 1 ) readonly buffer Instances {
+	Instance instances[];
+} buffers[];
+
+//The buffer index is pushed per draw, so it is uniform across the draw
+layout( push_constant ) uniform Draw {
+	mat4 viewProjection;
+	uint feedbackBuffer;
+	uint instanceBuffer;
+	uint texture;
+	uint textureId;
+} draw;
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+vec2 positions[ 3 ] = vec2[](
+	vec2(  0.0, -0.5 ),
+	vec2(  0.5,  0.5 ),
+	vec2( -0.5,  0.5 )
+);
+
+vec3 colors[ 3 ] = vec3[](
+	vec3( 1.0, 0.0, 0.0 ),
+	vec3( 0.0, 1.0, 0.0 ),
+	vec3( 0.0, 0.0, 1.0 )
+);
+
+layout( location = 0 ) out vec3 fragColor;
+layout( location = 1 ) out vec2 fragTexCoord;
+
+void main() {
+	vec4 transform = buffers[ draw.instanceBuffer ].instances[ gl_InstanceIndex ].transform;
+
+	gl_Position = draw.viewProjection * vec4( vec3( positions[ gl_VertexIndex ], 0.0 ) * transform.w + transform.xyz, 1.0 );
+
+	fragColor = colors[ gl_VertexIndex ];
+	fragTexCoord = positions[ gl_VertexIndex ] + 0.5;
+}
\ No newline at end of file
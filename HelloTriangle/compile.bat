@@ -1,3 +1,23 @@
-D:/sdk/Vulkan/1.0.33.0/Bin32/glslangValidator.exe -V shader.vert
-D:/sdk/Vulkan/1.0.33.0/Bin32/glslangValidator.exe -V shader.frag
-pause
\ No newline at end of file
+@echo off
+rem Compiles the shaders to SPIR-V and embeds them in generated\*.spv.h
+rem Uses glslangValidator from the Vulkan SDK the installer points VULKAN_SDK at
+setlocal
+cd /d "%~dp0"
+
+set GLSLANG="%VULKAN_SDK%\Bin\glslangValidator.exe"
+
+if not exist generated mkdir generated
+
+%GLSLANG% -V shader.vert -o vert.spv || exit /b 1
+%GLSLANG% -V shader.frag -o frag.spv || exit /b 1
+%GLSLANG% -V mesh.vert -o mesh_vert.spv || exit /b 1
+%GLSLANG% -V cull.comp -o cull.spv || exit /b 1
+%GLSLANG% -V bindless.vert -o bindless_vert.spv || exit /b 1
+%GLSLANG% -V textured.frag -o textured_frag.spv || exit /b 1
+
+%GLSLANG% -V --vn VertShaderCode shader.vert -o generated\vert.spv.h || exit /b 1
+%GLSLANG% -V --vn FragShaderCode shader.frag -o generated\frag.spv.h || exit /b 1
+%GLSLANG% -V --vn MeshVertShaderCode mesh.vert -o generated\mesh_vert.spv.h || exit /b 1
+%GLSLANG% -V --vn CullShaderCode cull.comp -o generated\cull.spv.h || exit /b 1
+%GLSLANG% -V --vn BindlessVertShaderCode bindless.vert -o generated\bindless_vert.spv.h || exit /b 1
+%GLSLANG% -V --vn TexturedFragShaderCode textured.frag -o generated\textured_frag.spv.h || exit /b 1
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Compiles the shaders to SPIR-V and embeds them in generated/*.spv.h
+# Uses glslangValidator from $VULKAN_SDK when set, otherwise from PATH
+set -e
+
+cd "$(dirname "$0")"
+
+if [ -n "$VULKAN_SDK" ]; then
+	GLSLANG="$VULKAN_SDK/bin/glslangValidator"
+else
+	GLSLANG=glslangValidator
+fi
+
+mkdir -p generated
+
+"$GLSLANG" -V shader.vert -o vert.spv
+"$GLSLANG" -V shader.frag -o frag.spv
+"$GLSLANG" -V mesh.vert -o mesh_vert.spv
+"$GLSLANG" -V cull.comp -o cull.spv
+"$GLSLANG" -V bindless.vert -o bindless_vert.spv
+"$GLSLANG" -V textured.frag -o textured_frag.spv
+
+"$GLSLANG" -V --vn VertShaderCode shader.vert -o generated/vert.spv.h
+"$GLSLANG" -V --vn FragShaderCode shader.frag -o generated/frag.spv.h
+"$GLSLANG" -V --vn MeshVertShaderCode mesh.vert -o generated/mesh_vert.spv.h
+"$GLSLANG" -V --vn CullShaderCode cull.comp -o generated/cull.spv.h
+"$GLSLANG" -V --vn BindlessVertShaderCode bindless.vert -o generated/bindless_vert.spv.h
+"$GLSLANG" -V --vn TexturedFragShaderCode textured.frag -o generated/textured_frag.spv.h
@@ -1,10 +1,259 @@
-#include <vulkan\vulkan.h>
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "HelloTriangleApplication.h"
+#include "Benchmarks.h"
+#include "DebugMessenger.h"
+#include "MeshFile.h"
+#include "ShaderStore.h"
+#include "TextureFile.h"
+
+namespace {
+
+/*
+	Parses the option at argument when it is one of the parser's, moving
+	argument past its value. Returns false for options it does not know;
+	valid is cleared when the option is known but its value is not.
+*/
+typedef bool ( *OptionParser )( int argc, char** argv, int& argument, tut::ApplicationOptions& options, bool& valid );
+
+/*
+	A mode running a benchmark on a headless device instead of rendering
+	frames. Either Enable or Count turns it on; Count also takes an optional
+	leading number. HostBenchmark runs first and needs no device.
+*/
+struct BenchmarkMode {
+	const char*							Flag;
+	bool tut::ApplicationOptions::*		Enable;
+	uint32_t tut::ApplicationOptions::*	Count;
+	uint32_t							DefaultCount;
+	int									( *HostBenchmark )( void );
+};
+
+const BenchmarkMode BENCHMARK_MODES[] = {
+	{ "--bench-device-memory",	&tut::ApplicationOptions::DeviceMemoryBenchmark,	nullptr,											0,		tut::Benchmarks::RunDeviceMemoryBenchmark },
+	{ "--bench-recording",		nullptr,											&tut::ApplicationOptions::RecordingBenchmarkDraws,	100000,	nullptr },
+	{ "--bench-culling",		&tut::ApplicationOptions::CullingBenchmark,			nullptr,											0,		nullptr },
+	{ "--bench-descriptors",	&tut::ApplicationOptions::DescriptorBenchmark,		nullptr,											0,		nullptr },
+	{ "--bench-render-graph",	&tut::ApplicationOptions::RenderGraphBenchmark,		nullptr,											0,		nullptr },
+};
+
+/*
+===============
+ParseSharedOption
+
+	[--record-threads n] [--draws n] [--gpu-culling] [--bindless] [--render-graph] [--serial-init] [--debug-severity error,warning,info,verbose|all] [--device index|name] [--mesh file.mesh] [--texture file.tex]... [--texture-budget MB] [--stream-upload [MB]] [--profile trace.json]
+	taken by every mode
+===============
+*/
+bool ParseSharedOption( int argc, char** argv, int& argument, tut::ApplicationOptions& options, bool& valid ) {
+	if ( strcmp( argv[ argument ], "--record-threads" ) == 0 && argument + 1 < argc ) {
+		options.RecordThreads = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+	} else if ( strcmp( argv[ argument ], "--draws" ) == 0 && argument + 1 < argc ) {
+		options.DrawsPerFrame = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+	} else if ( strcmp( argv[ argument ], "--gpu-culling" ) == 0 ) {
+		options.CullOnGpu = true;
+	} else if ( strcmp( argv[ argument ], "--bindless" ) == 0 ) {
+		options.Bindless = true;
+	} else if ( strcmp( argv[ argument ], "--render-graph" ) == 0 ) {
+		options.PrintRenderGraph = true;
+	} else if ( strcmp( argv[ argument ], "--serial-init" ) == 0 ) {
+		options.SerialInit = true;
+	} else if ( strcmp( argv[ argument ], "--debug-severity" ) == 0 && argument + 1 < argc ) {
+		if ( !tut::DebugMessenger::ParseSeverities( argv[ ++argument ], options.DebugSeverities ) ) {
+			std::cerr << "Unknown debug severity in " << argv[ argument ] << std::endl;
+			valid = false;
+		}
+	} else if ( strcmp( argv[ argument ], "--device" ) == 0 && argument + 1 < argc ) {
+		options.PreferredDevice = argv[ ++argument ];
+	} else if ( strcmp( argv[ argument ], "--mesh" ) == 0 && argument + 1 < argc ) {
+		options.MeshPath = argv[ ++argument ];
+	} else if ( strcmp( argv[ argument ], "--texture" ) == 0 && argument + 1 < argc ) {
+		options.TexturePaths.push_back( argv[ ++argument ] );
+	} else if ( strcmp( argv[ argument ], "--texture-budget" ) == 0 && argument + 1 < argc ) {
+		options.TextureBudgetMB = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+	} else if ( strcmp( argv[ argument ], "--stream-upload" ) == 0 ) {
+		options.StreamUploadMB = 256;
+		if ( argument + 1 < argc && argv[ argument + 1 ][ 0 ] != '-' ) {
+			options.StreamUploadMB = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+		}
+	} else if ( strcmp( argv[ argument ], "--profile" ) == 0 && argument + 1 < argc ) {
+		options.ProfilePath = argv[ ++argument ];
+	} else {
+		return false;
+	}
+
+	return true;
+}
+/*
+===============
+ParseHeadlessOption
+
+	[--output dir] [--raw] [--readback-depth n] [--writer-threads n]
+===============
+*/
+bool ParseHeadlessOption( int argc, char** argv, int& argument, tut::ApplicationOptions& options, bool& /*valid*/ ) {
+	if ( strcmp( argv[ argument ], "--output" ) == 0 && argument + 1 < argc ) {
+		options.OutputDirectory = argv[ ++argument ];
+	} else if ( strcmp( argv[ argument ], "--raw" ) == 0 ) {
+		options.RawOutput = true;
+	} else if ( strcmp( argv[ argument ], "--readback-depth" ) == 0 && argument + 1 < argc ) {
+		options.ReadbackDepth = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+	} else if ( strcmp( argv[ argument ], "--writer-threads" ) == 0 && argument + 1 < argc ) {
+		options.WriterThreads = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+	} else {
+		return false;
+	}
+
+	return true;
+}
+/*
+===============
+ParseWindowOption
+
+	[--present-policy low-latency|throughput|power-save] [--present-log file.csv] [--frames-in-flight n] [--resize-stress [seconds]]
+===============
+*/
+bool ParseWindowOption( int argc, char** argv, int& argument, tut::ApplicationOptions& options, bool& valid ) {
+	if ( strcmp( argv[ argument ], "--present-policy" ) == 0 && argument + 1 < argc ) {
+		const char* policy = argv[ ++argument ];
+
+		if ( strcmp( policy, "low-latency" ) == 0 ) {
+			options.Presentation = tut::PresentPolicy::LowLatency;
+		} else if ( strcmp( policy, "throughput" ) == 0 ) {
+			options.Presentation = tut::PresentPolicy::Throughput;
+		} else if ( strcmp( policy, "power-save" ) == 0 ) {
+			options.Presentation = tut::PresentPolicy::PowerSave;
+		} else {
+			std::cerr << "Unknown present policy " << policy << std::endl;
+			valid = false;
+		}
+	} else if ( strcmp( argv[ argument ], "--present-log" ) == 0 && argument + 1 < argc ) {
+		options.PresentLogPath = argv[ ++argument ];
+	} else if ( strcmp( argv[ argument ], "--frames-in-flight" ) == 0 && argument + 1 < argc ) {
+		options.FramesInFlight = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+	} else if ( strcmp( argv[ argument ], "--resize-stress" ) == 0 ) {
+		options.ResizeStressSeconds = 10;
+		if ( argument + 1 < argc && argv[ argument + 1 ][ 0 ] != '-' ) {
+			options.ResizeStressSeconds = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+		}
+	} else {
+		return false;
+	}
+
+	return true;
+}
+/*
+===============
+ParseBenchmarkOption
+
+	[--max-threads n], the recording benchmark's name for --record-threads
+===============
+*/
+bool ParseBenchmarkOption( int argc, char** argv, int& argument, tut::ApplicationOptions& options, bool& /*valid*/ ) {
+	if ( strcmp( argv[ argument ], "--max-threads" ) == 0 && argument + 1 < argc ) {
+		options.RecordThreads = ( uint32_t )strtoul( argv[ ++argument ], nullptr, 10 );
+		return true;
+	}
+
+	return false;
+}
+
+}
 
 int main( int argc, char** argv ) {
-	std::unique_ptr<tut::HelloTriangleApplication> application = std::make_unique<tut::HelloTriangleApplication>();
+	if ( argc > 1 && strcmp( argv[ 1 ], "--bench-handles" ) == 0 ) {
+		return tut::Benchmarks::RunHandleBenchmark();
+	}
+
+	if ( argc > 2 && strcmp( argv[ 1 ], "--pack-shaders" ) == 0 ) {
+		std::vector<std::string> shaderFiles( argv + 3, argv + argc );
+		return tut::ShaderStore::Pack( argv[ 2 ], shaderFiles, std::cout ) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if ( argc == 4 && strcmp( argv[ 1 ], "--convert-mesh" ) == 0 ) {
+		return tut::MeshFile::Convert( argv[ 2 ], argv[ 3 ], std::cout ) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	//--make-texture out.tex [size]
+	if ( ( argc == 3 || argc == 4 ) && strcmp( argv[ 1 ], "--make-texture" ) == 0 ) {
+		uint32_t size = argc == 4 ? ( uint32_t )strtoul( argv[ 3 ], nullptr, 10 ) : 4096;
+		return tut::TextureFile::Generate( argv[ 2 ], size, std::cout ) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	tut::ApplicationOptions		options;
+	const BenchmarkMode*		benchmark	= nullptr;
+	std::vector<OptionParser>	parsers		= { ParseSharedOption };
+	int							argument	= 1;
+
+	for ( const BenchmarkMode& mode : BENCHMARK_MODES ) {
+		if ( argc > 1 && strcmp( argv[ 1 ], mode.Flag ) == 0 ) {
+			benchmark = &mode;
+		}
+	}
+
+	//--bench-<name> [count] and the shared options, --bench-recording also [--max-threads n]
+	if ( benchmark != nullptr ) {
+		options.Headless		= true;
+		options.ReadbackDepth	= 1;
+
+		if ( benchmark->Enable != nullptr ) {
+			options.*benchmark->Enable = true;
+		}
+
+		argument = 2;
+		if ( benchmark->Count != nullptr ) {
+			options.*benchmark->Count = benchmark->DefaultCount;
+
+			if ( argc > argument && argv[ argument ][ 0 ] != '-' ) {
+				options.*benchmark->Count = std::max( 1u, ( uint32_t )strtoul( argv[ argument++ ], nullptr, 10 ) );
+			}
+		}
+
+		parsers.push_back( ParseBenchmarkOption );
+	//--headless [frames], the headless and the shared options
+	} else if ( argc > 1 && strcmp( argv[ 1 ], "--headless" ) == 0 ) {
+		options.Headless = true;
+
+		argument = 2;
+		if ( argc > argument && argv[ argument ][ 0 ] != '-' ) {
+			options.HeadlessFrames = ( uint32_t )strtoul( argv[ argument++ ], nullptr, 10 );
+		}
+
+		parsers.push_back( ParseHeadlessOption );
+	//The window and the shared options
+	} else {
+		parsers.push_back( ParseWindowOption );
+	}
+
+	for ( ; argument < argc; ++argument ) {
+		bool valid	= true;
+		bool parsed	= false;
+
+		for ( size_t i = 0; i < parsers.size() && !parsed; ++i ) {
+			parsed = parsers[ i ]( argc, argv, argument, options, valid );
+		}
+
+		if ( !parsed ) {
+			std::cerr << "Unknown option " << argv[ argument ] << std::endl;
+		}
+
+		if ( !parsed || !valid ) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ( benchmark != nullptr && benchmark->HostBenchmark != nullptr && benchmark->HostBenchmark() != EXIT_SUCCESS ) {
+		return EXIT_FAILURE;
+	}
+
+	std::unique_ptr<tut::HelloTriangleApplication> application = std::make_unique<tut::HelloTriangleApplication>( options );
 
 	return application->Run();
-}
\ No newline at end of file
+}
@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_seperate_shader_objects : enable
+
+//Maps the UNORM position from the mesh bounds to clip space
+layout( push_constant ) uniform MeshTransform {
+	vec4 scale;
+	vec4 offset;
+} transform;
+
+layout( location = 0 ) in vec4 inPosition;
+layout( location = 1 ) in vec2 inNormal;
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+layout( location = 0 ) out vec3 fragColor;
+
+vec3 DecodeOctahedral( vec2 encoded ) {
+	vec3	normal	= vec3( encoded, 1.0 - abs( encoded.x ) - abs( encoded.y ) );
+	float	fold	= max( -normal.z, 0.0 );
+
+	normal.x += normal.x >= 0.0 ? -fold : fold;
+	normal.y += normal.y >= 0.0 ? -fold : fold;
+
+	return normalize( normal );
+}
+
+void main() {
+	gl_Position = inPosition * transform.scale + transform.offset;
+
+	fragColor = DecodeOctahedral( inNormal ) * 0.5 + 0.5;
+}
\ No newline at end of file
@@ -1,6 +1,24 @@
 #version 450
 #extension GL_ARB_seperate_shader_objects : enable
 
+//Matches CullInstance, only the transform is read here
+struct Instance {
+	vec4	transform;	//xyz translation, w uniform scale
+	vec4	bounds;
+	uint	batch;
+	uint	padding0;
+	uint	padding1;
+	uint	padding2;
+};
+
+layout( std430, set = 0, binding = 0 ) readonly buffer Instances {
+	Instance instances[];
+};
+
+layout( push_constant ) uniform Camera {
+	mat4 viewProjection;
+} camera;
+
 out gl_PerVertex {
 	vec4 gl_Position;
 };
@@ -20,7 +38,9 @@ vec3 colors[ 3 ] = vec3[](
 layout( location = 0 ) out vec3 fragColor;
 
 void main() {
-	gl_Position = vec4( positions[ gl_VertexIndex ], 0.0, 1.0 );
+	vec4 transform = instances[ gl_InstanceIndex ].transform;
+
+	gl_Position = camera.viewProjection * vec4( vec3( positions[ gl_VertexIndex ], 0.0 ) * transform.w + transform.xyz, 1.0 );
 
 	fragColor = colors[ gl_VertexIndex ];
 }
\ No newline at end of file
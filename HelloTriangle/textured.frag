@@ -0,0 +1,45 @@
+#version 450
+#extension GL_ARB_seperate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+//The bindless table's image array and shared sampler, see BindlessTable
+layout( set = 0, binding = 0 ) uniform texture2D textures[];
+layout( set = 0, binding = 2 ) uniform sampler textureSampler;
+
+//One entry per streamed texture, the smallest texture coordinate step per pixel as float bits, see TextureStreamer
+layout( std430, set = 0, binding = 1 ) buffer Feedback {
+	uint steps[];
+} buffers[];
+
+//Matches BindlessDrawConstants, only the texture fields are read here
+layout( push_constant ) uniform Draw {
+	mat4 viewProjection;
+	uint feedbackBuffer;
+	uint instanceBuffer;
+	uint texture;
+	uint textureId;
+} draw;
+
+layout( location = 0 ) in vec3 inColor;
+layout( location = 1 ) in vec2 inTexCoord;
+
+layout( location = 0 ) out vec4 outColor;
+
+const uint NO_TEXTURE = 0xffffffff;
+
+void main() {
+	if ( draw.texture == NO_TEXTURE ) {
+		outColor = vec4( inColor, 1.0 );
+		return;
+	}
+
+	outColor = texture( sampler2D( textures[ draw.texture ], textureSampler ), inTexCoord ) * vec4( inColor, 1.0 );
+
+	//One pixel in 64 writes feedback, positive floats order the same as their bits so atomicMin keeps the sharpest request
+	uvec2 pixel = uvec2( gl_FragCoord.xy );
+	if ( ( ( pixel.x | pixel.y ) & 7 ) == 0 ) {
+		float uvStep = max( length( dFdx( inTexCoord ) ), length( dFdy( inTexCoord ) ) );
+
+		atomicMin( buffers[ draw.feedbackBuffer ].steps[ draw.textureId ], floatBitsToUint( uvStep ) );
+	}
+}